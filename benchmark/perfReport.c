@@ -0,0 +1,390 @@
+/*
+   perfReport: helper of runBenchmarks.sh for the performance regression runs.
+
+   perfReport record caseName ranks startNs endNs infoFile referenceLnL tolerance
+     prints one line of the report for a finished ExaML run: the wall-clock time
+     (startNs and endNs as given by "date +%s%N"), the time ExaML reports itself, and
+     the final log likelihood from the info file compared to the reference value.
+     If ExaML ran with --timers, the time of the phases is taken from the table "by group
+     of timers" of the info file (the maximum over the ranks), otherwise the phase columns
+     are "-". Note that the kernel time is also contained in the modOpt and SPR phases.
+     Use "-" as info file, reference, and tolerance for runs that only have a time
+     (e.g., parsing).
+
+   perfReport compare oldReport newReport [slowdown]
+     matches the lines of two reports by case and number of ranks and prints the ratio of
+     the wall-clock times. Exits with 1 if a case failed in the new report or became slower
+     than slowdown times the old time (DEFAULT: 1.10). Differences below MIN_DIFFERENCE
+     seconds are not counted, they are in the noise of starting the processes. The phases
+     that became slower by the same criterion are listed, they also count as a regression.
+
+   The report is a tab-separated table, lines starting with # are comments:
+
+   case ranks wallSeconds examlSeconds kernels reductions modOpt SPR I/O lnL referenceLnL difference tolerance status
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define LINE_LENGTH 4096
+#define MAX_CASES   1024
+#define MIN_DIFFERENCE 0.05
+#define NUM_PHASES  5
+#define NUM_FIELDS  (9 + NUM_PHASES)
+
+/* the columns of the ExaML timer report by group of timers (timers.c) */
+
+static const char
+  *phaseNames[NUM_PHASES] = {"kernels", "reductions", "modOpt", "SPR", "I/O"};
+
+typedef struct
+{
+  char
+    name[256],
+    status[16];
+
+  int
+    ranks;
+
+  double
+    wallSeconds,
+    phaseSeconds[NUM_PHASES];
+} reportEntry;
+
+static void printUsage(void)
+{
+  printf("Usage: perfReport record caseName ranks startNs endNs infoFile referenceLnL tolerance\n");
+  printf("       perfReport compare oldReport newReport [slowdown]\n");
+}
+
+/* returns 1 and the number after the last occurrence of key in the file, or after the first 
+   separator that follows it (if separator is not '\0'), returns 0 if there is no such number */
+static int findValue(const char *fileName, const char *key, char separator, double *value)
+{
+  FILE
+    *f = fopen(fileName, "r");
+
+  char
+    line[LINE_LENGTH];
+
+  int
+    found = 0;
+
+  if(!f)
+    return 0;
+
+  while(fgets(line, LINE_LENGTH, f))
+    {
+      char
+	*position = strstr(line, key);
+
+      if(position)
+	{
+	  position += strlen(key);
+
+	  if(separator != '\0')
+	    position = strchr(position, separator);
+
+	  if(position && sscanf(position + ((separator != '\0') ? 1 : 0), "%lf", value) == 1)
+	    found = 1;
+	}
+    }
+
+  fclose(f);
+
+  return found;
+}
+
+/* returns 1 and the time of every phase, i.e., the maximum over the ranks of the columns of the 
+   table "Time per process in seconds, by group of timers" of the info file, returns 0 if the 
+   file has no such table */
+static int findPhases(const char *fileName, double *phaseSeconds)
+{
+  FILE
+    *f = fopen(fileName, "r");
+
+  char
+    line[LINE_LENGTH];
+
+  int
+    columns[NUM_PHASES + 1],
+    numberOfColumns = 0,
+    found = 0,
+    i;
+
+  if(!f)
+    return 0;
+
+  for(i = 0; i < NUM_PHASES; i++)
+    phaseSeconds[i] = 0.0;
+
+  while(fgets(line, LINE_LENGTH, f))
+    if(strstr(line, "by group of timers"))
+      {
+	found = 1;
+	break;
+      }
+
+  /* the header line after an empty line maps the columns to the phases, 
+     the lines per rank follow until the next empty line */
+
+  while(found && fgets(line, LINE_LENGTH, f))
+    {
+      char
+	*token = strtok(line, " \t\n");
+
+      if(!token)
+	{
+	  if(numberOfColumns > 0)
+	    break;
+	  continue;
+	}
+
+      if(numberOfColumns == 0)
+	{
+	  for(token = strtok((char *)NULL, " \t\n"); token && numberOfColumns <= NUM_PHASES; token = strtok((char *)NULL, " \t\n"))
+	    {
+	      columns[numberOfColumns] = -1;
+
+	      for(i = 0; i < NUM_PHASES; i++)
+		if(strcmp(token, phaseNames[i]) == 0)
+		  columns[numberOfColumns] = i;
+
+	      numberOfColumns++;
+	    }
+	}
+      else
+	{
+	  for(i = 0, token = strtok((char *)NULL, " \t\n"); token && i < numberOfColumns; i++, token = strtok((char *)NULL, " \t\n"))
+	    if(columns[i] >= 0 && atof(token) > phaseSeconds[columns[i]])
+	      phaseSeconds[columns[i]] = atof(token);
+	}
+    }
+
+  fclose(f);
+
+  return found && numberOfColumns > 0;
+}
+
+/* formats the phase columns of the report */
+static void printPhases(char *buffer, const double *phaseSeconds, int found)
+{
+  int
+    i;
+
+  buffer[0] = '\0';
+
+  for(i = 0; i < NUM_PHASES; i++)
+    {
+      if(found)
+	sprintf(buffer + strlen(buffer), "%.3f\t", phaseSeconds[i]);
+      else
+	strcat(buffer, "-\t");
+    }
+}
+
+static int record(char *argv[])
+{
+  const char
+    *caseName = argv[2],
+    *infoFile = argv[6],
+    *status;
+
+  char
+    phases[NUM_PHASES * 32];
+
+  int
+    ranks = atoi(argv[3]);
+
+  double
+    wallSeconds = (atof(argv[5]) - atof(argv[4])) / 1.0e9,
+    examlSeconds = 0.0,
+    lnL = 0.0,
+    reference,
+    tolerance,
+    difference,
+    phaseSeconds[NUM_PHASES];
+
+  /* only a time */
+
+  if(strcmp(infoFile, "-") == 0)
+    {
+      printPhases(phases, (const double *)NULL, 0);
+      printf("%s\t%d\t%.3f\t-\t%s-\t-\t-\t-\tOK\n", caseName, ranks, wallSeconds, phases);
+      return 0;
+    }
+
+  reference = atof(argv[7]);
+  tolerance = atof(argv[8]);
+
+  /* ExaML writes the time of the tree evaluation (-f e) or of the search to the info file,
+     e.g., "Overall Time for evaluating the likelihhod of 1 trees: 0.19 secs" */
+
+  if(!findValue(infoFile, "Overall Time for evaluating the likelihhod of", ':', &examlSeconds))
+    findValue(infoFile, "Overall Time for 1 Inference", '\0', &examlSeconds);
+
+  printPhases(phases, phaseSeconds, findPhases(infoFile, phaseSeconds));
+
+  if(!findValue(infoFile, "Likelihood of best tree:", '\0', &lnL) && !findValue(infoFile, "Likelihood tree 0:", '\0', &lnL))
+    {
+      printf("%s\t%d\t%.3f\t-\t%s-\t%f\t-\t%f\tERROR\n", caseName, ranks, wallSeconds, phases, reference, tolerance);
+      return 1;
+    }
+
+  difference = lnL - reference;
+
+  status = (fabs(difference) <= tolerance) ? "PASS" : "FAIL";
+
+  printf("%s\t%d\t%.3f\t%.3f\t%s%f\t%f\t%f\t%f\t%s\n", caseName, ranks, wallSeconds, examlSeconds, phases, lnL, reference, difference, tolerance, status);
+
+  return (strcmp(status, "PASS") == 0) ? 0 : 1;
+}
+
+static int readReport(const char *fileName, reportEntry *entries)
+{
+  FILE
+    *f = fopen(fileName, "r");
+
+  char
+    line[LINE_LENGTH];
+
+  int
+    n = 0;
+
+  if(!f)
+    {
+      printf("Error, could not open report %s\n", fileName);
+      exit(2);
+    }
+
+  while(fgets(line, LINE_LENGTH, f) && n < MAX_CASES)
+    {
+      char
+	*fields[NUM_FIELDS],
+	*token;
+
+      int
+	i = 0,
+	k;
+
+      if(line[0] == '#' || line[0] == '\n')
+	continue;
+
+      line[strcspn(line, "\n")] = '\0';
+
+      for(token = strtok(line, "\t"); token && i < NUM_FIELDS; token = strtok((char *)NULL, "\t"))
+	fields[i++] = token;
+
+      if(i != NUM_FIELDS)
+	continue;
+
+      strncpy(entries[n].name, fields[0], sizeof(entries[n].name) - 1);
+      entries[n].name[sizeof(entries[n].name) - 1] = '\0';
+      entries[n].ranks = atoi(fields[1]);
+      entries[n].wallSeconds = atof(fields[2]);
+
+      /* -1.0 for phases without a time */
+
+      for(k = 0; k < NUM_PHASES; k++)
+	entries[n].phaseSeconds[k] = (strcmp(fields[4 + k], "-") == 0) ? -1.0 : atof(fields[4 + k]);
+
+      strncpy(entries[n].status, fields[NUM_FIELDS - 1], sizeof(entries[n].status) - 1);
+      entries[n].status[sizeof(entries[n].status) - 1] = '\0';
+      n++;
+    }
+
+  fclose(f);
+
+  return n;
+}
+
+/* returns 1 if the time became slower than slowdown times the old time */
+static int slower(double oldSeconds, double newSeconds, double slowdown)
+{
+  return oldSeconds > 0.0 && newSeconds > slowdown * oldSeconds && newSeconds - oldSeconds > MIN_DIFFERENCE;
+}
+
+static int compare(int argc, char *argv[])
+{
+  static reportEntry
+    oldEntries[MAX_CASES],
+    newEntries[MAX_CASES];
+
+  int
+    i,
+    j,
+    k,
+    regressions = 0,
+    numberOfOld = readReport(argv[2], oldEntries),
+    numberOfNew = readReport(argv[3], newEntries);
+
+  double
+    slowdown = (argc > 4) ? atof(argv[4]) : 1.10;
+
+  printf("# case\tranks\toldWallSeconds\tnewWallSeconds\tratio\tstatus\tslowerPhases\n");
+
+  for(i = 0; i < numberOfNew; i++)
+    {
+      const reportEntry
+	*n = &newEntries[i],
+	*o = (reportEntry *)NULL;
+
+      const char
+	*status;
+
+      char
+	slowerPhases[NUM_PHASES * 32] = "";
+
+      for(j = 0; j < numberOfOld; j++)
+	if(oldEntries[j].ranks == n->ranks && strcmp(oldEntries[j].name, n->name) == 0)
+	  o = &oldEntries[j];
+
+      if(strcmp(n->status, "PASS") != 0 && strcmp(n->status, "OK") != 0)
+	{
+	  status = n->status;
+	  regressions++;
+	}
+      else
+	{
+	  if(o)
+	    for(k = 0; k < NUM_PHASES; k++)
+	      if(slower(o->phaseSeconds[k], n->phaseSeconds[k], slowdown))
+		sprintf(slowerPhases + strlen(slowerPhases), "%s%s(%.2f)", (slowerPhases[0] != '\0') ? "," : "",
+			phaseNames[k], n->phaseSeconds[k] / o->phaseSeconds[k]);
+
+	  if(o && (slower(o->wallSeconds, n->wallSeconds, slowdown) || slowerPhases[0] != '\0'))
+	    {
+	      status = "SLOWER";
+	      regressions++;
+	    }
+	  else
+	    status = "OK";
+	}
+
+      if(slowerPhases[0] == '\0')
+	strcpy(slowerPhases, "-");
+
+      if(o)
+	printf("%s\t%d\t%.3f\t%.3f\t%.3f\t%s\t%s\n", n->name, n->ranks, o->wallSeconds, n->wallSeconds,
+	       (o->wallSeconds > 0.0) ? n->wallSeconds / o->wallSeconds : 0.0, status, slowerPhases);
+      else
+	printf("%s\t%d\t-\t%.3f\t-\t%s\t-\n", n->name, n->ranks, n->wallSeconds, status);
+    }
+
+  return (regressions > 0) ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+  if(argc == 9 && strcmp(argv[1], "record") == 0)
+    return record(argv);
+
+  if((argc == 4 || argc == 5) && strcmp(argv[1], "compare") == 0)
+    return compare(argc, argv);
+
+  printUsage();
+
+  return 2;
+}
@@ -0,0 +1,134 @@
+#!/bin/sh
+#
+# Performance regression runs on the data sets that come with the parser.
+#
+# Parses the alignments in ../parser, runs ExaML for every line of references.txt with
+# 1, 2, 4, and 8 MPI ranks, and writes a tab-separated report with the wall-clock time,
+# the time reported by ExaML, the time per phase (ExaML runs with --timers), and the final
+# log likelihood compared to the reference (see perfReport.c). Two reports, e.g., of two
+# versions, are compared with the following command, which also lists the slower phases:
+#
+#   ./perfReport compare old.tsv new.tsv
+#
+# Usage: ./runBenchmarks.sh [-e examlBinary] [-r "1 2 4 8"] [-o report.tsv] [-w workDirectory]
+#
+# The MPI launcher is taken from the environment variable MPIRUN, e.g., use
+# MPIRUN="mpirun --oversubscribe" to run more ranks than cores with OpenMPI.
+# Exits with 1 if a run failed or did not reproduce its reference log likelihood.
+
+benchDir=$(cd "$(dirname "$0")" && pwd)
+parserDir="$benchDir/../parser"
+examlDir="$benchDir/../examl"
+
+examl="$examlDir/examl-AVX"
+ranksList="1 2 4 8"
+report="$benchDir/report.tsv"
+workDir="${TMPDIR:-/tmp}/examl-benchmark.$$"
+mpirun="${MPIRUN:-mpirun}"
+
+while getopts "e:r:o:w:h" option
+do
+    case $option in
+	e) examl="$OPTARG" ;;
+	r) ranksList="$OPTARG" ;;
+	o) report="$OPTARG" ;;
+	w) workDir="$OPTARG" ;;
+	*) sed -n '3,17s/^# \{0,1\}//p' "$0"; exit 2 ;;
+    esac
+done
+
+case $examl in
+    /*) ;;
+    *) examl="$(pwd)/$examl" ;;
+esac
+
+case $report in
+    /*) ;;
+    *) report="$(pwd)/$report" ;;
+esac
+
+if [ ! -x "$examl" ]
+then
+    echo "ExaML binary $examl not found, please build it first or use -e"
+    exit 2
+fi
+
+# the parser and the report helper are built if necessary
+
+if [ ! -x "$parserDir/parse-examl" ]
+then
+    make -C "$parserDir" -f Makefile.SSE3.gcc > /dev/null || exit 2
+fi
+
+if [ ! -x "$benchDir/perfReport" ]
+then
+    make -C "$benchDir" -f Makefile.gcc > /dev/null || exit 2
+fi
+
+mkdir -p "$workDir" && cd "$workDir" || exit 2
+
+failed=0
+
+{
+    echo "# ExaML performance report"
+    echo "# binary: $examl"
+    echo "# ranks: $ranksList"
+    echo "# host: $(uname -n)"
+    printf "# case\tranks\twallSeconds\texamlSeconds\tkernels\treductions\tmodOpt\tSPR\tI/O\tlnL\treferenceLnL\tdifference\ttolerance\tstatus\n"
+} > "$report"
+
+# parse alignmentName parserArguments
+
+parse()
+{
+    name=$1
+    shift
+
+    rm -f "$name.binary" "RAxML_info.$name"
+
+    start=$(date +%s%N)
+    "$parserDir/parse-examl" "$@" -n "$name" > "parse.$name.out" 2>&1
+    end=$(date +%s%N)
+
+    if [ -f "$name.binary" ]
+    then
+	"$benchDir/perfReport" record "parse.$name" 1 "$start" "$end" - - - >> "$report"
+    else
+	printf "parse.%s\t1\t-\t-\t-\t-\t-\t-\t-\t-\t-\t-\t-\tERROR\n" "$name" >> "$report"
+	failed=1
+    fi
+}
+
+parse dna -s "$parserDir/dna.phy.dat" -m DNA
+parse gallotia -s "$parserDir/gallotia.phy" -q "$parserDir/gallotia.part" -p "$parserDir/gallotia.map"
+
+# the ExaML runs
+
+grep -v '^#' "$benchDir/references.txt" > cases.txt
+
+while read caseName alignment startingTree model mode reference tolerance
+do
+    if [ -z "$caseName" ]
+    then
+	continue
+    fi
+
+    for ranks in $ranksList
+    do
+	runName="$caseName.$ranks"
+
+	rm -f ExaML_*".$runName" ExaML_*".$runName".* ExaML_*".${runName}_"*
+
+	start=$(date +%s%N)
+	$mpirun -np "$ranks" "$examl" -s "$alignment.binary" -t "$parserDir/$startingTree" -m "$model" -f "$mode" -n "$runName" --timers < /dev/null > "$runName.out" 2>&1
+	end=$(date +%s%N)
+
+	"$benchDir/perfReport" record "$caseName" "$ranks" "$start" "$end" "ExaML_info.$runName" "$reference" "$tolerance" >> "$report" || failed=1
+    done
+done < cases.txt
+
+cat "$report"
+echo
+echo "Report written to $report, the output of the runs is in $workDir"
+
+exit $failed
@@ -0,0 +1,886 @@
+#include <unistd.h>
+
+#include <math.h>
+#include <time.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include "axml.h"
+#include <immintrin.h>
+
+
+/*
+   AVX-512 kernels of the GAMMA model for DNA and protein data (including LG4), only
+   compiled for the AVX512 kernel set of Makefile.MULTI.gcc (-D__AVX512), see cpuDispatch.c.
+   They only use AVX-512F instructions.
+
+   DNA: a zmm register holds the 4 states of 2 rate categories, hence a site fits into 2 registers.
+   The P matrices are transposed once per call, such that the vector-matrix products are
+   4 broadcasts (_mm512_permutex_pd) and fused multiply-adds per register.
+
+   Protein: the 20 states of a rate category are padded to 24 (3 registers) in the tables that
+   are computed once per call (transposed P matrices, eigenvectors, tip vectors), the padding is zero.
+   The last 4 states of a rate are written with a masked store instead of a scalar tail.
+
+   The scaling checks use the mask compare and scale a site if all its entries are below minlikelihood,
+   just as the AVX kernels.
+*/
+
+#define PROT_ROW     24
+#define PROT_MATRIX  (20 * PROT_ROW)
+#define PROT_TAIL    0x0F
+
+/*********************************************************************************************/
+/* DNA */
+
+/* t[p * 32 + j * 8 + h * 4 + l] = P[(2 * p + h) * 16 + l * 4 + j] for the rate pairs p = 0, 1 */
+
+static void transposeDNA(const double *P, double *t)
+{
+  int
+    p,
+    h,
+    j,
+    l;
+
+  for(p = 0; p < 2; p++)
+    for(j = 0; j < 4; j++)
+      for(h = 0; h < 2; h++)
+	for(l = 0; l < 4; l++)
+	  t[p * 32 + j * 8 + h * 4 + l] = P[(2 * p + h) * 16 + l * 4 + j];
+}
+
+/* multiplies the 2 rates of x with their P matrices in t */
+
+static inline __m512d transformDNA(__m512d x, const double *t)
+{
+  __m512d
+    a = _mm512_mul_pd(_mm512_permutex_pd(x, 0x00), _mm512_load_pd(&t[0]));
+
+  a = _mm512_fmadd_pd(_mm512_permutex_pd(x, 0x55), _mm512_load_pd(&t[8]), a);
+  a = _mm512_fmadd_pd(_mm512_permutex_pd(x, 0xAA), _mm512_load_pd(&t[16]), a);
+  a = _mm512_fmadd_pd(_mm512_permutex_pd(x, 0xFF), _mm512_load_pd(&t[24]), a);
+
+  return a;
+}
+
+static inline __m512d eigenDNA(__m512d c, const __m512d *ev)
+{
+  __m512d
+    x = _mm512_mul_pd(_mm512_permutex_pd(c, 0x00), ev[0]);
+
+  x = _mm512_fmadd_pd(_mm512_permutex_pd(c, 0x55), ev[1], x);
+  x = _mm512_fmadd_pd(_mm512_permutex_pd(c, 0xAA), ev[2], x);
+  x = _mm512_fmadd_pd(_mm512_permutex_pd(c, 0xFF), ev[3], x);
+
+  return x;
+}
+
+static void tipTableDNA(const double *tipVector, const double *t, double *ump)
+{
+  int
+    s;
+
+  for(s = 0; s < 16; s++)
+    {
+      __m512d
+	x = _mm512_broadcast_f64x4(_mm256_loadu_pd(&tipVector[4 * s]));
+
+      _mm512_store_pd(&ump[16 * s],     transformDNA(x, t));
+      _mm512_store_pd(&ump[16 * s + 8], transformDNA(x, &t[32]));
+    }
+}
+
+static inline boolean scaleDNA(__m512d *v0, __m512d *v1)
+{
+  const __m512d
+    minlikelihood_avx512 = _mm512_set1_pd(minlikelihood),
+    twoto = _mm512_set1_pd(twotothe256);
+
+  __mmask8
+    m0 = _mm512_cmp_pd_mask(_mm512_abs_pd(*v0), minlikelihood_avx512, _CMP_LT_OS),
+    m1 = _mm512_cmp_pd_mask(_mm512_abs_pd(*v1), minlikelihood_avx512, _CMP_LT_OS);
+
+  if((m0 & m1) != 0xFF)
+    return FALSE;
+
+  *v0 = _mm512_mul_pd(*v0, twoto);
+  *v1 = _mm512_mul_pd(*v1, twoto);
+
+  return TRUE;
+}
+
+void newviewGTRGAMMA_AVX512(int tipCase,
+			    double *x1, double *x2, double *x3,
+			    double *extEV, double *tipVector,
+			    int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+			    const size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling)
+{
+  double
+    lt[64] __attribute__ ((aligned (BYTE_ALIGNMENT))),
+    rt[64] __attribute__ ((aligned (BYTE_ALIGNMENT))),
+    umpX1[256] __attribute__ ((aligned (BYTE_ALIGNMENT))),
+    umpX2[256] __attribute__ ((aligned (BYTE_ALIGNMENT)));
+
+  __m512d
+    ev[4];
+
+  size_t
+    i;
+
+  int
+    l,
+    addScale = 0;
+
+  transposeDNA(left, lt);
+  transposeDNA(right, rt);
+
+  for(l = 0; l < 4; l++)
+    ev[l] = _mm512_broadcast_f64x4(_mm256_loadu_pd(&extEV[l * 4]));
+
+  switch(tipCase)
+    {
+    case TIP_TIP:
+      tipTableDNA(tipVector, lt, umpX1);
+      tipTableDNA(tipVector, rt, umpX2);
+
+      for(i = 0; i < n; i++)
+	{
+	  double
+	    *u1 = &umpX1[16 * tipX1[i]],
+	    *u2 = &umpX2[16 * tipX2[i]];
+
+	  _mm512_storeu_pd(&x3[16 * i],     eigenDNA(_mm512_mul_pd(_mm512_load_pd(&u1[0]), _mm512_load_pd(&u2[0])), ev));
+	  _mm512_storeu_pd(&x3[16 * i + 8], eigenDNA(_mm512_mul_pd(_mm512_load_pd(&u1[8]), _mm512_load_pd(&u2[8])), ev));
+	}
+      break;
+    case TIP_INNER:
+      tipTableDNA(tipVector, lt, umpX1);
+
+      for(i = 0; i < n; i++)
+	{
+	  double
+	    *u1 = &umpX1[16 * tipX1[i]];
+
+	  __m512d
+	    v0 = eigenDNA(_mm512_mul_pd(_mm512_load_pd(&u1[0]), transformDNA(_mm512_loadu_pd(&x2[16 * i]), &rt[0])), ev),
+	    v1 = eigenDNA(_mm512_mul_pd(_mm512_load_pd(&u1[8]), transformDNA(_mm512_loadu_pd(&x2[16 * i + 8]), &rt[32])), ev);
+
+	  if(scaleDNA(&v0, &v1))
+	    {
+	      if(useFastScaling)
+		addScale += wgt[i];
+	      else
+		ex3[i] += 1;
+	    }
+
+	  _mm512_storeu_pd(&x3[16 * i],     v0);
+	  _mm512_storeu_pd(&x3[16 * i + 8], v1);
+	}
+      break;
+    case INNER_INNER:
+      for(i = 0; i < n; i++)
+	{
+	  __m512d
+	    v0 = eigenDNA(_mm512_mul_pd(transformDNA(_mm512_loadu_pd(&x1[16 * i]), &lt[0]),
+					transformDNA(_mm512_loadu_pd(&x2[16 * i]), &rt[0])), ev),
+	    v1 = eigenDNA(_mm512_mul_pd(transformDNA(_mm512_loadu_pd(&x1[16 * i + 8]), &lt[32]),
+					transformDNA(_mm512_loadu_pd(&x2[16 * i + 8]), &rt[32])), ev);
+
+	  if(scaleDNA(&v0, &v1))
+	    {
+	      if(useFastScaling)
+		addScale += wgt[i];
+	      else
+		ex3[i] += 1;
+	    }
+
+	  _mm512_storeu_pd(&x3[16 * i],     v0);
+	  _mm512_storeu_pd(&x3[16 * i + 8], v1);
+	}
+      break;
+    default:
+      assert(0);
+    }
+
+  *scalerIncrement = addScale;
+}
+
+double evaluateGTRGAMMA_AVX512(int *wptr,
+			       double *x1, double *x2,
+			       double *tipVector,
+			       unsigned char *tipX1, const size_t n, double *diagptable, double *siteLikelihoods)
+{
+  double
+    sum = 0.0,
+    term;
+
+  size_t
+    i;
+
+  __m512d
+    d0 = _mm512_loadu_pd(&diagptable[0]),
+    d1 = _mm512_loadu_pd(&diagptable[8]);
+
+  if(tipX1)
+    {
+      double
+	tipD[256] __attribute__ ((aligned (BYTE_ALIGNMENT)));
+
+      int
+	s;
+
+      /* the tip vectors times the diagonal of the P matrix */
+
+      for(s = 0; s < 16; s++)
+	{
+	  __m512d
+	    tv = _mm512_broadcast_f64x4(_mm256_loadu_pd(&tipVector[4 * s]));
+
+	  _mm512_store_pd(&tipD[16 * s],     _mm512_mul_pd(tv, d0));
+	  _mm512_store_pd(&tipD[16 * s + 8], _mm512_mul_pd(tv, d1));
+	}
+
+      for(i = 0; i < n; i++)
+	{
+	  double
+	    *d = &tipD[16 * tipX1[i]];
+
+	  __m512d
+	    t = _mm512_mul_pd(_mm512_load_pd(&d[0]), _mm512_loadu_pd(&x2[16 * i]));
+
+	  t = _mm512_fmadd_pd(_mm512_load_pd(&d[8]), _mm512_loadu_pd(&x2[16 * i + 8]), t);
+
+	  term = LOG(0.25 * FABS(_mm512_reduce_add_pd(t)));
+
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
+	  sum += wptr[i] * term;
+	}
+    }
+  else
+    {
+      for(i = 0; i < n; i++)
+	{
+	  __m512d
+	    t = _mm512_mul_pd(_mm512_mul_pd(_mm512_loadu_pd(&x1[16 * i]), _mm512_loadu_pd(&x2[16 * i])), d0);
+
+	  t = _mm512_fmadd_pd(_mm512_mul_pd(_mm512_loadu_pd(&x1[16 * i + 8]), _mm512_loadu_pd(&x2[16 * i + 8])), d1, t);
+
+	  term = LOG(0.25 * FABS(_mm512_reduce_add_pd(t)));
+
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
+	  sum += wptr[i] * term;
+	}
+    }
+
+  return sum;
+}
+
+void sumGAMMA_AVX512(int tipCase, double *sumtable, double *x1, double *x2, double *tipVector,
+		     unsigned char *tipX1, unsigned char *tipX2, size_t n)
+{
+  size_t
+    i;
+
+  switch(tipCase)
+    {
+    case TIP_TIP:
+      for(i = 0; i < n; i++)
+	{
+	  __m512d
+	    v = _mm512_mul_pd(_mm512_broadcast_f64x4(_mm256_loadu_pd(&tipVector[4 * tipX1[i]])),
+			      _mm512_broadcast_f64x4(_mm256_loadu_pd(&tipVector[4 * tipX2[i]])));
+
+	  _mm512_storeu_pd(&sumtable[16 * i],     v);
+	  _mm512_storeu_pd(&sumtable[16 * i + 8], v);
+	}
+      break;
+    case TIP_INNER:
+      for(i = 0; i < n; i++)
+	{
+	  __m512d
+	    tv = _mm512_broadcast_f64x4(_mm256_loadu_pd(&tipVector[4 * tipX1[i]]));
+
+	  _mm512_storeu_pd(&sumtable[16 * i],     _mm512_mul_pd(tv, _mm512_loadu_pd(&x2[16 * i])));
+	  _mm512_storeu_pd(&sumtable[16 * i + 8], _mm512_mul_pd(tv, _mm512_loadu_pd(&x2[16 * i + 8])));
+	}
+      break;
+    case INNER_INNER:
+      for(i = 0; i < n; i++)
+	{
+	  _mm512_storeu_pd(&sumtable[16 * i],     _mm512_mul_pd(_mm512_loadu_pd(&x1[16 * i]),     _mm512_loadu_pd(&x2[16 * i])));
+	  _mm512_storeu_pd(&sumtable[16 * i + 8], _mm512_mul_pd(_mm512_loadu_pd(&x1[16 * i + 8]), _mm512_loadu_pd(&x2[16 * i + 8])));
+	}
+      break;
+    default:
+      assert(0);
+    }
+}
+
+void coreGTRGAMMA_AVX512(const size_t upper, double *sumtable,
+			 volatile double *ext_dlnLdlz,  volatile double *ext_d2lnLdlz2, double *EIGN, double *gammaRates, double lz, int *wgt)
+{
+  double
+    dlnLdlz = 0.0,
+    d2lnLdlz2 = 0.0,
+    diagptable0[16] __attribute__ ((aligned (BYTE_ALIGNMENT))),
+    diagptable1[16] __attribute__ ((aligned (BYTE_ALIGNMENT))),
+    diagptable2[16] __attribute__ ((aligned (BYTE_ALIGNMENT)));
+
+  size_t
+    i,
+    l;
+
+  __m512d
+    d00,
+    d01,
+    d10,
+    d11,
+    d20,
+    d21;
+
+  for(i = 0; i < 4; i++)
+    {
+      double
+	ki = gammaRates[i],
+	kisqr = ki * ki;
+
+      diagptable0[i * 4] = 1.0;
+      diagptable1[i * 4] = 0.0;
+      diagptable2[i * 4] = 0.0;
+
+      for(l = 1; l < 4; l++)
+	{
+	  diagptable0[i * 4 + l] = EXP(EIGN[l] * ki * lz);
+	  diagptable1[i * 4 + l] = EIGN[l] * ki;
+	  diagptable2[i * 4 + l] = EIGN[l] * EIGN[l] * kisqr;
+	}
+    }
+
+  d00 = _mm512_load_pd(&diagptable0[0]);
+  d01 = _mm512_load_pd(&diagptable0[8]);
+  d10 = _mm512_load_pd(&diagptable1[0]);
+  d11 = _mm512_load_pd(&diagptable1[8]);
+  d20 = _mm512_load_pd(&diagptable2[0]);
+  d21 = _mm512_load_pd(&diagptable2[8]);
+
+  for(i = 0; i < upper; i++)
+    {
+      __m512d
+	t0 = _mm512_mul_pd(d00, _mm512_loadu_pd(&sumtable[16 * i])),
+	t1 = _mm512_mul_pd(d01, _mm512_loadu_pd(&sumtable[16 * i + 8]));
+
+      double
+	inv_Li     = _mm512_reduce_add_pd(_mm512_add_pd(t0, t1)),
+	dlnLidlz   = _mm512_reduce_add_pd(_mm512_fmadd_pd(t1, d11, _mm512_mul_pd(t0, d10))),
+	d2lnLidlz2 = _mm512_reduce_add_pd(_mm512_fmadd_pd(t1, d21, _mm512_mul_pd(t0, d20)));
+
+      inv_Li = 1.0 / FABS(inv_Li);
+
+      dlnLidlz   *= inv_Li;
+      d2lnLidlz2 *= inv_Li;
+
+      dlnLdlz   += wgt[i] * dlnLidlz;
+      d2lnLdlz2 += wgt[i] * (d2lnLidlz2 - dlnLidlz * dlnLidlz);
+    }
+
+  *ext_dlnLdlz   = dlnLdlz;
+  *ext_d2lnLdlz2 = d2lnLdlz2;
+}
+
+
+/*********************************************************************************************/
+/* protein, the plain GAMMA model uses the same matrices for all rates, LG4 one per rate */
+
+/* t[r * PROT_MATRIX + j * PROT_ROW + e] = P[r * 400 + e * 20 + j] */
+
+static void transposePROT(const double *P, double *t)
+{
+  int
+    r,
+    j,
+    e;
+
+  for(r = 0; r < 4; r++)
+    for(j = 0; j < 20; j++)
+      {
+	for(e = 0; e < 20; e++)
+	  t[r * PROT_MATRIX + j * PROT_ROW + e] = P[r * 400 + e * 20 + j];
+	for(; e < PROT_ROW; e++)
+	  t[r * PROT_MATRIX + j * PROT_ROW + e] = 0.0;
+      }
+}
+
+/* the 20 states of x times the transposed P matrix of a rate */
+
+static inline void transformPROT(const double *x, const double *t, __m512d *a)
+{
+  int
+    j;
+
+  a[0] = _mm512_setzero_pd();
+  a[1] = _mm512_setzero_pd();
+  a[2] = _mm512_setzero_pd();
+
+  for(j = 0; j < 20; j++)
+    {
+      __m512d
+	xj = _mm512_set1_pd(x[j]);
+
+      a[0] = _mm512_fmadd_pd(xj, _mm512_load_pd(&t[j * PROT_ROW]),      a[0]);
+      a[1] = _mm512_fmadd_pd(xj, _mm512_load_pd(&t[j * PROT_ROW + 8]),  a[1]);
+      a[2] = _mm512_fmadd_pd(xj, _mm512_load_pd(&t[j * PROT_ROW + 16]), a[2]);
+    }
+}
+
+/* ump[s * 4 * PROT_ROW + r * PROT_ROW + e] for the 23 tip states s */
+
+static void tipTablePROT(double *tipVector[4], const double *t, double *ump)
+{
+  int
+    s,
+    r;
+
+  for(s = 0; s < 23; s++)
+    for(r = 0; r < 4; r++)
+      {
+	__m512d
+	  a[3];
+
+	double
+	  *u = &ump[s * 4 * PROT_ROW + r * PROT_ROW];
+
+	transformPROT(&tipVector[r][20 * s], &t[r * PROT_MATRIX], a);
+
+	_mm512_store_pd(&u[0],  a[0]);
+	_mm512_store_pd(&u[8],  a[1]);
+	_mm512_store_pd(&u[16], a[2]);
+      }
+}
+
+static boolean scalePROT(double *v)
+{
+  const __m512d
+    minlikelihood_avx512 = _mm512_set1_pd(minlikelihood),
+    twoto = _mm512_set1_pd(twotothe256);
+
+  __mmask8
+    below = 0xFF;
+
+  int
+    l;
+
+  for(l = 0; below == 0xFF && l < 80; l += 8)
+    below &= _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_loadu_pd(&v[l])), minlikelihood_avx512, _CMP_LT_OS);
+
+  if(below != 0xFF)
+    return FALSE;
+
+  for(l = 0; l < 80; l += 8)
+    _mm512_storeu_pd(&v[l], _mm512_mul_pd(_mm512_loadu_pd(&v[l]), twoto));
+
+  return TRUE;
+}
+
+static void newviewPROT_AVX512(int tipCase,
+				    double *x1, double *x2, double *x3, double *extEV[4], double *tipVector[4],
+				    int *ex3, unsigned char *tipX1, unsigned char *tipX2, size_t n,
+				    double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling)
+{
+  double
+    lt[4 * PROT_MATRIX] __attribute__ ((aligned (BYTE_ALIGNMENT))),
+    rt[4 * PROT_MATRIX] __attribute__ ((aligned (BYTE_ALIGNMENT))),
+    ev[4 * PROT_MATRIX] __attribute__ ((aligned (BYTE_ALIGNMENT))),
+    umpX1[23 * 4 * PROT_ROW] __attribute__ ((aligned (BYTE_ALIGNMENT))),
+    umpX2[23 * 4 * PROT_ROW] __attribute__ ((aligned (BYTE_ALIGNMENT))),
+    c[PROT_ROW] __attribute__ ((aligned (BYTE_ALIGNMENT)));
+
+  size_t
+    i;
+
+  int
+    r,
+    e,
+    m,
+    addScale = 0;
+
+  transposePROT(left, lt);
+  transposePROT(right, rt);
+
+  for(r = 0; r < 4; r++)
+    for(e = 0; e < 20; e++)
+      {
+	for(m = 0; m < 20; m++)
+	  ev[r * PROT_MATRIX + e * PROT_ROW + m] = extEV[r][e * 20 + m];
+	for(; m < PROT_ROW; m++)
+	  ev[r * PROT_MATRIX + e * PROT_ROW + m] = 0.0;
+      }
+
+  if(tipX1)
+    tipTablePROT(tipVector, lt, umpX1);
+
+  if(tipX2)
+    tipTablePROT(tipVector, rt, umpX2);
+
+  for(i = 0; i < n; i++)
+    {
+      double
+	*v = &x3[80 * i];
+
+      for(r = 0; r < 4; r++)
+	{
+	  __m512d
+	    a[3],
+	    b[3],
+	    x0 = _mm512_setzero_pd(),
+	    x1v = _mm512_setzero_pd(),
+	    x2v = _mm512_setzero_pd();
+
+	  if(tipX1)
+	    {
+	      double
+		*u = &umpX1[tipX1[i] * 4 * PROT_ROW + r * PROT_ROW];
+
+	      a[0] = _mm512_load_pd(&u[0]);
+	      a[1] = _mm512_load_pd(&u[8]);
+	      a[2] = _mm512_load_pd(&u[16]);
+	    }
+	  else
+	    transformPROT(&x1[80 * i + 20 * r], &lt[r * PROT_MATRIX], a);
+
+	  if(tipX2)
+	    {
+	      double
+		*u = &umpX2[tipX2[i] * 4 * PROT_ROW + r * PROT_ROW];
+
+	      b[0] = _mm512_load_pd(&u[0]);
+	      b[1] = _mm512_load_pd(&u[8]);
+	      b[2] = _mm512_load_pd(&u[16]);
+	    }
+	  else
+	    transformPROT(&x2[80 * i + 20 * r], &rt[r * PROT_MATRIX], b);
+
+	  _mm512_store_pd(&c[0],  _mm512_mul_pd(a[0], b[0]));
+	  _mm512_store_pd(&c[8],  _mm512_mul_pd(a[1], b[1]));
+	  _mm512_store_pd(&c[16], _mm512_mul_pd(a[2], b[2]));
+
+	  for(e = 0; e < 20; e++)
+	    {
+	      double
+		*evRow = &ev[r * PROT_MATRIX + e * PROT_ROW];
+
+	      __m512d
+		ce = _mm512_set1_pd(c[e]);
+
+	      x0  = _mm512_fmadd_pd(ce, _mm512_load_pd(&evRow[0]),  x0);
+	      x1v = _mm512_fmadd_pd(ce, _mm512_load_pd(&evRow[8]),  x1v);
+	      x2v = _mm512_fmadd_pd(ce, _mm512_load_pd(&evRow[16]), x2v);
+	    }
+
+	  _mm512_storeu_pd(&v[20 * r], x0);
+	  _mm512_storeu_pd(&v[20 * r + 8], x1v);
+	  _mm512_mask_storeu_pd(&v[20 * r + 16], PROT_TAIL, x2v);
+	}
+
+      if(tipCase != TIP_TIP && scalePROT(v))
+	{
+	  if(useFastScaling)
+	    addScale += wgt[i];
+	  else
+	    ex3[i] += 1;
+	}
+    }
+
+  if(useFastScaling)
+    *scalerIncrement = addScale;
+}
+
+void newviewGTRGAMMAPROT_AVX512(int tipCase,
+				double *x1, double *x2, double *x3, double *extEV, double *tipVector,
+				int *ex3, unsigned char *tipX1, unsigned char *tipX2, size_t n,
+				double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling)
+{
+  double
+    *EVs[4] = {extEV, extEV, extEV, extEV},
+    *tipVectors[4] = {tipVector, tipVector, tipVector, tipVector};
+
+  assert(tipCase == TIP_TIP || tipCase == TIP_INNER || tipCase == INNER_INNER);
+
+  newviewPROT_AVX512(tipCase, x1, x2, x3, EVs, tipVectors, ex3,
+			  (tipCase == INNER_INNER) ? (unsigned char *)NULL : tipX1,
+			  (tipCase == TIP_TIP) ? tipX2 : (unsigned char *)NULL,
+			  n, left, right, wgt, scalerIncrement, useFastScaling);
+}
+
+void newviewGTRGAMMAPROT_AVX512_LG4(int tipCase,
+				    double *x1, double *x2, double *x3, double *extEV[4], double *tipVector[4],
+				    int *ex3, unsigned char *tipX1, unsigned char *tipX2, size_t n,
+				    double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling)
+{
+  assert(tipCase == TIP_TIP || tipCase == TIP_INNER || tipCase == INNER_INNER);
+
+  newviewPROT_AVX512(tipCase, x1, x2, x3, extEV, tipVector, ex3,
+			  (tipCase == INNER_INNER) ? (unsigned char *)NULL : tipX1,
+			  (tipCase == TIP_TIP) ? tipX2 : (unsigned char *)NULL,
+			  n, left, right, wgt, scalerIncrement, useFastScaling);
+}
+
+/* the weights of the rates (LG4) and the factor of the site likelihood are applied to the diagonal */
+
+static double evaluatePROT_AVX512(int *wptr, double *x1, double *x2, double *tipVector[4],
+				       unsigned char *tipX1, size_t n, double *diagptable, const double *weights, const double factor, double *siteLikelihoods)
+{
+  double
+    sum = 0.0,
+    term,
+    d[80] __attribute__ ((aligned (BYTE_ALIGNMENT)));
+
+  size_t
+    i;
+
+  int
+    r,
+    l;
+
+  for(r = 0; r < 4; r++)
+    for(l = 0; l < 20; l++)
+      d[r * 20 + l] = diagptable[r * 20 + l] * weights[r];
+
+  if(tipX1)
+    {
+      double
+	tipD[23 * 80] __attribute__ ((aligned (BYTE_ALIGNMENT)));
+
+      int
+	s;
+
+      for(s = 0; s < 23; s++)
+	for(r = 0; r < 4; r++)
+	  for(l = 0; l < 20; l++)
+	    tipD[s * 80 + r * 20 + l] = tipVector[r][20 * s + l] * d[r * 20 + l];
+
+      for(i = 0; i < n; i++)
+	{
+	  double
+	    *t = &tipD[80 * tipX1[i]],
+	    *right = &x2[80 * i];
+
+	  __m512d
+	    tv = _mm512_mul_pd(_mm512_load_pd(&t[0]), _mm512_loadu_pd(&right[0]));
+
+	  for(l = 8; l < 80; l += 8)
+	    tv = _mm512_fmadd_pd(_mm512_load_pd(&t[l]), _mm512_loadu_pd(&right[l]), tv);
+
+	  term = LOG(factor * FABS(_mm512_reduce_add_pd(tv)));
+
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
+	  sum += wptr[i] * term;
+	}
+    }
+  else
+    {
+      for(i = 0; i < n; i++)
+	{
+	  double
+	    *left  = &x1[80 * i],
+	    *right = &x2[80 * i];
+
+	  __m512d
+	    tv = _mm512_mul_pd(_mm512_mul_pd(_mm512_loadu_pd(&left[0]), _mm512_loadu_pd(&right[0])), _mm512_load_pd(&d[0]));
+
+	  for(l = 8; l < 80; l += 8)
+	    tv = _mm512_fmadd_pd(_mm512_mul_pd(_mm512_loadu_pd(&left[l]), _mm512_loadu_pd(&right[l])), _mm512_load_pd(&d[l]), tv);
+
+	  term = LOG(factor * FABS(_mm512_reduce_add_pd(tv)));
+
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
+	  sum += wptr[i] * term;
+	}
+    }
+
+  return sum;
+}
+
+double evaluateGTRGAMMAPROT_AVX512(int *wptr, double *x1, double *x2, double *tipVector,
+				   unsigned char *tipX1, size_t n, double *diagptable, double *siteLikelihoods)
+{
+  double
+    *tipVectors[4] = {tipVector, tipVector, tipVector, tipVector},
+    weights[4] = {1.0, 1.0, 1.0, 1.0};
+
+  return evaluatePROT_AVX512(wptr, x1, x2, tipVectors, tipX1, n, diagptable, weights, 0.25, siteLikelihoods);
+}
+
+double evaluateGTRGAMMAPROT_AVX512_LG4(int *wptr, double *x1, double *x2, double *tipVector[4],
+				       unsigned char *tipX1, size_t n, double *diagptable, double *weights, double *siteLikelihoods)
+{
+  return evaluatePROT_AVX512(wptr, x1, x2, tipVector, tipX1, n, diagptable, weights, 1.0, siteLikelihoods);
+}
+
+static void sumPROT_AVX512(int tipCase, double *sumtable, double *x1, double *x2, double *tipVector[4],
+				unsigned char *tipX1, unsigned char *tipX2, size_t n)
+{
+  double
+    tips[23 * 80] __attribute__ ((aligned (BYTE_ALIGNMENT)));
+
+  size_t
+    i;
+
+  int
+    s,
+    r,
+    l;
+
+  /* the tip vectors of all rates next to each other, as in the CLVs */
+
+  if(tipCase != INNER_INNER)
+    for(s = 0; s < 23; s++)
+      for(r = 0; r < 4; r++)
+	for(l = 0; l < 20; l++)
+	  tips[s * 80 + r * 20 + l] = tipVector[r][20 * s + l];
+
+  for(i = 0; i < n; i++)
+    {
+      double
+	*left,
+	*right,
+	*sum = &sumtable[80 * i];
+
+      switch(tipCase)
+	{
+	case TIP_TIP:
+	  left  = &tips[80 * tipX1[i]];
+	  right = &tips[80 * tipX2[i]];
+	  break;
+	case TIP_INNER:
+	  left  = &tips[80 * tipX1[i]];
+	  right = &x2[80 * i];
+	  break;
+	case INNER_INNER:
+	  left  = &x1[80 * i];
+	  right = &x2[80 * i];
+	  break;
+	default:
+	  assert(0);
+	}
+
+      for(l = 0; l < 80; l += 8)
+	_mm512_storeu_pd(&sum[l], _mm512_mul_pd(_mm512_loadu_pd(&left[l]), _mm512_loadu_pd(&right[l])));
+    }
+}
+
+void sumGAMMAPROT_AVX512(int tipCase, double *sumtable, double *x1, double *x2, double *tipVector,
+			 unsigned char *tipX1, unsigned char *tipX2, size_t n)
+{
+  double
+    *tipVectors[4] = {tipVector, tipVector, tipVector, tipVector};
+
+  sumPROT_AVX512(tipCase, sumtable, x1, x2, tipVectors, tipX1, tipX2, n);
+}
+
+void sumGAMMAPROT_AVX512_LG4(int tipCase, double *sumtable, double *x1, double *x2, double *tipVector[4],
+			     unsigned char *tipX1, unsigned char *tipX2, size_t n)
+{
+  sumPROT_AVX512(tipCase, sumtable, x1, x2, tipVector, tipX1, tipX2, n);
+}
+
+/* the weights of the rates (LG4) are applied to diagptable0, for the plain GAMMA model they are 1.0 */
+
+static void corePROT_AVX512(double *gammaRates, double *EIGN[4], double *sumtable, const size_t upper, int *wgt,
+			    volatile double *ext_dlnLdlz,  volatile double *ext_d2lnLdlz2, double lz, const double *weights)
+{
+  double
+    dlnLdlz = 0.0,
+    d2lnLdlz2 = 0.0,
+    diagptable0[80] __attribute__ ((aligned (BYTE_ALIGNMENT))),
+    diagptable1[80] __attribute__ ((aligned (BYTE_ALIGNMENT))),
+    diagptable2[80] __attribute__ ((aligned (BYTE_ALIGNMENT)));
+
+  size_t
+    i,
+    l;
+
+  for(i = 0; i < 4; i++)
+    {
+      double
+	ki = gammaRates[i],
+	kisqr = ki * ki;
+
+      diagptable0[i * 20] = weights[i];
+      diagptable1[i * 20] = 0.0;
+      diagptable2[i * 20] = 0.0;
+
+      for(l = 1; l < 20; l++)
+	{
+	  diagptable0[i * 20 + l] = weights[i] * EXP(EIGN[i][l] * ki * lz);
+	  diagptable1[i * 20 + l] = EIGN[i][l] * ki;
+	  diagptable2[i * 20 + l] = EIGN[i][l] * EIGN[i][l] * kisqr;
+	}
+    }
+
+  for(i = 0; i < upper; i++)
+    {
+      double
+	*sum = &sumtable[80 * i],
+	inv_Li,
+	dlnLidlz,
+	d2lnLidlz2;
+
+      __m512d
+	a0 = _mm512_setzero_pd(),
+	a1 = _mm512_setzero_pd(),
+	a2 = _mm512_setzero_pd();
+
+      for(l = 0; l < 80; l += 8)
+	{
+	  __m512d
+	    tmpv = _mm512_mul_pd(_mm512_load_pd(&diagptable0[l]), _mm512_loadu_pd(&sum[l]));
+
+	  a0 = _mm512_add_pd(a0, tmpv);
+	  a1 = _mm512_fmadd_pd(tmpv, _mm512_load_pd(&diagptable1[l]), a1);
+	  a2 = _mm512_fmadd_pd(tmpv, _mm512_load_pd(&diagptable2[l]), a2);
+	}
+
+      inv_Li     = _mm512_reduce_add_pd(a0);
+      dlnLidlz   = _mm512_reduce_add_pd(a1);
+      d2lnLidlz2 = _mm512_reduce_add_pd(a2);
+
+      inv_Li = 1.0 / FABS(inv_Li);
+
+      dlnLidlz   *= inv_Li;
+      d2lnLidlz2 *= inv_Li;
+
+      dlnLdlz   += wgt[i] * dlnLidlz;
+      d2lnLdlz2 += wgt[i] * (d2lnLidlz2 - dlnLidlz * dlnLidlz);
+    }
+
+  *ext_dlnLdlz   = dlnLdlz;
+  *ext_d2lnLdlz2 = d2lnLdlz2;
+}
+
+void coreGTRGAMMAPROT_AVX512(double *gammaRates, double *EIGN, double *sumtable, const size_t upper, int *wgt,
+			     volatile double *ext_dlnLdlz,  volatile double *ext_d2lnLdlz2, double lz)
+{
+  double
+    *EIGNs[4] = {EIGN, EIGN, EIGN, EIGN},
+    weights[4] = {1.0, 1.0, 1.0, 1.0};
+
+  corePROT_AVX512(gammaRates, EIGNs, sumtable, upper, wgt, ext_dlnLdlz, ext_d2lnLdlz2, lz, weights);
+}
+
+void coreGTRGAMMAPROT_AVX512_LG4(double *gammaRates, double *EIGN[4], double *sumtable, const size_t upper, int *wgt,
+				 volatile double *ext_dlnLdlz,  volatile double *ext_d2lnLdlz2, double lz, double *weights)
+{
+  corePROT_AVX512(gammaRates, EIGN, sumtable, upper, wgt, ext_dlnLdlz, ext_d2lnLdlz2, lz, weights);
+}
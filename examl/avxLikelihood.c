@@ -66,8 +66,8 @@ static inline __m256d hadd3(__m256d v)
 void  newviewGTRGAMMA_AVX(int tipCase,
 			 double *x1, double *x2, double *x3,
 			 double *extEV, double *tipVector,
-			 unsigned char *tipX1, unsigned char *tipX2,
-			 const size_t n, double *left, double *right, int *wgt, int *scalerIncrement
+			 int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+			 const size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling
 			 )
 {
  
@@ -242,7 +242,10 @@ void  newviewGTRGAMMA_AVX(int tipCase,
 		xv[1] = _mm256_mul_pd(xv[1], twoto);
 		xv[2] = _mm256_mul_pd(xv[2], twoto);
 		xv[3] = _mm256_mul_pd(xv[3], twoto);
-		addScale += wgt[i];
+		if(useFastScaling)
+		  addScale += wgt[i];
+		else
+		  ex3[i] += 1;
 	      }
 
 	    _mm256_store_pd(&x3[16 * i],      xv[0]);
@@ -305,7 +308,10 @@ void  newviewGTRGAMMA_AVX(int tipCase,
 		xv[1] = _mm256_mul_pd(xv[1], twoto);
 		xv[2] = _mm256_mul_pd(xv[2], twoto);
 		xv[3] = _mm256_mul_pd(xv[3], twoto);
-		addScale += wgt[i];
+		if(useFastScaling)
+		  addScale += wgt[i];
+		else
+		  ex3[i] += 1;
 	      }
 		
 	    _mm256_store_pd(&x3[16 * i],      xv[0]);
@@ -329,8 +335,8 @@ void  newviewGTRGAMMA_AVX(int tipCase,
 
 void newviewGTRCAT_AVX(int tipCase,  double *EV,  int *cptr,
 			   double *x1_start, double *x2_start,  double *x3_start, double *tipVector,
-			   unsigned char *tipX1, unsigned char *tipX2,
-			   size_t n,  double *left, double *right, int *wgt, int *scalerIncrement)
+			   int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+			   size_t n,  double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling)
 {
   double
     *le,
@@ -427,7 +433,10 @@ void newviewGTRCAT_AVX(int tipCase,  double *EV,  int *cptr,
 	  if(_mm256_movemask_pd( v1 ) == 15)
 	    {	     	      
 	      vv = _mm256_mul_pd(vv, twoto);	      
-	      addScale += wgt[i];
+	      if(useFastScaling)
+		addScale += wgt[i];
+	      else
+		ex3[i] += 1;
 	    }       
 	  
 	  _mm256_store_pd(&x3_start[4 * i], vv);	 	  	  
@@ -475,7 +484,10 @@ void newviewGTRCAT_AVX(int tipCase,  double *EV,  int *cptr,
 	  if(_mm256_movemask_pd( v1 ) == 15)
 	    {	
 	      vv = _mm256_mul_pd(vv, twoto);	      
-	      addScale += wgt[i];
+	      if(useFastScaling)
+		addScale += wgt[i];
+	      else
+		ex3[i] += 1;
 	    }	
 
 	  _mm256_store_pd(&x3_start[4 * i], vv);
@@ -493,8 +505,8 @@ void newviewGTRCAT_AVX(int tipCase,  double *EV,  int *cptr,
 void newviewGTRCATPROT_AVX(int tipCase, double *extEV,
 			       int *cptr,
 			       double *x1, double *x2, double *x3, double *tipVector,
-			       unsigned char *tipX1, unsigned char *tipX2,
-			       size_t n, double *left, double *right, int *wgt, int *scalerIncrement)
+			       int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+			       size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling)
 {
   double
     *le, *ri, *v, *vl, *vr;
@@ -698,7 +710,10 @@ void newviewGTRCATPROT_AVX(int tipCase, double *extEV,
 		vv[l / 4] = _mm256_mul_pd(vv[l / 4] , twoto);		    		 
 	  
 	     
-	      addScale += wgt[i];
+	      if(useFastScaling)
+		addScale += wgt[i];
+	      else
+		ex3[i] += 1;
 	     	      
 	    }
 
@@ -799,7 +814,10 @@ void newviewGTRCATPROT_AVX(int tipCase, double *extEV,
 		vv[l / 4] = _mm256_mul_pd(vv[l / 4] , twoto);		    		 
 	  
 	     
-	      addScale += wgt[i];	      
+	      if(useFastScaling)
+		addScale += wgt[i];
+	      else
+		ex3[i] += 1;
 	    }
 
 	  _mm256_store_pd(&v[0], vv[0]);
@@ -1322,8 +1340,8 @@ __m256i
 
 void newviewGTRGAMMAPROT_AVX(int tipCase,
 			     double *x1, double *x2, double *x3, double *extEV, double *tipVector,
-			     unsigned char *tipX1, unsigned char *tipX2, size_t n, 
-			     double *left, double *right, int *wgt, int *scalerIncrement) 
+			     int *ex3, unsigned char *tipX1, unsigned char *tipX2, size_t n, 
+			     double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling) 
 {
   double	
     *uX1, 
@@ -1635,7 +1653,10 @@ void newviewGTRGAMMAPROT_AVX(int tipCase,
 		    _mm256_store_pd(&v[l],_mm256_mul_pd(vv,twotothe256v));
 		  }
 	
-		addScale += wgt[i];				
+		if(useFastScaling)
+		  addScale += wgt[i];
+		else
+		  ex3[i] += 1;
 	
 	      } 
 	  } 
@@ -1801,7 +1822,10 @@ void newviewGTRGAMMAPROT_AVX(int tipCase,
 		  _mm256_store_pd(&v[l],_mm256_mul_pd(vv,twotothe256v));
 		}
 	     
-	      addScale += wgt[i];						    
+	      if(useFastScaling)
+		addScale += wgt[i];
+	      else
+		ex3[i] += 1;
 	    } 
 	}
       break;
@@ -52,6 +52,10 @@
 
 #include <mpi.h>
 
+#if (defined(_USE_OMP) && defined(__linux__))
+#include <sys/syscall.h>
+#endif
+
 #if ! (defined(__ppc) || defined(__powerpc__) || defined(PPC))
 #include <xmmintrin.h>
 /*
@@ -249,6 +253,46 @@ int getUndetermined(int dataType)
   return pLengths[dataType].undetermined;
 }
 
+/* sets the bits of the undetermined sites in the gap vectors of the tips for the memory saving option. 
+   The tips of POMO are likelihood vectors, a site where all individuals of the species are missing 
+   has a vector of ones */
+
+void initTipGapVectors(tree *tr, pInfo *p)
+{
+  size_t
+    i,
+    j,
+    k;
+
+  const size_t
+    states = (size_t)p->states;
+
+  const int
+    undetermined = getUndetermined(p->dataType);
+
+  for(j = 1; j <= (size_t)(tr->mxtips); j++)
+    for(i = 0; i < p->width; i++)
+      {
+	boolean
+	  gap = TRUE;
+
+	if(isPomo(p->dataType))
+	  {
+	    const double
+	      *prob = &(p->xTipCLV[j][i * states]);
+
+	    for(k = 0; gap && k < states; k++)
+	      if(prob[k] != 1.0)
+		gap = FALSE;
+	  }
+	else
+	  gap = (p->yVector[j][i] == undetermined) ? TRUE : FALSE;
+
+	if(gap)
+	  p->gapVector[(size_t)p->gapVectorLength * j + i / 32] |= mask32[i % 32];
+      }
+}
+
 
 
 
@@ -444,6 +488,12 @@ void getxnode (nodeptr p)
       p->x = s->x;
       s->x = 0;
     }
+  else
+    {
+      /* the vector has been evicted because of the CLV budget (see recom.c) and is about to be re-computed */
+      if(!p->x)
+	p->x = 1;
+    }
 
   assert(p->x);
 }
@@ -643,6 +693,8 @@ static boolean setupTree (tree *tr)
 
   tr->bitVectors = (unsigned int **)NULL;
 
+  tr->bInf = (branchInfo *)NULL;
+
   tr->vLength = 0;
 
   tr->h = (hashtable*)NULL;
@@ -669,6 +721,8 @@ static void initAdef(analdef *adef)
   adef->perGeneBranchLengths   = FALSE;  
  
   adef->useCheckpoint          = FALSE;
+  adef->boot                   = 0;
+  adef->multipleRuns           = 1;
    
 #ifdef _BAYESIAN 
   adef->bayesian               = FALSE;
@@ -763,6 +817,7 @@ static void printREADME(void)
       printf("      -m rateHeterogeneityModel\n");
       printf("      -t userStartingTree|-R binaryCheckpointFile|-g constraintTree -p randomNumberSeed\n");
       printf("      [-a]\n");
+      printf("      [-b bootstrapRandomNumberSeed -N numberOfReplicates]\n");
       printf("      [-B numberOfMLtreesToSave]\n"); 
       printf("      [-c numberOfCategories]\n");
       printf("      [-D]\n");
@@ -775,11 +830,32 @@ static void printREADME(void)
       printf("      [-v]\n"); 
       printf("      [-w outputDirectory] \n"); 
       printf("      [--auto-prot=ml|bic|aic|aicc]\n");
+      printf("      [--rebalance=threshold]\n");
+      printf("      [--task-traversal]\n");
+      printf("      [--pars-prescreen=fraction]\n");
+      printf("      [--nni]\n");
+      printf("      [--groups=numberOfGroups]\n");
+      printf("      [--rell=numberOfTrees]\n");
+      printf("      [--clv-cache=numberOfVectors]\n");
+      printf("      [--time-limit=seconds]\n");
+      printf("      [--keep-checkpoints=numberOfFiles]\n");
+      printf("      [--clv-budget=numberOfVectors]\n");
+      printf("      [--timers]\n");
+      printf("      [--perf-counters[=rawEvent:flops,...]]\n");
+      printf("      [--trace=numberOfEvents]\n");
+      printf("      [--kernels=SSE3|AVX|AVX2|AVX512]\n");
+      printf("      [--clv-arena]\n");
+      printf("      [--clv-store=numberOfVectors[,directory]]\n");
       printf("\n");  
       printf("      -a      use the median for the discrete approximation of the GAMMA model of rate heterogeneity\n");
       printf("\n");
       printf("              DEFAULT: OFF\n");
       printf("\n");
+      printf("      -b      Conduct numberOfReplicates (specified via \"-N\") bootstrap searches, the pattern weights\n");
+      printf("              are re-sampled for every replicate starting from this random number seed.\n");
+      printf("              The replicate trees are written to ExaML_bootstrap.runID, with \"--groups\"\n");
+      printf("              the replicates are distributed among the search groups\n");
+      printf("\n");
       printf("      -B      specify the number of best ML trees to save and print to file\n");
       printf("\n");
       printf("      -c      Specify number of distinct rate catgories for ExaML when modelOfEvolution\n");
@@ -830,6 +906,7 @@ static void printREADME(void)
       printf("      -n      Specifies the name of the output file.\n"); 
       printf("\n");
       printf("      -p      Specify a random number seed, required in conjunction with the \"-g\" option for constraint trees\n");
+      printf("              and with more than one search group (\"--groups\")\n");
       printf("\n");
       printf("      -R      read in a binary checkpoint file called ExaML_binaryCheckpoint.RUN_ID_number\n");
       printf("\n");
@@ -852,6 +929,109 @@ static void printREADME(void)
       printf("              You can chose between ML score based selection and the BIC, AIC, and AICc criteria.\n");
       printf("\n");
       printf("              DEFAULT: ml\n");
+      printf("\n");
+      printf("      --rebalance=threshold Measure the time each process spends in the likelihood kernels and re-distribute\n");
+      printf("              alignment sites among processes between SPR cycles when the ratio of maximum to average time exceeds threshold.\n");
+      printf("              Useful on heterogeneous nodes or when the estimated per-site cost does not match the actual one.\n");
+      printf("\n");
+      printf("              DEFAULT: OFF\n");
+      printf("\n");
+      printf("      --task-traversal Hybrid MPI/OpenMP version only: execute independent subtrees of the traversal concurrently\n");
+      printf("              using OpenMP tasks in addition to splitting the sites among threads. Useful for alignments with few sites and many taxa.\n");
+      printf("\n");
+      printf("              DEFAULT: ON if some threads have no sites assigned, OFF otherwise\n");
+      printf("\n");
+      printf("      --pars-prescreen=fraction Rank the insertion positions of the fast SPR phase by their parsimony score\n");
+      printf("              and only evaluate the best fraction (0.0 < fraction <= 1.0) of them with ML.\n");
+      printf("\n");
+      printf("              DEFAULT: OFF\n");
+      printf("\n");
+      printf("      --nni   Sweep over the tree with NNI moves before each fast SPR cycle.\n");
+      printf("\n");
+      printf("              DEFAULT: OFF\n");
+      printf("\n");
+      printf("      --groups=numberOfGroups Split the processes into groups that conduct independent searches, group i starts\n");
+      printf("              from tree i (modulo the number of trees) of the starting tree file. Group i draws its random\n");
+      printf("              number seed from the seed of \"-p\", groups that re-use a tree of a group before them apply random\n");
+      printf("              SPR moves to it, such that they do not repeat the same search. Every group writes\n");
+      printf("              its own output files with the run ID suffix \".groupi\", the trees and likelihoods\n");
+      printf("              of all groups are collected in ExaML_groupTrees.runID\n");
+      printf("\n");
+      printf("              DEFAULT: 1\n");
+      printf("\n");
+      printf("      --rell=numberOfTrees Keep the numberOfTrees best other trees encountered during the search and compute\n");
+      printf("              RELL bootstrap supports for the branches of the best tree from the per-site log likelihoods\n");
+      printf("              of these trees. The best tree with the supports is written to ExaML_RELL.runID\n");
+      printf("\n");
+      printf("              DEFAULT: OFF\n");
+      printf("\n");
+      printf("      --clv-cache=numberOfVectors Keep up to numberOfVectors inner likelihood vectors that are re-oriented\n");
+      printf("              during the SPR search in a cache, such that they can be restored instead of re-computed\n");
+      printf("              when the tree is restored after trying the insertions of a subtree. Every vector requires\n");
+      printf("              as much memory as an inner node of the tree, not available with \"-S\" and \"-M\"\n");
+      printf("\n");
+      printf("              DEFAULT: OFF\n");
+      printf("\n");
+      printf("      --time-limit=seconds Stop the search in time such that it finishes within the given wall-clock time.\n");
+      printf("              Before every SPR cycle the search checks whether the cycle can be completed in time, based\n");
+      printf("              on the duration of the previous one, and otherwise reduces its rearrangement radius or stops.\n");
+      printf("              The best tree found so far is written as the final tree and the search can be continued\n");
+      printf("              from the last checkpoint via \"-R\". 5%% of the time are kept in reserve for the final output\n");
+      printf("\n");
+      printf("              DEFAULT: OFF\n");
+      printf("\n");
+      printf("      --keep-checkpoints=numberOfFiles Only keep the given number of most recent checkpoint files, older\n");
+      printf("              checkpoints are deleted once a newer one has been written completely.\n");
+      printf("              Checkpoints are written to disk in the background by a separate thread while the search\n");
+      printf("              continues, a checkpoint file only appears under its final name once it is complete\n");
+      printf("\n");
+      printf("              DEFAULT: keep all checkpoints\n");
+      printf("\n");
+      printf("      --clv-budget=numberOfVectors Only keep the given number of inner likelihood vectors in memory and recompute\n");
+      printf("              the remaining ones when they are needed, this trades run time for memory on large trees.\n");
+      printf("              Must be at least log2(number of taxa) + 4, can not be used with \"-S\", \"-M\", or \"--clv-cache\"\n");
+      printf("\n");
+      printf("              DEFAULT: OFF\n");
+      printf("\n");
+      printf("      --timers Measure the time of the likelihood kernels per data type and tip case, of the stages of\n");
+      printf("              the model optimization and the SPR cycles, of the I/O, and of the checkpoints, and write\n");
+      printf("              the min/avg/max over the processes and a per-process summary to the info file. With OpenMP,\n");
+      printf("              also write the NUMA placement of the likelihood vectors of each thread\n");
+      printf("\n");
+      printf("              DEFAULT: OFF\n");
+      printf("\n");
+      printf("      --perf-counters[=rawEvent:flops,...] Like \"--timers\" and additionally read the cycles, instructions,\n");
+      printf("              and cache misses of every kernel call with perf_event_open() and report the IPC and the\n");
+      printf("              estimated memory bandwidth per kernel and data type. For FLOP rates, pass the raw floating point\n");
+      printf("              events of the CPU with their operations per event, e.g., on Intel since Skylake:\n");
+      printf("              \"--perf-counters=r01c7:1,r04c7:2,r10c7:4\". Adds a system call per kernel call\n");
+      printf("\n");
+      printf("              DEFAULT: OFF\n");
+      printf("\n");
+      printf("      --trace=numberOfEvents Record the traversals, evaluations, branch length derivatives, checkpoint writes,\n");
+      printf("              and MPI collectives of every process in a ring buffer of numberOfEvents events (24 bytes each)\n");
+      printf("              and write them to ExaML_trace.runID in the Chrome trace event format (chrome://tracing)\n");
+      printf("\n");
+      printf("              DEFAULT: OFF\n");
+      printf("\n");
+      printf("      --kernels=SSE3|AVX|AVX2|AVX512 Use the likelihood kernels for the given instruction set instead of the\n");
+      printf("              fastest ones the CPU supports, only available in examl-MULTI (Makefile.MULTI.gcc)\n");
+      printf("\n");
+      printf("              DEFAULT: the fastest kernels of the CPU\n");
+      printf("\n");
+      printf("      --clv-arena Allocate the inner likelihood vectors, the CLV cache, and the per-partition buffers of every\n");
+      printf("              process from a few large regions backed by transparent huge pages, reuse freed vectors of the\n");
+      printf("              same size class, and write the footprint and fragmentation of the regions to the info file\n");
+      printf("\n");
+      printf("              DEFAULT: OFF\n");
+      printf("\n");
+      printf("      --clv-store=numberOfVectors[,directory] Keep the inner likelihood vectors of every process in a file\n");
+      printf("              in the given directory (DEFAULT: the output directory) and only numberOfVectors of them in memory,\n");
+      printf("              the vectors of the next nodes of a traversal are read ahead while computing. For datasets\n");
+      printf("              that do not fit into memory, the directory should be on a fast local disk.\n");
+      printf("              Can not be used with \"-S\", \"--clv-cache\", or \"--clv-budget\"\n");
+      printf("\n");
+      printf("              DEFAULT: OFF\n");
       printf("\n\n\n\n");
     }
 }
@@ -937,6 +1117,44 @@ static void get_args(int argc, char *argv[], analdef *adef, tree *tr)
   tr->useMedian = FALSE;
   
   tr->autoProteinSelectionType = AUTO_ML;
+
+  tr->dynamicLoadBalance = FALSE;
+  tr->rebalanceThreshold = 1.1;
+  tr->kernelTime = 0.0;
+
+  tr->taskTraversal = FALSE;
+
+  tr->parsimonyPrescreen = FALSE;
+  tr->prescreenFraction = 1.0;
+  tr->insertionSelected = (unsigned char *)NULL;
+
+  tr->nniSearch = FALSE;
+
+  tr->numberOfGroups = 1;
+  tr->rellTrees = 0;
+  tr->groupID = 0;
+
+  tr->clvCacheEntries = 0;
+
+  tr->timeLimit = 0.0;
+
+  tr->keepCheckpoints = 0;
+
+  tr->clvBudget = 0;
+  tr->clvSlot = (int *)NULL;
+
+  tr->timers = FALSE;
+  tr->perfCounters = FALSE;
+  tr->perfCounterEvents = (char *)NULL;
+
+  tr->traceEvents = 0;
+
+  tr->kernelSet = KERNELS_AUTO;
+
+  tr->clvArena = FALSE;
+
+  tr->clvStoreVectors = 0;
+  tr->clvStoreDirectory = (char *)NULL;
   
   /********* tr inits end*************/
 	
@@ -948,9 +1166,25 @@ static void get_args(int argc, char *argv[], analdef *adef, tree *tr)
   while(1)
     {
       static struct 
-	option long_options[2] =
+	option long_options[18] =
 	{	 	 
 	  {"auto-prot",   required_argument, &flag, 1},	   	  	 
+	  {"rebalance",   required_argument, &flag, 1},
+	  {"task-traversal", no_argument,    &flag, 1},
+	  {"pars-prescreen", required_argument, &flag, 1},
+	  {"nni",         no_argument,       &flag, 1},
+	  {"groups",      required_argument, &flag, 1},
+	  {"rell",        required_argument, &flag, 1},
+	  {"clv-cache",   required_argument, &flag, 1},
+	  {"time-limit",  required_argument, &flag, 1},
+	  {"keep-checkpoints", required_argument, &flag, 1},
+	  {"clv-budget",  required_argument, &flag, 1},
+	  {"timers",      no_argument,       &flag, 1},
+	  {"perf-counters", optional_argument, &flag, 1},
+	  {"trace",       required_argument, &flag, 1},
+	  {"kernels",     required_argument, &flag, 1},
+	  {"clv-arena",   no_argument,       &flag, 1},
+	  {"clv-store",   required_argument, &flag, 1},
 	  {0, 0, 0, 0}
 	};
       
@@ -959,7 +1193,7 @@ static void get_args(int argc, char *argv[], analdef *adef, tree *tr)
       
       flag = 0;        
 
-      c = getopt_long(argc, argv, "R:B:e:c:f:i:m:t:g:w:n:s:p:vhMSDa", long_options, &option_index);    
+      c = getopt_long(argc, argv, "R:B:b:N:e:c:f:i:m:t:g:w:n:s:p:vhMSDa", long_options, &option_index);    
     
       if(c == -1)
 	break;
@@ -1010,6 +1244,144 @@ static void get_args(int argc, char *argv[], analdef *adef, tree *tr)
 		  }
 	      }
 	      break;
+	    case 1:
+#if (defined(_USE_OMP) || defined(__MIC_NATIVE))
+	      printf("\nError, dynamic load re-balancing (--rebalance) is not supported by the hybrid MPI/OpenMP and Intel MIC versions\n\n");
+	      errorExit(-1);
+#endif
+	      sscanf(optarg, "%lf", &(tr->rebalanceThreshold));
+	      if(tr->rebalanceThreshold <= 1.0)
+		{
+		  printf("\nError, the re-balancing threshold (max/avg kernel time) must be larger than 1.0\n\n");
+		  errorExit(-1);
+		}
+	      tr->dynamicLoadBalance = TRUE;
+	      break;
+	    case 2:
+#ifndef _USE_OMP
+	      printf("\nError, the task-parallel traversal (--task-traversal) is only supported by the hybrid MPI/OpenMP version\n\n");
+	      errorExit(-1);
+#endif
+	      tr->taskTraversal = TRUE;
+	      break;
+	    case 3:
+	      sscanf(optarg, "%lf", &(tr->prescreenFraction));
+	      if(tr->prescreenFraction <= 0.0 || tr->prescreenFraction > 1.0)
+		{
+		  printf("\nError, the fraction of insertion positions to evaluate with ML must be in (0.0, 1.0]\n\n");
+		  errorExit(-1);
+		}
+	      tr->parsimonyPrescreen = TRUE;
+	      break;
+	    case 4:
+	      tr->nniSearch = TRUE;
+	      break;
+	    case 5:
+	      sscanf(optarg, "%d", &(tr->numberOfGroups));
+	      if(tr->numberOfGroups < 1)
+		{
+		  printf("\nError, the number of search groups must be at least 1\n\n");
+		  errorExit(-1);
+		}
+	      break;
+	    case 6:
+	      sscanf(optarg, "%d", &(tr->rellTrees));
+	      if(tr->rellTrees < 1)
+		{
+		  printf("\nError, the number of trees for computing RELL supports must be at least 1\n\n");
+		  errorExit(-1);
+		}
+	      break;
+	    case 7:
+	      sscanf(optarg, "%d", &(tr->clvCacheEntries));
+	      if(tr->clvCacheEntries < 1)
+		{
+		  printf("\nError, the CLV cache must hold at least 1 vector\n\n");
+		  errorExit(-1);
+		}
+	      break;
+	    case 8:
+	      sscanf(optarg, "%lf", &(tr->timeLimit));
+	      if(tr->timeLimit <= 0.0)
+		{
+		  printf("\nError, the time limit must be larger than 0 seconds\n\n");
+		  errorExit(-1);
+		}
+	      break;
+	    case 9:
+	      sscanf(optarg, "%d", &(tr->keepCheckpoints));
+	      if(tr->keepCheckpoints < 1)
+		{
+		  printf("\nError, at least 1 checkpoint file must be kept\n\n");
+		  errorExit(-1);
+		}
+	      break;
+	    case 10:
+	      sscanf(optarg, "%d", &(tr->clvBudget));
+	      if(tr->clvBudget < 1)
+		{
+		  printf("\nError, the CLV budget must be at least 1 vector\n\n");
+		  errorExit(-1);
+		}
+	      break;
+	    case 11:
+	      tr->timers = TRUE;
+	      break;
+	    case 12:
+	      tr->timers = TRUE;
+	      tr->perfCounters = TRUE;
+	      tr->perfCounterEvents = optarg;
+	      break;
+	    case 13:
+	      {
+		long
+		  events = 0;
+
+		sscanf(optarg, "%ld", &events);
+		if(events < 1)
+		  {
+		    printf("\nError, the trace buffer must hold at least 1 event\n\n");
+		    errorExit(-1);
+		  }
+		tr->traceEvents = (size_t)events;
+	      }
+	      break;
+	    case 14:
+#ifdef _CPU_DISPATCH
+	      tr->kernelSet = kernelSetByName(optarg);
+	      if(tr->kernelSet < 0)
+		{
+		  printf("\nError, unknown likelihood kernels \"%s\", use SSE3, AVX, AVX2, or AVX512\n\n", optarg);
+		  errorExit(-1);
+		}
+#else
+	      printf("\nError, the likelihood kernels can only be selected in examl-MULTI, please build it with Makefile.MULTI.gcc\n\n");
+	      errorExit(-1);
+#endif
+	      break;
+	    case 15:
+	      tr->clvArena = TRUE;
+	      break;
+	    case 16:
+	      {
+		char
+		  *directory = strchr(optarg, ',');
+
+		if(directory)
+		  {
+		    *directory = '\0';
+		    tr->clvStoreDirectory = strdup(directory + 1);
+		  }
+
+		sscanf(optarg, "%d", &(tr->clvStoreVectors));
+
+		if(tr->clvStoreVectors < 1)
+		  {
+		    printf("\nError, the CLV store must keep at least 1 vector in memory\n\n");
+		    errorExit(-1);
+		  }
+	      }
+	      break;
 	    default:
 	      assert(0);
 	    }
@@ -1024,6 +1396,22 @@ static void get_args(int argc, char *argv[], analdef *adef, tree *tr)
 	  case 'a':
 	    tr->useMedian = TRUE;	
 	    break;
+	  case 'b':
+	    sscanf(optarg,"%ld", &(adef->boot));
+	    if(adef->boot <= 0)
+	      {
+		printf("Bootstrap random number seed must be greater than 0!\n");
+		errorExit(-1);
+	      }
+	    break;
+	  case 'N':
+	    sscanf(optarg,"%d", &(adef->multipleRuns));
+	    if(adef->multipleRuns < 1)
+	      {
+		printf("Number of bootstrap replicates must be greater than 0!\n");
+		errorExit(-1);
+	      }
+	    break;
 	  case 'B':
 	    sscanf(optarg,"%d", &(tr->saveBestTrees));
 	    if(tr->saveBestTrees < 0)
@@ -1155,6 +1543,60 @@ static void get_args(int argc, char *argv[], analdef *adef, tree *tr)
 	}
     }
 
+  if(tr->numberOfGroups > 1 && !adef->boot && !seedSet)
+    {
+      if(processID == 0)
+	printf("\nError, you must specify a random number seed via \"-p\" when using more than one search group via \"--groups\"\n");
+      errorExit(-1);
+    }
+
+  if(adef->boot)
+    {
+      if(adef->useCheckpoint || adef->mode != BIG_RAPID_MODE)
+	{
+	  if(processID == 0)
+	    printf("\nError, bootstrapping via \"-b\" can not be used with \"-R\" or \"-f e\"\n");
+	  errorExit(-1);
+	}
+
+      if(tr->rellTrees > 0)
+	{
+	  if(processID == 0)
+	    printf("\nError, RELL supports via \"--rell\" can not be computed for bootstrap replicates\n");
+	  errorExit(-1);
+	}
+    }
+  else
+    {
+      if(adef->multipleRuns > 1)
+	{
+	  if(processID == 0)
+	    printf("\nError, you must specify a bootstrap random number seed via \"-b\" when using \"-N\"\n");
+	  errorExit(-1);
+	}
+    }
+
+  if(tr->clvCacheEntries > 0 && (tr->saveMemory || adef->perGeneBranchLengths))
+    {
+      if(processID == 0)
+	printf("\nError, the CLV cache via \"--clv-cache\" can not be used with \"-S\" or \"-M\"\n");
+      errorExit(-1);
+    }
+
+  if(tr->clvBudget > 0 && (tr->saveMemory || adef->perGeneBranchLengths || tr->clvCacheEntries > 0))
+    {
+      if(processID == 0)
+	printf("\nError, the CLV budget via \"--clv-budget\" can not be used with \"-S\", \"-M\", or \"--clv-cache\"\n");
+      errorExit(-1);
+    }
+
+  if(tr->clvStoreVectors > 0 && (tr->saveMemory || tr->clvCacheEntries > 0 || tr->clvBudget > 0))
+    {
+      if(processID == 0)
+	printf("\nError, the CLV store via \"--clv-store\" can not be used with \"-S\", \"--clv-cache\", or \"--clv-budget\"\n");
+      errorExit(-1);
+    }
+
   if(!byteFileSet)
     {
       if(processID == 0)
@@ -1248,6 +1690,7 @@ static void makeFileNames(void)
   strcpy(treeFileName,         workdir);
   strcpy(binaryCheckpointName, workdir);
   strcpy(modelFileName, workdir);
+  strcpy(bootstrapFileName,    workdir);
    
   strcat(resultFileName,       "ExaML_result.");
   strcat(logFileName,          "ExaML_log.");  
@@ -1255,6 +1698,7 @@ static void makeFileNames(void)
   strcat(binaryCheckpointName, "ExaML_binaryCheckpoint.");
   strcat(modelFileName,        "ExaML_modelFile.");
   strcat(treeFileName,         "ExaML_TreeFile.");
+  strcat(bootstrapFileName,    "ExaML_bootstrap.");
   
   strcat(resultFileName,       run_id);
   strcat(logFileName,          run_id);  
@@ -1262,6 +1706,7 @@ static void makeFileNames(void)
   strcat(binaryCheckpointName, run_id);
   strcat(modelFileName,        run_id);
   strcat(treeFileName,         run_id);
+  strcat(bootstrapFileName,    run_id);
 
   infoFileExists = filexists(infoFileName);
 
@@ -1439,6 +1884,13 @@ void printResult(tree *tr, analdef *adef, boolean finalPrint)
     {
       FILE *logFile;
       char temporaryFileName[1024] = "";
+
+      /* the bootstrap trees are written to their own file by computeBootstraps() */
+
+      if(adef->boot)
+	return;
+
+      startPhaseTimer(TIMER_OUTPUT);
       
       strcpy(temporaryFileName, resultFileName);
       
@@ -1507,6 +1959,8 @@ void printResult(tree *tr, analdef *adef, boolean finalPrint)
 	  exit(-1);
 	  break;
 	}
+
+      stopPhaseTimer(TIMER_OUTPUT);
     }
 }
 
@@ -1525,6 +1979,8 @@ void printLog(tree *tr)
       double t;
       
       t = gettime() - masterTime;
+
+      startPhaseTimer(TIMER_OUTPUT);
       
       logFile = myfopen(logFileName, "ab");
       
@@ -1533,6 +1989,8 @@ void printLog(tree *tr)
       fprintf(logFile, "%f %f\n", t, tr->likelihood);
       
       fclose(logFile);
+
+      stopPhaseTimer(TIMER_OUTPUT);
     }
 	     
 }
@@ -1830,6 +2288,15 @@ static void finalizeInfoFile(tree *tr, analdef *adef)
       switch(adef->mode)
 	{	
 	case BIG_RAPID_MODE:	 
+	  if(adef->boot)
+	    {
+	      /* there is no final tree, only the bootstrap trees */
+	      printBothOpen("\n\nOverall Time for %d Bootstrap replicates %f\n\n", adef->multipleRuns, t);
+	      printBothOpen("Bootstrap trees written to:            %s\n", bootstrapFileName);
+	      printBothOpen("Execution Log File written to:         %s\n", logFileName);
+	      printBothOpen("Execution information file written to: %s\n",infoFileName);
+	      break;
+	    }
 	  printBothOpen("\n\nOverall Time for 1 Inference %f\n", t);
 	  printBothOpen("\nOverall accumulated Time (in case of restarts): %f\n\n", accumulatedTime);
 	  printBothOpen("Likelihood   : %f\n", tr->likelihood);
@@ -1860,6 +2327,8 @@ static void finalizeInfoFile(tree *tr, analdef *adef)
 
 static void clean_MPI_Exit(void)
 {
+  finishCheckpointWriting();
+
   MPI_Barrier(MPI_COMM_WORLD);
   MPI_Finalize();
 }
@@ -1868,7 +2337,7 @@ static void error_MPI_Exit(void)  __attribute__ ((noreturn));
 
 static void error_MPI_Exit(void)
 {
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(comm);
   MPI_Finalize();
 
   exit(1);
@@ -1878,7 +2347,6 @@ static void error_MPI_Exit(void)
 static void initializePartitions(tree *tr)
 { 
   size_t
-    i,
     len, 
     j,    
     width;
@@ -1908,7 +2376,7 @@ static void initializePartitions(tree *tr)
        */
       
       len = 2 * (size_t)tr->mxtips; 
-      tr->partitionData[model].globalScaler       = (unsigned int *)calloc(len, sizeof(unsigned int));
+      tr->partitionData[model].globalScaler       = (unsigned int *)clvCalloc(len * sizeof(unsigned int));
 
 #ifdef _USE_OMP
       tr->partitionData[model].threadGlobalScaler = (unsigned int**) calloc(tr->nThreads, sizeof(unsigned int*));
@@ -2002,7 +2470,7 @@ static void initializePartitions(tree *tr)
       const int span = (size_t)(tr->partitionData[model].states) *
               discreteRateCategories(tr->rateHetModel);
 
-      tr->partitionData[model].sumBuffer = (double *)malloc_aligned(padded_width *
+      tr->partitionData[model].sumBuffer = (double *)clvAlloc(padded_width *
 									   span * sizeof(double));
 
       /* fill padding entries with 1. (will be corrected for with zero site weights in wgt) */
@@ -2012,7 +2480,7 @@ static void initializePartitions(tree *tr)
               tr->partitionData[model].sumBuffer[k] = 1.;
       }
 #else
-      tr->partitionData[model].sumBuffer = (double *)malloc_aligned(width *
+      tr->partitionData[model].sumBuffer = (double *)clvAlloc(width *
 									   (size_t)(tr->partitionData[model].states) *
 									   discreteRateCategories(tr->rateHetModel) *
 									   sizeof(double));
@@ -2027,9 +2495,9 @@ static void initializePartitions(tree *tr)
 	  tr->partitionData[model].gapVectorLength = ((int)width / 32) + 1;
 	  
 	  len = (size_t)tr->partitionData[model].gapVectorLength * 2 * (size_t)tr->mxtips; 
-	  tr->partitionData[model].gapVector = (unsigned int*)calloc(len, sizeof(unsigned int));	  	    	  	  
+	  tr->partitionData[model].gapVector = (unsigned int*)clvCalloc(len * sizeof(unsigned int));	  	    	  	  
 	    
-	  tr->partitionData[model].gapColumn = (double *)malloc_aligned(((size_t)tr->mxtips) *								      
+	  tr->partitionData[model].gapColumn = (double *)clvAlloc(((size_t)tr->mxtips) *								      
 									       ((size_t)(tr->partitionData[model].states)) *
 									       discreteRateCategories(tr->rateHetModel) * sizeof(double));
 	}
@@ -2044,6 +2512,59 @@ static void initializePartitions(tree *tr)
     }
 
 
+#ifdef _USE_OMP
+  /* thread-private P matrix buffers, large enough for any partition */
+  {
+    size_t
+      leftLength = 0,
+      rightLength = 0,
+      tipLength = 0;
+
+    int 
+      t;
+
+    for(model = 0; model < tr->NumberOfModels; model++)
+      {
+	const partitionLengths 
+	  *pl = getPartitionLengths(&(tr->partitionData[model])); 
+
+	if((size_t)pl->leftLength > leftLength)
+	  leftLength = (size_t)pl->leftLength;
+	if((size_t)pl->rightLength > rightLength)
+	  rightLength = (size_t)pl->rightLength;
+	if((size_t)pl->tipVectorLength > tipLength)
+	  tipLength = (size_t)pl->tipVectorLength;
+      }
+
+    tr->threadLeft  = (double **)calloc((size_t)tr->nThreads, sizeof(double *));
+    tr->threadRight = (double **)calloc((size_t)tr->nThreads, sizeof(double *));
+#ifdef __MIC_NATIVE
+    tr->threadUmpLeft  = (double **)calloc((size_t)tr->nThreads, sizeof(double *));
+    tr->threadUmpRight = (double **)calloc((size_t)tr->nThreads, sizeof(double *));
+#endif
+
+    for(t = 0; t < tr->nThreads; t++)
+      {
+	tr->threadLeft[t]  = (double *)malloc_aligned(leftLength * ((size_t)maxCategories + 1) * sizeof(double));
+	tr->threadRight[t] = (double *)malloc_aligned(rightLength * ((size_t)maxCategories + 1) * sizeof(double));
+#ifdef __MIC_NATIVE
+	tr->threadUmpLeft[t]  = (double*)malloc_aligned(4 * tipLength * sizeof(double));
+	tr->threadUmpRight[t] = (double*)malloc_aligned(4 * tipLength * sizeof(double));
+#endif
+      }
+
+    /* threads without any sites would idle during the traversal, 
+       let them work on independent subtrees instead */
+
+    for(t = 0; t < tr->nThreads; t++)
+      if(!tr->threadPartAssigns[t * tr->maxModelsPerThread])
+	tr->taskTraversal = TRUE;
+
+    if(tr->taskTraversal)
+      tr->traversalDeps = (char *)calloc((2 * (size_t)tr->mxtips + 1) * (size_t)tr->nThreads * (size_t)tr->maxModelsPerThread, sizeof(char));
+  }
+#endif
+
   /* set up the averaged frac changes per partition such that no further reading accesses to aliaswgt are necessary
      and we can free the array for the GAMMA model */
  
@@ -2074,7 +2595,7 @@ static void initializePartitions(tree *tr)
 	for(k = 0; k < partition.width; ++k)
 	  modelWeights[model] += (unsigned long) partition.wgt[k]; 
       }
-    MPI_Allreduce(MPI_IN_PLACE, modelWeights, tr->NumberOfModels, MPI_UNSIGNED_LONG, MPI_SUM, MPI_COMM_WORLD); 
+    MPI_Allreduce(MPI_IN_PLACE, modelWeights, tr->NumberOfModels, MPI_UNSIGNED_LONG, MPI_SUM, comm); 
        
     /* determine sum */
     for(model = 0; model < tr->NumberOfModels; ++model)
@@ -2094,20 +2615,8 @@ static void initializePartitions(tree *tr)
   if(tr->saveMemory)
     {
       for(model = 0; model <tr->NumberOfModels; model++)
-	{
-	  int        
-	    undetermined = getUndetermined(tr->partitionData[model].dataType);
-	  	 
-	  width =  tr->partitionData[model].width;
-	    
-	  if(width > 0)
-	    {	   	    	      	    	     
-	      for(j = 1; j <= (size_t)(tr->mxtips); j++)
-		for(i = 0; i < width; i++)
-		  if(tr->partitionData[model].yVector[j][i] == undetermined)
-		    tr->partitionData[model].gapVector[(size_t)tr->partitionData[model].gapVectorLength * j + i / 32] |= mask32[i % 32];	    
-	    }     
-	}
+	if(tr->partitionData[model].width > 0)
+	  initTipGapVectors(tr, &(tr->partitionData[model]));
     }
 }
 
@@ -2156,6 +2665,30 @@ Please set #define NUM_BRANCHES in axml.h to %d (or higher) and recompile %s\n",
   initializePartitions(tr);
 
   initModel(tr);
+
+  if(tr->clvBudget > 0)
+    {
+      if(tr->clvBudget < minimumClvBudget(tr->mxtips))
+	{
+	  if(processID == 0)
+	    printf("\nError, the CLV budget must be at least %d vectors for %d taxa\n", minimumClvBudget(tr->mxtips), tr->mxtips);
+	  error_MPI_Exit();
+	}
+
+      initRecomputation(tr);
+    }
+
+  if(tr->clvStoreVectors > 0)
+    {
+      if(tr->clvStoreVectors < minimumClvStoreVectors(tr->mxtips))
+	{
+	  if(processID == 0)
+	    printf("\nError, the CLV store must keep at least %d vectors in memory for %d taxa\n", minimumClvStoreVectors(tr->mxtips), tr->mxtips);
+	  error_MPI_Exit();
+	}
+
+      initClvStore(tr);
+    }
 }
 
 
@@ -2319,7 +2852,7 @@ static void readByteFile (tree *tr, int commRank, int commSize )
   PartitionAssignment 
     *pAss = NULL; 
   
-  initializePartitionAssignment(&pAss, bFile->partitions, bFile->numPartitions, commSize); 
+  initializePartitionAssignment(&pAss, bFile->partitions, bFile->numPartitions, commSize, tr->rateHetModel); 
   assign(pAss);
 
   if(commRank == 0 )
@@ -2346,21 +2879,362 @@ static void readByteFile (tree *tr, int commRank, int commSize )
 }
 
 #ifdef _USE_OMP
-void allocateXVectors(tree* tr)
-{
-  nodeptr
-    p = tr->start,
-    q = p->back;
 
-  tr->td[0].ti[0].pNumber = p->number;
-  tr->td[0].ti[0].qNumber = q->number;
+#ifndef __MIC_NATIVE
 
-  tr->td[0].count = 1;
+/* 
+   NUMA placement of the site-dependent arrays: 
 
-  computeTraversalInfo(q, &(tr->td[0].ti[0]), &(tr->td[0].count), tr->mxtips, tr->numBranches, FALSE);
+   Linux places a page on the memory node of the thread that touches it first. 
+   Since the master thread reads the alignment data and allocates all vectors, 
+   everything would end up on the socket of the master and the threads on the other 
+   sockets would be limited by the remote memory bandwidth. Hence, we let every thread touch 
+   (or copy) exactly the sites it has been assigned to in tr->threadPartAssigns.
+   Note that this only pays off, if the threads are pinned to cores (e.g., OMP_PROC_BIND=true).
+*/
 
-  traversalInfo
-    *ti = tr->td[0].ti;
+static void copyTipRange(unsigned char *dst, unsigned char *src, size_t tipLength, size_t offset, size_t length, int mxtips)
+{
+  int
+    j;
+
+  for(j = 0; j < mxtips; j++)
+    memcpy(dst + (size_t)j * tipLength + offset, src + (size_t)j * tipLength + offset, length);
+}
+
+static void firstTouchSiteData(tree *tr)
+{
+  int
+    model;
+
+  unsigned char
+    **tipResource = (unsigned char **)calloc((size_t)tr->NumberOfModels, sizeof(unsigned char *)),
+    **tipXResource = (unsigned char **)calloc((size_t)tr->NumberOfModels, sizeof(unsigned char *));
+
+  /* allocate new tip arrays, they will be filled by the threads that own the respective sites */
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      pInfo
+	*p = &(tr->partitionData[model]);
+
+      size_t
+	len = (size_t)tr->mxtips * (size_t)p->width;
+      
+      if(isPomo(p->dataType))
+	{
+	  tipResource[model]  = (unsigned char *)malloc_aligned(len * (size_t)p->states * sizeof(double));
+	  tipXResource[model] = (unsigned char *)malloc_aligned(len * (size_t)p->states * sizeof(double));
+	}
+      else
+	tipResource[model] = (unsigned char *)malloc_aligned(len * sizeof(unsigned char));
+    }
+
+#pragma omp parallel
+  {
+    int
+      m,
+      i,
+      tid = omp_get_thread_num();
+
+    for(m = 0; m < tr->maxModelsPerThread; m++)
+      {
+	Assign
+	  *pAss = tr->threadPartAssigns[tid * tr->maxModelsPerThread + m];
+
+	if(pAss)
+	  {
+	    pInfo
+	      *p = &(tr->partitionData[pAss->partitionId]);
+
+	    size_t
+	      span = (size_t)p->states * discreteRateCategories(tr->rateHetModel),
+	      offset = (size_t)pAss->offset,
+	      width = (size_t)pAss->width;
+
+	    /* inner likelihood vectors and the sumtable */
+	    
+	    for(i = 0; i < tr->mxtips; i++)
+	      if(p->xVector[i] && tr->clvStoreVectors == 0)
+		memset(p->xVector[i] + offset * span, 0, width * span * sizeof(double));
+	   
+	    memset(p->sumBuffer + offset * span, 0, width * span * sizeof(double));
+
+	    /* tips */
+
+	    if(isPomo(p->dataType))
+	      {
+		size_t
+		  bytes = (size_t)p->states * sizeof(double);
+
+		copyTipRange(tipResource[pAss->partitionId], (unsigned char *)p->xResource, (size_t)p->width * bytes, offset * bytes, width * bytes, tr->mxtips);
+		copyTipRange(tipXResource[pAss->partitionId], (unsigned char *)p->xTipVector[1], (size_t)p->width * bytes, offset * bytes, width * bytes, tr->mxtips);
+	      }
+	    else
+	      copyTipRange(tipResource[pAss->partitionId], p->yResource, (size_t)p->width, offset, width, tr->mxtips);
+	  }
+	else
+	  break;
+      }
+  }
+
+  /* replace the tip arrays allocated by the master thread */
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      pInfo
+	*p = &(tr->partitionData[model]);
+
+      int
+	j;
+
+      if(isPomo(p->dataType))
+	{
+	  size_t
+	    tipLength = (size_t)p->width * (size_t)p->states;
+	  
+	  free(p->xResource);
+	  free(p->xTipVector[1]);
+	  
+	  p->xResource = (double *)tipResource[model];
+
+	  for(j = 1; j <= tr->mxtips; j++)
+	    {
+	      p->xTipCLV[j]    = p->xResource + (size_t)(j - 1) * tipLength;
+	      p->xTipVector[j] = (double *)tipXResource[model] + (size_t)(j - 1) * tipLength;
+	    }
+	}
+      else
+	{
+	  free(p->yResource);
+
+	  p->yResource = tipResource[model];
+
+	  for(j = 1; j <= tr->mxtips; j++)
+	    p->yVector[j] = p->yResource + (size_t)(j - 1) * (size_t)p->width;
+	}
+    }
+
+  free(tipResource);
+  free(tipXResource);
+}
+
+#ifdef __linux__
+
+/* 
+   count the pages of [start, start + length) that reside on node and on other nodes, 
+   we directly use the system call such that we don't need to link against libnuma 
+*/
+
+#define PLACEMENT_QUERY_PAGES 1024
+
+static void countPagePlacement(void *start, size_t length, int node, size_t *local, size_t *remote, size_t *untouched)
+{
+  size_t
+    pageSize = (size_t)sysconf(_SC_PAGESIZE),
+    first = (size_t)start / pageSize,
+    last,
+    page;
+
+  void
+    *pages[PLACEMENT_QUERY_PAGES];
+
+  int
+    status[PLACEMENT_QUERY_PAGES];
+
+  if(length == 0)
+    return;
+
+  last = ((size_t)start + length - 1) / pageSize;
+
+  for(page = first; page <= last; page += PLACEMENT_QUERY_PAGES)
+    {
+      size_t
+	i,
+	count = MIN(PLACEMENT_QUERY_PAGES, last - page + 1);
+
+      for(i = 0; i < count; i++)
+	pages[i] = (void *)((page + i) * pageSize);
+
+      if(syscall(SYS_move_pages, 0, (unsigned long)count, pages, (const int *)NULL, status, 0) != 0)
+	{
+	  *untouched += count;
+	  continue;
+	}
+
+      for(i = 0; i < count; i++)
+	{
+	  if(status[i] < 0)
+	    *untouched += 1;
+	  else
+	    {
+	      if(status[i] == node)
+		*local += 1;
+	      else
+		*remote += 1;
+	    }
+	}
+    }
+}
+
+#endif
+
+/* 
+   report where the pages of the sites assigned to each thread reside, 
+   pages that have not been touched yet are not counted as local or remote. 
+   Only the summary over all processes is printed, the placement of each 
+   thread is gathered on process 0 and written with --timers 
+*/
+
+#define PLACEMENT_FIELDS 5
+
+static void printPagePlacement(tree *tr)
+{
+#ifdef __linux__
+  int
+    threads = omp_get_max_threads(),
+    maxThreads = 0;
+
+  unsigned long
+    *perThread,
+    *allThreads = (unsigned long *)NULL,
+    placement[3] = {0, 0, 0},
+    total[3] = {0, 0, 0};
+
+  MPI_Allreduce(&threads, &maxThreads, 1, MPI_INT, MPI_MAX, comm);
+
+  /* cpu, node, local, remote, untouched of each thread, the cpu is ULONG_MAX for threads that do not exist */
+
+  perThread = (unsigned long *)malloc(sizeof(unsigned long) * PLACEMENT_FIELDS * maxThreads);
+
+  {
+    int
+      t;
+
+    for(t = 0; t < maxThreads * PLACEMENT_FIELDS; t++)
+      perThread[t] = (t % PLACEMENT_FIELDS == 0)?ULONG_MAX:0;
+  }
+
+#pragma omp parallel
+  {
+    int
+      m,
+      i,
+      tid = omp_get_thread_num();
+
+    unsigned int
+      cpu = 0,
+      node = 0;
+
+    size_t
+      local = 0,
+      remote = 0,
+      untouched = 0;
+
+    if(syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+      node = 0;
+
+    for(m = 0; m < tr->maxModelsPerThread; m++)
+      {
+	Assign
+	  *pAss = tr->threadPartAssigns[tid * tr->maxModelsPerThread + m];
+
+	if(pAss)
+	  {
+	    pInfo
+	      *p = &(tr->partitionData[pAss->partitionId]);
+
+	    size_t
+	      span = (size_t)p->states * discreteRateCategories(tr->rateHetModel),
+	      offset = (size_t)pAss->offset,
+	      width = (size_t)pAss->width;
+
+	    for(i = 0; i < tr->mxtips; i++)
+	      if(p->xVector[i])
+		countPagePlacement(p->xVector[i] + offset * span, width * span * sizeof(double), (int)node, &local, &remote, &untouched);
+	  }
+	else
+	  break;
+      }
+
+    perThread[tid * PLACEMENT_FIELDS]     = (unsigned long)cpu;
+    perThread[tid * PLACEMENT_FIELDS + 1] = (unsigned long)node;
+    perThread[tid * PLACEMENT_FIELDS + 2] = (unsigned long)local;
+    perThread[tid * PLACEMENT_FIELDS + 3] = (unsigned long)remote;
+    perThread[tid * PLACEMENT_FIELDS + 4] = (unsigned long)untouched;
+  }
+
+  {
+    int
+      t;
+
+    for(t = 0; t < threads; t++)
+      {
+	placement[0] += perThread[t * PLACEMENT_FIELDS + 2];
+	placement[1] += perThread[t * PLACEMENT_FIELDS + 3];
+	placement[2] += perThread[t * PLACEMENT_FIELDS + 4];
+      }
+  }
+
+  MPI_Reduce(placement, total, 3, MPI_UNSIGNED_LONG, MPI_SUM, 0, comm);
+
+  if(tr->timers)
+    {
+      if(processID == 0)
+	allThreads = (unsigned long *)malloc(sizeof(unsigned long) * PLACEMENT_FIELDS * maxThreads * processes);
+
+      MPI_Gather(perThread, PLACEMENT_FIELDS * maxThreads, MPI_UNSIGNED_LONG, allThreads, PLACEMENT_FIELDS * maxThreads, MPI_UNSIGNED_LONG, 0, comm);
+
+      if(processID == 0)
+	{
+	  int
+	    r,
+	    t;
+
+	  printBothOpen("\nNUMA placement of the inner likelihood vectors of each thread:\n");
+
+	  for(r = 0; r < processes; r++)
+	    for(t = 0; t < maxThreads; t++)
+	      {
+		unsigned long
+		  *f = &allThreads[(r * maxThreads + t) * PLACEMENT_FIELDS];
+
+		if(f[0] != ULONG_MAX)
+		  printBothOpen("  process %d thread %d on cpu %lu node %lu: %lu local, %lu remote, %lu untouched pages\n", 
+				r, t, f[0], f[1], f[2], f[3], f[4]);
+	      }
+
+	  free(allThreads);
+	}
+    }
+
+  free(perThread);
+
+  if(total[0] + total[1] > 0)
+    printBothOpen("\nNUMA placement of inner likelihood vectors: %lu local, %lu remote, %lu untouched pages (%f%% local)\n\n",
+		  total[0], total[1], total[2], 100.0 * (double)total[0] / (double)(total[0] + total[1]));
+#endif
+}
+
+#endif
+
+void allocateXVectors(tree* tr)
+{
+  nodeptr
+    p = tr->start,
+    q = p->back;
+
+  tr->td[0].ti[0].pNumber = p->number;
+  tr->td[0].ti[0].qNumber = q->number;
+
+  tr->td[0].count = 1;
+
+  startClvTraversal(p, q);
+
+  computeTraversalInfo(q, &(tr->td[0].ti[0]), &(tr->td[0].count), tr->mxtips, tr->numBranches, FALSE);
+
+  traversalInfo
+    *ti = tr->td[0].ti;
 
   int
     i,
@@ -2380,7 +3254,7 @@ void allocateXVectors(tree* tr)
 	    width  = (size_t)tr->partitionData[model].width;
 
 	  double
-	    *x3_start = tr->partitionData[model].xVector[tInfo->pNumber - tr->mxtips - 1];
+	    *x3_start = tr->partitionData[model].xVector[tInfo->pSlot];
 
 	  size_t
 	    rateHet = discreteRateCategories(tr->rateHetModel),
@@ -2398,7 +3272,7 @@ void allocateXVectors(tree* tr)
 	       and node i
 	    */
 
-	    availableLength = tr->partitionData[model].xSpaceVector[(tInfo->pNumber - tr->mxtips - 1)],
+	    availableLength = tr->partitionData[model].xSpaceVector[tInfo->pSlot],
 	    requiredLength = 0;
 
 	  /* memory saving stuff, not important right now, but if you are interested ask Fernando */
@@ -2437,19 +3311,26 @@ void allocateXVectors(tree* tr)
 	      /* if there is a vector of incorrect length assigned here i.e., x3 != NULL we must free
 		 it first */
 	      if(x3_start)
-		free(x3_start);
+		clvFree(x3_start, availableLength);
 
 	      /* allocate memory: note that here we use a byte-boundary aligned malloc, because we need the vectors
 		 to be aligned at 16 BYTE (SSE3) or 32 BYTE (AVX) boundaries! */
 
-	      x3_start = (double*)malloc_aligned(requiredLength);
+	      x3_start = (double*)clvAlloc(requiredLength);
 
 	      /* update the data structures for consistent bookkeeping */
-	      tr->partitionData[model].xVector[tInfo->pNumber - tr->mxtips - 1] = x3_start;
-	      tr->partitionData[model].xSpaceVector[(tInfo->pNumber - tr->mxtips - 1)] = requiredLength;
+	      tr->partitionData[model].xVector[tInfo->pSlot] = x3_start;
+	      tr->partitionData[model].xSpaceVector[tInfo->pSlot] = requiredLength;
 	    }
 	} // for model
     } // for traversal
+
+#ifndef __MIC_NATIVE
+  /* now that all vectors exist, place them on the memory nodes of the threads that use them */
+
+  firstTouchSiteData(tr);
+  printPagePlacement(tr);
+#endif
 }
 
 void assignPartitionsToThreads(tree *tr, int commRank)
@@ -2466,7 +3347,7 @@ void assignPartitionsToThreads(tree *tr, int commRank)
   }
 
   PartitionAssignment *pAss = NULL;
-  initializePartitionAssignment(&pAss, rankPartitions, tr->NumberOfModels, tr->nThreads);
+  initializePartitionAssignment(&pAss, rankPartitions, tr->NumberOfModels, tr->nThreads, tr->rateHetModel);
 
   /* */
   for(i = 0; i < pAss->numPartitions; ++i)
@@ -2510,11 +3391,264 @@ void assignPartitionsToThreads(tree *tr, int commRank)
 #endif
 
 
+/*
+   bootstrap searches without re-reading the data: for every replicate
+   the pattern weights are re-sampled, and a full search is conducted
+   starting from the user tree. Replicate i is computed by search group
+   i modulo the number of groups.
+*/
+static void computeBootstraps(tree *tr, analdef *adef)
+{
+  int 
+    replicate,
+    computed = 0;
+
+  long 
+    seed = adef->boot;
+
+  double
+    replicateTime = 0.0;
+
+  /* the weights would be overwritten when sites are migrated */
+
+  if(tr->dynamicLoadBalance)
+    {
+      tr->dynamicLoadBalance = FALSE;
+      printBothOpen("\nDynamic re-balancing of sites is disabled for bootstrapping\n");
+    }
+
+  initializeBootstrap(tr);
+
+  for(replicate = 0; replicate < adef->multipleRuns; replicate++)
+    {
+      /* all groups draw the same sequence of replicate seeds */
+
+      long 
+	replicateSeed = 1 + (long)(randum(&seed) * 2147483646.0);
+
+      double 
+	t;
+
+      if(replicate % tr->numberOfGroups != tr->groupID)
+	continue;
+
+      /* with a time limit, only start replicates that can be expected to finish in time */
+
+      if(tr->timeLimit > 0.0 && timeLimitReached(tr, computed > 0 ? replicateTime : 0.0))
+	{
+	  printBothOpen("\nTime limit: stopping after %d bootstrap replicates\n", computed);
+	  break;
+	}
+
+      t = gettime();
+
+      resampleWeights(tr, replicateSeed);
+
+      getStartingTree(tr);
+
+#ifdef _USE_OMP
+      if(computed == 0)
+	allocateXVectors(tr);
+#endif
+
+      evaluateGeneric(tr, tr->start, TRUE);
+
+      treeEvaluate(tr, 1);
+
+      computeBIGRAPID(tr, adef, TRUE);
+
+      if(processID == 0)
+	{
+	  FILE 
+	    *f = myfopen(bootstrapFileName, "ab");
+
+	  Tree2String(tr->tree_string, tr, tr->start->back, TRUE, TRUE, FALSE, FALSE, TRUE, SUMMARIZE_LH, FALSE, FALSE);
+	  fprintf(f, "%s", tr->tree_string);
+	  fclose(f);
+	}
+
+      replicateTime = gettime() - t;
+
+      printBothOpen("\nBootstrap replicate %d: likelihood %f, time %f\n\n", replicate, tr->likelihood, replicateTime);
+
+      computed++;
+    }
+
+  restoreWeights(tr);
+
+  printBothOpen("%d bootstrap trees written to file %s\n", computed, bootstrapFileName);
+}
+
+
+/* run ID without the group suffix, for the files that summarize all search groups */
+static char groupsRunId[128] = "";
+
+/*
+   splits MPI_COMM_WORLD into tr->numberOfGroups groups of consecutive processes
+   that conduct independent searches on their own communicator. Every group
+   reads its own copy of the data, hence processID and processes are
+   re-defined with respect to the group.
+*/
+static void splitSearchGroups(tree *tr, analdef *adef)
+{
+  int 
+    worldRank = processID,
+    worldSize = processes;
+
+  char 
+    suffix[64];
+
+  if(tr->numberOfGroups > worldSize)
+    {
+      if(processID == 0)
+	printf("\nError, the number of search groups (%d) exceeds the number of processes (%d)\n\n", tr->numberOfGroups, worldSize);
+      errorExit(-1);
+    }
+
+  if(adef->useCheckpoint)
+    {
+      if(processID == 0)
+	printf("\nError, re-starting from a checkpoint is not supported with more than one search group\n\n");
+      errorExit(-1);
+    }
+
+  tr->groupID = (int)(((long)worldRank * (long)tr->numberOfGroups) / (long)worldSize);
+
+  /* every group has its own random number seed: group i takes the (i + 1)-th number of the sequence 
+     of the seed of "-p", as the replicates of the bootstrap, the first numbers of consecutive seeds 
+     are almost the same */
+
+  {
+    long 
+      seed = (long)tr->randomSeed;
+
+    int 
+      i;
+
+    for(i = 0; i <= tr->groupID; i++)
+      tr->randomSeed = 1 + (unsigned int)(randum(&seed) * 2147483646.0);
+  }
+
+  MPI_Comm_split(MPI_COMM_WORLD, tr->groupID, worldRank, &comm);
+  MPI_Comm_rank(comm, &processID);
+  MPI_Comm_size(comm, &processes);
+
+  /* every group writes its own output files */
+
+  sprintf(suffix, ".group%d", tr->groupID);
+
+  if(strlen(run_id) + strlen(suffix) >= sizeof(run_id))
+    {
+      if(worldRank == 0)
+	printf("\nError, run ID %s is too long\n\n", run_id);
+      errorExit(-1);
+    }
+
+  strcpy(groupsRunId, run_id);
+  strcat(run_id, suffix);
+
+  if(processID == 0)
+    printf("Process %d is process %d of %d in search group %d\n", worldRank, processID, processes, tr->groupID);
+}
+
+/*
+   the group leaders send the final tree and likelihood of their group
+   to the world master, which writes all of them to one file and
+   reports the best one
+*/
+static void gatherGroupResults(tree *tr)
+{
+  MPI_Comm 
+    leaders;
+
+  int 
+    worldRank;
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+
+  MPI_Comm_split(MPI_COMM_WORLD, (processID == 0) ? 0 : MPI_UNDEFINED, worldRank, &leaders);
+
+  if(processID == 0)
+    {
+      int 
+	i,
+	leaderRank,
+	numberOfLeaders,
+	best = 0;
+
+      double 
+	*likelihoods = (double *)NULL;
+
+      char 
+	*trees = (char *)NULL;
+
+      MPI_Comm_rank(leaders, &leaderRank);
+      MPI_Comm_size(leaders, &numberOfLeaders);
+
+      /* groups consist of consecutive processes */
+      assert(numberOfLeaders == tr->numberOfGroups && leaderRank == tr->groupID);
+
+      memset(tr->tree_string, 0, (size_t)tr->treeStringLength * sizeof(char));
+      Tree2String(tr->tree_string, tr, tr->start->back, TRUE, TRUE, FALSE, FALSE, TRUE, SUMMARIZE_LH, FALSE, FALSE);
+
+      if(leaderRank == 0)
+	{
+	  likelihoods = (double *)malloc(sizeof(double) * (size_t)numberOfLeaders);
+	  trees = (char *)malloc(sizeof(char) * (size_t)numberOfLeaders * (size_t)tr->treeStringLength);
+	}
+
+      MPI_Gather(&(tr->likelihood), 1, MPI_DOUBLE, likelihoods, 1, MPI_DOUBLE, 0, leaders);
+      MPI_Gather(tr->tree_string, tr->treeStringLength, MPI_CHAR, trees, tr->treeStringLength, MPI_CHAR, 0, leaders);
+
+      if(leaderRank == 0)
+	{
+	  char 
+	    fileName[1024];
+
+	  FILE 
+	    *f;
+
+	  strcpy(fileName, workdir);
+	  strcat(fileName, "ExaML_groupTrees.");
+	  strcat(fileName, groupsRunId);
+
+	  f = myfopen(fileName, "wb");
+
+	  printBothOpen("\n\nResults of %d independent search groups:\n\n", numberOfLeaders);
+
+	  for(i = 0; i < numberOfLeaders; i++)
+	    {
+	      printBothOpen("Search group %d likelihood %f\n", i, likelihoods[i]);
+	      fprintf(f, "%s", &trees[(size_t)i * (size_t)tr->treeStringLength]);
+
+	      if(likelihoods[i] > likelihoods[best])
+		best = i;
+	    }
+
+	  fclose(f);
+
+	  printBothOpen("\nBest tree found by search group %d with likelihood %f\n", best, likelihoods[best]);
+	  printBothOpen("Trees of all search groups written to file %s\n\n", fileName);
+
+	  free(likelihoods);
+	  free(trees);
+	}
+
+      MPI_Comm_free(&leaders);
+    }
+}
+
+
+/* the kernel benchmark (kernelBench.c) links everything but main() */
+
+#ifndef _KERNEL_BENCHMARK
+
 int main (int argc, char *argv[])
 { 
   MPI_Init(&argc, &argv);
   MPI_Comm_rank(MPI_COMM_WORLD, &processID);
   MPI_Comm_size(MPI_COMM_WORLD, &processes);
+  comm = MPI_COMM_WORLD;
   printf("\nThis is ExaML FINE-GRAIN MPI Process Number: %d\n", processID);   
   MPI_Barrier(MPI_COMM_WORLD);
   
@@ -2548,6 +3682,11 @@ int main (int argc, char *argv[])
   /* parse command line arguments: this has a side effect on tr struct and adef struct variables */
   
     get_args(argc, argv, adef, tr); 
+
+  /* from now on processID and processes refer to the group of this process */
+
+    if(tr->numberOfGroups > 1)
+      splitSearchGroups(tr, adef);
   
   /* generate the ExaML output file names and store them in strings */
     
@@ -2561,7 +3700,18 @@ int main (int argc, char *argv[])
       }
 #endif
 
+#ifdef _CPU_DISPATCH
+    tr->kernelSet = selectKernels(tr->kernelSet);
+#endif
+
+    initTimers(tr);
+    initTrace(tr);
+
+    startPhaseTimer(TIMER_READ_ALIGNMENT);
     readByteFile(tr, processID, processes );
+    stopPhaseTimer(TIMER_READ_ALIGNMENT);
+
+    initClvArena(tr);
 
 #ifdef _USE_OMP
     tr->nThreads = omp_get_max_threads();
@@ -2574,7 +3724,18 @@ int main (int argc, char *argv[])
       {	
 	printModelAndProgramInfo(tr, adef, argc, argv);  
 	printBothOpen("Memory Saving Option: %s\n", (tr->saveMemory == TRUE)?"ENABLED":"DISABLED");   	             
+	if(tr->clvBudget > 0)
+	  printBothOpen("CLV budget: %d of %d inner vectors\n", MIN(tr->clvBudget, tr->mxtips - 2), tr->mxtips - 2);
+	if(tr->clvStoreVectors > 0)
+	  printBothOpen("CLV store: %d of %d inner vectors in memory\n", MIN(tr->clvStoreVectors, tr->mxtips - 2), tr->mxtips - 2);
+#ifdef _USE_OMP
+	printBothOpen("Task-parallel traversal: %s\n", (tr->taskTraversal == TRUE)?"ENABLED":"DISABLED");
+#endif
       }
+
+#ifdef _CPU_DISPATCH
+    printKernelSelection(tr);
+#endif
     
     
 
@@ -2655,6 +3816,14 @@ int main (int argc, char *argv[])
 	    }
 	}
 
+#ifdef __MIC_NATIVE
+      if(tr->rellTrees > 0)
+	{
+	  printBothOpen("Error: There is no MIC support yet for RELL supports!\n\n");
+	  error_MPI_Exit();
+	}
+#endif
+
       if(countBinary > 0)
 	{
 	  if(tr->saveMemory == TRUE)
@@ -2696,6 +3865,13 @@ int main (int argc, char *argv[])
 	      printModelParams(tr, adef, -1);
 
 	  }
+	else if(adef->boot)
+	  {
+	    if(processID == 0)
+	      accumulatedTime = 0.0;
+
+	    computeBootstraps(tr, adef);
+	  }
 	else
 	  {
 	    /* not important, only used to keep track of total accumulated exec time 
@@ -2709,6 +3885,8 @@ int main (int argc, char *argv[])
 	   which we maybe should skip, TODO */
 	    
 	    getStartingTree(tr); 
+
+	    perturbStartingTree(tr);
 	    
 #ifdef _USE_OMP
 	    allocateXVectors(tr);
@@ -2743,6 +3921,16 @@ int main (int argc, char *argv[])
   
     if(processID == 0)
       finalizeInfoFile(tr, adef);
+
+    /* per-process breakdown of the time, see timers.c */
+
+    printTimerReport();
+    printClvArenaReport();
+    printClvStoreReport(tr);
+    writeTrace();
+
+    if(tr->numberOfGroups > 1 && !adef->boot)
+      gatherGroupResults(tr);
   }
   
   /* return 0 which means that our unix program terminated correctly, the return value is not 1 here */
@@ -2752,4 +3940,4 @@ int main (int argc, char *argv[])
   return 0;
 }
 
-
+#endif
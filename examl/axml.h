@@ -55,7 +55,7 @@
 
 #endif
 
-#ifdef __AVX
+#if defined(__AVX) && !defined(__AVX512)
 #define VECTOR_REGISTER __m256d
 #define VECTOR_WIDTH  4
 
@@ -73,10 +73,31 @@
 #define VECTOR_AND _mm256_and_pd
 #endif
 
+#ifdef __AVX512
+#define VECTOR_REGISTER __m512d
+#define VECTOR_WIDTH  8
+
+//the CLVs of the generic models are not necessarily 64-byte aligned, the unaligned 
+//AVX-512 loads and stores are as fast as the aligned ones on aligned data
+#define VECTOR_STORE _mm512_storeu_pd
+#define VECTOR_LOAD  _mm512_loadu_pd
+
+#define VECTOR_MUL   _mm512_mul_pd
+#define VECTOR_ADD   _mm512_add_pd
+#define VECTOR_SET_ZERO _mm512_setzero_pd
+#define VECTOR_SET_ONE _mm512_set1_pd
+//_mm512_and_pd requires AVX-512DQ
+#define VECTOR_AND(a, b) _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(a), _mm512_castpd_si512(b)))
+#endif
+
 
 #ifdef __MIC_NATIVE
 #define BYTE_ALIGNMENT 64
 #define VECTOR_PADDING 8
+#elif defined _CPU_DISPATCH
+/* the kernels are selected at run time, hence all memory is aligned for the widest ones (AVX-512) */
+#define BYTE_ALIGNMENT 64
+#define VECTOR_PADDING 1
 #elif defined __AVX
 #define BYTE_ALIGNMENT 32
 #define VECTOR_PADDING 1
@@ -87,6 +108,59 @@
 
 #define GET_PADDED_WIDTH(w) w % VECTOR_PADDING == 0 ? w : w + (VECTOR_PADDING - (w % VECTOR_PADDING))
 
+/* 
+   Run-time selection of the likelihood kernels (Makefile.MULTI.gcc, -D_CPU_DISPATCH):
+   newviewGenericSpecial.c, evaluateGenericSpecial.c, makenewzGenericSpecial.c, avxLikelihood.c, and
+   avx512Likelihood.c (AVX512 only) are compiled once per instruction set with -D_KERNEL_ISA=SSE3, AVX,
+   AVX2, or AVX512. Their global symbols get the instruction set as prefix, e.g., AVX2_newviewIterative,
+   and the functions of the same name in cpuDispatch.c call the set that has been chosen at start-up
+   by selectKernels().
+*/
+
+#ifdef _KERNEL_ISA
+#define KERNEL_SYMBOL(name) KERNEL_SYMBOL_ISA(name, _KERNEL_ISA)
+#define KERNEL_SYMBOL_ISA(name, isa) KERNEL_SYMBOL_PASTE(name, isa)
+#define KERNEL_SYMBOL_PASTE(name, isa) isa ## _ ## name
+
+#define newviewIterative     KERNEL_SYMBOL(newviewIterative)
+#define newviewTraversal     KERNEL_SYMBOL(newviewTraversal)
+#define newviewGeneric       KERNEL_SYMBOL(newviewGeneric)
+#define computeTraversalInfo KERNEL_SYMBOL(computeTraversalInfo)
+#define isGap                KERNEL_SYMBOL(isGap)
+#define noGap                KERNEL_SYMBOL(noGap)
+#define evaluateIterative    KERNEL_SYMBOL(evaluateIterative)
+#define evaluateGeneric      KERNEL_SYMBOL(evaluateGeneric)
+#define evaluateInsertion    KERNEL_SYMBOL(evaluateInsertion)
+#define makenewzIterative    KERNEL_SYMBOL(makenewzIterative)
+#define makenewzGeneric      KERNEL_SYMBOL(makenewzGeneric)
+#define execCore             KERNEL_SYMBOL(execCore)
+#define absMask              KERNEL_SYMBOL(absMask)
+#define absMask_AVX          KERNEL_SYMBOL(absMask_AVX)
+
+#define newviewGTRGAMMA_AVX                 KERNEL_SYMBOL(newviewGTRGAMMA_AVX)
+#define newviewGTRCAT_AVX                   KERNEL_SYMBOL(newviewGTRCAT_AVX)
+#define newviewGTRCATPROT_AVX               KERNEL_SYMBOL(newviewGTRCATPROT_AVX)
+#define newviewGTRGAMMAPROT_AVX             KERNEL_SYMBOL(newviewGTRGAMMAPROT_AVX)
+#define newviewGTRGAMMAPROT_AVX_LG4         KERNEL_SYMBOL(newviewGTRGAMMAPROT_AVX_LG4)
+#define newviewGTRGAMMA_AVX_GAPPED_SAVE     KERNEL_SYMBOL(newviewGTRGAMMA_AVX_GAPPED_SAVE)
+#define newviewGTRCAT_AVX_GAPPED_SAVE       KERNEL_SYMBOL(newviewGTRCAT_AVX_GAPPED_SAVE)
+#define newviewGTRCATPROT_AVX_GAPPED_SAVE   KERNEL_SYMBOL(newviewGTRCATPROT_AVX_GAPPED_SAVE)
+#define newviewGTRGAMMAPROT_AVX_GAPPED_SAVE KERNEL_SYMBOL(newviewGTRGAMMAPROT_AVX_GAPPED_SAVE)
+
+#define newviewGTRGAMMA_AVX512              KERNEL_SYMBOL(newviewGTRGAMMA_AVX512)
+#define newviewGTRGAMMAPROT_AVX512          KERNEL_SYMBOL(newviewGTRGAMMAPROT_AVX512)
+#define newviewGTRGAMMAPROT_AVX512_LG4      KERNEL_SYMBOL(newviewGTRGAMMAPROT_AVX512_LG4)
+#define evaluateGTRGAMMA_AVX512             KERNEL_SYMBOL(evaluateGTRGAMMA_AVX512)
+#define evaluateGTRGAMMAPROT_AVX512         KERNEL_SYMBOL(evaluateGTRGAMMAPROT_AVX512)
+#define evaluateGTRGAMMAPROT_AVX512_LG4     KERNEL_SYMBOL(evaluateGTRGAMMAPROT_AVX512_LG4)
+#define sumGAMMA_AVX512                     KERNEL_SYMBOL(sumGAMMA_AVX512)
+#define sumGAMMAPROT_AVX512                 KERNEL_SYMBOL(sumGAMMAPROT_AVX512)
+#define sumGAMMAPROT_AVX512_LG4             KERNEL_SYMBOL(sumGAMMAPROT_AVX512_LG4)
+#define coreGTRGAMMA_AVX512                 KERNEL_SYMBOL(coreGTRGAMMA_AVX512)
+#define coreGTRGAMMAPROT_AVX512             KERNEL_SYMBOL(coreGTRGAMMAPROT_AVX512)
+#define coreGTRGAMMAPROT_AVX512_LG4         KERNEL_SYMBOL(coreGTRGAMMAPROT_AVX512_LG4)
+#endif
+
 #include <mpi.h>
 
 #ifdef _USE_OMP
@@ -238,6 +312,9 @@
 #define ABS(x)    (((x)<0)   ?  (-(x)) : (x))
 #define MIN(x,y)  (((x)<(y)) ?    (x)  : (y))
 #define MAX(x,y)  (((x)>(y)) ?    (x)  : (y))
+
+/* index of the conditional likelihood vector of the inner node number in xVector */
+#define CLV_INDEX(tr, number) ((tr)->clvSlot ? (tr)->clvSlot[(number)] : (number) - (tr)->mxtips - 1)
 #define NINT(x)   ((int) ((x)>0 ? ((x)+0.5) : ((x)-0.5)))
 
 
@@ -356,6 +433,48 @@
 #define POMO_64          9
 #define MAX_MODEL        10
 
+/* phase timers and likelihood kernels for the timers, see timers.c */
+
+#define TIMER_READ_ALIGNMENT    0
+#define TIMER_READ_CHECKPOINT   1
+#define TIMER_WRITE_CHECKPOINT  2
+#define TIMER_OUTPUT            3
+#define TIMER_REDUCTION         4
+#define TIMER_MODOPT_RATES      5
+#define TIMER_MODOPT_FREQS      6
+#define TIMER_MODOPT_PHI        7
+#define TIMER_MODOPT_ALPHAS     8
+#define TIMER_MODOPT_CATS       9
+#define TIMER_MODOPT_BRANCHES   10
+#define TIMER_SPR_BRANCHES      11
+#define TIMER_SPR_NNI           12
+#define TIMER_SPR_REARRANGE     13
+#define TIMER_SPR_CANDIDATES    14
+#define NUM_PHASE_TIMERS        15
+
+#define KERNEL_NEWVIEW          0
+#define KERNEL_EVALUATE         1
+#define KERNEL_MAKENEWZ         2
+#define KERNEL_CORE             3
+#define NUM_KERNELS             4
+
+/* events of the tracer, see trace.c */
+
+#define TRACE_NEWVIEW           0
+#define TRACE_EVALUATE          1
+#define TRACE_MAKENEWZ          2
+#define TRACE_EXEC_CORE         3
+#define TRACE_CHECKPOINT        4
+
+/* instruction sets of the likelihood kernels, see cpuDispatch.c */
+
+#define KERNELS_AUTO           -1
+#define KERNELS_SSE3            0
+#define KERNELS_AVX             1
+#define KERNELS_AVX2            2
+#define KERNELS_AVX512          3
+#define NUM_KERNEL_SETS         4
+
 #define SEC_6_A 0
 #define SEC_6_B 1
 #define SEC_6_C 2
@@ -480,6 +599,9 @@ typedef struct
   int pNumber;
   int qNumber;
   int rNumber;
+  int pSlot;
+  int qSlot;
+  int rSlot;
   double qz[NUM_BRANCHES];
   double rz[NUM_BRANCHES];
 } traversalInfo;
@@ -566,6 +688,15 @@ typedef struct iL {
   int valid;
 } infoList;
 
+/* least recently used order of the entries of an array, see lruList.c */
+typedef struct
+{
+  int newest;
+  int oldest;
+  int *older;
+  int *newer;
+} lruList;
+
 
 
 typedef unsigned int parsimonyNumber;
@@ -646,9 +777,19 @@ typedef struct {
   unsigned char    *yResource; 	/* contains the entire array, that is referenced in yVector */
   unsigned int     *globalScaler; 
 
+  /* per-site log likelihoods and counts of scaling multiplications (summed over the inner nodes and 
+     per node), only set while computeSiteLikelihoods() in rell.c evaluates the tree */
+  double           *siteLikelihoods;
+  int              *siteScaler;
+  int              *siteScalerIncrement;
+
   int               gapVectorLength;
   unsigned int     *gapVector;
   double           *gapColumn; 
+
+  /* bit-parallel parsimony vectors (one bit-plane per state) of all nodes, see parsimony.c */
+  parsimonyNumber  *parsVect;
+  size_t            parsimonyLength;
  
 
   double *lhs;
@@ -965,6 +1106,60 @@ typedef  struct  {
   int *rateCategory_basePtr; 
   double *lhs_basePtr;
 
+  /* dynamic load balancing: time spent in the likelihood kernels by
+     this process since the last re-balancing step */
+  boolean dynamicLoadBalance; 
+  double rebalanceThreshold; 
+  double kernelTime; 
+
+  /* execute independent entries of the traversal descriptor concurrently (hybrid OpenMP version only) */
+  boolean taskTraversal;
+
+  /* parsimony pre-screening of the insertion positions in the fast SPR phase: 
+     only the best prescreenFraction of them (marked in insertionSelected) are scored by ML */
+  boolean parsimonyPrescreen;
+  double prescreenFraction;
+  unsigned char *insertionSelected;
+  boolean nniSearch;
+  int numberOfGroups;
+  int groupID;
+  int rellTrees;
+
+  /* number of vectors in the CLV cache of the SPR search, 0 if disabled */
+  int clvCacheEntries;
+
+  /* wall-clock time limit of the search in seconds, 0.0 if there is none */
+  double timeLimit;
+
+  /* number of most recent checkpoint files that are kept, 0 if all are kept */
+  int keepCheckpoints;
+
+  /* number of inner vectors that are kept in memory, 0 if all are kept,
+     clvSlot[number] is the index of the vector of an inner node in xVector (see recom.c) */
+  int clvBudget;
+  int *clvSlot;
+
+  /* phase and kernel timers are enabled (--timers) */
+  boolean timers;
+
+  /* hardware counters of the kernels are read (--perf-counters), with optional raw floating point events */
+  boolean perfCounters;
+  char *perfCounterEvents;
+
+  /* size of the ring buffer of the event tracer (--trace), 0 if disabled */
+  size_t traceEvents;
+
+  /* instruction set of the likelihood kernels (--kernels), KERNELS_AUTO selects the fastest one the CPU supports */
+  int kernelSet;
+
+  /* inner vectors and per-partition buffers are carved from a huge page arena (--clv-arena) */
+  boolean clvArena;
+
+  /* number of resident inner vectors of the out-of-core CLV store (--clv-store), 0 if disabled,
+     and the directory of its files, NULL for the output directory (see clvStore.c) */
+  int clvStoreVectors;
+  char *clvStoreDirectory;
+
 #ifdef _USE_OMP
   /* number of OMP threads*/
   int nThreads;
@@ -981,6 +1176,19 @@ typedef  struct  {
   /* partition-to-threads assignments: indexed by partition id */
   Assign **partThreadAssigns;
 
+  /* thread-private P matrix buffers, such that threads do not need to
+     synchronize for computing the P matrices of shared partitions */
+  double **threadLeft;
+  double **threadRight;
+#ifdef __MIC_NATIVE
+  double **threadUmpLeft;
+  double **threadUmpRight;
+#endif
+
+  /* one dependency object per (node, thread assignment) for the OpenMP tasks 
+     of the task-parallel traversal */
+  char *traversalDeps;
+
 #endif
 
 } tree;
@@ -1041,6 +1249,7 @@ typedef  struct {
     int              nextnode;
     int              scrNum;      /* position in sorted list of scores */
     int              tplNum;      /* position in sorted list of trees */
+    double          *siteLikelihoods; /* per-site log likelihoods of the local sites for RELL, see storeSiteLikelihoods() */
 
     } topol;
 
@@ -1073,6 +1282,8 @@ typedef  struct {
   boolean        compressPatterns;
   double         likelihoodEpsilon;
   boolean        useCheckpoint;
+  long           boot;
+  int            multipleRuns;
  
 #ifdef _BAYESIAN 
   boolean       bayesian;
@@ -1141,6 +1352,7 @@ extern partitionLengths * getPartitionLengths(pInfo *p);
 extern boolean getSmoothFreqs(int dataType);
 extern const unsigned int *getBitVector(int dataType);
 extern int getUndetermined(int dataType);
+extern void initTipGapVectors(tree *tr, pInfo *p);
 extern int getStates(int dataType);
 extern char getInverseMeaning(int dataType, unsigned char state);
 extern double gettime ( void );
@@ -1188,6 +1400,10 @@ extern void makeParsimonyTreeFast(tree *tr);
 extern void allocateParsimonyDataStructures(tree *tr);
 extern void freeParsimonyDataStructures(tree *tr);
 extern void parsimonySPR(nodeptr p, tree *tr);
+extern void prescreenInsertions(tree *tr, nodeptr p, nodeptr p1, nodeptr p2, int mintrav, int maxtrav);
+extern void resetParsimonyOrientation(tree *tr);
+extern void invalidateParsimonyBranch(tree *tr, nodeptr p);
+extern void printParsimonyPrescreenStatistics(void);
 
 extern FILE *myfopen(const char *path, const char *mode);
 
@@ -1213,6 +1429,7 @@ extern void addTraverseBIG ( tree *tr, nodeptr p, nodeptr q, int mintrav, int ma
 extern int rearrangeBIG ( tree *tr, nodeptr p, int mintrav, int maxtrav );
 extern void traversalOrder ( nodeptr p, int *count, nodeptr *nodeArray );
 extern double treeOptimizeRapid ( tree *tr, int mintrav, int maxtrav, analdef *adef, bestlist *bt, bestlist *bestML);
+extern boolean timeLimitReached(tree *tr, double expectedDuration);
 extern boolean testInsertRestoreBIG ( tree *tr, nodeptr p, nodeptr q );
 extern void restoreTreeFast ( tree *tr );
 extern int determineRearrangementSetting ( tree *tr, analdef *adef, bestlist *bestT, bestlist *bt, bestlist *bestML);
@@ -1246,12 +1463,14 @@ extern void treeReadTopologyString(char *treeString, tree *tr);
 extern boolean treeReadLenMULT ( FILE *fp, tree *tr, int *partCount);
 
 extern void getStartingTree ( tree *tr);
+extern void perturbStartingTree ( tree *tr);
 
 extern void computeBootStopOnly(tree *tr, char *bootStrapFileName, analdef *adef);
 extern boolean bootStop(tree *tr, hashtable *h, int numberOfTrees, double *pearsonAverage, unsigned int **bitVectors, int treeVectorLength, unsigned int vectorLength);
 extern void computeConsensusOnly(tree *tr, char* treeSetFileName, analdef *adef);
 extern double evaluatePartialGeneric (tree *, size_t i, double ki, int _model);
 extern void evaluateGeneric (tree *tr, nodeptr p, boolean fullTraversal);
+extern void evaluateInsertion(tree *tr, nodeptr p);
 extern void newviewGeneric (tree *tr, nodeptr p, boolean masked);
 extern void newviewGenericMulti (tree *tr, nodeptr p, int model);
 extern void makenewzGeneric(tree *tr, nodeptr p, nodeptr q, double *z0, int maxiter, double *result, boolean mask);
@@ -1267,6 +1486,7 @@ extern void computeTraversalInfo(nodeptr p, traversalInfo *ti, int *counter, int
 extern boolean isPomo(int dataType);
 
 extern void   newviewIterative(tree *tr, int startIndex);
+extern void   newviewTraversal(tree *tr, int startIndex);
 
 extern void evaluateIterative(tree *);
 
@@ -1358,6 +1578,7 @@ extern void checkPerSiteRates(const tree * const tr );
 extern void restart(tree *tr, analdef *adef);
 
 extern void writeCheckpoint(tree *tr, analdef *adef);
+extern void finishCheckpointWriting(void);
 
 extern boolean isGap(unsigned int *x, size_t pos);
 extern boolean noGap(unsigned int *x, size_t pos);
@@ -1379,28 +1600,28 @@ extern void newviewGTRGAMMAPROT_AVX_LG4(int tipCase,
 
 extern void newviewGTRCAT_AVX(int tipCase,  double *EV,  int *cptr,
 			      double *x1_start, double *x2_start,  double *x3_start, double *tipVector,
-			      unsigned char *tipX1, unsigned char *tipX2,
-			      size_t n,  double *left, double *right, int *wgt, int *scalerIncrement);
+			      int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+			      size_t n,  double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling);
 
 
 extern void newviewGTRCATPROT_AVX(int tipCase, double *extEV,
 				  int *cptr,
 				  double *x1, double *x2, double *x3, double *tipVector,
-				  unsigned char *tipX1, unsigned char *tipX2,
-				  size_t n, double *left, double *right, int *wgt, int *scalerIncrement);
+				  int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+				  size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling);
 
 
 extern void newviewGTRGAMMA_AVX(int tipCase,
 				double *x1_start, double *x2_start, double *x3_start,
 				double *EV, double *tipVector,
-				unsigned char *tipX1, unsigned char *tipX2,
-				const size_t n, double *left, double *right, int *wgt, int *scalerIncrement
+				int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+				const size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling
 				);
 
 extern void newviewGTRGAMMAPROT_AVX(int tipCase,
 				    double *x1, double *x2, double *x3, double *extEV, double *tipVector,
-				    unsigned char *tipX1, unsigned char *tipX2, size_t n, 
-				    double *left, double *right, int *wgt, int *scalerIncrement);
+				    int *ex3, unsigned char *tipX1, unsigned char *tipX2, size_t n, 
+				    double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling);
 
 /* memory saving functions */
 
@@ -1436,6 +1657,54 @@ void newviewGTRGAMMAPROT_AVX_GAPPED_SAVE(int tipCase,
 					 double *x1_gapColumn, double *x2_gapColumn, double *x3_gapColumn); 
 #endif
 
+#ifdef __AVX512
+
+/* from avx512Likelihood.c */
+
+extern void newviewGTRGAMMA_AVX512(int tipCase,
+				   double *x1, double *x2, double *x3,
+				   double *extEV, double *tipVector,
+				   int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+				   const size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling);
+
+extern void newviewGTRGAMMAPROT_AVX512(int tipCase,
+				       double *x1, double *x2, double *x3, double *extEV, double *tipVector,
+				       int *ex3, unsigned char *tipX1, unsigned char *tipX2, size_t n,
+				       double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling);
+
+extern void newviewGTRGAMMAPROT_AVX512_LG4(int tipCase,
+					   double *x1, double *x2, double *x3, double *extEV[4], double *tipVector[4],
+					   int *ex3, unsigned char *tipX1, unsigned char *tipX2, size_t n,
+					   double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling);
+
+extern double evaluateGTRGAMMA_AVX512(int *wptr, double *x1, double *x2, double *tipVector,
+				      unsigned char *tipX1, const size_t n, double *diagptable, double *siteLikelihoods);
+
+extern double evaluateGTRGAMMAPROT_AVX512(int *wptr, double *x1, double *x2, double *tipVector,
+					  unsigned char *tipX1, size_t n, double *diagptable, double *siteLikelihoods);
+
+extern double evaluateGTRGAMMAPROT_AVX512_LG4(int *wptr, double *x1, double *x2, double *tipVector[4],
+					      unsigned char *tipX1, size_t n, double *diagptable, double *weights, double *siteLikelihoods);
+
+extern void sumGAMMA_AVX512(int tipCase, double *sumtable, double *x1, double *x2, double *tipVector,
+			    unsigned char *tipX1, unsigned char *tipX2, size_t n);
+
+extern void sumGAMMAPROT_AVX512(int tipCase, double *sumtable, double *x1, double *x2, double *tipVector,
+				unsigned char *tipX1, unsigned char *tipX2, size_t n);
+
+extern void sumGAMMAPROT_AVX512_LG4(int tipCase, double *sumtable, double *x1, double *x2, double *tipVector[4],
+				    unsigned char *tipX1, unsigned char *tipX2, size_t n);
+
+extern void coreGTRGAMMA_AVX512(const size_t upper, double *sumtable,
+				volatile double *ext_dlnLdlz,  volatile double *ext_d2lnLdlz2, double *EIGN, double *gammaRates, double lz, int *wgt);
+
+extern void coreGTRGAMMAPROT_AVX512(double *gammaRates, double *EIGN, double *sumtable, const size_t upper, int *wgt,
+				    volatile double *ext_dlnLdlz,  volatile double *ext_d2lnLdlz2, double lz);
+
+extern void coreGTRGAMMAPROT_AVX512_LG4(double *gammaRates, double *EIGN[4], double *sumtable, const size_t upper, int *wgt,
+					volatile double *ext_dlnLdlz,  volatile double *ext_d2lnLdlz2, double lz, double *weights);
+#endif
+
 
 
 /* from communication.c */
@@ -1443,6 +1712,79 @@ void calculateLengthAndDisplPerProcess(tree *tr, int **length_result, int **disp
 void scatterDistrbutedArray(tree *tr, void *src, void *destination, MPI_Datatype type, int *countPerProc, int *displPerProc);
 void gatherDistributedArray(tree *tr, void **destination, void *src, MPI_Datatype type, int* countPerProc, int *displPerProc);
 
+/* from loadBalance.c */
+boolean rebalanceSiteAssignment(tree *tr);
+
+/* from bootstrap.c */
+void initializeBootstrap(tree *tr);
+void resampleWeights(tree *tr, long seed);
+void restoreWeights(tree *tr);
+
+/* from rell.c */
+void storeSiteLikelihoods(tree *tr, topol *tpl);
+void computeRELLSupports(tree *tr, bestlist *candidates);
+
+/* from clvCache.c */
+void initClvCache(tree *tr);
+void freeClvCache(tree *tr);
+void startClvCacheWindow(void);
+void stopClvCacheWindow(void);
+boolean restoreFromClvCache(nodeptr p, boolean partialTraversal);
+void updateClvKey(nodeptr p);
+void printClvCacheStatistics(void);
+
+/* from recom.c */
+void initRecomputation(tree *tr);
+void freeRecomputation(tree *tr);
+void startClvTraversal(nodeptr p, nodeptr q);
+void orderClvChildren(nodeptr *q, nodeptr *r, boolean partialTraversal);
+void assignClvSlots(traversalInfo *ti, nodeptr p, int maxTips);
+int minimumClvBudget(int numberOfTaxa);
+void printRecomputationStatistics(tree *tr);
+
+/* from timers.c */
+void initTimers(tree *tr);
+double startKernelTimer(void);
+void stopKernelTimer(int kernel, int dataType, int tipCase, double start);
+void startPhaseTimer(int phase);
+void stopPhaseTimer(int phase);
+void printTimerReport(void);
+
+/* from trace.c */
+void initTrace(tree *tr);
+double traceBegin(void);
+void traceEnd(int type, double start, size_t argument);
+void writeTrace(void);
+
+/* from cpuDispatch.c */
+int kernelSetByName(const char *name);
+const char *kernelSetName(int kernelSet);
+int selectKernels(int requested);
+void printKernelSelection(tree *tr);
+
+/* from clvArena.c */
+void initClvArena(tree *tr);
+void *clvAlloc(size_t bytes);
+void *clvCalloc(size_t bytes);
+void clvFree(void *block, size_t bytes);
+void printClvArenaReport(void);
+
+/* from lruList.c */
+void initLruList(lruList *l, int length);
+void freeLruList(lruList *l);
+void emptyLruList(lruList *l);
+void unlinkLruEntry(lruList *l, int e);
+void linkLruEntryAsNewest(lruList *l, int e);
+void touchLruEntry(lruList *l, int e);
+
+/* from clvStore.c */
+void initClvStore(tree *tr);
+void freeClvStore(tree *tr);
+void clvStoreTraversal(tree *tr, int startIndex);
+void clvStoreEntry(tree *tr, int index);
+int minimumClvStoreVectors(int numberOfTaxa);
+void printClvStoreReport(tree *tr);
+
 
 #endif
 
@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <mpi.h>
+
+#include "axml.h"
+
+
+extern int processID;
+extern MPI_Comm comm;
+
+
+/*
+   In-process bootstrapping: instead of generating and parsing a
+   bootstrapped alignment for every replicate, we draw new weights for
+   the alignment patterns that are already stored at the processes.
+
+   As in RAxML, every partition is resampled individually, i.e., the
+   number of sites of a partition does not change. The sites of a
+   partition are drawn with replacement from the cumulative weights of
+   all its patterns, which every process holds. All processes replay
+   the same sequence of draws and keep the patterns of their own slice
+   (assignment) of the partition, such that the replicates only depend
+   on the seed and not on the number of processes.
+*/
+
+
+typedef struct
+{
+  size_t
+    length;			/* number of patterns of the partition over all processes */
+
+  unsigned long
+    *globalWeights,		/* cumulative weights of all patterns of the partition */
+    total;
+
+  int
+    *originalWeights;
+} bootstrapPartition;
+
+
+static bootstrapPartition
+  *bootParts = (bootstrapPartition *)NULL;
+
+static unsigned long
+  *allWeights = (unsigned long *)NULL;
+
+
+/* returns the smallest index i with cumulative[i] > value */
+static size_t drawIndex(unsigned long *cumulative, size_t length, unsigned long value)
+{
+  size_t
+    low = 0,
+    high = length - 1;
+
+  assert(value < cumulative[length - 1]);
+
+  while(low < high)
+    {
+      size_t
+	mid = (low + high) / 2;
+
+      if(cumulative[mid] > value)
+	high = mid;
+      else
+	low = mid + 1;
+    }
+
+  return low;
+}
+
+static unsigned long drawValue(long *seed, unsigned long range)
+{
+  unsigned long
+    value = (unsigned long)(randum(seed) * (double)range);
+
+  return (value < range) ? value : range - 1;
+}
+
+/**
+   stores the original weights of the local patterns and gathers the
+   weights of all patterns at all processes, must be called by all
+   processes before the first call to resampleWeights()
+ */
+void initializeBootstrap(tree *tr)
+{
+  int
+    model,
+    i;
+
+  size_t
+    *partitionStart = (size_t *)calloc((size_t)tr->NumberOfModels + 1, sizeof(size_t)),
+    k;
+
+  bootParts = (bootstrapPartition *)calloc((size_t)tr->NumberOfModels, sizeof(bootstrapPartition));
+
+  /* the slices of a partition cover its patterns 0 ... length - 1 */
+
+  for(i = 0; i < tr->numAssignments; i++)
+    {
+      Assign
+	*a = &(tr->partAssigns[i]);
+
+      bootParts[a->partitionId].length = MAX(bootParts[a->partitionId].length, a->offset + a->width);
+    }
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    partitionStart[model + 1] = partitionStart[model] + bootParts[model].length;
+
+  /* every process enters the weights of its own patterns, the others are zero */
+
+  allWeights = (unsigned long *)calloc(MAX(partitionStart[tr->NumberOfModels], 1), sizeof(unsigned long));
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      pInfo
+	*p = &(tr->partitionData[model]);
+
+      bootstrapPartition
+	*b = &(bootParts[model]);
+
+      b->globalWeights = &(allWeights[partitionStart[model]]);
+
+      if(p->width > 0)
+	{
+	  assert(p->offset + p->width <= b->length);
+
+	  b->originalWeights = (int *)malloc(sizeof(int) * p->width);
+	  memcpy(b->originalWeights, p->wgt, sizeof(int) * p->width);
+
+	  for(k = 0; k < p->width; k++)
+	    b->globalWeights[p->offset + k] = (unsigned long)p->wgt[k];
+	}
+    }
+
+  MPI_Allreduce(MPI_IN_PLACE, allWeights, (int)partitionStart[tr->NumberOfModels], MPI_UNSIGNED_LONG, MPI_SUM, comm);
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      bootstrapPartition
+	*b = &(bootParts[model]);
+
+      for(k = 1; k < b->length; k++)
+	b->globalWeights[k] += b->globalWeights[k - 1];
+
+      b->total = (b->length > 0) ? b->globalWeights[b->length - 1] : 0;
+    }
+
+  free(partitionStart);
+}
+
+/**
+   draws a bootstrap replicate of the pattern weights of all
+   partitions. All processes must call this function with the same seed.
+ */
+void resampleWeights(tree *tr, long seed)
+{
+  int
+    model;
+
+  assert(bootParts);
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      pInfo
+	*p = &(tr->partitionData[model]);
+
+      bootstrapPartition
+	*b = &(bootParts[model]);
+
+      unsigned long
+	k;
+
+      if(b->total == 0)
+	continue;
+
+      if(p->width > 0)
+	memset(p->wgt, 0, sizeof(int) * p->width);
+
+      /* all processes draw all sites of the partition */
+
+      for(k = 0; k < b->total; k++)
+	{
+	  size_t
+	    pattern = drawIndex(b->globalWeights, b->length, drawValue(&seed, b->total));
+
+	  if(pattern >= p->offset && pattern < p->offset + p->width)
+	    p->wgt[pattern - p->offset]++;
+	}
+    }
+}
+
+/**
+   restores the original pattern weights and frees the bootstrap data structures
+ */
+void restoreWeights(tree *tr)
+{
+  int
+    model;
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      pInfo
+	*p = &(tr->partitionData[model]);
+
+      bootstrapPartition
+	*b = &(bootParts[model]);
+
+      if(b->originalWeights)
+	memcpy(p->wgt, b->originalWeights, sizeof(int) * p->width);
+
+      free(b->originalWeights);
+    }
+
+  free(bootParts);
+  bootParts = (bootstrapPartition *)NULL;
+
+  free(allWeights);
+  allWeights = (unsigned long *)NULL;
+}
@@ -17,6 +17,7 @@
 #define READ_ARRAY(file, arrPtr, numElem, size)  assert( fread(arrPtr, size, numElem, file) ==  (unsigned int) numElem)
 
 extern int processID;
+extern MPI_Comm comm;
 
 /** 
     seekPos finds the position in the byte file where a certain type
@@ -113,7 +114,7 @@ void initializeByteFile(ByteFile **bf, char *name)
 	  printf("Please parse the binary alignment file on the same hardware on which you intend to run ExaML.\n\n\n"); 
 	}
 	  
-      MPI_Barrier(MPI_COMM_WORLD);
+      MPI_Barrier(comm);
       MPI_Finalize();
       exit(-1);
     }
@@ -130,7 +131,7 @@ void initializeByteFile(ByteFile **bf, char *name)
 	  printf("Hasta siempre comandante.\n\n\n");
 	}
       
-      MPI_Barrier(MPI_COMM_WORLD);
+      MPI_Barrier(comm);
       MPI_Finalize();     
       exit(-1);
     }
@@ -146,7 +147,7 @@ void initializeByteFile(ByteFile **bf, char *name)
 	  printf("Hasta la victoria siempre.\n\n\n");
 	}
 
-      MPI_Barrier(MPI_COMM_WORLD);
+      MPI_Barrier(comm);
       MPI_Finalize();   
       exit(-1);
     }
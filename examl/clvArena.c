@@ -0,0 +1,484 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include <mpi.h>
+
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+#include "axml.h"
+
+extern int processID;
+extern int processes;
+extern MPI_Comm comm;
+
+
+/*
+   Arena for the inner likelihood vectors (--clv-arena).
+
+   Without the arena every inner vector of every partition is a separate malloc_aligned() that is
+   freed and allocated again whenever its length changes (memory saving with "-S", re-distribution of
+   the sites with "--rebalance"). With thousands of partitions this scatters the vectors over the heap
+   and, with 4KB pages, needs a TLB entry every 4KB of a traversal.
+
+   With the arena every process carves the inner vectors, the CLV cache entries, the sum buffers of
+   makenewz(), the gap columns and gap vectors of "-S", and the scaler counts (globalScaler) from a few
+   large regions that are aligned to 2MB and are backed by transparent huge pages (madvise(MADV_HUGEPAGE)).
+   The first region is sized for all vectors of the process, later regions grow with the arena.
+
+   Blocks are handed out in size classes (multiples of 64 bytes, 16 classes per power of two, i.e., a
+   block is at most 6.25% larger than requested) and freed blocks are kept in a free list per class,
+   from which the next block of the same class is taken. clvFree() needs the length of the block,
+   which the callers know anyway (xSpaceVector), such that there are no block headers and a vector
+   is not touched before firstTouchSiteData() writes it. Note that the operating system places every
+   huge page as a whole on the memory node of the thread that touches it first, hence under OpenMP
+   small partitions of different threads may share a memory node.
+
+   The arena is not thread safe, the vectors are only allocated outside of parallel regions.
+   printClvArenaReport() writes the footprint and the fragmentation of the arena of every process to
+   the info file. Without "--clv-arena" the functions below call malloc_aligned() and free().
+*/
+
+#define HUGE_PAGE_SIZE     ((size_t)2 * 1024 * 1024)
+#define MIN_REGION_SIZE    ((size_t)32 * 1024 * 1024)
+#define MAX_REGION_GROWTH  ((size_t)1024 * 1024 * 1024)
+#define MAX_REGIONS        64
+
+#define BLOCK_QUANTUM      64
+#define CLASSES_PER_POWER  16
+#define NUM_SIZE_CLASSES   1024
+
+typedef struct
+{
+  char
+    *base;
+
+  size_t
+    size,
+    used;		/* bytes carved from the start of the region */
+} arenaRegion;
+
+typedef struct
+{
+  size_t
+    regions,
+    mapped,
+    carved,
+    inUse,		/* in size classes */
+    requested,		/* as requested by the callers */
+    freeLists,
+    peak,
+    allocations,
+    reused,
+    frees;
+} arenaStatistics;
+
+static boolean
+  arenaEnabled = FALSE;
+
+static arenaRegion
+  regions[MAX_REGIONS];
+
+static void
+  *freeList[NUM_SIZE_CLASSES];
+
+static arenaStatistics
+  stats;
+
+
+/* returns the size class of a block of the given length and stores the length of the class in classBytes */
+static int sizeClass(size_t bytes, size_t *classBytes)
+{
+  size_t
+    units = (bytes + BLOCK_QUANTUM - 1) / BLOCK_QUANTUM,
+    step,
+    rounded;
+
+  int
+    exponent,
+    index;
+
+  if(units == 0)
+    units = 1;
+
+  if(units <= CLASSES_PER_POWER)
+    {
+      *classBytes = units * BLOCK_QUANTUM;
+      return (int)units - 1;
+    }
+
+  /* CLASSES_PER_POWER = 2^4 classes between 2^exponent and 2^(exponent + 1) units */
+
+  exponent = 63 - __builtin_clzll((unsigned long long)units);
+  step = (size_t)1 << (exponent - 4);
+  rounded = (units + step - 1) & ~(step - 1);
+
+  index = CLASSES_PER_POWER * (exponent - 3) + (int)(rounded / step) - CLASSES_PER_POWER - 1;
+
+  assert(index < NUM_SIZE_CLASSES);
+
+  *classBytes = rounded * BLOCK_QUANTUM;
+
+  return index;
+}
+
+static size_t roundToHugePages(size_t bytes)
+{
+  return (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+}
+
+/* maps a region of size bytes (a multiple of HUGE_PAGE_SIZE) that is aligned to HUGE_PAGE_SIZE */
+static char *mapRegion(size_t size)
+{
+#if defined(__linux__)
+  char
+    *raw = (char *)mmap((void *)NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0),
+    *aligned;
+
+  if(raw == (char *)MAP_FAILED)
+    return (char *)NULL;
+
+  aligned = (char *)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) & ~((uintptr_t)HUGE_PAGE_SIZE - 1));
+
+  /* give back the unaligned head and tail */
+
+  if(aligned > raw)
+    munmap(raw, (size_t)(aligned - raw));
+
+  if(raw + size + HUGE_PAGE_SIZE > aligned + size)
+    munmap(aligned + size, (size_t)((raw + size + HUGE_PAGE_SIZE) - (aligned + size)));
+
+#ifdef MADV_HUGEPAGE
+  madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+
+  return aligned;
+#else
+  void
+    *ptr = (void *)NULL;
+
+  if(posix_memalign(&ptr, HUGE_PAGE_SIZE, size) != 0)
+    return (char *)NULL;
+
+  return (char *)ptr;
+#endif
+}
+
+static arenaRegion *addRegion(size_t minimumBytes)
+{
+  arenaRegion
+    *r;
+
+  /* the first region fits the estimated footprint, later ones at least double the arena up to MAX_REGION_GROWTH */
+
+  size_t
+    size = (stats.regions == 0) ? MAX(minimumBytes, HUGE_PAGE_SIZE) : MAX(minimumBytes, MAX(MIN_REGION_SIZE, MIN(stats.mapped, MAX_REGION_GROWTH)));
+
+  if(stats.regions == MAX_REGIONS)
+    {
+      printf("\nError, the CLV arena of process %d needs more than %d regions\n\n", processID, MAX_REGIONS);
+      errorExit(-1);
+    }
+
+  r = &regions[stats.regions];
+
+  r->size = roundToHugePages(size);
+  r->used = 0;
+  r->base = mapRegion(r->size);
+
+  if(!r->base)
+    {
+      printf("\nError, the CLV arena of process %d could not map a region of %lu bytes\n\n", processID, (unsigned long)r->size);
+      errorExit(-1);
+    }
+
+  stats.regions++;
+  stats.mapped += r->size;
+
+  return r;
+}
+
+/* sizes the first region for all inner vectors, CLV cache entries, and per-partition buffers of this process */
+static size_t estimateFootprint(tree *tr)
+{
+  size_t
+    rateHet = discreteRateCategories(tr->rateHetModel),
+    innerVectors = (size_t)tr->mxtips - 2 + (size_t)tr->clvCacheEntries,
+    total = 0,
+    classBytes;
+
+  int
+    model;
+
+  if(tr->clvBudget > 0)
+    innerVectors = (size_t)MIN(tr->clvBudget, tr->mxtips - 2);
+
+  /* the inner vectors are mapped from the file of the CLV store */
+  if(tr->clvStoreVectors > 0)
+    innerVectors = 0;
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      size_t
+	width = (size_t)tr->partitionData[model].width,
+	states = (size_t)tr->partitionData[model].states;
+
+      /* the inner vectors and the sum buffer */
+
+      sizeClass(width * states * rateHet * sizeof(double), &classBytes);
+      total += (innerVectors + 1) * classBytes;
+
+      sizeClass(2 * (size_t)tr->mxtips * sizeof(unsigned int), &classBytes);
+      total += classBytes;
+
+      if(width > 0 && tr->saveMemory)
+	{
+	  sizeClass((size_t)tr->mxtips * states * rateHet * sizeof(double), &classBytes);
+	  total += classBytes;
+
+	  sizeClass((width / 32 + 1) * 2 * (size_t)tr->mxtips * sizeof(unsigned int), &classBytes);
+	  total += classBytes;
+	}
+    }
+
+  return total;
+}
+
+/* enables the arena with --clv-arena and maps the first region, must be called once the partitions of the process are known */
+void initClvArena(tree *tr)
+{
+  if(!tr->clvArena)
+    return;
+
+  assert(BYTE_ALIGNMENT <= BLOCK_QUANTUM);
+
+  memset(&stats, 0, sizeof(stats));
+  memset(freeList, 0, sizeof(freeList));
+
+  addRegion(estimateFootprint(tr));
+
+  arenaEnabled = TRUE;
+}
+
+void *clvAlloc(size_t bytes)
+{
+  size_t
+    classBytes;
+
+  int
+    index;
+
+  void
+    *block;
+
+  arenaRegion
+    *r;
+
+  if(!arenaEnabled)
+    return malloc_aligned(bytes);
+
+#ifdef _USE_OMP
+  assert(!omp_in_parallel());
+#endif
+
+  index = sizeClass(bytes, &classBytes);
+
+  stats.allocations++;
+  stats.inUse += classBytes;
+  stats.requested += bytes;
+  stats.peak = MAX(stats.peak, stats.inUse);
+
+  if(freeList[index])
+    {
+      block = freeList[index];
+      freeList[index] = *(void **)block;
+
+      stats.reused++;
+      stats.freeLists -= classBytes;
+
+      return block;
+    }
+
+  /* carve from the last region, the tail of the previous one is not used any more */
+
+  r = &regions[stats.regions - 1];
+
+  if(r->size - r->used < classBytes)
+    r = addRegion(classBytes);
+
+  block = r->base + r->used;
+  r->used += classBytes;
+  stats.carved += classBytes;
+
+  return block;
+}
+
+/* like clvAlloc(), but zeroes the block */
+void *clvCalloc(size_t bytes)
+{
+  void
+    *block = clvAlloc(bytes);
+
+  memset(block, 0, bytes);
+
+  return block;
+}
+
+/* returns a block of clvAlloc() or clvCalloc(), bytes must be the length that was requested */
+void clvFree(void *block, size_t bytes)
+{
+  size_t
+    classBytes;
+
+  int
+    index;
+
+  if(!arenaEnabled)
+    {
+      free(block);
+      return;
+    }
+
+  if(!block)
+    return;
+
+#ifdef _USE_OMP
+  assert(!omp_in_parallel());
+#endif
+
+  index = sizeClass(bytes, &classBytes);
+
+  *(void **)block = freeList[index];
+  freeList[index] = block;
+
+  stats.frees++;
+  stats.inUse -= classBytes;
+  stats.requested -= bytes;
+  stats.freeLists += classBytes;
+}
+
+/* returns the bytes of the regions that are backed by transparent huge pages (AnonHugePages in /proc/self/smaps) */
+static size_t hugePageBytes(void)
+{
+  size_t
+    bytes = 0;
+
+#if defined(__linux__)
+  FILE
+    *f = fopen("/proc/self/smaps", "r");
+
+  char
+    line[1024];
+
+  boolean
+    inArena = FALSE;
+
+  if(!f)
+    return 0;
+
+  while(fgets(line, sizeof(line), f))
+    {
+      unsigned long
+	start,
+	end,
+	kB;
+
+      if(sscanf(line, "%lx-%lx ", &start, &end) == 2)
+	{
+	  size_t
+	    i;
+
+	  inArena = FALSE;
+
+	  for(i = 0; i < stats.regions; i++)
+	    if((uintptr_t)start < (uintptr_t)(regions[i].base + regions[i].size) && (uintptr_t)end > (uintptr_t)regions[i].base)
+	      inArena = TRUE;
+	}
+      else
+	if(inArena && sscanf(line, "AnonHugePages: %lu kB", &kB) == 1)
+	  bytes += (size_t)kB * 1024;
+    }
+
+  fclose(f);
+#endif
+
+  return bytes;
+}
+
+#define ARENA_RECORD_LENGTH 11
+
+/* writes the footprint and fragmentation of the arenas of all processes to the info file, must be called by all processes */
+void printClvArenaReport(void)
+{
+  double
+    local[ARENA_RECORD_LENGTH],
+    *all = (double *)NULL;
+
+  if(!arenaEnabled)
+    return;
+
+  local[0]  = (double)stats.regions;
+  local[1]  = (double)stats.mapped;
+  local[2]  = (double)hugePageBytes();
+  local[3]  = (double)stats.carved;
+  local[4]  = (double)stats.inUse;
+  local[5]  = (double)stats.requested;
+  local[6]  = (double)stats.freeLists;
+  local[7]  = (double)stats.peak;
+  local[8]  = (double)stats.allocations;
+  local[9]  = (double)stats.reused;
+  local[10] = (double)stats.frees;
+
+  if(processID == 0)
+    all = (double *)malloc(sizeof(double) * ARENA_RECORD_LENGTH * (size_t)processes);
+
+  MPI_Gather(local, ARENA_RECORD_LENGTH, MPI_DOUBLE, all, ARENA_RECORD_LENGTH, MPI_DOUBLE, 0, comm);
+
+  if(processID == 0)
+    {
+      int
+	rank,
+	i;
+
+      double
+	total[ARENA_RECORD_LENGTH],
+	mb = 1024.0 * 1024.0;
+
+      memset(total, 0, sizeof(total));
+
+      printBothOpen("\nCLV arena per process (--clv-arena), sizes in MB:\n\n");
+      printBothOpen("%8s %8s %10s %10s %10s %10s %10s %10s %10s %12s %12s %12s\n", "rank", "regions", "mapped", "huge", "carved",
+		    "in use", "requested", "free", "peak", "allocations", "reused", "frees");
+
+      for(rank = 0; rank < processes; rank++)
+	{
+	  double
+	    *r = &all[rank * ARENA_RECORD_LENGTH];
+
+	  for(i = 0; i < ARENA_RECORD_LENGTH; i++)
+	    total[i] += r[i];
+
+	  printBothOpen("%8d %8.0f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %12.0f %12.0f %12.0f\n", rank, r[0],
+			r[1] / mb, r[2] / mb, r[3] / mb, r[4] / mb, r[5] / mb, r[6] / mb, r[7] / mb, r[8], r[9], r[10]);
+	}
+
+      /* rounding to the size classes, blocks in the free lists, and mapped memory that was never carved */
+
+      if(total[3] > 0.0)
+	printBothOpen("\nCLV arena fragmentation: %f%% size class rounding, %f%% in free lists, %f%% of the mapped memory not carved\n",
+		      (total[4] > 0.0) ? 100.0 * (total[4] - total[5]) / total[4] : 0.0,
+		      100.0 * total[6] / total[3],
+		      100.0 * (total[1] - total[3]) / total[1]);
+
+      free(all);
+    }
+}
@@ -0,0 +1,557 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include <mpi.h>
+
+#include "axml.h"
+
+
+/*
+   Bounded cache of inner conditional likelihood vectors (CLVs) for the SPR search.
+
+   When rearrangeBIG() prunes a subtree and tries to insert it into the branches around
+   its original position, the vectors along the paths to the insertion branches are
+   re-oriented, and they must be re-oriented once more when the subtree is hooked back
+   and the tree is restored. The content of such a vector is fully determined by the
+   subtree it summarizes and the branch lengths in it, hence we identify every vector by a
+   64-bit hash of the subtree topology and the branch lengths (the key) and keep the
+   content of a vector that is about to be re-oriented in a cache entry instead of discarding it.
+
+   The hooks are in computeTraversalInfo(): before a partial traversal descends into
+   the subtree of an inner node p, we compute the key of p and
+
+   - p is not re-computed if the vector at p is oriented correctly and its key matches,
+   - the vector is restored from the cache if there is an entry with this key,
+   - otherwise p is re-computed as usual. If this flips the orientation of the vector at
+     the node, its current content is saved to the cache first.
+
+   In all cases the traversal still descends into the subtree of p: the vectors in there that are
+   not oriented towards p may have been computed while the tree was modified (e.g., while the
+   subtree was pruned), hence they must be restored or re-computed as without the cache.
+
+   Vectors are never copied: restoring and saving swap the vector (and scaler) pointers of
+   the node with those of a cache entry. The cache holds a fixed number of entries that
+   are replaced in least recently used order, all processes take the same decisions since
+   they work on the same tree.
+
+   The cache is only used within the window that rearrangeBIG() opens for pruning a subtree,
+   trying its insertions, and hooking it back (startClvCacheWindow(), stopClvCacheWindow()).
+   Only vectors computed before the window started are saved: they describe the tree as it
+   is restored at the end of the window, whereas the vectors computed for the pruned tree
+   and the insertions are hardly ever needed again. The cache is flushed when the window is
+   closed.
+
+   A full traversal flushes the cache, since it is only called after the model parameters or
+   the site assignment have changed. Vectors that are computed with a masked traversal
+   (not all partitions executed) get an unknown key (0) and are never cached.
+*/
+
+#ifdef _USE_OMP
+#define SCALER_SLOTS(tr) (1 + (size_t)(tr)->nThreads)
+#else
+#define SCALER_SLOTS(tr) ((size_t)1)
+#endif
+
+typedef struct
+{
+  uint64_t
+    key;
+
+  int
+    nextInBucket;
+
+  double
+    **x;
+
+  size_t
+    *space;
+
+  unsigned int
+    *scalers;
+} clvCacheEntry;
+
+
+static tree
+  *cacheTree = (tree *)NULL;
+
+static clvCacheEntry
+  *entries = (clvCacheEntry *)NULL;
+
+static int
+  *buckets = (int *)NULL,
+  *freeEntries = (int *)NULL;
+
+static int
+  numberOfEntries = 0,
+  numberOfBuckets = 0,
+  freeCount = 0,
+  usedCount = 0;
+
+/* least recently used order of the used entries */
+static lruList
+  entryOrder;
+
+/* key of the current content of the vector at each inner node, 0 if unknown */
+static uint64_t
+  *nodeKey = (uint64_t *)NULL;
+
+/* number of the window in which the current content of the vector at each inner node was computed */
+static unsigned int
+  *nodeWindow = (unsigned int *)NULL,
+  window = 0;
+
+static boolean
+  inWindow = FALSE;
+
+/* statistics */
+static double
+  cacheHits = 0.0,
+  unchangedHits = 0.0,
+  cacheMisses = 0.0,
+  cacheSaves = 0.0,
+  cacheEvictions = 0.0;
+
+
+static uint64_t mixKey(uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+
+  return x;
+}
+
+static uint64_t subtreeKey(nodeptr p);
+
+/* key of the subtree at c including the length of the branch c, c->back */
+static uint64_t branchKey(nodeptr c)
+{
+  uint64_t
+    key = subtreeKey(c),
+    z;
+
+  if(key == 0)
+    return 0;
+
+  memcpy(&z, &(c->z[0]), sizeof(uint64_t));
+
+  return mixKey(key ^ mixKey(z + 0x9e3779b97f4a7c15ULL));
+}
+
+/* the key does not depend on the order of the two descendants */
+static uint64_t combineKeys(nodeptr p)
+{
+  uint64_t
+    a = branchKey(p->next->back),
+    b = branchKey(p->next->next->back),
+    key;
+
+  if(a == 0 || b == 0)
+    return 0;
+
+  if(a > b)
+    {
+      uint64_t
+	tmp = a;
+      a = b;
+      b = tmp;
+    }
+
+  key = mixKey(a ^ mixKey(b + 0x632be59bd9b4e019ULL));
+
+  return (key == 0) ? 1 : key;
+}
+
+static uint64_t subtreeKey(nodeptr p)
+{
+  if(isTip(p->number, cacheTree->mxtips))
+    {
+      uint64_t
+	key = mixKey((uint64_t)p->number + 0x2545f4914f6cdd1dULL);
+
+      return (key == 0) ? 1 : key;
+    }
+
+  if(p->x)
+    return nodeKey[p->number];
+
+  return combineKeys(p);
+}
+
+static int findEntry(uint64_t key)
+{
+  int
+    e = buckets[key % (uint64_t)numberOfBuckets];
+
+  while(e >= 0 && entries[e].key != key)
+    e = entries[e].nextInBucket;
+
+  return e;
+}
+
+static void insertIntoBucket(int e)
+{
+  int
+    b = (int)(entries[e].key % (uint64_t)numberOfBuckets);
+
+  entries[e].nextInBucket = buckets[b];
+  buckets[b] = e;
+}
+
+static void removeFromBucket(int e)
+{
+  int
+    *link = &(buckets[entries[e].key % (uint64_t)numberOfBuckets]);
+
+  while(*link != e)
+    {
+      assert(*link >= 0);
+      link = &(entries[*link].nextInBucket);
+    }
+
+  *link = entries[e].nextInBucket;
+}
+
+static void releaseEntry(int e)
+{
+  removeFromBucket(e);
+  unlinkLruEntry(&entryOrder, e);
+  entries[e].key = 0;
+  usedCount--;
+  freeEntries[freeCount++] = e;
+}
+
+/* exchanges the vectors and scalers of inner node number with those of entry e */
+static void swapVectors(int number, int e)
+{
+  tree
+    *tr = cacheTree;
+
+  clvCacheEntry
+    *entry = &(entries[e]);
+
+  int
+    model,
+    index = number - tr->mxtips - 1;
+
+  size_t
+    slots = SCALER_SLOTS(tr);
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      pInfo
+	*pr = &(tr->partitionData[model]);
+
+      double
+	*x = pr->xVector[index];
+
+      size_t
+	space = pr->xSpaceVector[index];
+
+      unsigned int
+	scaler = pr->globalScaler[number];
+
+      pr->xVector[index] = entry->x[model];
+      pr->xSpaceVector[index] = entry->space[model];
+      pr->globalScaler[number] = entry->scalers[model * slots];
+
+      entry->x[model] = x;
+      entry->space[model] = space;
+      entry->scalers[model * slots] = scaler;
+
+#ifdef _USE_OMP
+      {
+	int
+	  tid;
+
+	for(tid = 0; tid < tr->nThreads; tid++)
+	  if(pr->threadGlobalScaler[tid])
+	    {
+	      scaler = pr->threadGlobalScaler[tid][number];
+	      pr->threadGlobalScaler[tid][number] = entry->scalers[model * slots + 1 + (size_t)tid];
+	      entry->scalers[model * slots + 1 + (size_t)tid] = scaler;
+	    }
+      }
+#endif
+    }
+}
+
+/* moves the current content of the vector at node number into the cache */
+static void saveVector(int number)
+{
+  uint64_t
+    key = nodeKey[number];
+
+  int
+    e;
+
+  if(key == 0 || nodeWindow[number] == window || findEntry(key) >= 0)
+    return;
+
+  if(freeCount > 0)
+    e = freeEntries[--freeCount];
+  else
+    {
+      e = entryOrder.oldest;
+      removeFromBucket(e);
+      unlinkLruEntry(&entryOrder, e);
+      usedCount--;
+      cacheEvictions += 1.0;
+    }
+
+  swapVectors(number, e);
+
+  entries[e].key = key;
+  insertIntoBucket(e);
+  linkLruEntryAsNewest(&entryOrder, e);
+  usedCount++;
+  nodeKey[number] = 0;
+
+  cacheSaves += 1.0;
+}
+
+static void flushClvCache(void)
+{
+  int
+    e;
+
+  for(e = 0; e < numberOfEntries; e++)
+    entries[e].key = 0;
+
+  for(e = 0; e < numberOfBuckets; e++)
+    buckets[e] = -1;
+
+  for(e = 0; e < numberOfEntries; e++)
+    freeEntries[e] = e;
+
+  freeCount = numberOfEntries;
+  usedCount = 0;
+  emptyLruList(&entryOrder);
+}
+
+/**
+   allocates tr->clvCacheEntries vectors with the length of the inner vectors for the local sites,
+   must be called again after the site assignment has changed
+ */
+void initClvCache(tree *tr)
+{
+  int
+    e,
+    model;
+
+  size_t
+    rateHet = discreteRateCategories(tr->rateHetModel),
+    slots = SCALER_SLOTS(tr);
+
+  assert(tr->clvCacheEntries > 0 && !tr->saveMemory && tr->numBranches == 1);
+  assert(!cacheTree);
+
+  cacheTree = tr;
+
+  numberOfEntries = tr->clvCacheEntries;
+  numberOfBuckets = 2 * numberOfEntries + 1;
+
+  entries = (clvCacheEntry *)calloc((size_t)numberOfEntries, sizeof(clvCacheEntry));
+  buckets = (int *)malloc(sizeof(int) * (size_t)numberOfBuckets);
+  freeEntries = (int *)malloc(sizeof(int) * (size_t)numberOfEntries);
+  initLruList(&entryOrder, numberOfEntries);
+  nodeKey = (uint64_t *)calloc(2 * (size_t)tr->mxtips, sizeof(uint64_t));
+  nodeWindow = (unsigned int *)calloc(2 * (size_t)tr->mxtips, sizeof(unsigned int));
+  window = 0;
+  inWindow = FALSE;
+
+  for(e = 0; e < numberOfEntries; e++)
+    {
+      clvCacheEntry
+	*entry = &(entries[e]);
+
+      entry->x = (double **)malloc(sizeof(double *) * (size_t)tr->NumberOfModels);
+      entry->space = (size_t *)malloc(sizeof(size_t) * (size_t)tr->NumberOfModels);
+      entry->scalers = (unsigned int *)calloc((size_t)tr->NumberOfModels * slots, sizeof(unsigned int));
+
+      for(model = 0; model < tr->NumberOfModels; model++)
+	{
+	  size_t
+	    length = (size_t)tr->partitionData[model].width * rateHet * (size_t)tr->partitionData[model].states * sizeof(double);
+
+	  entry->x[model] = (length > 0) ? (double *)clvAlloc(length) : (double *)NULL;
+	  entry->space[model] = length;
+	}
+    }
+
+  flushClvCache();
+}
+
+void freeClvCache(tree *tr)
+{
+  int
+    e,
+    model;
+
+  assert(cacheTree == tr);
+
+  for(e = 0; e < numberOfEntries; e++)
+    {
+      for(model = 0; model < tr->NumberOfModels; model++)
+	if(entries[e].x[model])
+	  clvFree(entries[e].x[model], entries[e].space[model]);
+
+      free(entries[e].x);
+      free(entries[e].space);
+      free(entries[e].scalers);
+    }
+
+  free(entries);
+  free(buckets);
+  free(freeEntries);
+  freeLruList(&entryOrder);
+  free(nodeKey);
+  free(nodeWindow);
+
+  entries = (clvCacheEntry *)NULL;
+  buckets = (int *)NULL;
+  freeEntries = (int *)NULL;
+  nodeKey = (uint64_t *)NULL;
+  nodeWindow = (unsigned int *)NULL;
+  numberOfEntries = 0;
+  cacheTree = (tree *)NULL;
+}
+
+/**
+   called by rearrangeBIG() before it prunes a subtree, from now on the vectors computed
+   before are saved when they are re-oriented
+ */
+void startClvCacheWindow(void)
+{
+  if(!cacheTree)
+    return;
+
+  window++;
+  inWindow = TRUE;
+}
+
+/**
+   called by rearrangeBIG() once the pruned subtree has been hooked back and the vectors
+   around it have been restored
+ */
+void stopClvCacheWindow(void)
+{
+  if(!cacheTree)
+    return;
+
+  if(usedCount > 0)
+    flushClvCache();
+
+  inWindow = FALSE;
+}
+
+/**
+   called by computeTraversalInfo() for the inner node p before descending into its subtree.
+   Returns TRUE if the vector at p is valid (it was either already up to date or has been
+   restored from the cache) and must not be added to the traversal descriptor.
+ */
+boolean restoreFromClvCache(nodeptr p, boolean partialTraversal)
+{
+  uint64_t
+    key;
+
+  int
+    e,
+    number = p->number;
+
+  if(!cacheTree)
+    return FALSE;
+
+  if(!partialTraversal)
+    {
+      if(usedCount > 0)
+	flushClvCache();
+      return FALSE;
+    }
+
+  if(!inWindow)
+    return FALSE;
+
+  key = combineKeys(p);
+
+  if(key != 0 && p->x && nodeKey[number] == key)
+    {
+      unchangedHits += 1.0;
+      return TRUE;
+    }
+
+  e = (key != 0) ? findEntry(key) : -1;
+
+  if(e >= 0)
+    {
+      /* the old content of the node takes the place of the cached one if it is still worth keeping */
+
+      swapVectors(number, e);
+
+      if(!p->x && nodeKey[number] != 0 && nodeWindow[number] != window && findEntry(nodeKey[number]) < 0)
+	{
+	  removeFromBucket(e);
+	  entries[e].key = nodeKey[number];
+	  insertIntoBucket(e);
+	  touchLruEntry(&entryOrder, e);
+	  cacheSaves += 1.0;
+	}
+      else
+	releaseEntry(e);
+
+      /* the cached content was computed before the window */
+      nodeKey[number] = key;
+      nodeWindow[number] = window - 1;
+
+      if(!p->x)
+	getxnode(p);
+
+      cacheHits += 1.0;
+      return TRUE;
+    }
+
+  cacheMisses += 1.0;
+
+  if(!p->x)
+    saveVector(number);
+
+  return FALSE;
+}
+
+/**
+   called by computeTraversalInfo() once the inner node p has been added to the traversal descriptor,
+   the descendants of p are oriented correctly at this point
+ */
+void updateClvKey(nodeptr p)
+{
+  int
+    model;
+
+  if(!cacheTree)
+    return;
+
+  for(model = 0; model < cacheTree->NumberOfModels; model++)
+    if(!cacheTree->executeModel[model])
+      {
+	nodeKey[p->number] = 0;
+	return;
+      }
+
+  nodeKey[p->number] = combineKeys(p);
+  nodeWindow[p->number] = window;
+}
+
+void printClvCacheStatistics(void)
+{
+  double
+    lookups = cacheHits + cacheMisses;
+
+  if(lookups > 0.0)
+    printBothOpen("\nCLV cache: %.0f hits, %.0f misses (hit rate %f%%), %.0f vectors unchanged, %.0f saved, %.0f evicted\n",
+		  cacheHits, cacheMisses, 100.0 * cacheHits / lookups, unchangedHits, cacheSaves, cacheEvictions);
+}
@@ -0,0 +1,455 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include <mpi.h>
+
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+#include "axml.h"
+
+extern int processID;
+extern int processes;
+extern MPI_Comm comm;
+extern char workdir[1024];
+extern char run_id[128];
+
+
+/*
+   Out-of-core storage of the inner likelihood vectors (--clv-store=numberOfVectors[,directory]).
+
+   Every process maps a file that holds one row per inner node with the vectors of all its
+   partitions (MAP_SHARED), and xVector of every partition points into it. The kernels read and
+   write the vectors as before, the page cache of the operating system moves them between memory
+   and the file. The file is deleted right after it has been created, such that it goes away with
+   the process, and it should be placed on a fast local disk.
+
+   The store keeps at most numberOfVectors rows resident. The rows used by the entries of a
+   traversal descriptor become the most recent ones, and once there are too many the least recently
+   used row is unmapped, its dirty pages are written back asynchronously (sync_file_range()), and
+   its pages are dropped from the page cache a few evictions later, once they have been written.
+
+   Since the traversal descriptor tells us which vectors are needed next, clvStoreEntry()
+   prefetches the rows of the entry PREFETCH_DISTANCE entries ahead of the one that is computed
+   (MADV_WILLNEED), i.e., the reads are overlapped with the computation. After the last entry
+   the rows of the branch that evaluate() or makenewz() use are prefetched. A row that is about
+   to be recomputed does not need its old contents: without OpenMP we punch a hole into the file
+   instead of reading it (fallocate()), under OpenMP a thread may already be writing the row.
+   With --task-traversal the entries are not computed in order, hence only the first ones are prefetched.
+
+   Inner vectors are assigned to rows by node number, hence the store can not be combined with
+   the memory saving option (-S), the CLV cache, or the CLV budget.
+*/
+
+#define PREFETCH_DISTANCE   4
+#define WRITEBACK_LAG       8
+#define MIN_STORE_VECTORS   (3 * PREFETCH_DISTANCE)
+
+static tree
+  *storeTree = (tree *)NULL;
+
+static int
+  fileDescriptor = -1,
+  rows = 0,
+  resident = 0,
+  writeback[WRITEBACK_LAG],
+  evictions = 0;
+
+static char
+  *storeBase = (char *)NULL;
+
+static size_t
+  rowBytes = 0,
+  pageSize = 0;
+
+static lruList
+  residentRows;			/* LRU list of the resident rows */
+
+static int
+  *computedIn = (int *)NULL,	/* traversal that computes a row, such that it is not read */
+  traversalNumber = 0;
+
+static boolean
+  *isResident = (boolean *)NULL,
+  discardRows = FALSE;		/* the traversal recomputes all partitions of a row */
+
+static unsigned char
+  *pageVector = (unsigned char *)NULL;
+
+/* statistics, summed over all stores of the run */
+static double
+  readVectors = 0.0,
+  readBytes = 0.0,
+  punchedVectors = 0.0,
+  evictedVectors = 0.0;
+
+
+static boolean isStoreThread(void)
+{
+  if(!storeBase)
+    return FALSE;
+
+#ifdef _USE_OMP
+  if(omp_get_thread_num() != 0)
+    return FALSE;
+#endif
+
+  return TRUE;
+}
+
+/* writes the least recently used row back and drops it from memory */
+static void evictRow(void)
+{
+  int
+    row = residentRows.oldest,
+    lagging;
+
+  off_t
+    offset = (off_t)row * (off_t)rowBytes;
+
+  unlinkLruEntry(&residentRows, row);
+  isResident[row] = FALSE;
+  resident--;
+
+  /* unmapping hands the dirty pages to the page cache, from where they are written asynchronously */
+
+  madvise(storeBase + offset, rowBytes, MADV_DONTNEED);
+  sync_file_range(fileDescriptor, offset, (off_t)rowBytes, SYNC_FILE_RANGE_WRITE);
+
+  /* pages can only be dropped from the page cache once they have been written */
+
+  lagging = writeback[evictions % WRITEBACK_LAG];
+
+  if(lagging >= 0 && !isResident[lagging])
+    posix_fadvise(fileDescriptor, (off_t)lagging * (off_t)rowBytes, (off_t)rowBytes, POSIX_FADV_DONTNEED);
+
+  writeback[evictions % WRITEBACK_LAG] = row;
+  evictions++;
+
+  evictedVectors += 1.0;
+}
+
+static void touchRow(int row)
+{
+  if(isResident[row])
+    {
+      touchLruEntry(&residentRows, row);
+      return;
+    }
+
+  isResident[row] = TRUE;
+  resident++;
+  linkLruEntryAsNewest(&residentRows, row);
+
+  while(resident > storeTree->clvStoreVectors)
+    evictRow();
+}
+
+/* starts reading a row that is not resident, or discards it if it will be overwritten */
+static void prefetchRow(int row, boolean overwritten)
+{
+  char
+    *start = storeBase + (size_t)row * rowBytes;
+
+  size_t
+    i,
+    pages = rowBytes / pageSize,
+    missing = 0;
+
+  if(isResident[row])
+    return;
+
+#ifndef _USE_OMP
+  if(overwritten && discardRows && fallocate(fileDescriptor, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t)row * (off_t)rowBytes, (off_t)rowBytes) == 0)
+    {
+      punchedVectors += 1.0;
+      return;
+    }
+#endif
+
+  if(mincore(start, rowBytes, pageVector) == 0)
+    for(i = 0; i < pages; i++)
+      if(!(pageVector[i] & 1))
+	missing++;
+
+  if(missing > 0)
+    {
+      madvise(start, rowBytes, MADV_WILLNEED);
+
+      readVectors += 1.0;
+      readBytes += (double)missing * (double)pageSize;
+    }
+}
+
+/* row of an inner node, -1 for tips */
+static int nodeRow(int number)
+{
+  if(isTip(number, storeTree->mxtips))
+    return -1;
+
+  return number - storeTree->mxtips - 1;
+}
+
+/* prefetches the rows of entry index of the traversal descriptor, index count stands for the final branch */
+static void prefetchEntry(int index)
+{
+  traversalInfo
+    *ti = storeTree->td[0].ti;
+
+  int
+    count = storeTree->td[0].count,
+    row;
+
+  /* the children of an entry are computed by earlier entries of the descriptor or are read from the store */
+
+  if(index < count)
+    {
+      prefetchRow(ti[index].pSlot, TRUE);
+      computedIn[ti[index].pSlot] = traversalNumber;
+
+      if(ti[index].qSlot >= 0 && computedIn[ti[index].qSlot] != traversalNumber)
+	prefetchRow(ti[index].qSlot, FALSE);
+
+      if(ti[index].rSlot >= 0 && computedIn[ti[index].rSlot] != traversalNumber)
+	prefetchRow(ti[index].rSlot, FALSE);
+    }
+  else
+    if(index == count && count > 0)
+      {
+	if((row = nodeRow(ti[0].pNumber)) >= 0)
+	  {
+	    if(computedIn[row] != traversalNumber)
+	      prefetchRow(row, FALSE);
+	    touchRow(row);
+	  }
+
+	if((row = nodeRow(ti[0].qNumber)) >= 0)
+	  {
+	    if(computedIn[row] != traversalNumber)
+	      prefetchRow(row, FALSE);
+	    touchRow(row);
+	  }
+      }
+}
+
+/* called before the entries of the traversal descriptor from startIndex on are computed */
+void clvStoreTraversal(tree *tr, int startIndex)
+{
+  int
+    i;
+
+  if(!isStoreThread())
+    return;
+
+  traversalNumber++;
+
+  /* a masked traversal keeps the vectors of the converged partitions */
+
+  discardRows = TRUE;
+
+  for(i = 0; i < tr->NumberOfModels; i++)
+    if(!tr->td[0].executeModel[i])
+      discardRows = FALSE;
+
+  for(i = startIndex; i < startIndex + PREFETCH_DISTANCE; i++)
+    prefetchEntry(i);
+}
+
+/* called before entry index of the traversal descriptor is computed */
+void clvStoreEntry(tree *tr, int index)
+{
+  traversalInfo
+    *ti;
+
+  if(!isStoreThread())
+    return;
+
+  ti = &(tr->td[0].ti[index]);
+
+  prefetchEntry(index + PREFETCH_DISTANCE);
+
+  if(ti->qSlot >= 0)
+    touchRow(ti->qSlot);
+
+  if(ti->rSlot >= 0)
+    touchRow(ti->rSlot);
+
+  touchRow(ti->pSlot);
+}
+
+/**
+   maps the store of this process and points the inner vectors of all partitions into it.
+   Also called again after the sites have been re-distributed, all inner vectors are invalid afterwards.
+ */
+void initClvStore(tree *tr)
+{
+  char
+    fileName[2048];
+
+  size_t
+    *modelOffset = (size_t *)malloc(sizeof(size_t) * (size_t)tr->NumberOfModels),
+    rateHet = discreteRateCategories(tr->rateHetModel);
+
+  int
+    model,
+    i;
+
+  assert(tr->clvStoreVectors > 0 && !tr->saveMemory && tr->clvBudget == 0 && tr->clvCacheEntries == 0);
+
+  freeClvStore(tr);
+
+  storeTree = tr;
+  pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+  /* one row per node, the vectors of the partitions are aligned to 64 bytes and the rows to pages */
+
+  rowBytes = 0;
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      modelOffset[model] = rowBytes;
+      rowBytes += ((size_t)tr->partitionData[model].width * (size_t)tr->partitionData[model].states * rateHet * sizeof(double) + 63) & ~(size_t)63;
+    }
+
+  rowBytes = MAX(pageSize, (rowBytes + pageSize - 1) & ~(pageSize - 1));
+  rows = tr->mxtips;
+
+  if(tr->clvStoreDirectory)
+    sprintf(fileName, "%s/ExaML_clvStore.%s.%d", tr->clvStoreDirectory, run_id, processID);
+  else
+    sprintf(fileName, "%sExaML_clvStore.%s.%d", workdir, run_id, processID);
+
+  fileDescriptor = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0600);
+
+  if(fileDescriptor < 0 || ftruncate(fileDescriptor, (off_t)rows * (off_t)rowBytes) != 0)
+    {
+      printf("\nError, process %d could not create the CLV store %s of %lu bytes: %s\n\n", processID, fileName,
+	     (unsigned long)rows * (unsigned long)rowBytes, strerror(errno));
+      errorExit(-1);
+    }
+
+  unlink(fileName);
+
+  storeBase = (char *)mmap((void *)NULL, (size_t)rows * rowBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+
+  if(storeBase == (char *)MAP_FAILED)
+    {
+      printf("\nError, process %d could not map the CLV store: %s\n\n", processID, strerror(errno));
+      errorExit(-1);
+    }
+
+  /* the rows are accessed by node, the prefetching is done by us */
+
+  madvise(storeBase, (size_t)rows * rowBytes, MADV_RANDOM);
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      pInfo
+	*p = &(tr->partitionData[model]);
+
+      for(i = 0; i < rows; i++)
+	{
+	  assert(!p->xVector[i]);
+
+	  p->xVector[i] = (double *)(storeBase + (size_t)i * rowBytes + modelOffset[model]);
+	  p->xSpaceVector[i] = (size_t)p->width * (size_t)p->states * rateHet * sizeof(double);
+	}
+    }
+
+  initLruList(&residentRows, rows);
+  isResident = (boolean *)calloc((size_t)rows, sizeof(boolean));
+  computedIn = (int *)calloc((size_t)rows, sizeof(int));
+  pageVector = (unsigned char *)malloc(rowBytes / pageSize);
+
+  resident = 0;
+  evictions = 0;
+
+  for(i = 0; i < WRITEBACK_LAG; i++)
+    writeback[i] = -1;
+
+  /* the vectors in the file are not valid */
+
+  for(i = tr->mxtips + 1; i < 2 * tr->mxtips; i++)
+    {
+      nodeptr
+	p = tr->nodep[i];
+
+      p->x = 0;
+      p->next->x = 0;
+      p->next->next->x = 0;
+    }
+
+  free(modelOffset);
+}
+
+/* unmaps the store, the inner vectors of all partitions are NULL afterwards */
+void freeClvStore(tree *tr)
+{
+  int
+    model,
+    i;
+
+  if(!storeBase)
+    return;
+
+  assert(storeTree == tr);
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    for(i = 0; i < rows; i++)
+      {
+	tr->partitionData[model].xVector[i] = (double *)NULL;
+	tr->partitionData[model].xSpaceVector[i] = 0;
+      }
+
+  munmap(storeBase, (size_t)rows * rowBytes);
+  close(fileDescriptor);
+
+  freeLruList(&residentRows);
+  free(isResident);
+  free(computedIn);
+  free(pageVector);
+
+  storeBase = (char *)NULL;
+  fileDescriptor = -1;
+  isResident = (boolean *)NULL;
+  computedIn = (int *)NULL;
+  pageVector = (unsigned char *)NULL;
+  storeTree = (tree *)NULL;
+}
+
+/* smallest number of resident vectors the store can work with for a tree with the given number of taxa */
+int minimumClvStoreVectors(int numberOfTaxa)
+{
+  return MIN(MIN_STORE_VECTORS, numberOfTaxa - 2);
+}
+
+/* writes the size and the traffic of the stores of all processes to the info file, must be called by all processes */
+void printClvStoreReport(tree *tr)
+{
+  double
+    local[5],
+    total[5];
+
+  if(tr->clvStoreVectors == 0)
+    return;
+
+  local[0] = (double)rows * (double)rowBytes;
+  local[1] = readVectors;
+  local[2] = readBytes;
+  local[3] = punchedVectors;
+  local[4] = evictedVectors;
+
+  MPI_Reduce(local, total, 5, MPI_DOUBLE, MPI_SUM, 0, comm);
+
+  if(processID == 0)
+    printBothOpen("\nCLV store: %d of %d inner vectors resident, %.1f MB of files on %d processes, %.0f vectors (%.1f MB) read, %.0f discarded before recomputation, %.0f evicted\n",
+		  MIN(tr->clvStoreVectors, tr->mxtips - 2), tr->mxtips - 2, total[0] / (1024.0 * 1024.0), processes, total[1], total[2] / (1024.0 * 1024.0), total[3], total[4]);
+}
@@ -10,6 +10,7 @@
 
 extern int processes; 
 extern int processID; 
+extern MPI_Comm comm;
 
 
 
@@ -98,7 +99,7 @@ void scatterDistrbutedArray(tree *tr, void *src, void *destination, MPI_Datatype
       free(seenPerProcesses); 
     }
   
-  MPI_Scatterv(srcReordered, countPerProc, displPerProc, type, destination, countPerProc[processID], type, 0, MPI_COMM_WORLD); 
+  MPI_Scatterv(srcReordered, countPerProc, displPerProc, type, destination, countPerProc[processID], type, 0, comm); 
  
   /* after this scatter, every process already has the data correctly
      ordered at its repective base pointer */
@@ -138,7 +139,7 @@ void gatherDistributedArray(tree *tr, void **destinationPtr, void *src, MPI_Data
       destination = *destinationPtr; 
     }
   
-  MPI_Gatherv(src, countPerProc[processID], type, destinationUnordered, countPerProc, displPerProc, type,0 , MPI_COMM_WORLD ); 
+  MPI_Gatherv(src, countPerProc[processID], type, destinationUnordered, countPerProc, displPerProc, type,0 , comm ); 
   
   /*
     here the master reorders the array it has obtained. Afterwards,
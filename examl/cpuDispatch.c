@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <mpi.h>
+
+#include "axml.h"
+
+extern int processID;
+extern MPI_Comm comm;
+
+
+/*
+   Run-time selection of the likelihood kernels (Makefile.MULTI.gcc).
+
+   The kernel files are compiled once per instruction set, see the comment on _KERNEL_ISA in
+   axml.h:
+
+   SSE3:   the SSE3 kernels of newviewGenericSpecial.c, evaluateGenericSpecial.c, and makenewzGenericSpecial.c
+   AVX:    the AVX kernels (-D__AVX), including avxLikelihood.c
+   AVX2:   the AVX kernels compiled with -mavx2 -mfma, such that the compiler fuses the multiply-adds
+   AVX512: the AVX-512 kernels of avx512Likelihood.c (-D__AVX512) for DNA and protein data under GAMMA,
+           the NSTATE kernels with 512-bit vectors, and the AVX kernels for everything else
+
+   At start-up selectKernels() picks the fastest set the CPU supports (or the one given with
+   --kernels) with cpuid, via __builtin_cpu_supports(), which also checks that the operating
+   system saves the AVX and AVX-512 registers. The functions below forward the calls of the
+   remaining code to the selected set. Every process selects on its own, hence a single binary
+   uses the best kernels on all nodes of a heterogeneous cluster.
+
+   The results of the sets agree up to rounding, except that the fused multiply-adds of AVX2
+   and AVX512 may change the last digits of the likelihood.
+*/
+
+#define DECLARE_KERNEL_SET(isa)						\
+  extern void isa ## _newviewIterative(tree *tr, int startIndex);	\
+  extern void isa ## _newviewTraversal(tree *tr, int startIndex);	\
+  extern void isa ## _newviewGeneric(tree *tr, nodeptr p, boolean masked); \
+  extern void isa ## _computeTraversalInfo(nodeptr p, traversalInfo *ti, int *counter, int maxTips, int numBranches, boolean partialTraversal); \
+  extern boolean isa ## _isGap(unsigned int *x, size_t pos);		\
+  extern boolean isa ## _noGap(unsigned int *x, size_t pos);		\
+  extern void isa ## _evaluateIterative(tree *tr);			\
+  extern void isa ## _evaluateGeneric(tree *tr, nodeptr p, boolean fullTraversal); \
+  extern void isa ## _evaluateInsertion(tree *tr, nodeptr p);		\
+  extern void isa ## _makenewzIterative(tree *tr);			\
+  extern void isa ## _makenewzGeneric(tree *tr, nodeptr p, nodeptr q, double *z0, int maxiter, double *result, boolean mask); \
+  extern void isa ## _execCore(tree *tr, volatile double *dlnLdlz, volatile double *d2lnLdlz2);
+
+#define KERNEL_SET(isa)							\
+  {#isa,								\
+      isa ## _newviewIterative, isa ## _newviewTraversal, isa ## _newviewGeneric, isa ## _computeTraversalInfo, \
+      isa ## _isGap, isa ## _noGap,					\
+      isa ## _evaluateIterative, isa ## _evaluateGeneric, isa ## _evaluateInsertion, \
+      isa ## _makenewzIterative, isa ## _makenewzGeneric, isa ## _execCore}
+
+DECLARE_KERNEL_SET(SSE3)
+DECLARE_KERNEL_SET(AVX)
+DECLARE_KERNEL_SET(AVX2)
+DECLARE_KERNEL_SET(AVX512)
+
+typedef struct
+{
+  const char
+    *name;
+
+  void (*newviewIterative)(tree *, int);
+  void (*newviewTraversal)(tree *, int);
+  void (*newviewGeneric)(tree *, nodeptr, boolean);
+  void (*computeTraversalInfo)(nodeptr, traversalInfo *, int *, int, int, boolean);
+  boolean (*isGap)(unsigned int *, size_t);
+  boolean (*noGap)(unsigned int *, size_t);
+  void (*evaluateIterative)(tree *);
+  void (*evaluateGeneric)(tree *, nodeptr, boolean);
+  void (*evaluateInsertion)(tree *, nodeptr);
+  void (*makenewzIterative)(tree *);
+  void (*makenewzGeneric)(tree *, nodeptr, nodeptr, double *, int, double *, boolean);
+  void (*execCore)(tree *, volatile double *, volatile double *);
+} likelihoodKernels;
+
+/* indexed by KERNELS_SSE3 ... KERNELS_AVX512 */
+
+static const likelihoodKernels
+  kernelSets[NUM_KERNEL_SETS] = {KERNEL_SET(SSE3), KERNEL_SET(AVX), KERNEL_SET(AVX2), KERNEL_SET(AVX512)};
+
+static const likelihoodKernels
+  *kernels = &kernelSets[KERNELS_SSE3];
+
+static boolean isSupported(int kernelSet)
+{
+  __builtin_cpu_init();
+
+  switch(kernelSet)
+    {
+    case KERNELS_SSE3:
+      return (__builtin_cpu_supports("sse3")) ? TRUE : FALSE;
+    case KERNELS_AVX:
+      return (__builtin_cpu_supports("avx")) ? TRUE : FALSE;
+    case KERNELS_AVX2:
+      return (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ? TRUE : FALSE;
+    case KERNELS_AVX512:
+      return (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ? TRUE : FALSE;
+    default:
+      assert(0);
+    }
+
+  return FALSE;
+}
+
+/* returns the instruction set of the given name (case insensitive), -1 if there is no such set */
+int kernelSetByName(const char *name)
+{
+  int
+    i;
+
+  for(i = 0; i < NUM_KERNEL_SETS; i++)
+    if(strcasecmp(name, kernelSets[i].name) == 0)
+      return i;
+
+  return -1;
+}
+
+const char *kernelSetName(int kernelSet)
+{
+  assert(kernelSet >= 0 && kernelSet < NUM_KERNEL_SETS);
+
+  return kernelSets[kernelSet].name;
+}
+
+/*
+   selects the requested kernels, or the fastest ones the CPU supports for KERNELS_AUTO,
+   and returns the selected set. Exits if the CPU does not support the requested set.
+*/
+int selectKernels(int requested)
+{
+  int
+    kernelSet = requested;
+
+  if(requested == KERNELS_AUTO)
+    {
+      for(kernelSet = NUM_KERNEL_SETS - 1; kernelSet > KERNELS_SSE3; kernelSet--)
+	if(isSupported(kernelSet))
+	  break;
+    }
+
+  if(!isSupported(kernelSet))
+    {
+      printf("\nError, the CPU of process %d does not support the %s likelihood kernels\n\n", processID, kernelSetName(kernelSet));
+      errorExit(-1);
+    }
+
+  kernels = &kernelSets[kernelSet];
+
+  return kernelSet;
+}
+
+/* prints the selected kernels to the info file, must be called by all processes */
+void printKernelSelection(tree *tr)
+{
+  int
+    slowest,
+    fastest;
+
+  MPI_Allreduce(&(tr->kernelSet), &slowest, 1, MPI_INT, MPI_MIN, comm);
+  MPI_Allreduce(&(tr->kernelSet), &fastest, 1, MPI_INT, MPI_MAX, comm);
+
+  if(slowest == fastest)
+    printBothOpen("Likelihood kernels: %s\n", kernelSetName(tr->kernelSet));
+  else
+    printBothOpen("Likelihood kernels: %s to %s, depending on the CPU of the process\n", kernelSetName(slowest), kernelSetName(fastest));
+}
+
+
+/* the entry points of the kernel files */
+
+void newviewIterative(tree *tr, int startIndex)
+{
+  kernels->newviewIterative(tr, startIndex);
+}
+
+void newviewTraversal(tree *tr, int startIndex)
+{
+  kernels->newviewTraversal(tr, startIndex);
+}
+
+void newviewGeneric(tree *tr, nodeptr p, boolean masked)
+{
+  kernels->newviewGeneric(tr, p, masked);
+}
+
+void computeTraversalInfo(nodeptr p, traversalInfo *ti, int *counter, int maxTips, int numBranches, boolean partialTraversal)
+{
+  kernels->computeTraversalInfo(p, ti, counter, maxTips, numBranches, partialTraversal);
+}
+
+boolean isGap(unsigned int *x, size_t pos)
+{
+  return kernels->isGap(x, pos);
+}
+
+boolean noGap(unsigned int *x, size_t pos)
+{
+  return kernels->noGap(x, pos);
+}
+
+void evaluateIterative(tree *tr)
+{
+  kernels->evaluateIterative(tr);
+}
+
+void evaluateGeneric(tree *tr, nodeptr p, boolean fullTraversal)
+{
+  kernels->evaluateGeneric(tr, p, fullTraversal);
+}
+
+void evaluateInsertion(tree *tr, nodeptr p)
+{
+  kernels->evaluateInsertion(tr, p);
+}
+
+void makenewzIterative(tree *tr)
+{
+  kernels->makenewzIterative(tr);
+}
+
+void makenewzGeneric(tree *tr, nodeptr p, nodeptr q, double *z0, int maxiter, double *result, boolean mask)
+{
+  kernels->makenewzGeneric(tr, p, q, z0, maxiter, result, mask);
+}
+
+void execCore(tree *tr, volatile double *dlnLdlz, volatile double *d2lnLdlz2)
+{
+  kernels->execCore(tr, dlnLdlz, d2lnLdlz2);
+}
@@ -72,7 +72,7 @@ static double haddScalar(VECTOR_REGISTER v)
   _mm_storel_pd(&result, v);
 #endif
   
-#ifdef __AVX
+#if defined(__AVX) && !defined(__AVX512)
   double 
     ra[4] __attribute__ ((aligned (BYTE_ALIGNMENT)));
 
@@ -83,6 +83,10 @@ static double haddScalar(VECTOR_REGISTER v)
   result = ra[0] + ra[2];
 #endif
 
+#ifdef __AVX512
+  result = _mm512_reduce_add_pd(v);
+#endif
+
   return result;
 }
 
@@ -103,6 +107,7 @@ static double haddScalar(VECTOR_REGISTER v)
 
 extern const char inverseMeaningDNA[16];
 extern int processID;
+extern MPI_Comm comm;
 
 /* a pre-computed 32-bit integer mask */
 
@@ -188,7 +193,7 @@ static void calcDiagptableFlex_LG4(double z, int numberOfCategories, double *rpt
 static double evaluateGAMMA_FLEX(int *wptr,
 				 double *x1_start, double *x2_start, 
 				 double *tipVector, 
-				 unsigned char *tipX1, const size_t n, double *diagptable, const int states)
+				 unsigned char *tipX1, const size_t n, double *diagptable, const int states, double *siteLikelihoods)
 {
   double   
     sum = 0.0, 
@@ -238,6 +243,9 @@ static double evaluateGAMMA_FLEX(int *wptr,
 
 	  term = LOG(0.25 * FABS(term));
 	 	 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}     
     }
@@ -256,6 +264,9 @@ static double evaluateGAMMA_FLEX(int *wptr,
 	          	  	  	      	  
 	  term = LOG(0.25 * FABS(term));
 	  	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}                      	
     }
@@ -268,7 +279,7 @@ static double evaluateGAMMA_FLEX(int *wptr,
 
 static double evaluateCAT_FLEX (int *cptr, int *wptr,
 				double *x1, double *x2, double *tipVector,
-				unsigned char *tipX1, size_t n, double *diagptable_start, const int states)
+				unsigned char *tipX1, size_t n, double *diagptable_start, const int states, double *siteLikelihoods)
 {
   double   
     sum = 0.0, 
@@ -319,6 +330,9 @@ static double evaluateCAT_FLEX (int *cptr, int *wptr,
 	     i.e., form part of the same partition.
 	  */	   	     
 
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}      
     }    
@@ -337,6 +351,9 @@ static double evaluateCAT_FLEX (int *cptr, int *wptr,
 	  
 	  term = LOG(FABS(term));	 
 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;      
 	}
     }
@@ -366,16 +383,16 @@ static double evaluateCAT_FLEX (int *cptr, int *wptr,
 static double evaluateGTRGAMMA_BINARY(int *ex1, int *ex2, int *wptr,
                                       double *x1_start, double *x2_start, 
                                       double *tipVector, 
-                                      unsigned char *tipX1, const size_t n, double *diagptable, const boolean fastScaling);
+                                      unsigned char *tipX1, const size_t n, double *diagptable, const boolean fastScaling, double *siteLikelihoods);
 
 static double evaluateGTRCAT_BINARY (int *ex1, int *ex2, int *cptr, int *wptr,
                                      double *x1_start, double *x2_start, double *tipVector,                   
-                                     unsigned char *tipX1, size_t n, double *diagptable_start, const boolean fastScaling);
+                                     unsigned char *tipX1, size_t n, double *diagptable_start, const boolean fastScaling, double *siteLikelihoods);
 
 static double evaluateGTRGAMMAPROT_LG4(int *ex1, int *ex2, int *wptr,
 				       double *x1, double *x2,  
 				       double *tipVector[4], 
-				       unsigned char *tipX1, size_t n, double *diagptable, const boolean fastScaling, double *weights);
+				       unsigned char *tipX1, size_t n, double *diagptable, const boolean fastScaling, double *weights, double *siteLikelihoods);
 
 /* GAMMA for proteins with memory saving */
 
@@ -383,7 +400,7 @@ static double evaluateGTRGAMMAPROT_GAPPED_SAVE (int *wptr,
 						double *x1, double *x2,  
 						double *tipVector, 
 						unsigned char *tipX1, size_t n, double *diagptable, 
-						double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap);
+						double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap, double *siteLikelihoods);
 
 /**** likelihood calculation at virtual root generic n-state model **************************/
 
@@ -394,7 +411,8 @@ static double evaluateGTRGAMMA_NSTATE (int *wptr,
 				       unsigned char *tipX1, size_t n, double *diagptable, 
 				       const size_t numberOfStates, 
 				       const size_t gammaRates,
-				       const int genericTipState);
+				       const int genericTipState,
+				       double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap, double *siteLikelihoods);
 
 
 /* GAMMA for proteins */
@@ -402,7 +420,7 @@ static double evaluateGTRGAMMA_NSTATE (int *wptr,
 static double evaluateGTRGAMMAPROT (int *wptr,
 				    double *x1, double *x2,  
 				    double *tipVector, 
-				    unsigned char *tipX1, size_t n, double *diagptable);
+				    unsigned char *tipX1, size_t n, double *diagptable, double *siteLikelihoods);
 
 
 
@@ -411,7 +429,7 @@ static double evaluateGTRGAMMAPROT (int *wptr,
 
 static double evaluateGTRCATPROT (int *cptr, int *wptr,
 				  double *x1, double *x2, double *tipVector,
-				  unsigned char *tipX1, size_t n, double *diagptable_start);
+				  unsigned char *tipX1, size_t n, double *diagptable_start, double *siteLikelihoods);
 
 
 /* CAT for proteins with memory saving */
@@ -419,35 +437,90 @@ static double evaluateGTRCATPROT (int *cptr, int *wptr,
 static double evaluateGTRCATPROT_SAVE (int *cptr, int *wptr,
 				       double *x1, double *x2, double *tipVector,
 				       unsigned char *tipX1, size_t n, double *diagptable_start, 
-				       double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap);
+				       double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap, double *siteLikelihoods);
 
 /* analogous DNA fuctions */
 
 static double evaluateGTRCAT_SAVE (int *cptr, int *wptr,
 				   double *x1_start, double *x2_start, double *tipVector, 		      
 				   unsigned char *tipX1, size_t n, double *diagptable_start,
-				   double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap);
+				   double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap, double *siteLikelihoods);
 
 static double evaluateGTRGAMMA_GAPPED_SAVE(int *wptr,
 					   double *x1_start, double *x2_start, 
 					   double *tipVector, 
 					   unsigned char *tipX1, const size_t n, double *diagptable,
-					   double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap);
+					   double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap, double *siteLikelihoods);
 
 static double evaluateGTRGAMMA(int *wptr,
 			       double *x1_start, double *x2_start, 
 			       double *tipVector, 
-			       unsigned char *tipX1, const size_t n, double *diagptable);
+			       unsigned char *tipX1, const size_t n, double *diagptable, double *siteLikelihoods);
 
 
 static double evaluateGTRCAT (int *cptr, int *wptr,
 			      double *x1_start, double *x2_start, double *tipVector, 		      
-			      unsigned char *tipX1, size_t n, double *diagptable_start);
+			      unsigned char *tipX1, size_t n, double *diagptable_start, double *siteLikelihoods);
 
 
 #endif
 
 
+/* computes the P matrix at the virtual root (given by the branch lengths pz) for partition m */
+
+static void computeRootDiagptable(tree *tr, int m, double *pz, double *diagptable)
+{
+  int
+    categories,
+    states = tr->partitionData[m].states;
+
+  double
+    plain[1] = {1.0},
+    z,
+    *rateCategories;
+
+  /* if we are using a per-partition branch length estimate, the branch has an index, otherwise, for a joint branch length
+     estimate over all partitions we just use the branch length value with index 0 */
+  if(tr->numBranches > 1)
+    z = pz[m];
+  else
+    z = pz[0];
+
+
+    /*
+       figure out if we are using the CAT or GAMMA model of rate heterogeneity
+       and set pointers to the rate heterogeneity rate arrays and also set the
+       number of distinct rate categories appropriately.
+
+       Under GAMMA this is constant and hard-coded as 4, weheras under CAT
+       the number of site-wise rate categories can vary in the course of computations
+       up to a user defined maximum value of site categories (default: 25)
+     */
+
+  switch(tr->rateHetModel)
+    {
+    case CAT:
+      rateCategories = tr->partitionData[m].perSiteRates;
+      categories = tr->partitionData[m].numberOfCategories;
+      break;
+    case GAMMA:
+      rateCategories = tr->partitionData[m].gammaRates;
+      categories = 4;
+      break;
+    case PLAIN:
+      rateCategories = plain;
+      categories = 1;
+      break;
+    default:
+      assert(0);
+    }
+
+  if(tr->partitionData[m].protModels == LG4M || tr->partitionData[m].protModels == LG4X)
+    calcDiagptableFlex_LG4(z, 4, tr->partitionData[m].gammaRates, tr->partitionData[m].EIGN_LG4, diagptable, 20);
+  else
+    calcDiagptable(z, states, categories, rateCategories, tr->partitionData[m].EIGN, diagptable);
+}
+
 /* This is the core function for computing the log likelihood at a branch */
 
 void evaluateIterative(tree *tr)
@@ -457,7 +530,8 @@ void evaluateIterative(tree *tr)
 
   /* get the branch length at the root */
   double 
-    *pz = tr->td[0].ti[0].qz;   
+    *pz = tr->td[0].ti[0].qz,
+    traceStart = traceBegin();
 
   /* get the node number of the node to the left and right of the branch that defines the virtual rooting */
 
@@ -471,74 +545,6 @@ void evaluateIterative(tree *tr)
      for the conditional vectors with respect to the tree
   */
      
-  /* iterate over all valid entries in the traversal descriptor */
-  newviewIterative(tr, 1);
-
-  {
-    int 
-      m;
-    
-#ifdef _USE_OMP
-#pragma omp parallel for
-#endif
-    for(m = 0; m < tr->NumberOfModels; m++)
-      {
-	/* check if this partition has to be processed now - otherwise no need to compute P matrix */
-	if(!tr->td[0].executeModel[m] || tr->partitionData[m].width == 0)
-	  continue;
-	
-	int
-	  categories,
-	  states = tr->partitionData[m].states;
-	
-	double
-	  plain[1] = {1.0},
-	  z,
-	  *rateCategories,
-	  *diagptable = tr->partitionData[m].left;
-	
-	/* if we are using a per-partition branch length estimate, the branch has an index, otherwise, for a joint branch length
-	   estimate over all partitions we just use the branch length value with index 0 */
-	if(tr->numBranches > 1)
-	  z = pz[m];
-	else
-	  z = pz[0];
-
-
-	  /*
-	     figure out if we are using the CAT or GAMMA model of rate heterogeneity
-	     and set pointers to the rate heterogeneity rate arrays and also set the
-	     number of distinct rate categories appropriately.
-
-	     Under GAMMA this is constant and hard-coded as 4, weheras under CAT
-	     the number of site-wise rate categories can vary in the course of computations
-	     up to a user defined maximum value of site categories (default: 25)
-	   */
-
-	switch(tr->rateHetModel)
-	  {
-	  case CAT:	  
-	    rateCategories = tr->partitionData[m].perSiteRates;
-	    categories = tr->partitionData[m].numberOfCategories;
-	    break;
-	  case GAMMA:	   
-	    rateCategories = tr->partitionData[m].gammaRates;
-	    categories = 4;
-	    break;
-	  case PLAIN:
-	    rateCategories = plain;
-	    categories = 1;
-	    break;
-	  default:
-	    assert(0);
-	  }
-
-	if(tr->partitionData[m].protModels == LG4M || tr->partitionData[m].protModels == LG4X)
-	  calcDiagptableFlex_LG4(z, 4, tr->partitionData[m].gammaRates, tr->partitionData[m].EIGN_LG4, diagptable, 20);
-	else
-	  calcDiagptable(z, states, categories, rateCategories, tr->partitionData[m].EIGN, diagptable);
-    }
-  }
   /* after the above call we are sure that we have properly and consistently computed the 
      conditionals to the right and left of the virtual root and we can now invoke the 
      the log likelihood computation */
@@ -553,6 +559,11 @@ void evaluateIterative(tree *tr)
       model,
       maxModel;
 
+    /* iterate over all valid entries in the traversal descriptor, under OpenMP every thread 
+       only computes the sites it owns and can hence directly proceed to evaluate them, 
+       such that we only fork and join once per traversal */
+    newviewTraversal(tr, 1);
+
 #ifdef _USE_OMP
     maxModel = tr->maxModelsPerThread;
 #else
@@ -590,7 +601,7 @@ void evaluateIterative(tree *tr)
 	      
 	      assert(model < tr->NumberOfModels);
 	      
-	      diagptable = tr->partitionData[model].left;
+	      diagptable = tr->threadLeft[tid];
 	      globalScaler = tr->partitionData[model].threadGlobalScaler[tid];
 	      perPartitionLH = &tr->partitionData[model].reductionBuffer[tid];
 	    }
@@ -652,8 +663,12 @@ void evaluateIterative(tree *tr)
 	    *rateCategory = tr->partitionData[model].rateCategory + offset;
 	  
 	  double 
+	    kernelStart = startKernelTimer(),
 	    partitionLikelihood = 0.0, 	 
 	    *weights = tr->partitionData[model].weights,
+
+	    /* per-site log likelihoods, only requested by computeSiteLikelihoods() in rell.c */
+	    *siteLikelihoods = tr->partitionData[model].siteLikelihoods ? tr->partitionData[model].siteLikelihoods + offset : (double*)NULL,
 	    *x1_start   = (double*)NULL, 
 	    *x2_start   = (double*)NULL,
 	    *x1_gapColumn = (double*)NULL,
@@ -666,6 +681,9 @@ void evaluateIterative(tree *tr)
 	  unsigned char 
 	    *tip = (unsigned char*)NULL;	  
 
+	  /* compute the P matrix at the root */
+	  computeRootDiagptable(tr, model, pz, diagptable);
+
 	  /* figure out if we need to address tip vectors (a char array that indexes into a precomputed tip likelihood 
 	     value array or if we need to address inner vectors */
 
@@ -681,7 +699,7 @@ void evaluateIterative(tree *tr)
 		     note that inner nodes are enumerated/indexed starting at 0 to save allocating some 
 		     space for additional pointers */
 		  		 
-		  x2_start = tr->partitionData[model].xVector[pNumber - tr->mxtips -1] + x_offset;
+		  x2_start = tr->partitionData[model].xVector[CLV_INDEX(tr, pNumber)] + x_offset;
 
 		  /* get the corresponding tip vector */
 		  if(isPomo(tr->partitionData[model].dataType))		  
@@ -705,7 +723,7 @@ void evaluateIterative(tree *tr)
 		{	
 		  /* p is a tip, same as above */
 	 
-		  x2_start = tr->partitionData[model].xVector[qNumber - tr->mxtips - 1] + x_offset;
+		  x2_start = tr->partitionData[model].xVector[CLV_INDEX(tr, qNumber)] + x_offset;
 
 		  if(isPomo(tr->partitionData[model].dataType))		  
 		    {
@@ -731,8 +749,8 @@ void evaluateIterative(tree *tr)
 	      
 	      /* neither p nor q are tips, hence we need to get the addresses of two inner vectors */
     
-	      x1_start = tr->partitionData[model].xVector[pNumber - tr->mxtips - 1] + x_offset;
-	      x2_start = tr->partitionData[model].xVector[qNumber - tr->mxtips - 1] + x_offset;
+	      x1_start = tr->partitionData[model].xVector[CLV_INDEX(tr, pNumber)] + x_offset;
+	      x2_start = tr->partitionData[model].xVector[CLV_INDEX(tr, qNumber)] + x_offset;
 
 	      /* memory saving option */
 
@@ -759,11 +777,11 @@ void evaluateIterative(tree *tr)
 	  if(tr->rateHetModel == CAT)
 	     partitionLikelihood = evaluateCAT_FLEX(tr->partitionData[model].rateCategory, wgt,
 						    x1_start, x2_start, tr->partitionData[model].tipVector, 
-						    tip, width, diagptable, states);
+						    tip, width, diagptable, states, siteLikelihoods);
 	  else
 	    partitionLikelihood = evaluateGAMMA_FLEX(wgt,
 						     x1_start, x2_start, tr->partitionData[model].tipVector,
-						     tip, width, diagptable, states);
+						     tip, width, diagptable, states, siteLikelihoods);
 #else
 
 	  /* for the optimized functions we have a dedicated, optimized function implementation 
@@ -782,12 +800,12 @@ void evaluateIterative(tree *tr)
 	      if(tr->rateHetModel == CAT)
 		partitionLikelihood = evaluateGTRCAT_BINARY((int *)NULL, (int *)NULL, rateCategory, wgt,
 				      x1_start, x2_start, tr->partitionData[model].tipVector, 
-				      tip, width, diagptable, TRUE);
+				      tip, width, diagptable, TRUE, siteLikelihoods);
 	      else				  
 		partitionLikelihood = evaluateGTRGAMMA_BINARY((int *)NULL, (int *)NULL, wgt,
 							     x1_start, x2_start, 
 							     tr->partitionData[model].tipVector,
-							     tip, width, diagptable, TRUE);	      	      
+							     tip, width, diagptable, TRUE, siteLikelihoods);	      	      
 #endif
 	      break;
 	    case 4: /* DNA */
@@ -802,7 +820,7 @@ void evaluateIterative(tree *tr)
 #else
 		      partitionLikelihood =  evaluateGTRCAT_SAVE(rateCategory, wgt,
 								 x1_start, x2_start, tr->partitionData[model].tipVector, 
-								 tip, width, diagptable, x1_gapColumn, x2_gapColumn, x1_gap, x2_gap);
+								 tip, width, diagptable, x1_gapColumn, x2_gapColumn, x1_gap, x2_gap, siteLikelihoods);
 #endif
 		    else
 #ifdef __MIC_NATIVE
@@ -810,7 +828,7 @@ void evaluateIterative(tree *tr)
 #else
 		      partitionLikelihood =  evaluateGTRCAT(rateCategory, wgt,
 							    x1_start, x2_start, tr->partitionData[model].tipVector, 
-							    tip, width, diagptable);
+							    tip, width, diagptable, siteLikelihoods);
 #endif
 		  }
 		else
@@ -822,17 +840,21 @@ void evaluateIterative(tree *tr)
 		      partitionLikelihood =  evaluateGTRGAMMA_GAPPED_SAVE(wgt,
 									  x1_start, x2_start, tr->partitionData[model].tipVector,
 									  tip, width, diagptable,
-									  x1_gapColumn, x2_gapColumn, x1_gap, x2_gap);
+									  x1_gapColumn, x2_gapColumn, x1_gap, x2_gap, siteLikelihoods);
 #endif
 		    else
 #ifdef __MIC_NATIVE
               partitionLikelihood = evaluateGAMMA_MIC(wgt,
 	                                 x1_start, x2_start, tr->partitionData[model].mic_tipVector,
 	                                 tip, width, diagptable);
+#elif defined(__AVX512)
+		      partitionLikelihood =  evaluateGTRGAMMA_AVX512(wgt,
+								     x1_start, x2_start, tr->partitionData[model].tipVector,
+								     tip, width, diagptable, siteLikelihoods);
 #else
 		      partitionLikelihood =  evaluateGTRGAMMA(wgt,
 							      x1_start, x2_start, tr->partitionData[model].tipVector,
-							      tip, width, diagptable);
+							      tip, width, diagptable, siteLikelihoods);
 #endif
 		  }
 	      }
@@ -849,7 +871,7 @@ void evaluateIterative(tree *tr)
 #else
 		      partitionLikelihood = evaluateGTRCATPROT_SAVE(rateCategory, wgt,
 								    x1_start, x2_start, tr->partitionData[model].tipVector,
-								    tip, width, diagptable,  x1_gapColumn, x2_gapColumn, x1_gap, x2_gap);
+								    tip, width, diagptable,  x1_gapColumn, x2_gapColumn, x1_gap, x2_gap, siteLikelihoods);
 #endif
 		    else
 #ifdef __MIC_NATIVE
@@ -857,7 +879,7 @@ void evaluateIterative(tree *tr)
 #else
 		      partitionLikelihood = evaluateGTRCATPROT(rateCategory, wgt,
 							       x1_start, x2_start, tr->partitionData[model].tipVector,
-							       tip, width, diagptable);
+							       tip, width, diagptable, siteLikelihoods);
 #endif
 		  }
 		else
@@ -869,7 +891,7 @@ void evaluateIterative(tree *tr)
 		      partitionLikelihood = evaluateGTRGAMMAPROT_GAPPED_SAVE(wgt,
 									     x1_start, x2_start, tr->partitionData[model].tipVector,
 									     tip, width, diagptable,
-									     x1_gapColumn, x2_gapColumn, x1_gap, x2_gap);
+									     x1_gapColumn, x2_gapColumn, x1_gap, x2_gap, siteLikelihoods);
 #endif
 		    else
 		      {
@@ -878,20 +900,28 @@ void evaluateIterative(tree *tr)
 			 partitionLikelihood = evaluateGAMMAPROT_LG4_MIC(wgt,
                                x1_start, x2_start, tr->partitionData[model].mic_tipVector,
                                tip, width, diagptable, weights);
+#elif defined(__AVX512)
+			  partitionLikelihood =  evaluateGTRGAMMAPROT_AVX512_LG4(wgt,
+										 x1_start, x2_start, tr->partitionData[model].tipVector_LG4,
+										 tip, width, diagptable, weights, siteLikelihoods);
 #else
 			  partitionLikelihood =  evaluateGTRGAMMAPROT_LG4((int *)NULL, (int *)NULL, wgt,
 									  x1_start, x2_start, tr->partitionData[model].tipVector_LG4,
-									  tip, width, diagptable, TRUE, weights);
+									  tip, width, diagptable, TRUE, weights, siteLikelihoods);
 #endif
 			else
 #ifdef __MIC_NATIVE
 	            partitionLikelihood = evaluateGAMMAPROT_MIC(wgt,
 	                               x1_start, x2_start, tr->partitionData[model].mic_tipVector,
 	                               tip, width, diagptable);
+#elif defined(__AVX512)
+			partitionLikelihood = evaluateGTRGAMMAPROT_AVX512(wgt,
+									  x1_start, x2_start, tr->partitionData[model].tipVector,
+									  tip, width, diagptable, siteLikelihoods);
 #else
 			partitionLikelihood = evaluateGTRGAMMAPROT(wgt,
 								   x1_start, x2_start, tr->partitionData[model].tipVector,
-								   tip, width, diagptable);
+								   tip, width, diagptable, siteLikelihoods);
 
 		
 #endif
@@ -899,49 +929,62 @@ void evaluateIterative(tree *tr)
 		  }
 	      }
 	      break;	      		    
-	    case 16:
-	      //mth POMO16
-	      assert(!tr->saveMemory);
-
+	    case 16: /* POMO16 */
 	      switch(tr->rateHetModel)
 		{
 		case GAMMA:
 		  partitionLikelihood = evaluateGTRGAMMA_NSTATE(wgt,
 								x1_start, x2_start, tr->partitionData[model].tipVector,
-								tip, width, diagptable, 16, 4, genericTipCase);
+								tip, width, diagptable, 16, 4, genericTipCase,
+								x1_gapColumn, x2_gapColumn, x1_gap, x2_gap, siteLikelihoods);
 		  break;
 		case PLAIN:
 		  partitionLikelihood = evaluateGTRGAMMA_NSTATE(wgt,
 								x1_start, x2_start, tr->partitionData[model].tipVector,
-								tip, width, diagptable, 16, 1, genericTipCase);
-		  
+								tip, width, diagptable, 16, 1, genericTipCase,
+								x1_gapColumn, x2_gapColumn, x1_gap, x2_gap, siteLikelihoods);
 		  break;
 		default:
 		  assert(0);
 		}
-
-
 	      break;
-	    case 64:
-	      //mth POMO64 
-	      assert(!tr->saveMemory);
-
+	    case 32: /* GENERIC_32 */
 	      switch(tr->rateHetModel)
 		{
 		case GAMMA:
 		  partitionLikelihood = evaluateGTRGAMMA_NSTATE(wgt,
-								 x1_start, x2_start, tr->partitionData[model].tipVector,
-								 tip, width, diagptable, 64, 4, genericTipCase);
+								x1_start, x2_start, tr->partitionData[model].tipVector,
+								tip, width, diagptable, 32, 4, genericTipCase,
+								x1_gapColumn, x2_gapColumn, x1_gap, x2_gap, siteLikelihoods);
 		  break;
 		case PLAIN:
-		   partitionLikelihood = evaluateGTRGAMMA_NSTATE(wgt,
-								 x1_start, x2_start, tr->partitionData[model].tipVector,
-								 tip, width, diagptable, 64, 1, genericTipCase);
+		  partitionLikelihood = evaluateGTRGAMMA_NSTATE(wgt,
+								x1_start, x2_start, tr->partitionData[model].tipVector,
+								tip, width, diagptable, 32, 1, genericTipCase,
+								x1_gapColumn, x2_gapColumn, x1_gap, x2_gap, siteLikelihoods);
+		  break;
+		default:
+		  assert(0);
+		}
+	      break;
+	    case 64: /* POMO64 and GENERIC_64 */
+	      switch(tr->rateHetModel)
+		{
+		case GAMMA:
+		  partitionLikelihood = evaluateGTRGAMMA_NSTATE(wgt,
+								x1_start, x2_start, tr->partitionData[model].tipVector,
+								tip, width, diagptable, 64, 4, genericTipCase,
+								x1_gapColumn, x2_gapColumn, x1_gap, x2_gap, siteLikelihoods);
+		  break;
+		case PLAIN:
+		  partitionLikelihood = evaluateGTRGAMMA_NSTATE(wgt,
+								x1_start, x2_start, tr->partitionData[model].tipVector,
+								tip, width, diagptable, 64, 1, genericTipCase,
+								x1_gapColumn, x2_gapColumn, x1_gap, x2_gap, siteLikelihoods);
 		  break;
 		default:
 		  assert(0);
 		}
-	      
 	      break;
 	    default:	    
 	      assert(0);	    
@@ -961,6 +1004,21 @@ void evaluateIterative(tree *tr)
 
 	  partitionLikelihood += (globalScaler[pNumber] + globalScaler[qNumber]) * LOG(minlikelihood);
 
+	  /* the same for the per-site log likelihoods, using the scaling multiplications of every site 
+	     that the newview() functions have counted during the full traversal */
+
+	  if(siteLikelihoods)
+	    {
+	      size_t
+		i;
+
+	      int
+		*siteScaler = tr->partitionData[model].siteScaler + offset;
+
+	      for(i = 0; i < width; i++)
+		siteLikelihoods[i] += siteScaler[i] * LOG(minlikelihood);
+	    }
+
 	  /* check that there was no major numerical screw-up, the log likelihood should be < 0.0 always */
 
 	  //printf("P-like: %f\n", partitionLikelihood);
@@ -973,6 +1031,9 @@ void evaluateIterative(tree *tr)
 	     of this partition for example */
 
 	  *perPartitionLH = partitionLikelihood;
+
+	  stopKernelTimer(KERNEL_EVALUATE, tr->partitionData[model].dataType,
+			  (isTip(pNumber, tr->mxtips) || isTip(qNumber, tr->mxtips)) ? TIP_INNER : INNER_INNER, kernelStart);
 	}
       else
 	{
@@ -1021,25 +1082,92 @@ void evaluateIterative(tree *tr)
 	}
     }
 #endif
+
+  traceEnd(TRACE_EVALUATE, traceStart, 0);
 }
 
 
 
 
+/* executes the traversal descriptor in tr->td[0] (the newviews at entries 1 to count - 1 and the 
+   evaluation at the branch of entry 0) and reduces the per-partition log likelihoods of all processes */
+
+static void executeEvaluateTraversal(tree *tr)
+{
+  volatile double 
+    result = 0.0;
+
+  int 
+    model;
+
+  /* now we copy this partition execute mask into the traversal descriptor which must come from the 
+     calling program, the logic of this should not form part of the library */
+
+  storeExecuteMaskInTraversalDescriptor(tr);  
+  
+  /* also store in the traversal descriptor that something has changed i.e., in the parallel case that the 
+     traversal descriptor list of nodes needs to be broadcast once again */
+  
+  tr->td[0].traversalHasChanged = TRUE;
+
+  {
+    double 
+      t = gettime(); 
+
+    evaluateIterative(tr);  
+
+    tr->kernelTime += gettime() - t; 
+  }
+  
+  {
+    double 
+      *recv = (double *)malloc(sizeof(double) * (size_t)tr->NumberOfModels);
+
+    startPhaseTimer(TIMER_REDUCTION);
+    
+#ifdef _USE_ALLREDUCE   
+    MPI_Allreduce(tr->perPartitionLH, recv, tr->NumberOfModels, MPI_DOUBLE, MPI_SUM, comm);
+#else
+    MPI_Reduce(tr->perPartitionLH, recv, tr->NumberOfModels, MPI_DOUBLE, MPI_SUM, 0, comm);
+    MPI_Bcast(recv, tr->NumberOfModels, MPI_DOUBLE, 0, comm);
+#endif
+
+    stopPhaseTimer(TIMER_REDUCTION);
+    
+    memcpy(tr->perPartitionLH, recv, (size_t)tr->NumberOfModels * sizeof(double));
+
+    for(model = 0; model < tr->NumberOfModels; model++)        
+      result += tr->perPartitionLH[model];
+         
+    free(recv);
+  }
+
+
+  /* set the tree data structure likelihood value to the total likelihood */
+
+  tr->likelihood = result;    
+
+  /* 
+     MPI_Barrier(comm);
+     printf("Process %d likelihood: %f\n", processID, tr->likelihood);
+     MPI_Barrier(comm);
+  */
+
+  /* do some bookkeeping to have traversalHasChanged in a consistent state */
+
+  tr->td[0].traversalHasChanged = FALSE;  
+}
+
 void evaluateGeneric (tree *tr, nodeptr p, boolean fullTraversal)
 {
   /* now this may be the entry point of the library to compute 
      the log like at a branch defined by p and p->back == q */
 
-  volatile double 
-    result = 0.0;
-  
   nodeptr 
     q = p->back; 
   
   int 
-    i,
-    model;
+    i;
 
  
   /* set the first entry of the traversal descriptor to contain the indices
@@ -1061,6 +1189,8 @@ void evaluateGeneric (tree *tr, nodeptr p, boolean fullTraversal)
   /* one entry in the traversal descriptor is already used, hence set the tarversal length counter to 1 */
   tr->td[0].count = 1;
 
+  startClvTraversal(p, q);
+
   /* do we need to recompute any of the vectors at or below p ? */
   
   if(fullTraversal)
@@ -1079,57 +1209,48 @@ void evaluateGeneric (tree *tr, nodeptr p, boolean fullTraversal)
       if(!q->x)
 	computeTraversalInfo(q, &(tr->td[0].ti[0]), &(tr->td[0].count), tr->mxtips, tr->numBranches, TRUE);  
     }
-   
-      /* now we copy this partition execute mask into the traversal descriptor which must come from the 
-	 calling program, the logic of this should not form part of the library */
 
-  storeExecuteMaskInTraversalDescriptor(tr);  
-  
-  /* also store in the traversal descriptor that something has changed i.e., in the parallel case that the 
-     traversal descriptor list of nodes needs to be broadcast once again */
-  
-  tr->td[0].traversalHasChanged = TRUE;
+  executeEvaluateTraversal(tr);
+}
 
+/* computes the log likelihood of the tree after inserting the subtree s = p->back into the branch 
+   between q = p->next->back and r = p->next->next->back, as done for scoring lazy SPR moves in testInsertBIG().
 
-  evaluateIterative(tr);  
-  
-  {
-    double 
-      *recv = (double *)malloc(sizeof(double) * (size_t)tr->NumberOfModels);
-    
-#ifdef _USE_ALLREDUCE   
-    MPI_Allreduce(tr->perPartitionLH, recv, tr->NumberOfModels, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-#else
-    MPI_Reduce(tr->perPartitionLH, recv, tr->NumberOfModels, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-    MPI_Bcast(recv, tr->NumberOfModels, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-#endif
-    
-    memcpy(tr->perPartitionLH, recv, (size_t)tr->NumberOfModels * sizeof(double));
+   Formerly this was done by newviewGeneric() at p (oriented towards s) followed by evaluateGeneric() 
+   at p->next->next, which re-computed the vector at p a second time (now oriented towards r) in a separate 
+   traversal. Since the likelihood does not depend on the position of the virtual root, we rather evaluate 
+   at the branch (p, s): the vectors at q, r (oriented towards p) and at s are still valid from before the insertion, 
+   hence this amounts to a single newview at p and a single evaluate kernel call, executed in one traversal 
+   (one parallel region and one reduction). The entries for q, r, or s are only added if they need to be re-oriented. */
 
-    for(model = 0; model < tr->NumberOfModels; model++)        
-      result += tr->perPartitionLH[model];
-         
-    free(recv);
-  }
+void evaluateInsertion(tree *tr, nodeptr p)
+{
+  nodeptr 
+    s = p->back;
 
+  int 
+    i;
 
-  /* set the tree data structure likelihood value to the total likelihood */
+  assert(!isTip(p->number, tr->mxtips));
 
-  tr->likelihood = result;    
-  
+  tr->td[0].ti[0].pNumber = p->number;
+  tr->td[0].ti[0].qNumber = s->number;          
   
+  for(i = 0; i < tr->numBranches; i++)    
+    tr->td[0].ti[0].qz[i] =  s->z[i];
 
- 
+  tr->td[0].count = 1;
 
-  /* 
-     MPI_Barrier(MPI_COMM_WORLD);
-     printf("Process %d likelihood: %f\n", processID, tr->likelihood);
-     MPI_Barrier(MPI_COMM_WORLD);
-  */
+  startClvTraversal(p, s);
 
-  /* do some bookkeeping to have traversalHasChanged in a consistent state */
+  /* the vector at p must always be re-computed, since q and r have just been attached to it */
 
-  tr->td[0].traversalHasChanged = FALSE;  
+  computeTraversalInfo(p, &(tr->td[0].ti[0]), &(tr->td[0].count), tr->mxtips, tr->numBranches, TRUE);
+
+  if(!s->x)
+    computeTraversalInfo(s, &(tr->td[0].ti[0]), &(tr->td[0].count), tr->mxtips, tr->numBranches, TRUE);  
+
+  executeEvaluateTraversal(tr);
 }
 
 
@@ -1146,7 +1267,7 @@ void evaluateGeneric (tree *tr, nodeptr p, boolean fullTraversal)
 
 static double evaluateGTRCAT_BINARY (int *ex1, int *ex2, int *cptr, int *wptr,
                                      double *x1_start, double *x2_start, double *tipVector,                   
-                                     unsigned char *tipX1, size_t n, double *diagptable_start, const boolean fastScaling)
+                                     unsigned char *tipX1, size_t n, double *diagptable_start, const boolean fastScaling, double *siteLikelihoods)
 {
   double  sum = 0.0, term;       
   size_t     i;
@@ -1172,6 +1293,9 @@ static double evaluateGTRCAT_BINARY (int *ex1, int *ex2, int *cptr, int *wptr,
           else
             term = log(fabs(t[0] + t[1])) + (ex2[i] * log(minlikelihood));                           
 
+          if(siteLikelihoods)
+            siteLikelihoods[i] = term;
+
           sum += wptr[i] * term;
         }       
     }               
@@ -1195,6 +1319,9 @@ static double evaluateGTRCAT_BINARY (int *ex1, int *ex2, int *cptr, int *wptr,
             term = log(fabs(t[0] + t[1])) + ((ex1[i] + ex2[i]) * log(minlikelihood));                        
 
           
+          if(siteLikelihoods)
+            siteLikelihoods[i] = term;
+
           sum += wptr[i] * term;
         }          
     }
@@ -1206,7 +1333,7 @@ static double evaluateGTRCAT_BINARY (int *ex1, int *ex2, int *cptr, int *wptr,
 static double evaluateGTRGAMMA_BINARY(int *ex1, int *ex2, int *wptr,
                                       double *x1_start, double *x2_start, 
                                       double *tipVector, 
-                                      unsigned char *tipX1, const size_t n, double *diagptable, const boolean fastScaling)
+                                      unsigned char *tipX1, const size_t n, double *diagptable, const boolean fastScaling, double *siteLikelihoods)
 {
   double   sum = 0.0, term;    
 
@@ -1249,6 +1376,9 @@ static double evaluateGTRGAMMA_BINARY(int *ex1, int *ex2, int *wptr,
             term = log(0.25 * (fabs(t[0] + t[1]))) + (ex2[i] * log(minlikelihood));       
  
           
+          if(siteLikelihoods)
+            siteLikelihoods[i] = term;
+
           sum += wptr[i] * term;
         }         
     }
@@ -1287,6 +1417,9 @@ static double evaluateGTRGAMMA_BINARY(int *ex1, int *ex2, int *wptr,
             term = log(0.25 * (fabs(t[0] + t[1]))) + ((ex1[i] +ex2[i]) * log(minlikelihood));     
 
 
+          if(siteLikelihoods)
+            siteLikelihoods[i] = term;
+
           sum += wptr[i] * term;
         }                       
     }
@@ -1301,7 +1434,7 @@ static double evaluateGTRGAMMA_BINARY(int *ex1, int *ex2, int *wptr,
 static double evaluateGTRGAMMAPROT_LG4(int *ex1, int *ex2, int *wptr,
 				       double *x1, double *x2,  
 				       double *tipVector[4], 
-				       unsigned char *tipX1, size_t n, double *diagptable, const boolean fastScaling, double *weights)
+				       unsigned char *tipX1, size_t n, double *diagptable, const boolean fastScaling, double *weights, double *siteLikelihoods)
 {
   double   sum = 0.0, term;        
   size_t     i, j, l;
@@ -1360,6 +1493,9 @@ static double evaluateGTRGAMMAPROT_LG4(int *ex1, int *ex2, int *wptr,
 	  else
 	    term = LOG(FABS(term)) + (ex2[i] * LOG(minlikelihood));	   
 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}    	        
     }              
@@ -1416,6 +1552,9 @@ static double evaluateGTRGAMMAPROT_LG4(int *ex1, int *ex2, int *wptr,
 	  else
 	    term = LOG(FABS(term)) + ((ex1[i] + ex2[i])*LOG(minlikelihood));
 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}         
     }
@@ -1429,7 +1568,7 @@ static double evaluateGTRGAMMAPROT_GAPPED_SAVE (int *wptr,
 						double *x1, double *x2,  
 						double *tipVector, 
 						unsigned char *tipX1, size_t n, double *diagptable, 
-						double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap)					   
+						double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap, double *siteLikelihoods)					   
 {
   double   sum = 0.0, term;        
   size_t     i;
@@ -1475,6 +1614,9 @@ static double evaluateGTRGAMMAPROT_GAPPED_SAVE (int *wptr,
 	  
 	  term = LOG(0.25 * FABS(term));	  
 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}    	        
     }              
@@ -1519,6 +1661,9 @@ static double evaluateGTRGAMMAPROT_GAPPED_SAVE (int *wptr,
 	  term = LOG(0.25 * FABS(term));
 	
 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}         
     }
@@ -1535,13 +1680,18 @@ static double evaluateGTRGAMMA_NSTATE (int *wptr,
 				       double *tipVector, 
 				       unsigned char *tipX1, size_t n, double *diagptable, 
 				       const size_t numberOfStates, 
-				       const size_t gammaRates, const int genericTipCase)
+				       const size_t gammaRates, const int genericTipCase,
+				       double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap, double *siteLikelihoods)
 {
   double   
     sum = 0.0, 
     term,
     *left, 
-    *right; 
+    *right,
+    *x1v,
+    *x2v,
+    *x1_ptr = x1,
+    *x2_ptr = x2; 
 
   const double
     factor = 1.0 / (double)gammaRates;
@@ -1549,139 +1699,90 @@ static double evaluateGTRGAMMA_NSTATE (int *wptr,
   size_t
     i, 
     j, 
-    l;   
+    l,
+    x1Rate;   
 
   const size_t   
     loopLength = numberOfStates - (numberOfStates % VECTOR_WIDTH), //or 18 for testing!
     stride = numberOfStates * gammaRates;
+
+  /* the tip vectors do not depend on the rate, with the memory saving option (x2_gap != NULL) the 
+     inner vectors only store the sites that are not entirely undetermined, see newviewGTRGAMMA_NSTATES() */
  
-  if(tipX1)
-    {               
-      for (i = 0; i < n; i++) 
-	{
-	  VECTOR_REGISTER 
-	    tv = VECTOR_SET_ZERO();
+  for (i = 0; i < n; i++) 
+    {
+      VECTOR_REGISTER 
+	tv = VECTOR_SET_ZERO();
 
-	  double 
-	    tBuffer = 0.0;
+      double 
+	tBuffer = 0.0;
 
-	  left = &(tipVector[numberOfStates * tipX1[i]]);	  	  
-	  
-	  for(j = 0, term = 0.0; j < gammaRates; j++)
+      if(tipX1)
+	{
+	  x1v = &(tipVector[numberOfStates * tipX1[i]]);
+	  x1Rate = 0;
+	}
+      else
+	{
+	  if(genericTipCase == TIP_INNER_CLV)
 	    {
-	      double 
-		*d = &diagptable[j * numberOfStates];
-	      
-	      right = &(x2[stride * i + numberOfStates * j]);
-	      
-	      for(l = 0; l < loopLength; l += VECTOR_WIDTH)
+	      x1v = &(x1[numberOfStates * i]);
+	      x1Rate = 0;
+	    }
+	  else
+	    {
+	      if(x1_gap && isGap(x1_gap, i))
+		x1v = x1_gapColumn;
+	      else
 		{
-		  VECTOR_REGISTER 
-		    mul = VECTOR_MUL(VECTOR_LOAD(&left[l]), VECTOR_LOAD(&right[l]));
-		  tv = VECTOR_ADD(tv, VECTOR_MUL(mul, VECTOR_LOAD(&d[l])));		   
-		}	
-	     
-	      for(; l < numberOfStates; l++)
-		tBuffer += left[l] * right[l] * d[l];	   	 		
-	    }	 	 
-
-	  term = haddScalar(tv);
-
-	  term += tBuffer;
-	  	  	 
-	  term = LOG(factor * FABS(term));		 	  	  
-
-	  sum += wptr[i] * term;
-	}    	        
-    }              
-  else
-    {
-      if(genericTipCase == TIP_INNER_CLV)
-	{
-	  //printf("ETIC\n");
+		  x1v = x1_ptr;
+		  x1_ptr += stride;
+		}
 
-	  for (i = 0; i < n; i++) 
-	    {	  	 	             
-	      VECTOR_REGISTER 
-		tv = VECTOR_SET_ZERO();	 	  	  
-	      
-	      double 
-		tBuffer = 0.0;
-	      
-	      for(j = 0, term = 0.0; j < gammaRates; j++)
-		{
-		  double 
-		    *d = &diagptable[j * numberOfStates];
-		  
-		  left  = &(x1[numberOfStates * i]);
-		  right = &(x2[stride * i + numberOfStates * j]);		 		 
-		    
-		  for(l = 0; l < loopLength; l += VECTOR_WIDTH)
-		    {
-		      VECTOR_REGISTER 
-			mul = VECTOR_MUL(VECTOR_LOAD(&left[l]), VECTOR_LOAD(&right[l]));
-		      tv = VECTOR_ADD(tv, VECTOR_MUL(mul, VECTOR_LOAD(&d[l])));		   
-		    }
-		  
-		  for(; l < numberOfStates; l++)
-		      tBuffer += left[l] * right[l] * d[l];		 	      
-
-		  /*for(l = 0; l < numberOfStates; l++)
-		    tBuffer += left[l] * right[l] * d[l];
-		  for(l = 0; l < numberOfStates; l++)
-		  printf("t[%d] %f %f\n", j, left[l], right[l]);*/
-		}	  	  	  
-	      
-	      term = haddScalar(tv);
-	      
-	      term += tBuffer;	    
-	      
-	      term = LOG(factor * FABS(term));	    
-	      //printf("%d %f %d\n", i, term, wptr[i]);
-	      sum += wptr[i] * term;
+	      x1Rate = numberOfStates;
 	    }
 	}
+
+      if(x2_gap && isGap(x2_gap, i))
+	x2v = x2_gapColumn;
       else
 	{
-	  for (i = 0; i < n; i++) 
-	    {	  	 	             
-	      VECTOR_REGISTER 
-		tv = VECTOR_SET_ZERO();	 	  	  
-	      
-	      double 
-		tBuffer = 0.0;
-	      
-	      for(j = 0, term = 0.0; j < gammaRates; j++)
-		{
-		  double 
-		    *d = &diagptable[j * numberOfStates];
-		  
-		  left  = &(x1[stride * i + numberOfStates * j]);
-		  right = &(x2[stride * i + numberOfStates * j]);
-		  
-		  for(l = 0; l < loopLength; l += VECTOR_WIDTH)
-		    {
-		      VECTOR_REGISTER 
-			mul = VECTOR_MUL(VECTOR_LOAD(&left[l]), VECTOR_LOAD(&right[l]));
-		      tv = VECTOR_ADD(tv, VECTOR_MUL(mul, VECTOR_LOAD(&d[l])));		   
-		    }
-		  
-		  for(; l < numberOfStates; l++)
-		    tBuffer += left[l] * right[l] * d[l];		 		
-		}	  	  	  
-	      
-	      term = haddScalar(tv);
-	      
-	      term += tBuffer;
-	      
-	      term = LOG(factor * FABS(term));
-	      
-	      sum += wptr[i] * term;
-	    }
+	  x2v = x2_ptr;
+	  x2_ptr += stride;
 	}
-    }
-       
-  return  sum;
+	  
+      for(j = 0, term = 0.0; j < gammaRates; j++)
+	{
+	  double 
+	    *d = &diagptable[j * numberOfStates];
+	  
+	  left  = &(x1v[x1Rate * j]);
+	  right = &(x2v[numberOfStates * j]);
+	  
+	  for(l = 0; l < loopLength; l += VECTOR_WIDTH)
+	    {
+	      VECTOR_REGISTER 
+		mul = VECTOR_MUL(VECTOR_LOAD(&left[l]), VECTOR_LOAD(&right[l]));
+	      tv = VECTOR_ADD(tv, VECTOR_MUL(mul, VECTOR_LOAD(&d[l])));		   
+	    }	
+	  
+	  for(; l < numberOfStates; l++)
+	    tBuffer += left[l] * right[l] * d[l];	   	 		
+	}	 	 
+
+      term = haddScalar(tv);
+
+      term += tBuffer;
+	  	  	 
+      term = LOG(factor * FABS(term));		 	  	  
+
+      if(siteLikelihoods)
+        siteLikelihoods[i] = term;
+
+      sum += wptr[i] * term;
+    }    	        
+
+  return sum;
 }
 
 
@@ -1690,7 +1791,7 @@ static double evaluateGTRGAMMA_NSTATE (int *wptr,
 static double evaluateGTRGAMMAPROT (int *wptr,
 				    double *x1, double *x2,  
 				    double *tipVector, 
-				    unsigned char *tipX1, size_t n, double *diagptable)
+				    unsigned char *tipX1, size_t n, double *diagptable, double *siteLikelihoods)
 {
   double   sum = 0.0, term;        
   size_t     i, j, l;   
@@ -1722,6 +1823,9 @@ static double evaluateGTRGAMMAPROT (int *wptr,
 	  term = LOG(0.25 * FABS(term));
 		 
 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}    	        
     }              
@@ -1750,6 +1854,9 @@ static double evaluateGTRGAMMAPROT (int *wptr,
 	  term = LOG(0.25 * FABS(term));
 	  
 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}
     }
@@ -1760,7 +1867,7 @@ static double evaluateGTRGAMMAPROT (int *wptr,
 
 static double evaluateGTRCATPROT (int *cptr, int *wptr,
 				  double *x1, double *x2, double *tipVector,
-				  unsigned char *tipX1, size_t n, double *diagptable_start)
+				  unsigned char *tipX1, size_t n, double *diagptable_start, double *siteLikelihoods)
 {
   double   sum = 0.0, term;
   double  *diagptable,  *left, *right;
@@ -1793,6 +1900,9 @@ static double evaluateGTRCATPROT (int *cptr, int *wptr,
 	  
 	  term = LOG(FABS(term));
 	  	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}      
     }    
@@ -1823,6 +1933,9 @@ static double evaluateGTRCATPROT (int *cptr, int *wptr,
 	  	  
 	  term = LOG(FABS(term));	 
 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;      
 	}
     }
@@ -1834,7 +1947,7 @@ static double evaluateGTRCATPROT (int *cptr, int *wptr,
 static double evaluateGTRCATPROT_SAVE (int *cptr, int *wptr,
 				       double *x1, double *x2, double *tipVector,
 				       unsigned char *tipX1, size_t n, double *diagptable_start, 
-				       double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap)
+				       double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap, double *siteLikelihoods)
 {
   double   
     sum = 0.0, 
@@ -1883,6 +1996,9 @@ static double evaluateGTRCATPROT_SAVE (int *cptr, int *wptr,
 	  
 	  term = LOG(FABS(term));
 	  	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}      
     }    
@@ -1926,6 +2042,9 @@ static double evaluateGTRCATPROT_SAVE (int *cptr, int *wptr,
 	  	  
 	  term = LOG(FABS(term));	 
 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;      
 	}
     }
@@ -1937,7 +2056,7 @@ static double evaluateGTRCATPROT_SAVE (int *cptr, int *wptr,
 static double evaluateGTRCAT_SAVE (int *cptr, int *wptr,
 				   double *x1_start, double *x2_start, double *tipVector, 		      
 				   unsigned char *tipX1, size_t n, double *diagptable_start,
-				   double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap)
+				   double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap, double *siteLikelihoods)
 {
   double  sum = 0.0, term;       
   size_t     i;
@@ -1988,6 +2107,9 @@ static double evaluateGTRCAT_SAVE (int *cptr, int *wptr,
 	      
 	 
 
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}	
     }               
@@ -2036,6 +2158,9 @@ static double evaluateGTRCAT_SAVE (int *cptr, int *wptr,
 	 
 	  term = LOG(FABS(t[0] + t[1]));
 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}    
     }
@@ -2048,7 +2173,7 @@ static double evaluateGTRGAMMA_GAPPED_SAVE(int *wptr,
 					   double *x1_start, double *x2_start, 
 					   double *tipVector, 
 					   unsigned char *tipX1, const size_t n, double *diagptable,
-					   double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap)
+					   double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap, double *siteLikelihoods)
 {
   double   sum = 0.0, term;    
   size_t     i, j;
@@ -2108,6 +2233,9 @@ static double evaluateGTRGAMMA_GAPPED_SAVE(int *wptr,
 	  term = LOG(0.25 * FABS(t[0] + t[1]));
 	   
 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}     
     }
@@ -2165,6 +2293,9 @@ static double evaluateGTRGAMMA_GAPPED_SAVE(int *wptr,
 	  term = LOG(0.25 * FABS(t[0] + t[1]));
 	 	  
 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}                      	
     }
@@ -2176,7 +2307,7 @@ static double evaluateGTRGAMMA_GAPPED_SAVE(int *wptr,
 static double evaluateGTRGAMMA(int *wptr,
 			       double *x1_start, double *x2_start, 
 			       double *tipVector, 
-			       unsigned char *tipX1, const size_t n, double *diagptable)
+			       unsigned char *tipX1, const size_t n, double *diagptable, double *siteLikelihoods)
 {
   double   sum = 0.0, term;    
   size_t     i, j;
@@ -2228,6 +2359,9 @@ static double evaluateGTRGAMMA(int *wptr,
 	  
 	 
 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}     
     }
@@ -2274,6 +2408,9 @@ static double evaluateGTRGAMMA(int *wptr,
 	 	  
 
 	  
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}                      	
     }
@@ -2284,7 +2421,7 @@ static double evaluateGTRGAMMA(int *wptr,
 
 static double evaluateGTRCAT (int *cptr, int *wptr,
 			      double *x1_start, double *x2_start, double *tipVector, 		      
-			      unsigned char *tipX1, size_t n, double *diagptable_start)
+			      unsigned char *tipX1, size_t n, double *diagptable_start, double *siteLikelihoods)
 {
   double  sum = 0.0, term;       
   size_t     i;
@@ -2326,6 +2463,9 @@ static double evaluateGTRCAT (int *cptr, int *wptr,
 	  term = LOG(FABS(t[0] + t[1]));
 	  
 
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}	
     }               
@@ -2364,6 +2504,9 @@ static double evaluateGTRCAT (int *cptr, int *wptr,
 	  term = LOG(FABS(t[0] + t[1]));
 	  
 
+	  if(siteLikelihoods)
+	    siteLikelihoods[i] = term;
+
 	  sum += wptr[i] * term;
 	}    
     }
@@ -41,6 +41,11 @@ extern infoList iList;
 int processID;
 infoList iList;
 
+/* communicator of the processes that jointly compute one search, see --groups */
+extern MPI_Comm comm;
+
+MPI_Comm comm;
+
 extern int Thorough;
 
 int Thorough = 0;
@@ -63,7 +68,8 @@ extern char run_id[128],
   binaryCheckpointInputName[1024],
   byteFileName[1024],
   modelFileName[1024],
-  treeFileName[1024];
+  treeFileName[1024],
+  bootstrapFileName[1024];
 
 char run_id[128] = "", 
   workdir[1024] = "", 
@@ -79,7 +85,8 @@ char run_id[128] = "",
   binaryCheckpointInputName[1024] = "",
   byteFileName[1024] = "",
   modelFileName[1024] = "",
-  treeFileName[1024] = "";
+  treeFileName[1024] = "",
+  bootstrapFileName[1024] = "";
 
 extern char *protModels[NUM_PROT_MODELS];
 
@@ -194,14 +201,15 @@ partitionLengths pLengths[MAX_MODEL] = {
   {4096, 4096, 64, 4096, 4096, 2016, 64, 4160, 64, 2016, FALSE, 64, (char*)NULL, 64, TRUE, (unsigned int*)NULL},
 
   //mth some pre-defined lengths etc. for 10-state POMO models
+  //the tip vector only holds the likelihood vector of an all-missing species for the memory saving option
   
   /* POMO_16 */
   
-  {256,  256,  16, 256,  256,  120,  16,   0, 120,  16, FALSE, 16, (char*)NULL,               16, FALSE, (unsigned int*)NULL},
+  {256,  256,  16, 256,  256,  120,  16,  16, 120,  16, FALSE, 16, (char*)NULL,               16, FALSE, (unsigned int*)NULL},
 
   /* POMO_64 */
   
-  {4096, 4096, 64, 4096, 4096, 2016, 64, 0, 2016, 64, FALSE, 64,   (char *)NULL,              64, FALSE, (unsigned int*)NULL}
+  {4096, 4096, 64, 4096, 4096, 2016, 64, 64, 2016, 64, FALSE, 64,   (char *)NULL,              64, FALSE, (unsigned int*)NULL}
 
 };
 
@@ -0,0 +1,971 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <unistd.h>
+#include <assert.h>
+
+#include <mpi.h>
+
+#include "axml.h"
+
+
+/*
+   Standalone micro-benchmark of the likelihood kernels.
+
+   The kernels are run on synthetic data of one partition, without an alignment, a tree
+   file, or mpirun: for every data type and model of rate heterogeneity we set up a tree
+   struct with BENCH_TAXA tips, random tip states (tip likelihood vectors for POMO), random
+   site weights, and the default model parameters of initModel(), and time the kernels
+   through the same entry points the search uses:
+
+   - newview:  newviewIterative() for a TIP_TIP, a TIP_INNER, and an INNER_INNER entry,
+   - evaluate: evaluateIterative() at a tip/inner and an inner/inner branch,
+   - sumtable: makenewzIterative() at the same branches,
+   - core:     execCore(), the first and second derivative at the inner/inner branch.
+
+   The inner nodes BENCH_TAXA + 1, + 2, + 3 hold the vectors computed by the three newview
+   entries, the branches for evaluate, sumtable, and core are chosen among them. No MPI
+   communication takes place inside the timed regions.
+
+   The FLOP and byte counts per site are nominal, they follow the textbook formulation
+   (inner vectors in the eigenspace of the rate matrix, P matrices and tip lookup tables
+   precomputed per call) and not the exact instruction mix of a kernel. They are meant for
+   comparing kernels, builds, and machines, not for absolute roofline numbers.
+
+   With -c nothing is timed, instead we check that the memory saving option (-S) computes the
+   same likelihoods and derivatives as the full vectors: the kernels run twice on the same
+   data with entirely undetermined columns below the inner nodes, once with the SEV gap 
+   vectors. The results are reported as identical if they are bit-identical, a relative
+   difference up to CHECK_TOLERANCE is accepted as rounding: under PSR the gap column of an
+   inner node is computed with a P matrix of its own instead of the rate categories of the
+   sites, and the AVX512 kernel set has no -S kernels of its own for DNA and protein data.
+
+   The benchmark is built with mpicc from all modules except axml.c, like examl: the kernel
+   files reference the helpers, globals, timers, and CLV store of the other modules, and
+   axml.h includes mpi.h. It is started without mpirun and refuses to run on more than one
+   process.
+
+   Build with "make -f Makefile.XXX bench".
+*/
+
+#ifdef _USE_OMP
+#error "the kernel benchmark times the sequential kernels, please build it without -D_USE_OMP"
+#endif
+
+extern int processID;
+extern int processes;
+extern MPI_Comm comm;
+
+extern partitionLengths pLengths[MAX_MODEL];
+
+#define BENCH_TAXA 4
+
+#define BENCH_NEWVIEW  0
+#define BENCH_EVALUATE 1
+#define BENCH_SUMTABLE 2
+#define BENCH_CORE     3
+
+typedef struct
+{
+  const char
+    *name;
+
+  int
+    dataType,
+    protModels;
+} benchData;
+
+static const benchData benchDataTypes[] = {
+  {"BIN",       BINARY_DATA, GTR},
+  {"DNA",       DNA_DATA,    GTR},
+  {"AA",        AA_DATA,     WAG},
+  {"LG4",       AA_DATA,     LG4M},
+  {"GENERIC32", GENERIC_32,  GTR},
+  {"GENERIC64", GENERIC_64,  GTR},
+  {"POMO16",    POMO_16,     GTR},
+  {"POMO64",    POMO_64,     GTR}
+};
+
+static const char
+  *rateHetNames[] = {"PSR", "GAMMA", "PLAIN"},
+  *tipCaseNames[] = {"TIP_TIP", "TIP_INNER", "INNER_INNER"},
+  *kernelNames[]  = {"newview", "evaluate", "sumtable", "core"};
+
+static void printUsage(char *binaryName)
+{
+  printf("\nUsage: %s [-s numberOfSites] [-t seconds] [-d dataType] [-m rateHeterogeneityModel] [-c]\n\n", binaryName);
+  printf("      -s      number of alignment sites (patterns) of the synthetic partition\n");
+  printf("              DEFAULT: 10000\n\n");
+  printf("      -t      minimum time in seconds each kernel is timed for\n");
+  printf("              DEFAULT: 0.5\n\n");
+  printf("      -d      only run the given data type: BIN, DNA, AA, LG4, GENERIC32, GENERIC64, POMO16, POMO64\n");
+  printf("              DEFAULT: all data types\n\n");
+  printf("      -m      only run the given model of rate heterogeneity: GAMMA, PSR (not for POMO), or PLAIN (only for POMO)\n");
+  printf("              DEFAULT: all models\n\n");
+  printf("      -c      check that the memory saving option (-S) gives the same likelihoods and derivatives as the\n");
+  printf("              full vectors on data with undetermined columns, instead of timing the kernels\n\n");
+#ifdef _CPU_DISPATCH
+  printf("      -k      use the likelihood kernels of the given instruction set: SSE3, AVX, AVX2, AVX512\n");
+  printf("              DEFAULT: the fastest kernels of the CPU\n\n");
+#endif
+}
+
+static double randomUniform(void)
+{
+  return ((double)rand() + 0.5) / ((double)RAND_MAX + 1.0);
+}
+
+/* a random tip state that is not ambiguous, or the undetermined character for about 5% of the sites */
+static unsigned char randomTipState(int dataType)
+{
+  const unsigned int
+    *bitVector = getBitVector(dataType);
+
+  int
+    undetermined = getUndetermined(dataType);
+
+  if(randomUniform() < 0.05)
+    return (unsigned char)undetermined;
+
+  for(;;)
+    {
+      int
+	c = (int)(randomUniform() * (double)undetermined);
+
+      if(__builtin_popcount(bitVector[c]) == 1)
+	return (unsigned char)c;
+    }
+}
+
+static boolean supportedCombination(const benchData *d, int rateHetModel)
+{
+  /* the tips of generic 64-state data can not be set up (no tip bit vector in pLengths) */
+  if(!isPomo(d->dataType) && !pLengths[d->dataType].bitVector)
+    return FALSE;
+
+#ifdef _OPTIMIZED_FUNCTIONS
+  /* the vectorized kernels of 32-state data only cover GAMMA */
+  if(d->dataType == GENERIC_32 && rateHetModel == CAT)
+    return FALSE;
+#endif
+
+  if(rateHetModel == PLAIN && !isPomo(d->dataType))
+    return FALSE;
+
+  if(rateHetModel == CAT && isPomo(d->dataType))
+    return FALSE;
+
+  if(rateHetModel != GAMMA && d->protModels == LG4M)
+    return FALSE;
+
+  return TRUE;
+}
+
+/* the combinations ExaML accepts with the memory saving option, see main() in axml.c */
+static boolean memorySavingSupported(const benchData *d)
+{
+#ifndef _OPTIMIZED_FUNCTIONS
+  return FALSE;
+#endif
+
+  return (d->dataType != BINARY_DATA && d->protModels != LG4M) ? TRUE : FALSE;
+}
+
+/* sets up a tree with one partition of the given data type, analogous to setupTree(), initializePartitions(), and initModel() */
+static tree *setupBenchTree(const benchData *d, int rateHetModel, size_t width)
+{
+  tree
+    *tr = (tree *)calloc(1, sizeof(tree));
+
+  pInfo
+    *p;
+
+  const partitionLengths
+    *pl = &pLengths[d->dataType];
+
+  size_t
+    i,
+    j,
+    span;
+
+  tr->mxtips = BENCH_TAXA;
+  tr->NumberOfModels = 1;
+  tr->numBranches = 1;
+  tr->rateHetModel = rateHetModel;
+  tr->categories = 25;
+  tr->maxCategories = MAX(4, tr->categories);
+  tr->multiStateModel = GTR_MULTI_STATE;
+  tr->useMedian = FALSE;
+  tr->saveMemory = FALSE;
+  tr->clvSlot = (int *)NULL;
+
+  tr->perPartitionLH = (double *)calloc(1, sizeof(double));
+  tr->partitionContributions = (double *)malloc(sizeof(double));
+  tr->partitionWeights = (double *)malloc(sizeof(double));
+  tr->executeModel = (boolean *)malloc(sizeof(boolean));
+  tr->executeModel[0] = TRUE;
+
+  tr->td[0].count = 0;
+  tr->td[0].ti = (traversalInfo *)calloc((size_t)tr->mxtips, sizeof(traversalInfo));
+  tr->td[0].executeModel = (boolean *)malloc(sizeof(boolean));
+  tr->td[0].parameterValues = (double *)malloc(sizeof(double));
+  tr->td[0].executeModel[0] = TRUE;
+
+  tr->partitionData = (pInfo *)calloc(1, sizeof(pInfo));
+
+  p = &tr->partitionData[0];
+
+  p->states = pl->states;
+  p->maxTipStates = pl->undetermined + 1;
+  p->lower = 0;
+  p->upper = width;
+  p->width = width;
+  p->offset = 0;
+  p->dataType = d->dataType;
+  p->protModels = d->protModels;
+  p->autoProtModels = WAG;
+  p->protFreqs = FALSE;
+  p->nonGTR = FALSE;
+  p->optimizeBaseFrequencies = FALSE;
+  p->numberOfCategories = 1;
+  p->partitionName = "benchmark";
+
+  span = (size_t)p->states * discreteRateCategories(tr->rateHetModel);
+
+  p->globalScaler         = (unsigned int *)calloc(2 * (size_t)tr->mxtips, sizeof(unsigned int));
+  p->left                 = (double *)malloc_aligned((size_t)pl->leftLength * ((size_t)tr->maxCategories + 1) * sizeof(double));
+  p->right                = (double *)malloc_aligned((size_t)pl->rightLength * ((size_t)tr->maxCategories + 1) * sizeof(double));
+  p->EIGN                 = (double *)malloc((size_t)pl->eignLength * sizeof(double));
+  p->EV                   = (double *)malloc_aligned((size_t)pl->evLength * sizeof(double));
+  p->EI                   = (double *)malloc((size_t)pl->eiLength * sizeof(double));
+  p->substRates           = (double *)malloc((size_t)pl->substRatesLength * sizeof(double));
+  p->frequencies          = (double *)malloc((size_t)pl->frequenciesLength * sizeof(double));
+  p->freqExponents        = (double *)malloc((size_t)pl->frequenciesLength * sizeof(double));
+  p->empiricalFrequencies = (double *)malloc((size_t)pl->frequenciesLength * sizeof(double));
+  p->tipVector            = (double *)malloc_aligned((size_t)(isPomo(p->dataType) ? (getUndetermined(GENERIC_32) + 1) * p->states : pl->tipVectorLength) * sizeof(double));
+  p->symmetryVector       = (int *)malloc((size_t)pl->symmetryVectorLength * sizeof(int));
+  p->frequencyGrouping    = (int *)malloc((size_t)pl->frequencyGroupingLength * sizeof(int));
+  p->perSiteRates         = (double *)malloc(sizeof(double) * (size_t)tr->maxCategories);
+  p->sumBuffer            = (double *)malloc_aligned(width * span * sizeof(double));
+  p->wgt                  = (int *)malloc(width * sizeof(int));
+  p->rateCategory         = (int *)calloc(width, sizeof(int));
+  p->patrat               = (double *)malloc(width * sizeof(double));
+
+  if(p->protModels == LG4M)
+    {
+      int
+	k;
+
+      for(k = 0; k < 4; k++)
+	{
+	  p->rawEIGN_LG4[k]     = (double *)malloc((size_t)pl->eignLength * sizeof(double));
+	  p->EIGN_LG4[k]        = (double *)malloc((size_t)pl->eignLength * sizeof(double));
+	  p->EV_LG4[k]          = (double *)malloc_aligned((size_t)pl->evLength * sizeof(double));
+	  p->EI_LG4[k]          = (double *)malloc((size_t)pl->eiLength * sizeof(double));
+	  p->substRates_LG4[k]  = (double *)malloc((size_t)pl->substRatesLength * sizeof(double));
+	  p->frequencies_LG4[k] = (double *)malloc((size_t)pl->frequenciesLength * sizeof(double));
+	  p->tipVector_LG4[k]   = (double *)malloc_aligned((size_t)pl->tipVectorLength * sizeof(double));
+	}
+    }
+
+  /* equal base frequencies instead of empirical ones, the protein models use their own */
+
+  for(i = 0; i < (size_t)pl->frequenciesLength; i++)
+    p->frequencies[i] = 1.0 / (double)(isPomo(p->dataType) ? 4 : p->states);
+
+  for(i = 0; i < width; i++)
+    p->wgt[i] = 1 + (int)(randomUniform() * 3.0);
+
+  /* tips */
+
+  if(isPomo(p->dataType))
+    {
+      p->xTipCLV    = (double **)calloc((size_t)tr->mxtips + 1, sizeof(double *));
+      p->xTipVector = (double **)calloc((size_t)tr->mxtips + 1, sizeof(double *));
+
+      for(j = 1; j <= (size_t)tr->mxtips; j++)
+	{
+	  p->xTipCLV[j]    = (double *)malloc_aligned(width * (size_t)p->states * sizeof(double));
+	  p->xTipVector[j] = (double *)malloc_aligned(width * (size_t)p->states * sizeof(double));
+
+	  /* a random distribution over the states of every site */
+
+	  for(i = 0; i < width; i++)
+	    {
+	      double
+		*prob = &p->xTipCLV[j][i * (size_t)p->states],
+		sum = 0.0;
+
+	      int
+		k;
+
+	      for(k = 0; k < p->states; k++)
+		{
+		  prob[k] = randomUniform();
+		  sum += prob[k];
+		}
+
+	      for(k = 0; k < p->states; k++)
+		prob[k] /= sum;
+	    }
+	}
+    }
+  else
+    {
+      p->yVector = (unsigned char **)calloc((size_t)tr->mxtips + 1, sizeof(unsigned char *));
+
+      for(j = 1; j <= (size_t)tr->mxtips; j++)
+	{
+	  p->yVector[j] = (unsigned char *)malloc_aligned(width * sizeof(unsigned char));
+
+	  for(i = 0; i < width; i++)
+	    p->yVector[j][i] = randomTipState(p->dataType);
+	}
+    }
+
+  /* inner vectors of the nodes BENCH_TAXA + 1 ... 2 * BENCH_TAXA - 1 */
+
+  p->xVector      = (double **)calloc((size_t)tr->mxtips, sizeof(double *));
+  p->xSpaceVector = (size_t *)calloc((size_t)tr->mxtips, sizeof(size_t));
+
+  for(j = 0; j < (size_t)tr->mxtips - 1; j++)
+    {
+      p->xSpaceVector[j] = width * span * sizeof(double);
+      p->xVector[j] = (double *)malloc_aligned(p->xSpaceVector[j]);
+    }
+
+  /* the set-up of the POMO rate matrix is not finished in this version (updatePomoRates() exits), 
+     hence we use equal rates on the POMO states: initReversibleGTR() as for generic data, which also 
+     fills the tipVector that POMO does not use, followed by the tip vectors in the eigenspace */
+
+  if(isPomo(p->dataType))
+    {
+      for(i = 0; i < (size_t)pl->substRatesLength; i++)
+	p->substRates[i] = 1.0;
+
+      p->alpha = 1.0;
+      makeGammaCats(p->alpha, p->gammaRates, 4, tr->useMedian);
+
+      p->dataType = GENERIC_32;
+      initReversibleGTR(tr, 0);
+      p->dataType = d->dataType;
+
+      updateTipXVectors(tr, 0);
+    }
+  else
+    initModel(tr);
+
+  /* per-site rates: 25 categories with mean 1.0 as after a few rounds of optimizeRateCategories() */
+
+  if(tr->rateHetModel == CAT)
+    {
+      int
+	k;
+
+      p->numberOfCategories = tr->categories;
+
+      for(k = 0; k < p->numberOfCategories; k++)
+	p->perSiteRates[k] = 2.0 * ((double)k + 0.5) / (double)p->numberOfCategories;
+
+      for(i = 0; i < width; i++)
+	p->rateCategory[i] = (int)(randomUniform() * (double)p->numberOfCategories);
+    }
+
+  return tr;
+}
+
+static void freeBenchTree(tree *tr)
+{
+  pInfo
+    *p = &tr->partitionData[0];
+
+  int
+    j;
+
+  for(j = 0; j < tr->mxtips - 1; j++)
+    free(p->xVector[j]);
+
+  for(j = 1; j <= tr->mxtips; j++)
+    {
+      if(isPomo(p->dataType))
+	{
+	  free(p->xTipCLV[j]);
+	  free(p->xTipVector[j]);
+	}
+      else
+	free(p->yVector[j]);
+    }
+
+  if(isPomo(p->dataType))
+    {
+      free(p->xTipCLV);
+      free(p->xTipVector);
+    }
+  else
+    free(p->yVector);
+
+  if(p->protModels == LG4M)
+    {
+      int
+	k;
+
+      for(k = 0; k < 4; k++)
+	{
+	  free(p->rawEIGN_LG4[k]);
+	  free(p->EIGN_LG4[k]);
+	  free(p->EV_LG4[k]);
+	  free(p->EI_LG4[k]);
+	  free(p->substRates_LG4[k]);
+	  free(p->frequencies_LG4[k]);
+	  free(p->tipVector_LG4[k]);
+	}
+    }
+
+  free(p->xVector);
+  free(p->xSpaceVector);
+  free(p->gapVector);
+  free(p->gapColumn);
+  free(p->globalScaler);
+  free(p->left);
+  free(p->right);
+  free(p->EIGN);
+  free(p->EV);
+  free(p->EI);
+  free(p->substRates);
+  free(p->frequencies);
+  free(p->freqExponents);
+  free(p->empiricalFrequencies);
+  free(p->tipVector);
+  free(p->symmetryVector);
+  free(p->frequencyGrouping);
+  free(p->perSiteRates);
+  free(p->sumBuffer);
+  free(p->wgt);
+  free(p->rateCategory);
+  free(p->patrat);
+
+  free(tr->partitionData);
+  free(tr->td[0].ti);
+  free(tr->td[0].executeModel);
+  free(tr->td[0].parameterValues);
+  free(tr->executeModel);
+  free(tr->perPartitionLH);
+  free(tr->partitionContributions);
+  free(tr->partitionWeights);
+  free(tr);
+}
+
+/* makes the first BENCH_TAXA, 3, or 2 tips undetermined at about 10% of the sites each, such that 
+   the sites are entirely undetermined below every inner node of benchmark() at some sites */
+static void addUndeterminedColumns(tree *tr)
+{
+  pInfo
+    *p = &tr->partitionData[0];
+
+  size_t
+    i,
+    k;
+
+  for(i = 0; i < p->width; i++)
+    {
+      double
+	u = randomUniform();
+
+      int
+	j,
+	undeterminedTips = (u < 0.1) ? tr->mxtips : ((u < 0.2) ? 3 : ((u < 0.3) ? 2 : 0));
+
+      for(j = 1; j <= undeterminedTips; j++)
+	{
+	  /* a POMO species without any individuals */
+	  if(isPomo(p->dataType))
+	    for(k = 0; k < (size_t)p->states; k++)
+	      p->xTipCLV[j][i * (size_t)p->states + k] = 1.0;
+	  else
+	    p->yVector[j][i] = (unsigned char)getUndetermined(p->dataType);
+	}
+    }
+
+  if(isPomo(p->dataType))
+    updateTipXVectors(tr, 0);
+}
+
+/* switches on the memory saving option, analogous to allocPartitions() and initializePartitions() */
+static void enableMemorySaving(tree *tr)
+{
+  pInfo
+    *p = &tr->partitionData[0];
+
+  tr->saveMemory = TRUE;
+
+  p->gapVectorLength = ((int)p->width / 32) + 1;
+  p->gapVector = (unsigned int *)calloc((size_t)p->gapVectorLength * 2 * (size_t)tr->mxtips, sizeof(unsigned int));
+  p->gapColumn = (double *)malloc_aligned((size_t)tr->mxtips * (size_t)p->states * discreteRateCategories(tr->rateHetModel) * sizeof(double));
+
+  initTipGapVectors(tr, p);
+}
+
+/* a traversal descriptor with the single entry p, q, r, or the branch p, q (r = q) for evaluate and makenewz */
+static void setTraversal(tree *tr, int tipCase, int pNumber, int qNumber, int rNumber)
+{
+  traversalInfo
+    *ti = &tr->td[0].ti[0];
+
+  ti->tipCase = tipCase;
+  ti->pNumber = pNumber;
+  ti->qNumber = qNumber;
+  ti->rNumber = rNumber;
+  ti->qz[0] = 0.9;
+  ti->rz[0] = 0.8;
+
+  assignClvSlots(ti, (nodeptr)NULL, tr->mxtips);
+
+  tr->td[0].count = 1;
+}
+
+static void runKernel(tree *tr, int kernel)
+{
+  volatile double
+    dlnLdlz[NUM_BRANCHES],
+    d2lnLdlz2[NUM_BRANCHES];
+
+  switch(kernel)
+    {
+    case BENCH_NEWVIEW:
+      newviewIterative(tr, 0);
+      break;
+    case BENCH_EVALUATE:
+      evaluateIterative(tr);
+      break;
+    case BENCH_SUMTABLE:
+      makenewzIterative(tr);
+      break;
+    case BENCH_CORE:
+      execCore(tr, dlnLdlz, d2lnLdlz2);
+      break;
+    default:
+      assert(0);
+    }
+}
+
+/* runs the kernel at least for minTime seconds, returns the time per call */
+static double timeKernel(tree *tr, int kernel, double minTime)
+{
+  double
+    t,
+    elapsed;
+
+  long
+    i,
+    calls = 1;
+
+  /* warm-up, also sets up the sumtable for core */
+  runKernel(tr, kernel);
+
+  for(;;)
+    {
+      t = gettime();
+
+      for(i = 0; i < calls; i++)
+	runKernel(tr, kernel);
+
+      elapsed = gettime() - t;
+
+      if(elapsed >= minTime)
+	break;
+
+      /* aim a bit above minTime with the next try */
+      if(elapsed > 0.0)
+	calls = MAX(2 * calls, (long)((double)calls * 1.2 * minTime / elapsed));
+      else
+	calls *= 2;
+    }
+
+  return elapsed / (double)calls;
+}
+
+/* nominal floating point operations per site, see the comment at the top */
+static double flopsPerSite(tree *tr, int kernel, int tipCase)
+{
+  double
+    s = (double)tr->partitionData[0].states,
+    c = (double)discreteRateCategories(tr->rateHetModel);
+
+  switch(kernel)
+    {
+    case BENCH_NEWVIEW:
+      /* P matrix times vector for every inner child, product, back-transformation. The tips 
+	 of POMO data are likelihood vectors and cost as much as inner vectors */
+      if(isPomo(tr->partitionData[0].dataType))
+	return c * (6.0 * s * s + s);
+
+      switch(tipCase)
+	{
+	case TIP_TIP:
+	  return c * (2.0 * s * s + s);
+	case TIP_INNER:
+	  return c * (4.0 * s * s + s);
+	default:
+	  return c * (6.0 * s * s + s);
+	}
+    case BENCH_EVALUATE:
+      return c * 3.0 * s + 2.0;
+    case BENCH_SUMTABLE:
+      return c * s;
+    case BENCH_CORE:
+      return c * 6.0 * s + 6.0;
+    default:
+      assert(0);
+    }
+
+  return 0.0;
+}
+
+/* nominal bytes read and written per site */
+static double bytesPerSite(tree *tr, int kernel, int tipCase)
+{
+  double
+    vector = (double)(tr->partitionData[0].states * (int)discreteRateCategories(tr->rateHetModel)) * sizeof(double),
+    tip = isPomo(tr->partitionData[0].dataType) ? (double)tr->partitionData[0].states * sizeof(double) : sizeof(unsigned char),
+    rateCategory = (tr->rateHetModel == CAT) ? sizeof(int) : 0.0,
+    tips = (tipCase == TIP_TIP) ? 2.0 : ((tipCase == TIP_INNER) ? 1.0 : 0.0),
+    inner = 2.0 - tips;
+
+  switch(kernel)
+    {
+    case BENCH_NEWVIEW:
+      return tips * tip + inner * vector + vector + rateCategory;
+    case BENCH_EVALUATE:
+      return tips * tip + inner * vector + sizeof(int) + rateCategory;
+    case BENCH_SUMTABLE:
+      return tips * tip + inner * vector + vector;
+    case BENCH_CORE:
+      return vector + sizeof(int) + rateCategory;
+    default:
+      assert(0);
+    }
+
+  return 0.0;
+}
+
+static void report(tree *tr, const benchData *d, int kernel, int tipCase, double seconds)
+{
+  double
+    sites = (double)tr->partitionData[0].width / seconds;
+
+  printf("%-10s %-6s %-9s %-12s %12.4e sites/s %9.3f GFLOP/s %9.3f GB/s\n",
+	 d->name, rateHetNames[tr->rateHetModel], kernelNames[kernel], tipCaseNames[tipCase],
+	 sites,
+	 sites * flopsPerSite(tr, kernel, tipCase) / 1.0e9,
+	 sites * bytesPerSite(tr, kernel, tipCase) / 1.0e9);
+
+  fflush(stdout);
+}
+
+static void benchmark(const benchData *d, int rateHetModel, size_t width, double minTime)
+{
+  const int
+    tipTip = BENCH_TAXA + 1,
+    tipInner = BENCH_TAXA + 2,
+    innerInner = BENCH_TAXA + 3;
+
+  tree
+    *tr = setupBenchTree(d, rateHetModel, width);
+
+  double
+    seconds;
+
+  /* newview, the vectors computed here are used by the other kernels */
+
+  setTraversal(tr, TIP_TIP, tipTip, 1, 2);
+  seconds = timeKernel(tr, BENCH_NEWVIEW, minTime);
+  report(tr, d, BENCH_NEWVIEW, TIP_TIP, seconds);
+
+  setTraversal(tr, TIP_INNER, tipInner, 3, tipTip);
+  seconds = timeKernel(tr, BENCH_NEWVIEW, minTime);
+  report(tr, d, BENCH_NEWVIEW, TIP_INNER, seconds);
+
+  setTraversal(tr, INNER_INNER, innerInner, tipTip, tipInner);
+  seconds = timeKernel(tr, BENCH_NEWVIEW, minTime);
+  report(tr, d, BENCH_NEWVIEW, INNER_INNER, seconds);
+
+  /* evaluate and sumtable at the branches innerInner - tip and innerInner - tipInner */
+
+  setTraversal(tr, TIP_INNER, innerInner, 4, 4);
+  seconds = timeKernel(tr, BENCH_EVALUATE, minTime);
+  report(tr, d, BENCH_EVALUATE, TIP_INNER, seconds);
+
+  seconds = timeKernel(tr, BENCH_SUMTABLE, minTime);
+  report(tr, d, BENCH_SUMTABLE, TIP_INNER, seconds);
+
+  setTraversal(tr, INNER_INNER, innerInner, tipInner, tipInner);
+  seconds = timeKernel(tr, BENCH_EVALUATE, minTime);
+  report(tr, d, BENCH_EVALUATE, INNER_INNER, seconds);
+
+  seconds = timeKernel(tr, BENCH_SUMTABLE, minTime);
+  report(tr, d, BENCH_SUMTABLE, INNER_INNER, seconds);
+
+  /* the derivatives only depend on the sumtable computed last */
+
+  tr->td[0].parameterValues[0] = log(0.9);
+  tr->coreLZ[0] = log(0.9);
+  seconds = timeKernel(tr, BENCH_CORE, minTime);
+  report(tr, d, BENCH_CORE, INNER_INNER, seconds);
+
+  freeBenchTree(tr);
+}
+
+#define CHECK_RESULTS   6
+#define CHECK_TOLERANCE 1.0e-12
+
+static const char
+  *checkResultNames[CHECK_RESULTS] = {"lnL TIP_INNER", "dlnLdlz TIP_INNER", "d2lnLdlz2 TIP_INNER",
+				      "lnL INNER_INNER", "dlnLdlz INNER_INNER", "d2lnLdlz2 INNER_INNER"};
+
+/* the likelihood and the derivatives at the two branches of benchmark() */
+static void computeResults(tree *tr, double *results)
+{
+  const int
+    tipTip = BENCH_TAXA + 1,
+    tipInner = BENCH_TAXA + 2,
+    innerInner = BENCH_TAXA + 3;
+
+  volatile double
+    dlnLdlz[NUM_BRANCHES],
+    d2lnLdlz2[NUM_BRANCHES];
+
+  int
+    branch;
+
+  setTraversal(tr, TIP_TIP, tipTip, 1, 2);
+  newviewIterative(tr, 0);
+
+  setTraversal(tr, TIP_INNER, tipInner, 3, tipTip);
+  newviewIterative(tr, 0);
+
+  setTraversal(tr, INNER_INNER, innerInner, tipTip, tipInner);
+  newviewIterative(tr, 0);
+
+  for(branch = 0; branch < 2; branch++)
+    {
+      if(branch == 0)
+	setTraversal(tr, TIP_INNER, innerInner, 4, 4);
+      else
+	setTraversal(tr, INNER_INNER, innerInner, tipInner, tipInner);
+
+      evaluateIterative(tr);
+      results[3 * branch] = tr->perPartitionLH[0];
+
+      makenewzIterative(tr);
+      tr->td[0].parameterValues[0] = log(0.9);
+      tr->coreLZ[0] = log(0.9);
+      execCore(tr, dlnLdlz, d2lnLdlz2);
+      results[3 * branch + 1] = dlnLdlz[0];
+      results[3 * branch + 2] = d2lnLdlz2[0];
+    }
+}
+
+/* returns the number of results that differ between the full vectors and the memory saving option */
+static int checkMemorySaving(const benchData *d, int rateHetModel, size_t width)
+{
+  tree
+    *tr;
+
+  double
+    full[CHECK_RESULTS],
+    saving[CHECK_RESULTS],
+    maxDifference = 0.0;
+
+  int
+    i,
+    mismatches = 0;
+
+  /* the same data for both runs */
+
+  srand(12345);
+  tr = setupBenchTree(d, rateHetModel, width);
+  addUndeterminedColumns(tr);
+  computeResults(tr, full);
+  freeBenchTree(tr);
+
+  srand(12345);
+  tr = setupBenchTree(d, rateHetModel, width);
+  addUndeterminedColumns(tr);
+  enableMemorySaving(tr);
+  computeResults(tr, saving);
+  freeBenchTree(tr);
+
+  for(i = 0; i < CHECK_RESULTS; i++)
+    {
+      double
+	difference = fabs(saving[i] - full[i]) / MAX(fabs(full[i]), DBL_MIN);
+
+      maxDifference = MAX(maxDifference, difference);
+
+      if(difference > CHECK_TOLERANCE)
+	{
+	  printf("%-10s %-6s -S differs: %-22s %.17e (-S) %.17e (full vectors)\n", d->name, rateHetNames[rateHetModel],
+		 checkResultNames[i], saving[i], full[i]);
+	  mismatches++;
+	}
+    }
+
+  if(mismatches == 0)
+    {
+      if(maxDifference == 0.0)
+	printf("%-10s %-6s -S identical: lnL %f, dlnLdlz %e, d2lnLdlz2 %e\n", d->name, rateHetNames[rateHetModel],
+	       full[3], full[4], full[5]);
+      else
+	printf("%-10s %-6s -S equal up to a relative difference of %.1e: lnL %f, dlnLdlz %e, d2lnLdlz2 %e\n", d->name, rateHetNames[rateHetModel],
+	       maxDifference, full[3], full[4], full[5]);
+    }
+
+  fflush(stdout);
+
+  return mismatches;
+}
+
+int main(int argc, char *argv[])
+{
+  int
+    c,
+    i,
+    rateHetModel,
+    numberOfDataTypes = (int)(sizeof(benchDataTypes) / sizeof(benchData)),
+    selectedRateHet = -1,
+    mismatches = 0;
+
+  boolean
+    check = FALSE;
+
+#ifdef _CPU_DISPATCH
+  int
+    kernelSet = KERNELS_AUTO;
+#endif
+
+  size_t
+    width = 10000;
+
+  double
+    minTime = 0.5;
+
+  char
+    *selectedData = (char *)NULL;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &processID);
+  MPI_Comm_size(MPI_COMM_WORLD, &processes);
+  comm = MPI_COMM_WORLD;
+
+  if(processes > 1)
+    {
+      if(processID == 0)
+	printf("\nError, the kernel benchmark runs on a single process, please start it without mpirun\n");
+      MPI_Finalize();
+      return 1;
+    }
+
+  while((c = getopt(argc, argv, "s:t:d:m:k:ch")) != -1)
+    {
+      switch(c)
+	{
+	case 's':
+	  width = (size_t)atol(optarg);
+	  if(width < 1)
+	    {
+	      printf("\nError, the number of sites must be at least 1\n");
+	      errorExit(-1);
+	    }
+	  break;
+	case 't':
+	  minTime = atof(optarg);
+	  if(minTime <= 0.0)
+	    {
+	      printf("\nError, the minimum time per kernel must be larger than 0.0\n");
+	      errorExit(-1);
+	    }
+	  break;
+	case 'd':
+	  selectedData = optarg;
+	  break;
+	case 'c':
+	  check = TRUE;
+	  break;
+	case 'm':
+	  if(strcmp(optarg, "GAMMA") == 0)
+	    selectedRateHet = GAMMA;
+	  else if(strcmp(optarg, "PSR") == 0)
+	    selectedRateHet = CAT;
+	  else if(strcmp(optarg, "PLAIN") == 0)
+	    selectedRateHet = PLAIN;
+	  else
+	    {
+	      printf("\nError, unknown model of rate heterogeneity \"%s\", use GAMMA, PSR, or PLAIN\n", optarg);
+	      errorExit(-1);
+	    }
+	  break;
+#ifdef _CPU_DISPATCH
+	case 'k':
+	  kernelSet = kernelSetByName(optarg);
+	  if(kernelSet < 0)
+	    {
+	      printf("\nError, unknown likelihood kernels \"%s\", use SSE3, AVX, AVX2, or AVX512\n", optarg);
+	      errorExit(-1);
+	    }
+	  break;
+#endif
+	case 'h':
+	default:
+	  printUsage(argv[0]);
+	  MPI_Finalize();
+	  return (c == 'h') ? 0 : 1;
+	}
+    }
+
+  /* fixed seed such that all runs use the same data */
+  srand(12345);
+
+#ifdef _CPU_DISPATCH
+  kernelSet = selectKernels(kernelSet);
+  printf("\n%s %s likelihood kernel benchmark (%s), %zu sites, at least %.2f seconds per kernel\n\n", programName, programVersion, kernelSetName(kernelSet), width, minTime);
+#elif defined(__AVX)
+  printf("\n%s %s likelihood kernel benchmark (AVX), %zu sites, at least %.2f seconds per kernel\n\n", programName, programVersion, width, minTime);
+#else
+  printf("\n%s %s likelihood kernel benchmark (SSE3), %zu sites, at least %.2f seconds per kernel\n\n", programName, programVersion, width, minTime);
+#endif
+
+  for(i = 0; i < numberOfDataTypes; i++)
+    {
+      const benchData
+	*d = &benchDataTypes[i];
+
+      if(selectedData && strcmp(selectedData, d->name) != 0)
+	continue;
+
+      for(rateHetModel = CAT; rateHetModel <= PLAIN; rateHetModel++)
+	{
+	  if(selectedRateHet >= 0 && rateHetModel != selectedRateHet)
+	    continue;
+
+	  if(check && supportedCombination(d, rateHetModel))
+	    {
+	      if(memorySavingSupported(d))
+		mismatches += checkMemorySaving(d, rateHetModel, width);
+	      else
+		if(selectedData || selectedRateHet >= 0)
+		  printf("%-10s %-6s not supported with -S\n", d->name, rateHetNames[rateHetModel]);
+	    }
+	  else if(!check && supportedCombination(d, rateHetModel))
+	    benchmark(d, rateHetModel, width, minTime);
+	  else
+	    if(selectedData || selectedRateHet >= 0)
+	      printf("%-10s %-6s not supported\n", d->name, rateHetNames[rateHetModel]);
+	}
+    }
+
+  MPI_Finalize();
+
+  return (mismatches > 0) ? 1 : 0;
+}
@@ -0,0 +1,371 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <mpi.h>
+
+#include "axml.h"
+#include "byteFile.h"
+#include "partitionAssignment.h"
+
+
+extern int processes;
+extern int processID;
+extern MPI_Comm comm;
+extern char byteFileName[1024];
+
+
+/*
+   we need at least this much kernel time (in seconds, averaged over
+   all processes) before we trust the measurement
+*/
+#define REBALANCE_MIN_WINDOW 1.0
+
+/* never shrink the share of a process below this fraction of the average */
+#define REBALANCE_MIN_SHARE 0.1
+
+
+/**
+    estimated work of the sites currently assigned to process procId
+ */
+static double currentWork(tree *tr, int procId)
+{
+  int
+    i;
+
+  double
+    work = 0.0;
+
+  for(i = 0; i < tr->numAssignments; ++i)
+    {
+      Assign
+	*a = &(tr->partAssigns[i]);
+
+      if(a->procId == procId)
+	work += (double)a->width * estimateSiteCost(tr->partitionData[a->partitionId].dataType, tr->partitionData[a->partitionId].states, tr->rateHetModel);
+    }
+
+  return work;
+}
+
+
+/**
+    frees all arrays that depend on the sites assigned to this process
+    (tip data, weights, CLVs, ...). Everything else (model parameters,
+    P matrices, scalers) is independent of the assignment.
+ */
+static void freeSiteData(tree *tr)
+{
+  int
+    model,
+    j;
+
+  for(model = 0; model < tr->NumberOfModels; ++model)
+    {
+      pInfo
+	*p = &(tr->partitionData[model]);
+
+      for(j = 0; j < tr->mxtips; ++j)
+	{
+	  if(p->xVector[j])
+	    clvFree(p->xVector[j], p->xSpaceVector[j]);
+	  p->xVector[j] = (double*)NULL;
+	  p->xSpaceVector[j] = 0;
+	}
+
+      if(isPomo(p->dataType))
+	{
+	  if(p->xTipVector)
+	    free(p->xTipVector[1]);
+	  free(p->xTipVector);
+	  free(p->xTipCLV);
+	  free(p->xResource);
+
+	  p->xTipVector = (double**)NULL;
+	  p->xTipCLV = (double**)NULL;
+	  p->xResource = (double*)NULL;
+	}
+      else
+	{
+	  free(p->yVector);
+	  free(p->yResource);
+
+	  p->yVector = (unsigned char**)NULL;
+	  p->yResource = (unsigned char*)NULL;
+	}
+
+      free(p->wgt);
+      clvFree(p->sumBuffer, p->width * (size_t)p->states * discreteRateCategories(tr->rateHetModel) * sizeof(double));
+      clvFree(p->gapVector, (size_t)p->gapVectorLength * 2 * (size_t)tr->mxtips * sizeof(unsigned int));
+      clvFree(p->gapColumn, ((size_t)tr->mxtips) * ((size_t)(p->states)) * discreteRateCategories(tr->rateHetModel) * sizeof(double));
+
+      p->wgt = (int*)NULL;
+      p->sumBuffer = (double*)NULL;
+      p->gapVector = (unsigned int*)NULL;
+      p->gapColumn = (double*)NULL;
+      p->gapVectorLength = 0;
+
+      p->width = 0;
+      p->offset = 0;
+    }
+
+  free(tr->partAssigns);
+  tr->partAssigns = (Assign*)NULL;
+  tr->numAssignments = 0;
+
+  free(tr->patrat_basePtr);
+  free(tr->rateCategory_basePtr);
+  free(tr->lhs_basePtr);
+
+  tr->patrat_basePtr = (double*)NULL;
+  tr->rateCategory_basePtr = (int*)NULL;
+  tr->lhs_basePtr = (double*)NULL;
+}
+
+
+/**
+    reads the data for the new assignment from the byte file and
+    re-allocates the buffers whose size depends on the number of sites
+    (analogous to initializePartitions())
+ */
+static void readSiteData(tree *tr, PartitionAssignment *pa)
+{
+  int
+    model;
+
+  ByteFile
+    *bFile = (ByteFile *)NULL;
+
+  initializeByteFile(&bFile, byteFileName);
+  readHeader(bFile);
+  readTaxa(bFile);
+  readPartitions(bFile);
+  readMyData(bFile, pa, processID);
+
+  for(model = 0; model < tr->NumberOfModels; ++model)
+    {
+      pInfo
+	*src = bFile->partitions[model],
+	*p = &(tr->partitionData[model]);
+
+      size_t
+	width = src->width;
+
+      assert(src->states == p->states && src->lower == p->lower && src->upper == p->upper);
+
+      p->width      = src->width;
+      p->offset     = src->offset;
+      p->wgt        = src->wgt;
+      p->yVector    = src->yVector;
+      p->yResource  = src->yResource;
+      p->xTipVector = src->xTipVector;
+      p->xTipCLV    = src->xTipCLV;
+      p->xResource  = src->xResource;
+
+      /* these are allocated by readPartitions, but we keep our own copies */
+      free(src->partitionName);
+      free(src->frequencies);
+
+      p->sumBuffer = (double *)clvAlloc(width * (size_t)p->states * discreteRateCategories(tr->rateHetModel) * sizeof(double));
+
+      if(width > 0 && tr->saveMemory)
+	{
+	  p->gapVectorLength = ((int)width / 32) + 1;
+	  p->gapVector = (unsigned int*)clvCalloc((size_t)p->gapVectorLength * 2 * (size_t)tr->mxtips * sizeof(unsigned int));
+	  p->gapColumn = (double *)clvAlloc(((size_t)tr->mxtips) * ((size_t)(p->states)) * discreteRateCategories(tr->rateHetModel) * sizeof(double));
+
+	  initTipGapVectors(tr, p);
+	}
+
+      /* the tip vectors of POMO are stored in eigen space */
+      if(width > 0 && isPomo(p->dataType))
+	updateTipXVectors(tr, (size_t)model);
+    }
+
+  deleteByteFile(bFile);
+}
+
+
+/**
+    Re-distributes the sites among processes, if the kernel time
+    measured since the last call indicates that the current assignment
+    is imbalanced (e.g., because of heterogeneous nodes or scaling
+    frequencies that differ between the processes).
+
+    The new share of each process is proportional to its measured
+    speed (estimated work per second). Alignment data and weights are
+    re-read from the byte file, the distributed CAT arrays are gathered
+    at the master with the old assignment and scattered again with the
+    new one. All conditional likelihood vectors are invalidated, hence
+    we conclude with a full tree traversal.
+
+    Must be called by all processes at the same point (e.g., between
+    SPR cycles). Returns TRUE, if sites have been migrated.
+ */
+boolean rebalanceSiteAssignment(tree *tr)
+{
+  int
+    i,
+    *countPerProc = (int*)NULL,
+    *displPerProc = (int*)NULL,
+    *rateCategory = (int*)NULL;
+
+  double
+    avgTime = 0.0,
+    maxTime = 0.0,
+    avgSpeed = 0.0,
+    *patrat = (double*)NULL,
+    *times = (double *)calloc((size_t)processes, sizeof(double)),
+    *share = (double *)calloc((size_t)processes, sizeof(double));
+
+  PartitionAssignment
+    *pAss = (PartitionAssignment *)NULL;
+
+  if(!tr->dynamicLoadBalance || processes == 1)
+    {
+      free(times);
+      free(share);
+      return FALSE;
+    }
+
+  MPI_Allgather(&(tr->kernelTime), 1, MPI_DOUBLE, times, 1, MPI_DOUBLE, comm);
+
+  for(i = 0; i < processes; ++i)
+    {
+      avgTime += times[i];
+      if(times[i] > maxTime)
+	maxTime = times[i];
+    }
+  avgTime /= (double)processes;
+
+  /* window too short or imbalance acceptable */
+  if(avgTime < REBALANCE_MIN_WINDOW || maxTime / avgTime < tr->rebalanceThreshold)
+    {
+      if(avgTime >= REBALANCE_MIN_WINDOW)
+	tr->kernelTime = 0.0;
+      free(times);
+      free(share);
+      return FALSE;
+    }
+
+  /*
+     the speed of a process is the estimated work it processed per
+     second. Processes without any measurable time get the average
+     speed.
+  */
+  for(i = 0; i < processes; ++i)
+    {
+      double
+	work = currentWork(tr, i);
+
+      share[i] = (times[i] > 0.0 && work > 0.0) ? work / times[i] : 0.0;
+      avgSpeed += share[i];
+    }
+  avgSpeed /= (double)processes;
+
+  for(i = 0; i < processes; ++i)
+    {
+      if(share[i] == 0.0)
+	share[i] = avgSpeed;
+      if(share[i] < REBALANCE_MIN_SHARE * avgSpeed)
+	share[i] = REBALANCE_MIN_SHARE * avgSpeed;
+    }
+
+  printBothOpen("\nRe-balancing sites: kernel time max/avg %f (%f/%f secs)\n", maxTime / avgTime, maxTime, avgTime);
+
+  /* gather the CAT information with the old assignment */
+  if(tr->rateHetModel == CAT)
+    {
+      calculateLengthAndDisplPerProcess(tr, &countPerProc, &displPerProc);
+      gatherDistributedArray(tr, (void**)&patrat, tr->patrat_basePtr, MPI_DOUBLE, countPerProc, displPerProc);
+      gatherDistributedArray(tr, (void**)&rateCategory, tr->rateCategory_basePtr, MPI_INT, countPerProc, displPerProc);
+      free(countPerProc);
+      free(displPerProc);
+    }
+
+  /* compute the new assignment, all processes obtain the same result */
+  {
+    ByteFile
+      *bFile = (ByteFile *)NULL;
+
+    /* do not change the order, see readByteFile() */
+    initializeByteFile(&bFile, byteFileName);
+    readHeader(bFile);
+    readTaxa(bFile);
+    readPartitions(bFile);
+
+    initializePartitionAssignment(&pAss, bFile->partitions, bFile->numPartitions, processes, tr->rateHetModel);
+
+    for(i = 0; i < bFile->numPartitions; ++i)
+      {
+	free(bFile->partitions[i]->partitionName);
+	free(bFile->partitions[i]->frequencies);
+      }
+    deleteByteFile(bFile);
+  }
+
+  assignProportional(pAss, share);
+
+  if(processID == 0)
+    {
+      printLoad(pAss);
+      printf("\n");
+    }
+
+  /* migrate */
+  if(tr->parsimonyPrescreen)
+    freeParsimonyDataStructures(tr);
+
+  if(tr->clvCacheEntries > 0)
+    freeClvCache(tr);
+
+  /* the rows of the CLV store depend on the widths of the partitions */
+  if(tr->clvStoreVectors > 0)
+    freeClvStore(tr);
+
+  freeSiteData(tr);
+  readSiteData(tr, pAss);
+  copyAssignmentInfoToTree(pAss, tr);
+  deletePartitionAssignment(pAss);
+
+  /* the parsimony vectors cover the local sites only */
+  if(tr->parsimonyPrescreen)
+    allocateParsimonyDataStructures(tr);
+
+  /* as do the vectors in the CLV cache */
+  if(tr->clvCacheEntries > 0)
+    initClvCache(tr);
+
+  /* the vectors in the budget slots have been freed */
+  if(tr->clvBudget > 0)
+    initRecomputation(tr);
+
+  if(tr->clvStoreVectors > 0)
+    initClvStore(tr);
+
+  if(tr->rateHetModel == CAT)
+    {
+      calculateLengthAndDisplPerProcess(tr, &countPerProc, &displPerProc);
+      scatterDistrbutedArray(tr, patrat, tr->patrat_basePtr, MPI_DOUBLE, countPerProc, displPerProc);
+      scatterDistrbutedArray(tr, rateCategory, tr->rateCategory_basePtr, MPI_INT, countPerProc, displPerProc);
+      free(countPerProc);
+      free(displPerProc);
+
+      if(processID == 0)
+	{
+	  free(patrat);
+	  free(rateCategory);
+	}
+    }
+
+  /* all CLVs are gone, hence re-compute them */
+  evaluateGeneric(tr, tr->start, TRUE);
+
+  tr->kernelTime = 0.0;
+
+  free(times);
+  free(share);
+
+  return TRUE;
+}
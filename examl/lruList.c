@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <mpi.h>
+
+#include "axml.h"
+
+
+/*
+   Least recently used order of the entries 0 ... length - 1 of an array, as used by
+   the CLV cache (clvCache.c), the CLV budget (recom.c), and the CLV store (clvStore.c).
+
+   The list is intrusive: older[e] and newer[e] are the neighbors of entry e, -1 at the
+   ends of the list. Linking, unlinking, and touching an entry take constant time, the
+   owner walks from oldest to newest via the newer links to find an entry to replace.
+*/
+
+/* allocates the links of length entries, the list is empty afterwards */
+void initLruList(lruList *l, int length)
+{
+  assert(length > 0);
+
+  l->older = (int *)malloc(sizeof(int) * (size_t)length);
+  l->newer = (int *)malloc(sizeof(int) * (size_t)length);
+
+  emptyLruList(l);
+}
+
+void freeLruList(lruList *l)
+{
+  free(l->older);
+  free(l->newer);
+
+  l->older = (int *)NULL;
+  l->newer = (int *)NULL;
+  l->newest = -1;
+  l->oldest = -1;
+}
+
+void emptyLruList(lruList *l)
+{
+  l->newest = -1;
+  l->oldest = -1;
+}
+
+void unlinkLruEntry(lruList *l, int e)
+{
+  if(l->older[e] >= 0)
+    l->newer[l->older[e]] = l->newer[e];
+  else
+    l->oldest = l->newer[e];
+
+  if(l->newer[e] >= 0)
+    l->older[l->newer[e]] = l->older[e];
+  else
+    l->newest = l->older[e];
+}
+
+void linkLruEntryAsNewest(lruList *l, int e)
+{
+  l->older[e] = l->newest;
+  l->newer[e] = -1;
+
+  if(l->newest >= 0)
+    l->newer[l->newest] = e;
+  else
+    l->oldest = e;
+
+  l->newest = e;
+}
+
+/* the entry e, which must be in the list, has just been used */
+void touchLruEntry(lruList *l, int e)
+{
+  if(e != l->newest)
+    {
+      unlinkLruEntry(l, e);
+      linkLruEntryAsNewest(l, e);
+    }
+}
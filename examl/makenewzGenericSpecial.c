@@ -77,7 +77,7 @@ static double haddScalar(VECTOR_REGISTER v)
   _mm_storel_pd(&result, v);
 #endif
   
-#ifdef __AVX
+#if defined(__AVX) && !defined(__AVX512)
   double 
     ra[4] __attribute__ ((aligned (BYTE_ALIGNMENT)));
 
@@ -88,6 +88,10 @@ static double haddScalar(VECTOR_REGISTER v)
   result = ra[0] + ra[2];
 #endif
 
+#ifdef __AVX512
+  result = _mm512_reduce_add_pd(v);
+#endif
+
   return result;
 }
 
@@ -97,6 +101,7 @@ static double haddScalar(VECTOR_REGISTER v)
 
 
 extern int processID;
+extern MPI_Comm comm;
 extern const unsigned int mask32[32];
 
 /*******************/
@@ -155,7 +160,7 @@ static void getVects(tree *tr, unsigned char **tipX1, unsigned char **tipX2, dou
 		  *genericTipCase = TIP_INNER;
 		}
 	      
-	      *x2_start = tr->partitionData[model].xVector[pNumber - tr->mxtips - 1] + x_offset;
+	      *x2_start = tr->partitionData[model].xVector[CLV_INDEX(tr, pNumber)] + x_offset;
 	      
 	      if(tr->saveMemory)
 		{
@@ -180,7 +185,7 @@ static void getVects(tree *tr, unsigned char **tipX1, unsigned char **tipX2, dou
 		  *genericTipCase = TIP_INNER;
 		}
 		  
-	      *x2_start = tr->partitionData[model].xVector[qNumber - tr->mxtips - 1] + x_offset;
+	      *x2_start = tr->partitionData[model].xVector[CLV_INDEX(tr, qNumber)] + x_offset;
 	      
 	      if(tr->saveMemory)
 		{
@@ -205,7 +210,7 @@ static void getVects(tree *tr, unsigned char **tipX1, unsigned char **tipX2, dou
 	    }
 	  else
 	    {
-	      *genericTipCase = TIP_TIP_CLV;
+	      *genericTipCase = TIP_TIP;
 	      
 	      *tipCase = TIP_TIP;
 	      *tipX1 = tr->partitionData[model].yVector[pNumber] + offset;
@@ -218,8 +223,8 @@ static void getVects(tree *tr, unsigned char **tipX1, unsigned char **tipX2, dou
       *tipCase        = INNER_INNER;
       *genericTipCase = INNER_INNER;
 
-      *x1_start = tr->partitionData[model].xVector[pNumber - tr->mxtips - 1] + x_offset;
-      *x2_start = tr->partitionData[model].xVector[qNumber - tr->mxtips - 1] + x_offset;
+      *x1_start = tr->partitionData[model].xVector[CLV_INDEX(tr, pNumber)] + x_offset;
+      *x2_start = tr->partitionData[model].xVector[CLV_INDEX(tr, qNumber)] + x_offset;
       
       if(tr->saveMemory)
 	{
@@ -436,7 +441,8 @@ static void sumGAMMAPROT(int tipCase, double *sumtable, double *x1, double *x2,
 			 unsigned char *tipX1, unsigned char *tipX2, size_t n);
 
 static void sumGAMMA_NSTATE(double *sumtable, double *x1, double *x2, double *tipVector,
-			    unsigned char *tipX1, unsigned char *tipX2, size_t n, const size_t numberOfStates, const size_t gammaRates, const int genericTipCase);
+			    unsigned char *tipX1, unsigned char *tipX2, size_t n, const size_t numberOfStates, const size_t gammaRates, const int genericTipCase,
+			    double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap);
 
 
 
@@ -713,10 +719,8 @@ static void coreGAMMA_FLEX(const size_t upper, double *sumtable, volatile double
 
 void makenewzIterative(tree *tr)
 {
-  /* call newvieIterative to get the likelihood arrays to the left and right of the branch */
-
-  newviewIterative(tr, 1);
-
+  double
+    traceStart = traceBegin();
 
   /*
      loop over all partoitions to do the precomputation of the sumTable buffer
@@ -755,6 +759,11 @@ void makenewzIterative(tree *tr)
     *x1_gap = (unsigned int*)NULL,
     *x2_gap = (unsigned int*)NULL;			      
   
+  /* call newviewTraversal to get the likelihood arrays to the left and right of the branch, 
+     under OpenMP every thread computes the sites it owns and directly continues with the 
+     sumtable of these sites */
+
+  newviewTraversal(tr, 1);
 
   for(m = 0; m < maxModel; m++)
     { 
@@ -802,6 +811,9 @@ void makenewzIterative(tree *tr)
 	  size_t
 	    /* offset for current thread's data in global xVector (in doubles!) */
 	    x_offset = offset * (size_t)span;
+
+	  double
+	    kernelStart = startKernelTimer();
 	  
 	  getVects(tr, &tipX1, &tipX2, &x1_start, &x2_start, &tipCase, model, &x1_gapColumn, &x2_gapColumn, &x1_gap, &x2_gap, offset, &genericTipCase);
 
@@ -869,6 +881,9 @@ void makenewzIterative(tree *tr)
 #ifdef __MIC_NATIVE
              sumGAMMA_MIC(tipCase, sumBuffer, x1_start, x2_start, tr->partitionData[model].mic_tipVector, tipX1, tipX2,
 	                width);
+#elif defined(__AVX512)
+			  sumGAMMA_AVX512(tipCase, sumBuffer, x1_start, x2_start, tr->partitionData[model].tipVector, tipX1, tipX2,
+					  width);
 #else
 			  sumGAMMA(tipCase, sumBuffer, x1_start, x2_start, tr->partitionData[model].tipVector, tipX1, tipX2,
 			     width);
@@ -910,6 +925,9 @@ void makenewzIterative(tree *tr)
 #ifdef __MIC_NATIVE
 			sumGAMMAPROT_LG4_MIC(tipCase, sumBuffer, x1_start, x2_start, tr->partitionData[model].mic_tipVector, tipX1, tipX2,
 					     width);
+#elif defined(__AVX512)
+		      sumGAMMAPROT_AVX512_LG4(tipCase,  sumBuffer, x1_start, x2_start, tr->partitionData[model].tipVector_LG4,
+					      tipX1, tipX2, width);
 #else
 		      sumGAMMAPROT_LG4(tipCase,  sumBuffer, x1_start, x2_start, tr->partitionData[model].tipVector_LG4,
 				       tipX1, tipX2, width);
@@ -918,6 +936,9 @@ void makenewzIterative(tree *tr)
 #ifdef __MIC_NATIVE
             sumGAMMAPROT_MIC(tipCase, sumBuffer, x1_start, x2_start, tr->partitionData[model].mic_tipVector, tipX1, tipX2,
 		                  width);
+#elif defined(__AVX512)
+		      sumGAMMAPROT_AVX512(tipCase, sumBuffer, x1_start, x2_start, tr->partitionData[model].tipVector,
+					  tipX1, tipX2, width);
 #else
 		      
 		      sumGAMMAPROT(tipCase, sumBuffer, x1_start, x2_start, tr->partitionData[model].tipVector,
@@ -927,57 +948,68 @@ void makenewzIterative(tree *tr)
 		   
 		}
 	      break;	      
-	    case 16:
-	      //mth POMO 16
-	      assert(!tr->saveMemory);
-
-	      //mth do some precalculations for NR optimization and store them in an 
-	      //mth array that can later be re-used
-
+	    case 16: /* POMO16 */
 	      switch(tr->rateHetModel)
 		{
 		case GAMMA:
 		  sumGAMMA_NSTATE(sumBuffer, x1_start, x2_start, tr->partitionData[model].tipVector,
-				  tipX1, tipX2, width, 16, 4, genericTipCase);
+				  tipX1, tipX2, width, 16, 4, genericTipCase,
+				  x1_gapColumn, x2_gapColumn, x1_gap, x2_gap);
 		  break;
 		case PLAIN:
 		  sumGAMMA_NSTATE(sumBuffer, x1_start, x2_start, tr->partitionData[model].tipVector,
-				  tipX1, tipX2, width, 16, 1, genericTipCase);
+				  tipX1, tipX2, width, 16, 1, genericTipCase,
+				  x1_gapColumn, x2_gapColumn, x1_gap, x2_gap);
 		  break;
 		default:
 		  assert(0);
 		}
-
-	      break;	      
-	    case 64:
-	      //mth POMO 64
-
-	      assert(!tr->saveMemory);
-
-	      //mth do some precalculations for NR optimization and store them in an 
-	      //mth array that can later be re-used
+	      break;
+	    case 32: /* GENERIC_32 */
 	      switch(tr->rateHetModel)
 		{
 		case GAMMA:
 		  sumGAMMA_NSTATE(sumBuffer, x1_start, x2_start, tr->partitionData[model].tipVector,
-				  tipX1, tipX2, width, 64, 4, genericTipCase);	      
+				  tipX1, tipX2, width, 32, 4, genericTipCase,
+				  x1_gapColumn, x2_gapColumn, x1_gap, x2_gap);
 		  break;
 		case PLAIN:
 		  sumGAMMA_NSTATE(sumBuffer, x1_start, x2_start, tr->partitionData[model].tipVector,
-				  tipX1, tipX2, width, 64, 1, genericTipCase);	    
+				  tipX1, tipX2, width, 32, 1, genericTipCase,
+				  x1_gapColumn, x2_gapColumn, x1_gap, x2_gap);
+		  break;
+		default:
+		  assert(0);
+		}
+	      break;
+	    case 64: /* POMO64 and GENERIC_64 */
+	      switch(tr->rateHetModel)
+		{
+		case GAMMA:
+		  sumGAMMA_NSTATE(sumBuffer, x1_start, x2_start, tr->partitionData[model].tipVector,
+				  tipX1, tipX2, width, 64, 4, genericTipCase,
+				  x1_gapColumn, x2_gapColumn, x1_gap, x2_gap);
+		  break;
+		case PLAIN:
+		  sumGAMMA_NSTATE(sumBuffer, x1_start, x2_start, tr->partitionData[model].tipVector,
+				  tipX1, tipX2, width, 64, 1, genericTipCase,
+				  x1_gapColumn, x2_gapColumn, x1_gap, x2_gap);
 		  break;
 		default:
 		  assert(0);
 		}
-
 	      break;
 	    default:	     
 	      assert(0);
 	    }
 #endif
+
+	  stopKernelTimer(KERNEL_MAKENEWZ, tr->partitionData[model].dataType, tipCase, kernelStart);
 	}
     }  // for model
   }  // omp parallel region
+
+  traceEnd(TRACE_MAKENEWZ, traceStart, 0);
 }
 
 
@@ -988,6 +1020,9 @@ void makenewzIterative(tree *tr)
 
 void execCore(tree *tr, volatile double *_dlnLdlz, volatile double *_d2lnLdlz2)
 {
+  double
+    traceStart = traceBegin();
+
 #ifdef _USE_OMP
 #pragma omp parallel
 #endif
@@ -1118,6 +1153,9 @@ void execCore(tree *tr, volatile double *_dlnLdlz, volatile double *_d2lnLdlz2)
 	    dlnLdlz   = 0.0,
 	    d2lnLdlz2 = 0.0;
 
+	  double
+	    kernelStart = startKernelTimer();
+
   #ifndef _OPTIMIZED_FUNCTIONS
 
 	    /* compute first and second derivatives with the slow generic functions */
@@ -1169,6 +1207,9 @@ void execCore(tree *tr, volatile double *_dlnLdlz, volatile double *_d2lnLdlz2)
   #ifdef __MIC_NATIVE
 			    coreGTRGAMMA_MIC(width, sumBuffer,
 			     &dlnLdlz, &d2lnLdlz2, tr->partitionData[model].EIGN, tr->partitionData[model].gammaRates, lz, wgt);
+  #elif defined(__AVX512)
+			    coreGTRGAMMA_AVX512(width, sumBuffer,
+						&dlnLdlz, &d2lnLdlz2, tr->partitionData[model].EIGN, tr->partitionData[model].gammaRates, lz, wgt);
   #else
 			    coreGTRGAMMA(width, sumBuffer,
 					    &dlnLdlz, &d2lnLdlz2, tr->partitionData[model].EIGN, tr->partitionData[model].gammaRates, lz, wgt);
@@ -1196,6 +1237,10 @@ void execCore(tree *tr, volatile double *_dlnLdlz, volatile double *_d2lnLdlz2)
 		    coreGTRGAMMAPROT_LG4_MIC(width, sumBuffer,
 					     &dlnLdlz, &d2lnLdlz2, tr->partitionData[model].EIGN_LG4, tr->partitionData[model].gammaRates,
 					     lz, wgt, weights);
+#elif defined(__AVX512)
+		    coreGTRGAMMAPROT_AVX512_LG4(tr->partitionData[model].gammaRates, tr->partitionData[model].EIGN_LG4,
+						sumBuffer, width, wgt,
+						&dlnLdlz, &d2lnLdlz2, lz, weights);
 #else
 		  {
 		    //printf("model %d weights %f %f %f %f\n", model, weights[0], weights[1], weights[2], weights[3]);
@@ -1208,6 +1253,10 @@ void execCore(tree *tr, volatile double *_dlnLdlz, volatile double *_d2lnLdlz2)
 #ifdef __MIC_NATIVE
 		      coreGTRGAMMAPROT_MIC(width, sumBuffer,
 					   &dlnLdlz, &d2lnLdlz2, tr->partitionData[model].EIGN, tr->partitionData[model].gammaRates, lz, wgt);
+#elif defined(__AVX512)
+		  coreGTRGAMMAPROT_AVX512(tr->partitionData[model].gammaRates, tr->partitionData[model].EIGN,
+					  sumBuffer, width, wgt,
+					  &dlnLdlz, &d2lnLdlz2, lz);
 #else
 		  coreGTRGAMMAPROT(tr->partitionData[model].gammaRates, tr->partitionData[model].EIGN,
 				   sumBuffer, width, wgt,
@@ -1215,10 +1264,8 @@ void execCore(tree *tr, volatile double *_dlnLdlz, volatile double *_d2lnLdlz2)
 #endif
 		}
 		break;
-	      case 16:
-		//mth POMO 16 
-		assert(!tr->saveMemory);
-		
+	      case 16: /* POMO16 */
+		/* the sumtable holds all sites, also with the memory saving option */
 		switch(tr->rateHetModel)
 		  {
 		  case GAMMA:
@@ -1239,12 +1286,30 @@ void execCore(tree *tr, volatile double *_dlnLdlz, volatile double *_d2lnLdlz2)
 		  default:
 		    assert(0);
 		  }
-		
 		break;
-	      case 64:
-		//mth POMO 64 
-		assert(!tr->saveMemory);
+	      case 32: /* GENERIC_32 */
+		switch(tr->rateHetModel)
+		  {
+		  case GAMMA:
+		    coreGTRGAMMA_NSTATE(tr->partitionData[model].gammaRates, tr->partitionData[model].EIGN,
+					sumBuffer, width, wgt,
+					&dlnLdlz, &d2lnLdlz2, lz, 32, 4);
+		    break;
+		  case PLAIN:
+		    {
+		      double 
+			plain[1] = {1.0};
 
+		      coreGTRGAMMA_NSTATE(plain, tr->partitionData[model].EIGN,
+					  sumBuffer, width, wgt,
+					  &dlnLdlz, &d2lnLdlz2, lz, 32, 1);
+		    }
+		    break;
+		  default:
+		    assert(0);
+		  }
+		break;
+	      case 64: /* POMO64 and GENERIC_64 */
 		switch(tr->rateHetModel)
 		  {
 		  case GAMMA:
@@ -1265,7 +1330,6 @@ void execCore(tree *tr, volatile double *_dlnLdlz, volatile double *_d2lnLdlz2)
 		  default:
 		    assert(0);
 		  }
-		      
 		break;
 	      default:		
 		assert(0);
@@ -1276,6 +1340,8 @@ void execCore(tree *tr, volatile double *_dlnLdlz, volatile double *_d2lnLdlz2)
 
 	    *d1acc += dlnLdlz;
 	    *d2acc += d2lnLdlz2;
+
+	    stopKernelTimer(KERNEL_CORE, tr->partitionData[model].dataType, -1, kernelStart);
 	  }
 	 else
 	  {
@@ -1317,6 +1383,8 @@ void execCore(tree *tr, volatile double *_dlnLdlz, volatile double *_d2lnLdlz2)
       }
   }
 #endif
+
+  traceEnd(TRACE_EXEC_CORE, traceStart, 0);
 }
 
 
@@ -1424,13 +1492,20 @@ static void topLevelMakenewz(tree *tr, double *z0, int _maxiter, double *result)
 	 do the precomputations as well, otherwise just execute the computation
 	 of the derivatives */
 
-      if(firstIteration)
-	{
-	  makenewzIterative(tr);
-	  firstIteration = FALSE;
-	}
+      {
+	double 
+	  t = gettime(); 
+
+	if(firstIteration)
+	  {
+	    makenewzIterative(tr);
+	    firstIteration = FALSE;
+	  }
       
-      execCore(tr, dlnLdlz, d2lnLdlz2);
+	execCore(tr, dlnLdlz, d2lnLdlz2);
+
+	tr->kernelTime += gettime() - t; 
+      }
 
       {
 	double 
@@ -1439,16 +1514,20 @@ static void topLevelMakenewz(tree *tr, double *z0, int _maxiter, double *result)
   
 	memcpy(&send[0],                dlnLdlz,   sizeof(double) * (size_t)tr->numBranches);
 	memcpy(&send[tr->numBranches],  d2lnLdlz2, sizeof(double) * (size_t)tr->numBranches);
+
+	startPhaseTimer(TIMER_REDUCTION);
 	
 #ifdef _USE_ALLREDUCE	  
 	/* the MPI_Allreduce implementation is apparently sometimes not deterministic */
 
-	MPI_Allreduce(send, recv, tr->numBranches * 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);	    	    
+	MPI_Allreduce(send, recv, tr->numBranches * 2, MPI_DOUBLE, MPI_SUM, comm);	    	    
 #else
-	MPI_Reduce(send, recv, tr->numBranches * 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-	MPI_Bcast(recv,        tr->numBranches * 2, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	MPI_Reduce(send, recv, tr->numBranches * 2, MPI_DOUBLE, MPI_SUM, 0, comm);
+	MPI_Bcast(recv,        tr->numBranches * 2, MPI_DOUBLE, 0, comm);
 #endif   
 
+	stopPhaseTimer(TIMER_REDUCTION);
+
 	memcpy(dlnLdlz,   &recv[0],               sizeof(double) * (size_t)tr->numBranches);
 	memcpy(d2lnLdlz2, &recv[tr->numBranches], sizeof(double) * (size_t)tr->numBranches);
 
@@ -1585,6 +1664,8 @@ void makenewzGeneric(tree *tr, nodeptr p, nodeptr q, double *z0, int maxiter, do
      first in makenewzIterative */
 
   tr->td[0].count = 1;
+
+  startClvTraversal(p, q);
   
   if(!p->x)
     computeTraversalInfo(p, &(tr->td[0].ti[0]), &(tr->td[0].count), tr->mxtips, tr->numBranches, TRUE);
@@ -2283,136 +2364,97 @@ static void sumGAMMAPROT_LG4(int tipCase, double *sumtable, double *x1, double *
 /**** branch length optimization: pre-comnputation ******************/
 
 static void sumGAMMA_NSTATE(double *sumtable, double *x1, double *x2, double *tipVector,
-			    unsigned char *tipX1, unsigned char *tipX2, size_t n, const size_t numberOfStates, const size_t gammaRates, const int genericTipCase)
+			    unsigned char *tipX1, unsigned char *tipX2, size_t n, const size_t numberOfStates, const size_t gammaRates, const int genericTipCase,
+			    double *x1_gapColumn, double *x2_gapColumn, unsigned int *x1_gap, unsigned int *x2_gap)
 {
   size_t
     i, 
     l, 
-    k;
+    k,
+    x1Rate,
+    x2Rate;
   
   double 
     *left, 
     *right, 
-    *sum;
+    *sum,
+    *x1v,
+    *x2v,
+    *x1_ptr = x1,
+    *x2_ptr = x2;
 
   const size_t
     loopLength = numberOfStates - (numberOfStates % VECTOR_WIDTH), //or 18 for testing!
     stride = numberOfStates * gammaRates;
 
-  switch(genericTipCase)
-    {
-    case TIP_TIP_CLV:
-       for(i = 0; i < n; i++)
-	{
-	  for(l = 0; l < gammaRates; l++)
-	    {
-	      left  = &(x1[numberOfStates * i]);
-	      right = &(x2[numberOfStates * i]);
-	      sum   = &(sumtable[i * stride + l * numberOfStates]);
+  /* the tip vectors do not depend on the rate, with the memory saving option (x1_gap, x2_gap != NULL) the 
+     inner vectors only store the sites that are not entirely undetermined, see newviewGTRGAMMA_NSTATES() */
 
-	      for(k = 0; k < loopLength; k += VECTOR_WIDTH)
-		{
-		  VECTOR_REGISTER sumv = VECTOR_MUL(VECTOR_LOAD(&left[k]), VECTOR_LOAD(&right[k]));
-		  
-		  VECTOR_STORE(&sum[k], sumv);		 
-		}
-	      
-	      for(; k < numberOfStates; k++)
-		sum[k] = left[k] * right[k];
-	    }
-	}     
-      break;
-    case TIP_TIP:
-      for(i = 0; i < n; i++)
+  for(i = 0; i < n; i++)
+    {
+      switch(genericTipCase)
 	{
-	  left  = &(tipVector[numberOfStates * tipX1[i]]);
-	  right = &(tipVector[numberOfStates * tipX2[i]]);
-
-	  for(l = 0; l < gammaRates; l++)
+	case TIP_TIP:
+	case TIP_INNER:
+	  x1v = &(tipVector[numberOfStates * tipX1[i]]);
+	  x1Rate = 0;
+	  break;
+	case TIP_TIP_CLV:
+	case TIP_INNER_CLV:
+	  x1v = &(x1[numberOfStates * i]);
+	  x1Rate = 0;
+	  break;
+	case INNER_INNER:
+	  if(x1_gap && isGap(x1_gap, i))
+	    x1v = x1_gapColumn;
+	  else
 	    {
-	      sum = &sumtable[i * stride + l * numberOfStates];
-
-	      for(k = 0; k < loopLength; k += VECTOR_WIDTH)
-		{
-		  VECTOR_REGISTER 
-		    sumv = VECTOR_MUL(VECTOR_LOAD(&left[k]), VECTOR_LOAD(&right[k]));
-		  
-		  VECTOR_STORE(&sum[k], sumv);		 
-		}
-
-	      for(; k < numberOfStates; k++)	
-		sum[k] = left[k] * right[k];	       
+	      x1v = x1_ptr;
+	      x1_ptr += stride;
 	    }
+	  x1Rate = numberOfStates;
+	  break;
+	default:
+	  assert(0);
 	}
-      break;
-    case TIP_INNER:
-      for(i = 0; i < n; i++)
-	{
-	  left = &(tipVector[numberOfStates * tipX1[i]]);
-
-	  for(l = 0; l < gammaRates; l++)
-	    {
-	      right = &(x2[stride * i + l * numberOfStates]);
-	      sum  = &sumtable[stride * i + l * numberOfStates];
-
-	      for(k = 0; k < loopLength; k += VECTOR_WIDTH)
-		{
-		  VECTOR_REGISTER 
-		    sumv = VECTOR_MUL(VECTOR_LOAD(&left[k]), VECTOR_LOAD(&right[k]));
-		  
-		  VECTOR_STORE(&sum[k], sumv);		 
-		}
 
-	      for(; k < numberOfStates; k++)
-		sum[k] = left[k] * right[k];
-
-	    }
-	}
-      break;
-    case INNER_INNER:
-      for(i = 0; i < n; i++)
+      switch(genericTipCase)
 	{
-	  for(l = 0; l < gammaRates; l++)
+	case TIP_TIP:
+	  x2v = &(tipVector[numberOfStates * tipX2[i]]);
+	  x2Rate = 0;
+	  break;
+	case TIP_TIP_CLV:
+	  x2v = &(x2[numberOfStates * i]);
+	  x2Rate = 0;
+	  break;
+	default:
+	  if(x2_gap && isGap(x2_gap, i))
+	    x2v = x2_gapColumn;
+	  else
 	    {
-	      left  = &(x1[stride * i + l * numberOfStates]);
-	      right = &(x2[stride * i + l * numberOfStates]);
-	      sum   = &(sumtable[i * stride + l * numberOfStates]);
-
-	      for(k = 0; k < loopLength; k += VECTOR_WIDTH)
-		{
-		  VECTOR_REGISTER sumv = VECTOR_MUL(VECTOR_LOAD(&left[k]), VECTOR_LOAD(&right[k]));
-		  
-		  VECTOR_STORE(&sum[k], sumv);		 
-		}
-	      
-	      for(; k < numberOfStates; k++)
-		sum[k] = left[k] * right[k];
+	      x2v = x2_ptr;
+	      x2_ptr += stride;
 	    }
+	  x2Rate = numberOfStates;
 	}
-      break;
-    case TIP_INNER_CLV:      
-      for(i = 0; i < n; i++)
+
+      for(l = 0; l < gammaRates; l++)
 	{
-	  for(l = 0; l < gammaRates; l++)
-	    {
-	      left  = &(x1[numberOfStates * i]);
-	      right = &(x2[stride * i + l * numberOfStates]);
-	      sum   = &(sumtable[i * stride + l * numberOfStates]);
+	  left  = &(x1v[x1Rate * l]);
+	  right = &(x2v[x2Rate * l]);
+	  sum   = &(sumtable[i * stride + l * numberOfStates]);
 
-	      for(k = 0; k < loopLength; k += VECTOR_WIDTH)
-		{
-		  VECTOR_REGISTER sumv = VECTOR_MUL(VECTOR_LOAD(&left[k]), VECTOR_LOAD(&right[k]));
-		  
-		  VECTOR_STORE(&sum[k], sumv);		 
-		}
+	  for(k = 0; k < loopLength; k += VECTOR_WIDTH)
+	    {
+	      VECTOR_REGISTER sumv = VECTOR_MUL(VECTOR_LOAD(&left[k]), VECTOR_LOAD(&right[k]));
 	      
-	      for(; k < numberOfStates; k++)
-		sum[k] = left[k] * right[k];
+	      VECTOR_STORE(&sum[k], sumv);		 
 	    }
+	  
+	  for(; k < numberOfStates; k++)
+	    sum[k] = left[k] * right[k];
 	}
-      break;
-    default:
-      assert(0);
     }
 }
 
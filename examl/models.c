@@ -3270,6 +3270,36 @@ static double haddScalar(VECTOR_REGISTER v)
   return result;
 }
 
+/* transforms the tip likelihood vector prob of a site into eigen space */
+
+static void tipToEigenSpace(const double *prob, double *x, const double *EV_T, const size_t states)
+{
+  const size_t
+    loopLength = states - (states % VECTOR_WIDTH);
+
+  size_t       
+    l, 
+    m;
+	  
+  for(l = 0; l < states; l++)
+    {
+      VECTOR_REGISTER _x = VECTOR_SET_ZERO();
+
+      for(m = 0; m < loopLength; m += VECTOR_WIDTH)
+	_x = VECTOR_ADD(_x, VECTOR_MUL(VECTOR_LOAD(&prob[m]), VECTOR_LOAD(&EV_T[states * l + m])));
+	      
+      x[l] =  haddScalar(_x);
+
+      //for loop below not tested yet!
+      //what happens when the vector_width is > the number of states??? -> never tested so far ....
+      for(; m < states; m++)
+	x[l] += prob[m] * EV_T[states * l + m];
+
+      if(x[l] > MAX_TIP_EV)
+	x[l] = MAX_TIP_EV;
+    }
+}
+
 void updateTipXVectors(tree *tr, size_t model)
 {
   size_t    
@@ -3278,14 +3308,14 @@ void updateTipXVectors(tree *tr, size_t model)
 
   const size_t
     states = (size_t)(tr->partitionData[model].states),
-    loopLength = states - (states % VECTOR_WIDTH),
     width =  tr->partitionData[model].width;
 
   const double 
     *EV = tr->partitionData[model].EV;
 
   double
-    EV_T[states * states] __attribute__ ((aligned (BYTE_ALIGNMENT)));
+    EV_T[states * states] __attribute__ ((aligned (BYTE_ALIGNMENT))),
+    missing[states] __attribute__ ((aligned (BYTE_ALIGNMENT)));
 
   //calculate transpose of EV matrix 
 
@@ -3300,34 +3330,15 @@ void updateTipXVectors(tree *tr, size_t model)
 	*pv = tr->partitionData[model].xTipCLV[i];	  
       
       for(j = 0; j < width; j++)
-	{
-	  double
-	    *prob = &pv[j * states], 
-	    *x    = &xv[j * states];
-
-	  size_t       
-	    l, 
-	    m;
-	  
-	  for(l = 0; l < states; l++)
-	    {
-	      VECTOR_REGISTER _x = VECTOR_SET_ZERO();
+	tipToEigenSpace(&pv[j * states], &xv[j * states], EV_T, states);
+    }
 
-	      for(m = 0; m < loopLength; m += VECTOR_WIDTH)
-		_x = VECTOR_ADD(_x, VECTOR_MUL(VECTOR_LOAD(&prob[m]), VECTOR_LOAD(&EV_T[states * l + m])));
-	      
-	      x[l] =  haddScalar(_x);
+  //the tip vector holds the vector of an all-missing species, i.e., the gap column of the tips for the memory saving option
 
-	      //for loop below not tested yet!
-	      //what happens when the vector_width is > the number of states??? -> never tested so far ....
-	      for(; m < states; m++)
-		x[l] += prob[m] * EV_T[states * l + m];
+  for(j = 0; j < states; j++)
+    missing[j] = 1.0;
 
-	      if(x[l] > MAX_TIP_EV)
-		x[l] = MAX_TIP_EV;
-	    }	      	  
-	}
-    }
+  tipToEigenSpace(missing, tr->partitionData[model].tipVector, EV_T, states);
 }
 
 
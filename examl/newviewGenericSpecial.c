@@ -88,7 +88,7 @@ static const union __attribute__ ((aligned (BYTE_ALIGNMENT)))
 
 
 
-#ifdef __AVX
+#if defined(__AVX) && !defined(__AVX512)
 #include <xmmintrin.h>
 #include <pmmintrin.h>
 #include <immintrin.h>
@@ -112,6 +112,17 @@ static const union __attribute__ ((aligned (BYTE_ALIGNMENT)))
 
 #endif
 
+#ifdef __AVX512
+#include <immintrin.h>
+
+#define VECTOR_STORE_LEFT(x,y) _mm_storel_pd(x, _mm512_castpd512_pd128(y))
+
+/* the mask of the first n < VECTOR_WIDTH lanes, for the state tails */
+
+#define VECTOR_TAIL_MASK(n) ((__mmask8)((1 << (n)) - 1))
+
+#endif
+
 static double haddScalar(VECTOR_REGISTER v)
 {
   double 
@@ -124,7 +135,7 @@ static double haddScalar(VECTOR_REGISTER v)
   _mm_storel_pd(&result, v);
 #endif
   
-#ifdef __AVX 
+#if defined(__AVX) && !defined(__AVX512)
   double 
     ra[4] __attribute__ ((aligned (BYTE_ALIGNMENT)));
 
@@ -135,6 +146,10 @@ static double haddScalar(VECTOR_REGISTER v)
   result = ra[0] + ra[2];
 #endif
 
+#ifdef __AVX512
+  result = _mm512_reduce_add_pd(v);
+#endif
+
   return result;
 }
 
@@ -146,7 +161,9 @@ static VECTOR_REGISTER haddBroadCast(VECTOR_REGISTER v)
    
 #endif
 
-#ifdef __AVX
+#ifdef __AVX512
+  return _mm512_set1_pd(_mm512_reduce_add_pd(v));
+#elif defined(__AVX)
   __m256d
     a;
   
@@ -158,6 +175,51 @@ static VECTOR_REGISTER haddBroadCast(VECTOR_REGISTER v)
 #endif
 }
 
+#ifdef __AVX512
+
+/* the tail of a site that is not a multiple of VECTOR_WIDTH is checked and scaled with masked loads and stores */
+
+static boolean scaleEntry(const size_t stride, const size_t i, double *x3, const size_t scalingLoopLength)
+{
+  double 
+    *v = &(x3[stride * i]);
+  
+  VECTOR_REGISTER 
+    minlikelihood_vector = VECTOR_SET_ONE( minlikelihood ),
+    twoto = VECTOR_SET_ONE(twotothe256);
+
+  size_t
+    l;
+
+  __mmask8
+    below = 0xFF;
+
+  for(l = 0; below == 0xFF && l < stride; l += VECTOR_WIDTH)
+    {
+      __mmask8
+	lanes = (stride - l < VECTOR_WIDTH) ? VECTOR_TAIL_MASK(stride - l) : 0xFF;
+
+      /* the lanes beyond the tail are zero, hence below minlikelihood */
+
+      below &= _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_maskz_loadu_pd(lanes, &v[l])), minlikelihood_vector, _CMP_LT_OS);
+    }
+
+  if(below != 0xFF)
+    return FALSE;
+
+  for(l = 0; l < stride; l += VECTOR_WIDTH)
+    {
+      __mmask8
+	lanes = (stride - l < VECTOR_WIDTH) ? VECTOR_TAIL_MASK(stride - l) : 0xFF;
+
+      _mm512_mask_storeu_pd(&v[l], lanes, VECTOR_MUL(_mm512_maskz_loadu_pd(lanes, &v[l]), twoto));
+    }
+
+  return TRUE;
+}
+
+#else
+
 static boolean scaleEntry(const size_t stride, const size_t i, double *x3, const size_t scalingLoopLength)
 {
   double 
@@ -223,6 +285,8 @@ static boolean scaleEntry(const size_t stride, const size_t i, double *x3, const
     }
 }
 
+#endif
+
 
 
 /* includes MIC-optimized functions */
@@ -383,8 +447,8 @@ static void makeP_FlexLG4(double z1, double z2, double *rptr, double *EI[4],  do
 static void newviewCAT_FLEX(int tipCase, double *extEV,
 			    int *cptr,
 			    double *x1, double *x2, double *x3, double *tipVector,
-			    unsigned char *tipX1, unsigned char *tipX2,
-			    size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const int states)
+			    int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+			    size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling, const int states)
 {
   double
     *le, 
@@ -533,7 +597,10 @@ static void newviewCAT_FLEX(int tipCase, double *extEV,
 		 Note here, that, if we scaled the site we need to increment the scaling counter by the wieght, i.e., 
 		 the number of sites this potentially compressed pattern represents ! */ 
 
-	      addScale += wgt[i];	  
+	      if(useFastScaling)
+		addScale += wgt[i];
+	      else
+		ex3[i] += 1;
 	    }
 	}   
       break;
@@ -581,7 +648,10 @@ static void newviewCAT_FLEX(int tipCase, double *extEV,
 	       for(l = 0; l < states; l++)
 		 v[l] *= twotothe256;
 
-	       addScale += wgt[i];	   
+	       if(useFastScaling)
+		 addScale += wgt[i];
+	       else
+		 ex3[i] += 1;
 	     }
 	}
       break;
@@ -597,8 +667,8 @@ static void newviewCAT_FLEX(int tipCase, double *extEV,
 
 static void newviewGAMMA_FLEX(int tipCase,
 			      double *x1, double *x2, double *x3, double *extEV, double *tipVector,
-			      unsigned char *tipX1, unsigned char *tipX2,
-			      size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const int states, const int maxStateValue)
+			      int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+			      size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling, const int states, const int maxStateValue)
 {
   double  
     *uX1, 
@@ -780,7 +850,10 @@ static void newviewGAMMA_FLEX(int tipCase,
 		for(l = 0; l < span; l++)
 		  v[l] *= twotothe256;
 	
-		addScale += wgt[i];		    
+		if(useFastScaling)
+		  addScale += wgt[i];
+		else
+		  ex3[i] += 1;
 	      }
 	  }
 
@@ -835,7 +908,10 @@ static void newviewGAMMA_FLEX(int tipCase,
 	     for(l = 0; l < span; l++)
 	       v[l] *= twotothe256;
 	     
-	     addScale += wgt[i];	    	  
+	     if(useFastScaling)
+	       addScale += wgt[i];
+	     else
+	       ex3[i] += 1;
 	   }
        }
       break;
@@ -866,6 +942,13 @@ void computeTraversalInfo(nodeptr p, traversalInfo *ti, int *counter, int maxTip
   {
     int 
       i;
+
+    /* with the CLV cache the vector at p may already be up to date or be restored from the cache 
+       (see clvCache.c). We still need to descend into its subtree though, such that the vectors 
+       in there are oriented towards p again */
+
+    boolean
+      restored = restoreFromClvCache(p, partialTraversal);
     
     /* get the left and right descendants */
 
@@ -900,7 +983,12 @@ void computeTraversalInfo(nodeptr p, traversalInfo *ti, int *counter, int maxTip
 
 	/* increment length counter */
 
-	*counter = *counter + 1;
+	if(!restored)
+	  {
+	    updateClvKey(p);
+	    assignClvSlots(&ti[*counter], p, maxTips);
+	    *counter = *counter + 1;
+	  }
       }
     else
       {
@@ -943,14 +1031,22 @@ void computeTraversalInfo(nodeptr p, traversalInfo *ti, int *counter, int maxTip
 		ti[*counter].rz[i] = r->z[i];
 	      }
 
-	    *counter = *counter + 1;
+	    if(!restored)
+	      {
+		updateClvKey(p);
+		assignClvSlots(&ti[*counter], p, maxTips);
+		*counter = *counter + 1;
+	      }
 	  }
 	else
 	  {
 	    /* same as above, only now q and r are inner nodes. Hence if they are not 
 	       oriented correctly they will need to be recomputed and we need to descend into the 
 	       respective subtrees to check if everything is consistent in there, potentially expanding 
-	       the traversal descriptor */
+	       the traversal descriptor. With a CLV budget (see recom.c) the subtree that requires 
+	       more vectors is computed first */
+
+	    orderClvChildren(&q, &r, partialTraversal);
 	   
 	    if(! q->x || !partialTraversal)
 	      computeTraversalInfo(q, ti, counter, maxTips, numBranches, partialTraversal);
@@ -974,7 +1070,12 @@ void computeTraversalInfo(nodeptr p, traversalInfo *ti, int *counter, int maxTip
 		ti[*counter].rz[i] = r->z[i];
 	      }
 
-	    *counter = *counter + 1;
+	    if(!restored)
+	      {
+		updateClvKey(p);
+		assignClvSlots(&ti[*counter], p, maxTips);
+		*counter = *counter + 1;
+	      }
 	  }
       }
   }
@@ -986,9 +1087,11 @@ void computeTraversalInfo(nodeptr p, traversalInfo *ti, int *counter, int maxTip
 
 static void newviewGTRGAMMA_NSTATES(int tipCase,
 				    double *x1, double *x2, double *x3, double *extEV, double *tipVector,
-				    unsigned char *tipX1, unsigned char *tipX2,
-				    size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const size_t numberOfAllCharacters, const size_t numberOfStates, 
-				    const size_t gammaRates);
+				    int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+				    size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling, const size_t numberOfAllCharacters, const size_t numberOfStates, 
+				    const size_t gammaRates,
+				    unsigned int *x1_gap, unsigned int *x2_gap, unsigned int *x3_gap,
+				    double *x1_gapColumn, double *x2_gapColumn, double *x3_gapColumn);
 
 #endif
 
@@ -1009,35 +1112,35 @@ static void newviewGTRGAMMAPROT_LG4(int tipCase,
 static void newviewGTRGAMMA_GAPPED_SAVE(int tipCase,
 					double *x1_start, double *x2_start, double *x3_start,
 					double *EV, double *tipVector,
-					unsigned char *tipX1, unsigned char *tipX2,
-					const size_t n, double *left, double *right, int *wgt, int *scalerIncrement, 
+					int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+					const size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling, 
 					unsigned int *x1_gap, unsigned int *x2_gap, unsigned int *x3_gap, 
 					double *x1_gapColumn, double *x2_gapColumn, double *x3_gapColumn);
 
 static void newviewGTRGAMMA(int tipCase,
 			    double *x1_start, double *x2_start, double *x3_start,
 			    double *EV, double *tipVector,
-			    unsigned char *tipX1, unsigned char *tipX2,
-			    const size_t n, double *left, double *right, int *wgt, int *scalerIncrement
+			    int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+			    const size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling
 			    );
 
 static void newviewGTRCAT( int tipCase,  double *EV,  int *cptr,
 			   double *x1_start, double *x2_start,  double *x3_start, double *tipVector,
-			   unsigned char *tipX1, unsigned char *tipX2,
-			   size_t n,  double *left, double *right, int *wgt, int *scalerIncrement);
+			   int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+			   size_t n,  double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling);
 
 
 static void newviewGTRCAT_SAVE( int tipCase,  double *EV,  int *cptr,
 				double *x1_start, double *x2_start,  double *x3_start, double *tipVector,
-				unsigned char *tipX1, unsigned char *tipX2,
-				size_t n,  double *left, double *right, int *wgt, int *scalerIncrement,
+				int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+				size_t n,  double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling,
 				unsigned int *x1_gap, unsigned int *x2_gap, unsigned int *x3_gap,
 				double *x1_gapColumn, double *x2_gapColumn, double *x3_gapColumn, const int maxCats);
 
 static void newviewGTRGAMMAPROT_GAPPED_SAVE(int tipCase,
 					    double *x1, double *x2, double *x3, double *extEV, double *tipVector,
-					    unsigned char *tipX1, unsigned char *tipX2,
-					    size_t n, double *left, double *right, int *wgt, int *scalerIncrement, 
+					    int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+					    size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling, 
 					    unsigned int *x1_gap, unsigned int *x2_gap, unsigned int *x3_gap,  
 					    double *x1_gapColumn, double *x2_gapColumn, double *x3_gapColumn
 					    );
@@ -1046,19 +1149,19 @@ static void newviewGTRGAMMAPROT_GAPPED_SAVE(int tipCase,
 
 static void newviewGTRGAMMAPROT(int tipCase,
 				double *x1, double *x2, double *x3, double *extEV, double *tipVector,
-				unsigned char *tipX1, unsigned char *tipX2,
-				size_t n, double *left, double *right, int *wgt, int *scalerIncrement);
+				int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+				size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling);
 static void newviewGTRCATPROT(int tipCase, double *extEV,
 			      int *cptr,
 			      double *x1, double *x2, double *x3, double *tipVector,
-			      unsigned char *tipX1, unsigned char *tipX2,
-			      size_t n, double *left, double *right, int *wgt, int *scalerIncrement );
+			      int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+			      size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling );
 
 static void newviewGTRCATPROT_SAVE(int tipCase, double *extEV,
 				   int *cptr,
 				   double *x1, double *x2, double *x3, double *tipVector,
-				   unsigned char *tipX1, unsigned char *tipX2,
-				   size_t n, double *left, double *right, int *wgt, int *scalerIncrement,
+				   int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+				   size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling,
 				   unsigned int *x1_gap, unsigned int *x2_gap, unsigned int *x3_gap,
 				   double *x1_gapColumn, double *x2_gapColumn, double *x3_gapColumn, const int maxCats);
 
@@ -1090,722 +1193,935 @@ boolean noGap(unsigned int *x, size_t pos)
   return (boolean)(!(x[pos / 32] & mask32[pos % 32]));
 }
 
-/* now this is the function that just iterates over the length of the traversal descriptor and 
-   just computes the conditional likelihhod arrays in the order given by the descriptor.
-   So in a sense, this function has no clue that there is any tree-like structure 
-   in the traversal descriptor, it just operates on an array of structs of given length */ 
-
-
 extern const char inverseMeaningDNA[16]; 
 
-void newviewIterative (tree *tr, int startIndex)
+/* computes the left and right P matrices of partition model for the branch lengths stored in 
+   the traversal descriptor entry tInfo */
+
+static void computeTransitionMatrices(tree *tr, traversalInfo *tInfo, int model, double *left, double *right, double *umpLeft, double *umpRight)
 {
-  traversalInfo 
-    *ti   = tr->td[0].ti;
+  size_t
+    categories,
+    states = (size_t)tr->partitionData[model].states;
 
-  int 
-    i;
+  double
+    qz,
+    rz,
+    *rateCategories,
+    plain[1] = {1.0};
 
-    /* loop over traversal descriptor length. Note that on average we only re-compute the conditionals on 3 -4
-       nodes in RAxML */
+  /* figure out what kind of rate heterogeneity approach we are using */
+  switch(tr->rateHetModel)
+    {
+    case CAT:
+      rateCategories = tr->partitionData[model].perSiteRates;
+      categories = (size_t)tr->partitionData[model].numberOfCategories;
+      break;
+    case GAMMA:
+      rateCategories = tr->partitionData[model].gammaRates;
+      categories = 4;
+      break;
+    case PLAIN:
+      rateCategories = plain;
+      categories = 1;
+      break;
+    default:
+      assert(0);
+    }
 
-  for(i = startIndex; i < tr->td[0].count; i++)
+  /* if we use per-partition branch length optimization
+     get the branch length of partition model and take the log otherwise
+     use the joint branch length among all partitions that is always stored
+     at index [0] */
+  if(tr->numBranches > 1)
     {
-      traversalInfo 
-	*tInfo = &ti[i];
-      
-      {
-	int 
-	  model;
-      
-#ifdef _USE_OMP
-#pragma omp parallel for
-#endif
-	for(model = 0; model < tr->NumberOfModels; model++)
-	  {
-	    /* check if this partition has to be processed now - otherwise no need to compute P matrix */
-	    if(!tr->td[0].executeModel[model] || tr->partitionData[model].width == 0)
-	      continue;
-	    
-	    size_t
-	      categories,
-	      states = (size_t)tr->partitionData[model].states;
-	    
-	    double
-	      qz,
-	      rz,
-	      *rateCategories,
-	      *left = tr->partitionData[model].left,
-	      *right = tr->partitionData[model].right,
-	      plain[1] = {1.0};
-	    
-	    /* figure out what kind of rate heterogeneity approach we are using */
-	    switch(tr->rateHetModel)
-	      {
-	      case CAT:
-		rateCategories = tr->partitionData[model].perSiteRates;
-		categories = (size_t)tr->partitionData[model].numberOfCategories;
-		break;
-	      case GAMMA:
-		rateCategories = tr->partitionData[model].gammaRates;
-		categories = 4;
-		break;
-	      case PLAIN:
-		rateCategories = plain;
-		categories = 1;
-		break;
-	      default:
-		assert(0);
-	      }
-	    
-	    /* if we use per-partition branch length optimization
-	       get the branch length of partition model and take the log otherwise
-	       use the joint branch length among all partitions that is always stored
-	       at index [0] */
-	    if(tr->numBranches > 1)
-	      {
-		qz = tInfo->qz[model];
-		rz = tInfo->rz[model];
-	      }
-	    else
-	      {
-		qz = tInfo->qz[0];
-		rz = tInfo->rz[0];
-	      }
-	    
-	    qz = (qz > zmin) ? log(qz) : log(zmin);
-	    rz = (rz > zmin) ? log(rz) : log(zmin);
-	    
-	    /* compute the left and right P matrices */
+      qz = tInfo->qz[model];
+      rz = tInfo->rz[model];
+    }
+  else
+    {
+      qz = tInfo->qz[0];
+      rz = tInfo->rz[0];
+    }
+
+  qz = (qz > zmin) ? log(qz) : log(zmin);
+  rz = (rz > zmin) ? log(rz) : log(zmin);
+
+  /* compute the left and right P matrices */
 #ifdef __MIC_NATIVE
-	    switch (tr->partitionData[model].states)
-	      {
-	      case 2: /* BINARY data */
-		assert(0 && "Binary data model is not implemented on Intel MIC");
-		break;
-	      case 4: /* DNA data */
-		{
-		  makeP_DNA_MIC(qz, rz, rateCategories,   tr->partitionData[model].EI,
-				tr->partitionData[model].EIGN, categories,
-				left, right, tr->saveMemory, tr->maxCategories);
-		  
-		  precomputeTips_DNA_MIC(tInfo->tipCase, tr->partitionData[model].tipVector,
-					 left, right,
-					 tr->partitionData[model].mic_umpLeft, tr->partitionData[model].mic_umpRight,
-					 categories);
-		} 
-		break;
-	      case 20: /* AA data */
-		{
-		  if(tr->partitionData[model].protModels == LG4M || tr->partitionData[model].protModels == LG4X)
-		    {
-		      makeP_PROT_LG4_MIC(qz, rz, tr->partitionData[model].gammaRates,
-					 tr->partitionData[model].EI_LG4, tr->partitionData[model].EIGN_LG4,
-					 4, left, right);
-		      
-		      precomputeTips_PROT_LG4_MIC(tInfo->tipCase, tr->partitionData[model].tipVector_LG4,
-						  left, right,
-						  tr->partitionData[model].mic_umpLeft, tr->partitionData[model].mic_umpRight,
-						  categories);
-		    }
-		  else
-		    {
-		      makeP_PROT_MIC(qz, rz, rateCategories, tr->partitionData[model].EI,
-				     tr->partitionData[model].EIGN, categories,
-				     left, right, tr->saveMemory, tr->maxCategories);
-		      
-		      precomputeTips_PROT_MIC(tInfo->tipCase, tr->partitionData[model].tipVector,
-					      left, right,
-					      tr->partitionData[model].mic_umpLeft, tr->partitionData[model].mic_umpRight,
-					      categories);
-		    }
-		} 
-		break;
-	      default:
-		assert(0);
-	      }
-#else
-	    if(tr->partitionData[model].protModels == LG4M || tr->partitionData[model].protModels == LG4X)
-	      makeP_FlexLG4(qz, rz, tr->partitionData[model].gammaRates,
-			    tr->partitionData[model].EI_LG4,
-			    tr->partitionData[model].EIGN_LG4,
-			    4, left, right, 20);
-	    else
-	      makeP(qz, rz, rateCategories,   tr->partitionData[model].EI,
-		    tr->partitionData[model].EIGN, categories,
-		    left, right, tr->saveMemory, tr->maxCategories, states);
-#endif
-	  } // for model
+  switch (tr->partitionData[model].states)
+    {
+    case 2: /* BINARY data */
+      assert(0 && "Binary data model is not implemented on Intel MIC");
+      break;
+    case 4: /* DNA data */
+      {
+	makeP_DNA_MIC(qz, rz, rateCategories,   tr->partitionData[model].EI,
+		      tr->partitionData[model].EIGN, categories,
+		      left, right, tr->saveMemory, tr->maxCategories);
+
+	precomputeTips_DNA_MIC(tInfo->tipCase, tr->partitionData[model].tipVector,
+			       left, right,
+			       umpLeft, umpRight,
+			       categories);
       }
-
-      /* now loop over all partitions for nodes p, q, and r of the current traversal vector entry */
-#ifdef _USE_OMP
-#pragma omp parallel
-#endif
+      break;
+    case 20: /* AA data */
       {
-	int
-	  m,
-	  model,
-	  maxModel;
-	
-#ifdef _USE_OMP
-	maxModel = tr->maxModelsPerThread;
+	if(tr->partitionData[model].protModels == LG4M || tr->partitionData[model].protModels == LG4X)
+	  {
+	    makeP_PROT_LG4_MIC(qz, rz, tr->partitionData[model].gammaRates,
+			       tr->partitionData[model].EI_LG4, tr->partitionData[model].EIGN_LG4,
+			       4, left, right);
+
+	    precomputeTips_PROT_LG4_MIC(tInfo->tipCase, tr->partitionData[model].tipVector_LG4,
+					left, right,
+					umpLeft, umpRight,
+					categories);
+	  }
+	else
+	  {
+	    makeP_PROT_MIC(qz, rz, rateCategories, tr->partitionData[model].EI,
+			   tr->partitionData[model].EIGN, categories,
+			   left, right, tr->saveMemory, tr->maxCategories);
+
+	    precomputeTips_PROT_MIC(tInfo->tipCase, tr->partitionData[model].tipVector,
+				    left, right,
+				    umpLeft, umpRight,
+				    categories);
+	  }
+      }
+      break;
+    default:
+      assert(0);
+    }
 #else
-	maxModel = tr->NumberOfModels;
+  if(tr->partitionData[model].protModels == LG4M || tr->partitionData[model].protModels == LG4X)
+    makeP_FlexLG4(qz, rz, tr->partitionData[model].gammaRates,
+		  tr->partitionData[model].EI_LG4,
+		  tr->partitionData[model].EIGN_LG4,
+		  4, left, right, 20);
+  else
+    makeP(qz, rz, rateCategories,   tr->partitionData[model].EI,
+	  tr->partitionData[model].EIGN, categories,
+	  left, right, tr->saveMemory, tr->maxCategories, states);
 #endif
+}
 
-	for(m = 0; m < maxModel; m++)
-	  {
-	    size_t
-	      width  = 0,
-	      offset = 0;
-	    
-	    double
-	      *left     = (double*)NULL,
-	      *right    = (double*)NULL;
-	    
-	    unsigned int
-	      *globalScaler = (unsigned int*)NULL;
-
-#ifdef _USE_OMP
-	    int
-	      tid = omp_get_thread_num();
-
-	    /* check if this thread should process this partition */
-	    Assign* 
-	      pAss = tr->threadPartAssigns[tid * tr->maxModelsPerThread + m];
+/* computes the conditional likelihood vector at node tInfo->pNumber for the sites [offset, offset + width) 
+   of partition model. left and right must point to buffers for the P matrices that are not used 
+   concurrently by other threads */
 
-	    if(pAss)
-	      {
-		assert(tid == pAss->procId);
-		
-		model  = pAss->partitionId;
-		width  = pAss->width;
-		offset = pAss->offset;
+static void newviewEntry(tree *tr, traversalInfo *tInfo, int model, size_t offset, size_t width, 
+			 double *left, double *right, double *umpLeft, double *umpRight, unsigned int *globalScaler)
+{
+    double
+      *x1_start = (double*)NULL,
+      *x2_start = (double*)NULL,		 
+      *x3_start = (double*)NULL, //tr->partitionData[model].xVector[tInfo->pSlot],
+      *x1_gapColumn = (double*)NULL,
+      *x2_gapColumn = (double*)NULL,
+      *x3_gapColumn = (double*)NULL;
+
+    int
+      genericTipCase  = -1,
+      scalerIncrement = 0,
 		
-		left  = tr->partitionData[model].left;
-		right = tr->partitionData[model].right;
-		globalScaler = tr->partitionData[model].threadGlobalScaler[tid];
-	      }
-	    else
-	      break;
-#else
-	    model = m;	    
-
-	    /* number of sites in this partition */
-	    width  = (size_t)tr->partitionData[model].width;
-	    offset = 0;
+      /* integer wieght vector with pattern compression weights */
+      *wgt = tr->partitionData[model].wgt + offset,
 
-	    /* set the pointers to the left and right P matrices to the pre-allocated memory space for storing them */
-	    
-	    left  = tr->partitionData[model].left;
-	    right = tr->partitionData[model].right;
-	    globalScaler = tr->partitionData[model].globalScaler;
-#endif
+      /* integer rate category vector (for each pattern, _number_ of PSR category assigned to it, NOT actual rate!) */
+      *rateCategory = tr->partitionData[model].rateCategory + offset,
 
-	    /* this conditional statement is exactly identical to what we do in evaluateIterative */
-	    if(tr->td[0].executeModel[model] && width > 0)
-	      {	      
-		double
-		  *x1_start = (double*)NULL,
-		  *x2_start = (double*)NULL,		 
-		  *x3_start = (double*)NULL, //tr->partitionData[model].xVector[tInfo->pNumber - tr->mxtips - 1],
-		  *x1_gapColumn = (double*)NULL,
-		  *x2_gapColumn = (double*)NULL,
-		  *x3_gapColumn = (double*)NULL;
-
-		int
-		  genericTipCase  = -1,
-		  scalerIncrement = 0,
-		
-		  /* integer wieght vector with pattern compression weights */
-		  *wgt = tr->partitionData[model].wgt + offset,
+      /* per-site count of the scaling multiplications at p, only used for computing per-site log likelihoods */
+      *ex3 = (int*)NULL;
 
-		  /* integer rate category vector (for each pattern, _number_ of PSR category assigned to it, NOT actual rate!) */
-		  *rateCategory = tr->partitionData[model].rateCategory + offset;
+    boolean
+      useFastScaling = TRUE;
 
-		unsigned int
-		  *x1_gap = (unsigned int*)NULL,
-		  *x2_gap = (unsigned int*)NULL,
-		  *x3_gap = (unsigned int*)NULL;
+    unsigned int
+      *x1_gap = (unsigned int*)NULL,
+      *x2_gap = (unsigned int*)NULL,
+      *x3_gap = (unsigned int*)NULL;
 
-		unsigned char
-		  *tipX1 = (unsigned char *)NULL,
-		  *tipX2 = (unsigned char *)NULL;	
+    unsigned char
+      *tipX1 = (unsigned char *)NULL,
+      *tipX2 = (unsigned char *)NULL;	
 	      
-		size_t
-		  gapOffset = 0,
-		  rateHet = discreteRateCategories(tr->rateHetModel),
+    size_t
+      gapOffset = 0,
+      rateHet = discreteRateCategories(tr->rateHetModel),
 		  
-		  /* get the number of states in the data stored in partition model */
+      /* get the number of states in the data stored in partition model */
 		  
-		  states = (size_t)tr->partitionData[model].states,	
+      states = (size_t)tr->partitionData[model].states,	
 		  
-		  /* span for single alignment site (in doubles!) */
-		  span = rateHet * states,
-		  x_offset = offset * (size_t)span,
+      /* span for single alignment site (in doubles!) */
+      span = rateHet * states,
+      x_offset = offset * (size_t)span,
 		  
 		  
-		  /* get the length of the current likelihood array stored at node p. This is 
-		     important mainly for the SEV-based memory saving option described in here:
+      /* get the length of the current likelihood array stored at node p. This is 
+	 important mainly for the SEV-based memory saving option described in here:
 		     
-		     F. Izquierdo-Carrasco, S.A. Smith, A. Stamatakis: "Algorithms, Data Structures, and Numerics for Likelihood-based Phylogenetic Inference of Huge Trees".
+	 F. Izquierdo-Carrasco, S.A. Smith, A. Stamatakis: "Algorithms, Data Structures, and Numerics for Likelihood-based Phylogenetic Inference of Huge Trees".
 		     
-		     So tr->partitionData[model].xSpaceVector[i] provides the length of the allocated conditional array of partition model 
-		     and node i 
-		  */
+	 So tr->partitionData[model].xSpaceVector[i] provides the length of the allocated conditional array of partition model 
+	 and node i 
+      */
 		
-		  availableLength = tr->partitionData[model].xSpaceVector[(tInfo->pNumber - tr->mxtips - 1)],
-		  requiredLength = 0;	     
+      availableLength = tr->partitionData[model].xSpaceVector[tInfo->pSlot],
+      requiredLength = 0;	     
 
-		x3_start = tr->partitionData[model].xVector[tInfo->pNumber - tr->mxtips - 1] + x_offset;
+    /* compute the left and right P matrices */
+    computeTransitionMatrices(tr, tInfo, model, left, right, umpLeft, umpRight);
 
-		/* memory saving stuff, not important right now, but if you are interested ask Fernando */
-		if(tr->saveMemory)
-		  {
-		    size_t
-		      j,
-		      setBits = 0;		  
+    /* for the per-site log likelihoods (see computeSiteLikelihoods() in rell.c) the kernels count the 
+       scaling multiplications of every site in ex3 instead of summing up their weights */
+    if(tr->partitionData[model].siteScaler)
+      {
+	ex3 = tr->partitionData[model].siteScalerIncrement + offset;
+	memset(ex3, 0, width * sizeof(int));
+	useFastScaling = FALSE;
+      }
+
+    x3_start = tr->partitionData[model].xVector[tInfo->pSlot] + x_offset;
+
+    /* memory saving stuff, not important right now, but if you are interested ask Fernando */
+    if(tr->saveMemory)
+      {
+	size_t
+	  j,
+	  setBits = 0;		  
 		    
-		    gapOffset = states * (size_t)getUndetermined(tr->partitionData[model].dataType);
+	/* the tip vector of POMO only holds the vector of an all-missing species, see updateTipXVectors() */
+	if(isPomo(tr->partitionData[model].dataType))
+	  gapOffset = 0;
+	else
+	  gapOffset = states * (size_t)getUndetermined(tr->partitionData[model].dataType);
 		    
-		    x1_gap = &(tr->partitionData[model].gapVector[tInfo->qNumber * tr->partitionData[model].gapVectorLength]);
-		    x2_gap = &(tr->partitionData[model].gapVector[tInfo->rNumber * tr->partitionData[model].gapVectorLength]);
-		    x3_gap = &(tr->partitionData[model].gapVector[tInfo->pNumber * tr->partitionData[model].gapVectorLength]);		      		  
+	x1_gap = &(tr->partitionData[model].gapVector[tInfo->qNumber * tr->partitionData[model].gapVectorLength]);
+	x2_gap = &(tr->partitionData[model].gapVector[tInfo->rNumber * tr->partitionData[model].gapVectorLength]);
+	x3_gap = &(tr->partitionData[model].gapVector[tInfo->pNumber * tr->partitionData[model].gapVectorLength]);		      		  
 		    
-		    for(j = 0; j < (size_t)tr->partitionData[model].gapVectorLength; j++)
-		      {		     
-			x3_gap[j] = x1_gap[j] & x2_gap[j];
-			setBits += (size_t)__builtin_popcount(x3_gap[j]);		      
-		      }
+	for(j = 0; j < (size_t)tr->partitionData[model].gapVectorLength; j++)
+	  {		     
+	    x3_gap[j] = x1_gap[j] & x2_gap[j];
+	    setBits += (size_t)__builtin_popcount(x3_gap[j]);		      
+	  }
 		    
-		    requiredLength = (width - setBits)  * rateHet * states * sizeof(double);		
-		  }
-		else
-		  /* if we are not trying to save memory the space required to store an inner likelihood array 
-		     is the number of sites in the partition times the number of states of the data type in the partition 
-		     times the number of discrete GAMMA rates (1 for CAT essentially) times 8 bytes */
-		  requiredLength  =  width * rateHet * states * sizeof(double);
+	requiredLength = (width - setBits)  * rateHet * states * sizeof(double);		
+      }
+    else
+      /* if we are not trying to save memory the space required to store an inner likelihood array 
+	 is the number of sites in the partition times the number of states of the data type in the partition 
+	 times the number of discrete GAMMA rates (1 for CAT essentially) times 8 bytes */
+      requiredLength  =  width * rateHet * states * sizeof(double);
 		
-		/* Initially, even when not using memory saving no space is allocated for inner likelihood arrats hence 
-		   availableLength will be zero at the very first time we traverse the tree.
-		   Hence we need to allocate something here */
+    /* Initially, even when not using memory saving no space is allocated for inner likelihood arrats hence 
+       availableLength will be zero at the very first time we traverse the tree.
+       Hence we need to allocate something here */
 #ifndef _USE_OMP
-		if(requiredLength != availableLength)
-		  {
-		    /* if there is a vector of incorrect length assigned here i.e., x3 != NULL we must free
-		       it first */
-		    if(x3_start)
-		      free(x3_start);
+    if(requiredLength != availableLength)
+      {
+	/* if there is a vector of incorrect length assigned here i.e., x3 != NULL we must free
+	   it first */
+	if(x3_start)
+	  clvFree(x3_start, availableLength);
 		    
-		    /* allocate memory: note that here we use a byte-boundary aligned malloc, because we need the vectors
-		       to be aligned at 16 BYTE (SSE3) or 32 BYTE (AVX) boundaries! */
+	/* allocate memory: note that here we use a byte-boundary aligned malloc, because we need the vectors
+	   to be aligned at 16 BYTE (SSE3) or 32 BYTE (AVX) boundaries! */
 		    
-		    x3_start = (double*)malloc_aligned(requiredLength);
+	x3_start = (double*)clvAlloc(requiredLength);
 		    
-		    /* update the data structures for consistent bookkeeping */
-		    tr->partitionData[model].xVector[tInfo->pNumber - tr->mxtips - 1] = x3_start;
-		    tr->partitionData[model].xSpaceVector[(tInfo->pNumber - tr->mxtips - 1)] = requiredLength;
-		  }
+	/* update the data structures for consistent bookkeeping */
+	tr->partitionData[model].xVector[tInfo->pSlot] = x3_start;
+	tr->partitionData[model].xSpaceVector[tInfo->pSlot] = requiredLength;
+      }
 #endif
 
-		/* now just set the pointers for data accesses in the newview() implementations above to the corresponding values 
-		   according to the tip case */
+    /* now just set the pointers for data accesses in the newview() implementations above to the corresponding values 
+       according to the tip case */
 		
-		switch(tInfo->tipCase)
-		  {
-		  case TIP_TIP:		  
-		    if(isPomo(tr->partitionData[model].dataType))
-		      {
-			//mth add appropriate offset for MIC version, note that, we just count the number of double entries irrespctive of the number of rate cats!
-			assert(offset == 0 && x_offset == 0);
-			x1_start = tr->partitionData[model].xTipVector[tInfo->qNumber];						
-			x2_start = tr->partitionData[model].xTipVector[tInfo->rNumber];
+    switch(tInfo->tipCase)
+      {
+      case TIP_TIP:		  
+	if(isPomo(tr->partitionData[model].dataType))
+	  {
+	    //mth add appropriate offset for MIC version, note that, we just count the number of double entries irrespctive of the number of rate cats!
+	    assert(offset == 0 && x_offset == 0);
+	    x1_start = tr->partitionData[model].xTipVector[tInfo->qNumber];						
+	    x2_start = tr->partitionData[model].xTipVector[tInfo->rNumber];
 
-			genericTipCase = TIP_TIP_CLV;
-		      }
-		    else
-		      {
-			tipX1    = tr->partitionData[model].yVector[tInfo->qNumber] + offset;
-			tipX2    = tr->partitionData[model].yVector[tInfo->rNumber] + offset;
+	    genericTipCase = TIP_TIP_CLV;
+	  }
+	else
+	  {
+	    tipX1    = tr->partitionData[model].yVector[tInfo->qNumber] + offset;
+	    tipX2    = tr->partitionData[model].yVector[tInfo->rNumber] + offset;
 
-			genericTipCase = TIP_TIP;
-		      }
+	    genericTipCase = TIP_TIP;
+	  }
 		    
-		    if(tr->saveMemory)
-		      {
-			assert(tInfo->pNumber - tr->mxtips - 1 >= 0);
+	if(tr->saveMemory)
+	  {
+	    assert(tInfo->pNumber - tr->mxtips - 1 >= 0);
 
-			x1_gapColumn   = &(tr->partitionData[model].tipVector[gapOffset]);
-			x2_gapColumn   = &(tr->partitionData[model].tipVector[gapOffset]);		    
-			x3_gapColumn   = &tr->partitionData[model].gapColumn[((size_t)tInfo->pNumber - (size_t)tr->mxtips - 1) * states * rateHet];		    
-		      }
+	    x1_gapColumn   = &(tr->partitionData[model].tipVector[gapOffset]);
+	    x2_gapColumn   = &(tr->partitionData[model].tipVector[gapOffset]);		    
+	    x3_gapColumn   = &tr->partitionData[model].gapColumn[((size_t)tInfo->pNumber - (size_t)tr->mxtips - 1) * states * rateHet];		    
+	  }
 		    
-		    break;
-		  case TIP_INNER:
-		    if(isPomo(tr->partitionData[model].dataType))
-		      {	
-			//mth add appropriate offset for MIC version, note that, we just count the number of double entries irrespctive of the number of rate cats!
-			assert(offset == 0 && x_offset == 0);
-			x1_start = tr->partitionData[model].xTipVector[tInfo->qNumber];
+	break;
+      case TIP_INNER:
+	if(isPomo(tr->partitionData[model].dataType))
+	  {	
+	    //mth add appropriate offset for MIC version, note that, we just count the number of double entries irrespctive of the number of rate cats!
+	    assert(offset == 0 && x_offset == 0);
+	    x1_start = tr->partitionData[model].xTipVector[tInfo->qNumber];
 			
-			genericTipCase = TIP_INNER_CLV;
-		      }
-		    else
-		      {
-			tipX1    =  tr->partitionData[model].yVector[tInfo->qNumber] + offset;
+	    genericTipCase = TIP_INNER_CLV;
+	  }
+	else
+	  {
+	    tipX1    =  tr->partitionData[model].yVector[tInfo->qNumber] + offset;
 			
-			genericTipCase = TIP_INNER;
-		      }
+	    genericTipCase = TIP_INNER;
+	  }
 		    
-		    x2_start = tr->partitionData[model].xVector[tInfo->rNumber - tr->mxtips - 1] + x_offset;
+	x2_start = tr->partitionData[model].xVector[tInfo->rSlot] + x_offset;
 		    
-		    if(tr->saveMemory)
-		      {	
-			assert(tInfo->rNumber - tr->mxtips - 1 >= 0 &&
-			       tInfo->pNumber - tr->mxtips - 1 >= 0);
+	if(tr->saveMemory)
+	  {	
+	    assert(tInfo->rNumber - tr->mxtips - 1 >= 0 &&
+		   tInfo->pNumber - tr->mxtips - 1 >= 0);
 			       
 
-			x1_gapColumn   = &(tr->partitionData[model].tipVector[gapOffset]);	     
-			x2_gapColumn   = &tr->partitionData[model].gapColumn[((size_t)tInfo->rNumber - (size_t)tr->mxtips - 1) * states * rateHet];
-			x3_gapColumn   = &tr->partitionData[model].gapColumn[((size_t)tInfo->pNumber - (size_t)tr->mxtips - 1) * states * rateHet];
-		      }
+	    x1_gapColumn   = &(tr->partitionData[model].tipVector[gapOffset]);	     
+	    x2_gapColumn   = &tr->partitionData[model].gapColumn[((size_t)tInfo->rNumber - (size_t)tr->mxtips - 1) * states * rateHet];
+	    x3_gapColumn   = &tr->partitionData[model].gapColumn[((size_t)tInfo->pNumber - (size_t)tr->mxtips - 1) * states * rateHet];
+	  }
 		    
-		    break;
-		  case INNER_INNER:	 
-		    if(isPomo(tr->partitionData[model].dataType))	 		 
-		      genericTipCase = INNER_INNER;
+	break;
+      case INNER_INNER:	 
+	genericTipCase = INNER_INNER;
 		    
-		    x1_start       = tr->partitionData[model].xVector[tInfo->qNumber - tr->mxtips - 1] + x_offset;
-		    x2_start       = tr->partitionData[model].xVector[tInfo->rNumber - tr->mxtips - 1] + x_offset;
+	x1_start       = tr->partitionData[model].xVector[tInfo->qSlot] + x_offset;
+	x2_start       = tr->partitionData[model].xVector[tInfo->rSlot] + x_offset;
 		    
-		    assert(tInfo->rNumber - tr->mxtips - 1 >= 0 &&
-			   tInfo->pNumber - tr->mxtips - 1 >= 0 && 
-			   tInfo->qNumber - tr->mxtips - 1 >= 0);
+	assert(tInfo->rNumber - tr->mxtips - 1 >= 0 &&
+	       tInfo->pNumber - tr->mxtips - 1 >= 0 && 
+	       tInfo->qNumber - tr->mxtips - 1 >= 0);
 
-		    if(tr->saveMemory)
-		      {
-			x1_gapColumn   = &tr->partitionData[model].gapColumn[((size_t)tInfo->qNumber - (size_t)tr->mxtips - 1) * states * rateHet];
-			x2_gapColumn   = &tr->partitionData[model].gapColumn[((size_t)tInfo->rNumber - (size_t)tr->mxtips - 1) * states * rateHet];
-			x3_gapColumn   = &tr->partitionData[model].gapColumn[((size_t)tInfo->pNumber - (size_t)tr->mxtips - 1) * states * rateHet];
-		      }
+	if(tr->saveMemory)
+	  {
+	    x1_gapColumn   = &tr->partitionData[model].gapColumn[((size_t)tInfo->qNumber - (size_t)tr->mxtips - 1) * states * rateHet];
+	    x2_gapColumn   = &tr->partitionData[model].gapColumn[((size_t)tInfo->rNumber - (size_t)tr->mxtips - 1) * states * rateHet];
+	    x3_gapColumn   = &tr->partitionData[model].gapColumn[((size_t)tInfo->pNumber - (size_t)tr->mxtips - 1) * states * rateHet];
+	  }
 		    
-		    break;
-		  default:
-		    assert(0);
-		  }
+	break;
+      default:
+	assert(0);
+      }
 		
 #ifndef _OPTIMIZED_FUNCTIONS
 
-	      /* memory saving not implemented */
+  /* memory saving not implemented */
 
-	      assert(!tr->saveMemory);
+  assert(!tr->saveMemory);
 
-	      assert(tr->rateHetModel != PLAIN);
+  assert(tr->rateHetModel != PLAIN);
 
-	      /* figure out if we need to compute the CAT or GAMMA model of rate heterogeneity */
+  /* figure out if we need to compute the CAT or GAMMA model of rate heterogeneity */
 
-	      if(tr->rateHetModel == CAT)
-		newviewCAT_FLEX(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
-				x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
-				tipX1, tipX2,
-				width, left, right, wgt, &scalerIncrement, states);
-	      else
-		newviewGAMMA_FLEX(tInfo->tipCase,
-				  x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
-				  tipX1, tipX2,
-				  width, left, right, wgt, &scalerIncrement, states, getUndetermined(tr->partitionData[model].dataType) + 1);
+  if(tr->rateHetModel == CAT)
+    newviewCAT_FLEX(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
+		    x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
+		    ex3, tipX1, tipX2,
+		    width, left, right, wgt, &scalerIncrement, useFastScaling, states);
+  else
+    newviewGAMMA_FLEX(tInfo->tipCase,
+		      x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+		      ex3, tipX1, tipX2,
+		      width, left, right, wgt, &scalerIncrement, useFastScaling, states, getUndetermined(tr->partitionData[model].dataType) + 1);
 
 #else
-	      /* dedicated highly optimized functions. Analogously to the functions in evaluateGeneric() 
-		 we also siwtch over the state number */
+  /* dedicated highly optimized functions. Analogously to the functions in evaluateGeneric() 
+     we also siwtch over the state number */
 
-	      switch(states)
-		{		
-		case 2:
+  switch(states)
+    {		
+    case 2:
 #ifdef __MIC_NATIVE
- 	      assert(0 && "Binary data model is not implemented on Intel MIC");
+  assert(0 && "Binary data model is not implemented on Intel MIC");
 #else
-		  assert(!tr->saveMemory);
+      assert(!tr->saveMemory);
 
-		  assert(tr->rateHetModel != PLAIN);
+      assert(tr->rateHetModel != PLAIN);
 		  
-		  if(tr->rateHetModel == CAT)
-		    newviewGTRCAT_BINARY(tInfo->tipCase,  tr->partitionData[model].EV,  rateCategory,
-					 x1_start,  x2_start,  x3_start, tr->partitionData[model].tipVector,
-					 (int*)NULL, tipX1, tipX2,
-					 width, left, right, wgt, &scalerIncrement, TRUE);
-		  else
-		    newviewGTRGAMMA_BINARY(tInfo->tipCase,
-					   x1_start, x2_start, x3_start,
-					   tr->partitionData[model].EV, tr->partitionData[model].tipVector,
-					   (int *)NULL, tipX1, tipX2,
-					   width, left, right, wgt, &scalerIncrement, TRUE);		 
+      if(tr->rateHetModel == CAT)
+	newviewGTRCAT_BINARY(tInfo->tipCase,  tr->partitionData[model].EV,  rateCategory,
+			     x1_start,  x2_start,  x3_start, tr->partitionData[model].tipVector,
+			     ex3, tipX1, tipX2,
+			     width, left, right, wgt, &scalerIncrement, useFastScaling);
+      else
+	newviewGTRGAMMA_BINARY(tInfo->tipCase,
+			       x1_start, x2_start, x3_start,
+			       tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+			       ex3, tipX1, tipX2,
+			       width, left, right, wgt, &scalerIncrement, useFastScaling);		 
 #endif
-		  break;
-		case 4:	/* DNA */
-		  assert(tr->rateHetModel != PLAIN);
+      break;
+    case 4:	/* DNA */
+      assert(tr->rateHetModel != PLAIN);
 
-		  if(tr->rateHetModel == CAT)
-		    {		    		     
-		      if(tr->saveMemory)
+      if(tr->rateHetModel == CAT)
+	{		    		     
+	  if(tr->saveMemory)
 #ifdef __MIC_NATIVE
-		     assert(0 && "Neither CAT model of rate heterogeneity nor memory saving are implemented on Intel MIC");
+	 assert(0 && "Neither CAT model of rate heterogeneity nor memory saving are implemented on Intel MIC");
 #elif __AVX
-			newviewGTRCAT_AVX_GAPPED_SAVE(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
-						      x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
-						      (int*)NULL, tipX1, tipX2,
-						      width, left, right, wgt, &scalerIncrement, TRUE, x1_gap, x2_gap, x3_gap,
-						      x1_gapColumn, x2_gapColumn, x3_gapColumn, tr->maxCategories);
+	    newviewGTRCAT_AVX_GAPPED_SAVE(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
+					  x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
+					  ex3, tipX1, tipX2,
+					  width, left, right, wgt, &scalerIncrement, useFastScaling, x1_gap, x2_gap, x3_gap,
+					  x1_gapColumn, x2_gapColumn, x3_gapColumn, tr->maxCategories);
 #else
-			newviewGTRCAT_SAVE(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
-					   x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
-					   tipX1, tipX2,
-					   width, left, right, wgt, &scalerIncrement, x1_gap, x2_gap, x3_gap,
-					   x1_gapColumn, x2_gapColumn, x3_gapColumn, tr->maxCategories);
+	    newviewGTRCAT_SAVE(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
+			       x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
+			       ex3, tipX1, tipX2,
+			       width, left, right, wgt, &scalerIncrement, useFastScaling, x1_gap, x2_gap, x3_gap,
+			       x1_gapColumn, x2_gapColumn, x3_gapColumn, tr->maxCategories);
 #endif
-		      else
+	  else
 #ifdef __MIC_NATIVE
-		     assert(0 && "CAT model of rate heterogeneity is not implemented on Intel MIC");
+	 assert(0 && "CAT model of rate heterogeneity is not implemented on Intel MIC");
 #elif __AVX
-			newviewGTRCAT_AVX(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
-					  x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
-					  tipX1, tipX2,
-					  width, left, right, wgt, &scalerIncrement);
+	    newviewGTRCAT_AVX(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
+			      x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
+			      ex3, tipX1, tipX2,
+			      width, left, right, wgt, &scalerIncrement, useFastScaling);
 #else
-			newviewGTRCAT(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
-				      x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
-				      tipX1, tipX2,
-				      width, left, right, wgt, &scalerIncrement);
+	    newviewGTRCAT(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
+			  x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
+			  ex3, tipX1, tipX2,
+			  width, left, right, wgt, &scalerIncrement, useFastScaling);
 #endif
-		    }
-		  else
-		    {
+	}
+      else
+	{
 		      
 		       
-		       if(tr->saveMemory)
+	   if(tr->saveMemory)
 #ifdef __MIC_NATIVE
-		     assert(0 && "Memory saving is not implemented on Intel MIC");
+	 assert(0 && "Memory saving is not implemented on Intel MIC");
 #elif __AVX
-			 newviewGTRGAMMA_AVX_GAPPED_SAVE(tInfo->tipCase,
-							 x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector, (int*)NULL,
-							 tipX1, tipX2,
-							 width, left, right, wgt, &scalerIncrement, TRUE,
-							 x1_gap, x2_gap, x3_gap, 
-							 x1_gapColumn, x2_gapColumn, x3_gapColumn);
+	     newviewGTRGAMMA_AVX_GAPPED_SAVE(tInfo->tipCase,
+					     x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector, ex3,
+					     tipX1, tipX2,
+					     width, left, right, wgt, &scalerIncrement, useFastScaling,
+					     x1_gap, x2_gap, x3_gap, 
+					     x1_gapColumn, x2_gapColumn, x3_gapColumn);
 #else
-		       newviewGTRGAMMA_GAPPED_SAVE(tInfo->tipCase,
-						   x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
-						   tipX1, tipX2,
-						   width, left, right, wgt, &scalerIncrement, 
-						   x1_gap, x2_gap, x3_gap, 
-						   x1_gapColumn, x2_gapColumn, x3_gapColumn);
+	   newviewGTRGAMMA_GAPPED_SAVE(tInfo->tipCase,
+				       x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+				       ex3, tipX1, tipX2,
+				       width, left, right, wgt, &scalerIncrement, useFastScaling, 
+				       x1_gap, x2_gap, x3_gap, 
+				       x1_gapColumn, x2_gapColumn, x3_gapColumn);
 #endif
-		       else
+	   else
 #ifdef __MIC_NATIVE
-			 newviewGTRGAMMA_MIC(tInfo->tipCase,
-				  x1_start, x2_start, x3_start, tr->partitionData[model].mic_EV, tr->partitionData[model].tipVector,
-				  tipX1, tipX2,
-				  width, left, right, wgt, &scalerIncrement,
-				  tr->partitionData[model].mic_umpLeft, tr->partitionData[model].mic_umpRight);
+	     newviewGTRGAMMA_MIC(tInfo->tipCase,
+		      x1_start, x2_start, x3_start, tr->partitionData[model].mic_EV, tr->partitionData[model].tipVector,
+		      tipX1, tipX2,
+		      width, left, right, wgt, &scalerIncrement,
+		      umpLeft, umpRight);
+#elif defined(__AVX512)
+	     newviewGTRGAMMA_AVX512(tInfo->tipCase,
+				    x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+				    ex3, tipX1, tipX2,
+				    width, left, right, wgt, &scalerIncrement, useFastScaling);
 #elif __AVX
-			 newviewGTRGAMMA_AVX(tInfo->tipCase,
-					     x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
-					     tipX1, tipX2,
-					     width, left, right, wgt, &scalerIncrement);
+	     newviewGTRGAMMA_AVX(tInfo->tipCase,
+				 x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+				 ex3, tipX1, tipX2,
+				 width, left, right, wgt, &scalerIncrement, useFastScaling);
 #else
-		       newviewGTRGAMMA(tInfo->tipCase,
-					 x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
-					 tipX1, tipX2,
-					 width, left, right, wgt, &scalerIncrement);
+	   newviewGTRGAMMA(tInfo->tipCase,
+			     x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+			     ex3, tipX1, tipX2,
+			     width, left, right, wgt, &scalerIncrement, useFastScaling);
 #endif
-		    }
+	}
 		
-		  break;		    
-		case 20: /* proteins */
-		  assert(tr->rateHetModel != PLAIN);
-		  if(tr->rateHetModel == CAT)
-		    {		     
-		      if(tr->saveMemory)
-			{
+      break;		    
+    case 20: /* proteins */
+      assert(tr->rateHetModel != PLAIN);
+      if(tr->rateHetModel == CAT)
+	{		     
+	  if(tr->saveMemory)
+	    {
 #ifdef __MIC_NATIVE
-		     assert(0 && "Neither CAT model of rate heterogeneity nor memory saving are implemented on Intel MIC");
+	 assert(0 && "Neither CAT model of rate heterogeneity nor memory saving are implemented on Intel MIC");
 #elif __AVX
-			  newviewGTRCATPROT_AVX_GAPPED_SAVE(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
-							    x1_start, x2_start, x3_start, tr->partitionData[model].tipVector, (int*)NULL,
-							    tipX1, tipX2, width, left, right, wgt, &scalerIncrement, TRUE, x1_gap, x2_gap, x3_gap,
-							    x1_gapColumn, x2_gapColumn, x3_gapColumn, tr->maxCategories);
+	      newviewGTRCATPROT_AVX_GAPPED_SAVE(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
+						x1_start, x2_start, x3_start, tr->partitionData[model].tipVector, ex3,
+						tipX1, tipX2, width, left, right, wgt, &scalerIncrement, useFastScaling, x1_gap, x2_gap, x3_gap,
+						x1_gapColumn, x2_gapColumn, x3_gapColumn, tr->maxCategories);
 #else
-			  newviewGTRCATPROT_SAVE(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
-						 x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
-						 tipX1, tipX2, width, left, right, wgt, &scalerIncrement, x1_gap, x2_gap, x3_gap,
-						 x1_gapColumn, x2_gapColumn, x3_gapColumn, tr->maxCategories);
+	      newviewGTRCATPROT_SAVE(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
+				     x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
+				     ex3, tipX1, tipX2, width, left, right, wgt, &scalerIncrement, useFastScaling, x1_gap, x2_gap, x3_gap,
+				     x1_gapColumn, x2_gapColumn, x3_gapColumn, tr->maxCategories);
 #endif
-			}
-		      else
-			{			 			
+	    }
+	  else
+	    {			 			
 #ifdef __MIC_NATIVE
-		     assert(0 && "CAT model of rate heterogeneity is not implemented on Intel MIC");
+	 assert(0 && "CAT model of rate heterogeneity is not implemented on Intel MIC");
 #elif __AVX
-			  newviewGTRCATPROT_AVX(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
-						x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
-						tipX1, tipX2, width, left, right, wgt, &scalerIncrement);
+	      newviewGTRCATPROT_AVX(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
+				    x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
+				    ex3, tipX1, tipX2, width, left, right, wgt, &scalerIncrement, useFastScaling);
 #else
-			  newviewGTRCATPROT(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
-					    x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
-					    tipX1, tipX2, width, left, right, wgt, &scalerIncrement);			
+	      newviewGTRCATPROT(tInfo->tipCase,  tr->partitionData[model].EV, rateCategory,
+				x1_start, x2_start, x3_start, tr->partitionData[model].tipVector,
+				ex3, tipX1, tipX2, width, left, right, wgt, &scalerIncrement, useFastScaling);			
 #endif
-			}
-		    }
-		  else
-		    {		    			 			  
-		      if(tr->saveMemory)
-			{
+	    }
+	}
+      else
+	{		    			 			  
+	  if(tr->saveMemory)
+	    {
 #ifdef __MIC_NATIVE
-		     assert(0 && "Memory saving is not implemented on Intel MIC");
+	 assert(0 && "Memory saving is not implemented on Intel MIC");
 #elif __AVX
-			  newviewGTRGAMMAPROT_AVX_GAPPED_SAVE(tInfo->tipCase,
-							      x1_start, x2_start, x3_start,
-							      tr->partitionData[model].EV,
-							      tr->partitionData[model].tipVector, (int*)NULL,
-							      tipX1, tipX2,
-							      width, left, right, wgt, &scalerIncrement, TRUE,
-							      x1_gap, x2_gap, x3_gap,
-							      x1_gapColumn, x2_gapColumn, x3_gapColumn);
+	      newviewGTRGAMMAPROT_AVX_GAPPED_SAVE(tInfo->tipCase,
+						  x1_start, x2_start, x3_start,
+						  tr->partitionData[model].EV,
+						  tr->partitionData[model].tipVector, ex3,
+						  tipX1, tipX2,
+						  width, left, right, wgt, &scalerIncrement, useFastScaling,
+						  x1_gap, x2_gap, x3_gap,
+						  x1_gapColumn, x2_gapColumn, x3_gapColumn);
 #else
-			  newviewGTRGAMMAPROT_GAPPED_SAVE(tInfo->tipCase,
-							  x1_start, x2_start, x3_start,
-							  tr->partitionData[model].EV,
-							  tr->partitionData[model].tipVector,
-							  tipX1, tipX2,
-							  width, left, right, wgt, &scalerIncrement,
-							  x1_gap, x2_gap, x3_gap,
-							  x1_gapColumn, x2_gapColumn, x3_gapColumn);
+	      newviewGTRGAMMAPROT_GAPPED_SAVE(tInfo->tipCase,
+					      x1_start, x2_start, x3_start,
+					      tr->partitionData[model].EV,
+					      tr->partitionData[model].tipVector,
+					      ex3, tipX1, tipX2,
+					      width, left, right, wgt, &scalerIncrement, useFastScaling,
+					      x1_gap, x2_gap, x3_gap,
+					      x1_gapColumn, x2_gapColumn, x3_gapColumn);
 #endif
-			}
-		      else
-			{
-			  if(tr->partitionData[model].protModels == LG4M || tr->partitionData[model].protModels == LG4X)
-			    {
+	    }
+	  else
+	    {
+	      if(tr->partitionData[model].protModels == LG4M || tr->partitionData[model].protModels == LG4X)
+		{
 #ifdef __MIC_NATIVE
-			      newviewGTRGAMMAPROT_LG4_MIC(tInfo->tipCase,
-							x1_start, x2_start, x3_start, tr->partitionData[model].mic_EV, tr->partitionData[model].mic_tipVector,
-							tipX1, tipX2,
-							width, left, right, wgt, &scalerIncrement,
-							tr->partitionData[model].mic_umpLeft, tr->partitionData[model].mic_umpRight);
+		  newviewGTRGAMMAPROT_LG4_MIC(tInfo->tipCase,
+					    x1_start, x2_start, x3_start, tr->partitionData[model].mic_EV, tr->partitionData[model].mic_tipVector,
+					    tipX1, tipX2,
+					    width, left, right, wgt, &scalerIncrement,
+					    umpLeft, umpRight);
+#elif defined(__AVX512)
+		  newviewGTRGAMMAPROT_AVX512_LG4(tInfo->tipCase,
+						 x1_start, x2_start, x3_start,
+						 tr->partitionData[model].EV_LG4,
+						 tr->partitionData[model].tipVector_LG4,
+						 ex3, tipX1, tipX2,
+						 width, left, right, wgt, &scalerIncrement, useFastScaling);
 #elif __AVX
-			      newviewGTRGAMMAPROT_AVX_LG4(tInfo->tipCase,
-							  x1_start, x2_start, x3_start,
-							  tr->partitionData[model].EV_LG4,
-							  tr->partitionData[model].tipVector_LG4,
-							  (int*)NULL, tipX1, tipX2,
-							  width, left, right, wgt, &scalerIncrement, TRUE);
+		  newviewGTRGAMMAPROT_AVX_LG4(tInfo->tipCase,
+					      x1_start, x2_start, x3_start,
+					      tr->partitionData[model].EV_LG4,
+					      tr->partitionData[model].tipVector_LG4,
+					      ex3, tipX1, tipX2,
+					      width, left, right, wgt, &scalerIncrement, useFastScaling);
 #else
-			      newviewGTRGAMMAPROT_LG4(tInfo->tipCase,
-						      x1_start, x2_start, x3_start,
-						      tr->partitionData[model].EV_LG4,
-						      tr->partitionData[model].tipVector_LG4,
-						      (int*)NULL, tipX1, tipX2,
-						      width, left, right, 
-						      wgt, &scalerIncrement, TRUE);
+		  newviewGTRGAMMAPROT_LG4(tInfo->tipCase,
+					  x1_start, x2_start, x3_start,
+					  tr->partitionData[model].EV_LG4,
+					  tr->partitionData[model].tipVector_LG4,
+					  ex3, tipX1, tipX2,
+					  width, left, right, 
+					  wgt, &scalerIncrement, useFastScaling);
 #endif			    
-			    }
-			  else
-			    {
+		}
+	      else
+		{
 #ifdef __MIC_NATIVE
-			      newviewGTRGAMMAPROT_MIC(tInfo->tipCase,
-							x1_start, x2_start, x3_start, tr->partitionData[model].mic_EV, tr->partitionData[model].mic_tipVector,
-							tipX1, tipX2,
-							width, left, right, wgt, &scalerIncrement,
-							tr->partitionData[model].mic_umpLeft, tr->partitionData[model].mic_umpRight);
+		  newviewGTRGAMMAPROT_MIC(tInfo->tipCase,
+					    x1_start, x2_start, x3_start, tr->partitionData[model].mic_EV, tr->partitionData[model].mic_tipVector,
+					    tipX1, tipX2,
+					    width, left, right, wgt, &scalerIncrement,
+					    umpLeft, umpRight);
+#elif defined(__AVX512)
+		  newviewGTRGAMMAPROT_AVX512(tInfo->tipCase,
+					     x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+					     ex3, tipX1, tipX2,
+					     width, left, right, wgt, &scalerIncrement, useFastScaling);
 #elif __AVX
 			     
 			      
-			      /*newviewGTRGAMMA_NSTATES(tInfo->tipCase,
-						       x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
-						       tipX1, tipX2,
-						       width, left, right, wgt, &scalerIncrement, 23, 20, 4);*/
-
-			       newviewGTRGAMMAPROT_AVX(tInfo->tipCase,
-						      x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
-						      tipX1, tipX2,
-						      width, left, right, wgt, &scalerIncrement);
+		  /*newviewGTRGAMMA_NSTATES(tInfo->tipCase,
+					   x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+					   tipX1, tipX2,
+					   width, left, right, wgt, &scalerIncrement, 23, 20, 4);*/
+
+		   newviewGTRGAMMAPROT_AVX(tInfo->tipCase,
+					  x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+					  ex3, tipX1, tipX2,
+					  width, left, right, wgt, &scalerIncrement, useFastScaling);
 #else
 			       
 
-			      newviewGTRGAMMAPROT(tInfo->tipCase,
-						  x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
-						  tipX1, tipX2,
-						  width, left, right, wgt, &scalerIncrement);			     					      
+		  newviewGTRGAMMAPROT(tInfo->tipCase,
+				      x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+				      ex3, tipX1, tipX2,
+				      width, left, right, wgt, &scalerIncrement, useFastScaling);			     					      
 #endif
-			    }
-			}
-		    }	
-		  break;	
-		case 16:
-		  //mth POMO16
-		  assert(!tr->saveMemory);
-		  
-		  switch(tr->rateHetModel)
-		    {
-		    case GAMMA:
-		      newviewGTRGAMMA_NSTATES(genericTipCase,
-					      x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
-					      tipX1, tipX2,
-					      width, left, right, wgt, &scalerIncrement, 0, 16, 4);
-		      break;
-		    case PLAIN:
-		      newviewGTRGAMMA_NSTATES(genericTipCase,
-					      x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
-					      tipX1, tipX2,
-					      width, left, right, wgt, &scalerIncrement, 0, 16, 1);
-		      break;
-		    default:
-		      assert(0);
-		    }
-		  break;
-		case 64:
-		  //mth POMO64
-		  assert(!tr->saveMemory); 
-		  switch(tr->rateHetModel)
-		    {
-		    case GAMMA:
-		      newviewGTRGAMMA_NSTATES(genericTipCase,
-					      x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
-					      tipX1, tipX2,
-					      width, left, right, wgt, &scalerIncrement, 0, 64, 4);
-		      break;
-		    case PLAIN:
-		      newviewGTRGAMMA_NSTATES(genericTipCase,
-					      x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
-					      tipX1, tipX2,
-					      width, left, right, wgt, &scalerIncrement, 0, 64, 1);
-		      break;
-		    default:
-		      assert(0);
-		    }
-		  break;
-		default:		  
-		  assert(0);
 		}
+	    }
+	}	
+      break;	
+    /* the state counts are passed as constants, such that the compiler can drop the remainder loops of the
+       NSTATES kernels. The tips of POMO are likelihood vectors (no tip vector entries), the generic data types 
+       index the tip vector */
+    case 16: /* POMO16 */
+      switch(tr->rateHetModel)
+	{
+	case GAMMA:
+	  newviewGTRGAMMA_NSTATES(genericTipCase,
+				  x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+				  ex3, tipX1, tipX2,
+				  width, left, right, wgt, &scalerIncrement, useFastScaling, 0, 16, 4,
+				  x1_gap, x2_gap, x3_gap,
+				  x1_gapColumn, x2_gapColumn, x3_gapColumn);
+	  break;
+	case PLAIN:
+	  newviewGTRGAMMA_NSTATES(genericTipCase,
+				  x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+				  ex3, tipX1, tipX2,
+				  width, left, right, wgt, &scalerIncrement, useFastScaling, 0, 16, 1,
+				  x1_gap, x2_gap, x3_gap,
+				  x1_gapColumn, x2_gapColumn, x3_gapColumn);
+	  break;
+	default:
+	  assert(0);
+	}
+      break;
+    case 32: /* GENERIC_32 */
+      switch(tr->rateHetModel)
+	{
+	case GAMMA:
+	  newviewGTRGAMMA_NSTATES(genericTipCase,
+				  x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+				  ex3, tipX1, tipX2,
+				  width, left, right, wgt, &scalerIncrement, useFastScaling, (size_t)getUndetermined(GENERIC_32) + 1, 32, 4,
+				  x1_gap, x2_gap, x3_gap,
+				  x1_gapColumn, x2_gapColumn, x3_gapColumn);
+	  break;
+	case PLAIN:
+	  newviewGTRGAMMA_NSTATES(genericTipCase,
+				  x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+				  ex3, tipX1, tipX2,
+				  width, left, right, wgt, &scalerIncrement, useFastScaling, (size_t)getUndetermined(GENERIC_32) + 1, 32, 1,
+				  x1_gap, x2_gap, x3_gap,
+				  x1_gapColumn, x2_gapColumn, x3_gapColumn);
+	  break;
+	default:
+	  assert(0);
+	}
+      break;
+    case 64: /* POMO64 and GENERIC_64 */
+      switch(tr->rateHetModel)
+	{
+	case GAMMA:
+	  newviewGTRGAMMA_NSTATES(genericTipCase,
+				  x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+				  ex3, tipX1, tipX2,
+				  width, left, right, wgt, &scalerIncrement, useFastScaling, (isPomo(tr->partitionData[model].dataType) ? 0 : (size_t)getUndetermined(GENERIC_64) + 1), 64, 4,
+				  x1_gap, x2_gap, x3_gap,
+				  x1_gapColumn, x2_gapColumn, x3_gapColumn);
+	  break;
+	case PLAIN:
+	  newviewGTRGAMMA_NSTATES(genericTipCase,
+				  x1_start, x2_start, x3_start, tr->partitionData[model].EV, tr->partitionData[model].tipVector,
+				  ex3, tipX1, tipX2,
+				  width, left, right, wgt, &scalerIncrement, useFastScaling, (isPomo(tr->partitionData[model].dataType) ? 0 : (size_t)getUndetermined(GENERIC_64) + 1), 64, 1,
+				  x1_gap, x2_gap, x3_gap,
+				  x1_gapColumn, x2_gapColumn, x3_gapColumn);
+	  break;
+	default:
+	  assert(0);
+	}
+      break;
+    default:		  
+      assert(0);
+    }
 #endif
 
-	      /* important step, here we essentiallt recursively compute the number of scaling multiplications 
-		 at node p: it's the sum of the number of scaling multiplications already conducted 
-		 for computing nodes q and r plus the scaling multiplications done at node p */
+  /* add the per-site counts to the scaling multiplications of the traversal and to the weighted sum at p */
+  if(!useFastScaling)
+    {
+      size_t
+	i;
 
-	      globalScaler[tInfo->pNumber] =
-		globalScaler[tInfo->qNumber] +
-		globalScaler[tInfo->rNumber] +
-		(unsigned int)scalerIncrement;
+      int
+	*siteScaler = tr->partitionData[model].siteScaler + offset;
 
-	      /* check that we are not getting an integer overflow ! */
+      for(i = 0; i < width; i++)
+	{
+	  siteScaler[i] += ex3[i];
+	  scalerIncrement += wgt[i] * ex3[i];
+	}
+    }
 
-	      assert(globalScaler[tInfo->pNumber] < INT_MAX);
-	    }	
+  /* important step, here we essentiallt recursively compute the number of scaling multiplications 
+     at node p: it's the sum of the number of scaling multiplications already conducted 
+     for computing nodes q and r plus the scaling multiplications done at node p */
+
+  globalScaler[tInfo->pNumber] =
+    globalScaler[tInfo->qNumber] +
+    globalScaler[tInfo->rNumber] +
+    (unsigned int)scalerIncrement;
+
+  /* check that we are not getting an integer overflow ! */
+
+  assert(globalScaler[tInfo->pNumber] < INT_MAX);
+}
+
+#ifdef _USE_OMP
+
+/* the dependencies are tracked per vector rather than per node, since with a CLV budget 
+   a slot may be overwritten by a later entry once it has been read (see recom.c). 
+   Without a budget this is just the node number */
+
+static size_t vectorDependency(tree *tr, int number, int slot)
+{
+  if(isTip(number, tr->mxtips))
+    return (size_t)number;
+
+  return (size_t)tr->mxtips + 1 + (size_t)slot;
+}
+
+/* task-parallel version of newviewTraversal(): the traversal descriptor is a post-order 
+   linearization of the tree, but entries whose child vectors have already been computed 
+   are independent of each other (e.g., sibling subtrees). Hence, we create one OpenMP task per 
+   entry and site range in tr->threadPartAssigns with dependencies on the entries 
+   computing q and r, and let the OpenMP runtime schedule them (work stealing) onto the threads.
+
+   The site ranges are kept, such that the scaling counts remain in the 
+   per-thread scalers of the thread that owns the sites and evaluate/sumtable 
+   can continue as usual after the implicit barrier of the single construct. */
+
+static void newviewTasks(tree *tr, int startIndex)
+{
+#pragma omp single
+  {
+    traversalInfo 
+      *ti   = tr->td[0].ti;
+
+    int 
+      i,
+      c,
+      numChunks = tr->nThreads * tr->maxModelsPerThread;
+
+    for(i = startIndex; i < tr->td[0].count; i++)
+      for(c = 0; c < numChunks; c++)
+	{
+	  traversalInfo 
+	    *tInfo = &ti[i];
+
+	  Assign
+	    *pAss = tr->threadPartAssigns[c];
+
+	  size_t
+	    p = vectorDependency(tr, tInfo->pNumber, tInfo->pSlot) * (size_t)numChunks + (size_t)c,
+	    q = vectorDependency(tr, tInfo->qNumber, tInfo->qSlot) * (size_t)numChunks + (size_t)c,
+	    r = vectorDependency(tr, tInfo->rNumber, tInfo->rSlot) * (size_t)numChunks + (size_t)c;
+
+	  if(!pAss || !tr->td[0].executeModel[pAss->partitionId] || pAss->width == 0)
+	    continue;
+
+#pragma omp task firstprivate(tInfo, pAss) depend(in: tr->traversalDeps[q], tr->traversalDeps[r]) depend(out: tr->traversalDeps[p])
+	  {
+	    /* tasks are tied and newviewEntry() contains no task scheduling point, 
+	       thus the P matrix buffers of the executing thread can not be used by another task meanwhile */
+
+	    int
+	      tid = omp_get_thread_num();
+
+	    newviewEntry(tr, tInfo, pAss->partitionId, (size_t)pAss->offset, (size_t)pAss->width, 
+			 tr->threadLeft[tid], tr->threadRight[tid], 
+#ifdef __MIC_NATIVE
+			 tr->threadUmpLeft[tid], tr->threadUmpRight[tid], 
+#else
+			 (double *)NULL, (double *)NULL,
+#endif
+			 tr->partitionData[pAss->partitionId].threadGlobalScaler[pAss->procId]);
+	  }
+	}
+  }
+}
+
+#endif
+
+/* executes the traversal descriptor starting at entry startIndex. 
+
+   Under _USE_OMP this must be called by all threads of a parallel region. Every thread 
+   computes the P matrices (in a private buffer) and the conditional likelihoods only for the 
+   site ranges it owns according to tr->threadPartAssigns. Since a thread only reads those 
+   entries of the child vectors that it has computed itself, there is no need to synchronize 
+   between the entries of the traversal descriptor. Thus, the callers can open a single parallel region 
+   per traversal (and directly continue with evaluate or the sumtable computation in the same region) 
+   instead of forking and joining threads for every node. 
+   
+   With tr->taskTraversal, independent entries are additionally executed concurrently, see newviewTasks(). */
+
+void newviewTraversal(tree *tr, int startIndex)
+{
+  traversalInfo 
+    *ti   = tr->td[0].ti;
+
+  int 
+    i;
+
+  double
+    traceStart = traceBegin();
+
+  clvStoreTraversal(tr, startIndex);
+
+#ifdef _USE_OMP
+  if(tr->taskTraversal)
+    {
+      newviewTasks(tr, startIndex);
+
+      if(tr->td[0].count > startIndex)
+	traceEnd(TRACE_NEWVIEW, traceStart, (size_t)(tr->td[0].count - startIndex));
+      return;
+    }
+#endif
+
+    /* loop over traversal descriptor length. Note that on average we only re-compute the conditionals on 3 -4
+       nodes in RAxML */
+
+  for(i = startIndex; i < tr->td[0].count; i++)
+    {
+      traversalInfo 
+	*tInfo = &ti[i];
+
+      clvStoreEntry(tr, i);
+
+      /* now loop over all partitions for nodes p, q, and r of the current traversal vector entry */
+      {
+	int
+	  m,
+	  model,
+	  maxModel;
+	
+#ifdef _USE_OMP
+	maxModel = tr->maxModelsPerThread;
+#else
+	maxModel = tr->NumberOfModels;
+#endif
+
+	for(m = 0; m < maxModel; m++)
+	  {
+	    size_t
+	      width  = 0,
+	      offset = 0;
+	    
+	    double
+	      *left     = (double*)NULL,
+	      *right    = (double*)NULL,
+	      *umpLeft  = (double*)NULL,
+	      *umpRight = (double*)NULL;
+	    
+	    unsigned int
+	      *globalScaler = (unsigned int*)NULL;
+
+#ifdef _USE_OMP
+	    int
+	      tid = omp_get_thread_num();
+
+	    /* check if this thread should process this partition */
+	    Assign* 
+	      pAss = tr->threadPartAssigns[tid * tr->maxModelsPerThread + m];
+
+	    if(pAss)
+	      {
+		assert(tid == pAss->procId);
+		
+		model  = pAss->partitionId;
+		width  = pAss->width;
+		offset = pAss->offset;
+		
+		/* P matrices are computed in thread-private buffers */
+		left  = tr->threadLeft[tid];
+		right = tr->threadRight[tid];
+#ifdef __MIC_NATIVE
+		umpLeft  = tr->threadUmpLeft[tid];
+		umpRight = tr->threadUmpRight[tid];
+#endif
+		globalScaler = tr->partitionData[model].threadGlobalScaler[tid];
+	      }
+	    else
+	      break;
+#else
+	    model = m;	    
+
+	    /* number of sites in this partition */
+	    width  = (size_t)tr->partitionData[model].width;
+	    offset = 0;
+
+	    /* set the pointers to the left and right P matrices to the pre-allocated memory space for storing them */
+	    
+	    left  = tr->partitionData[model].left;
+	    right = tr->partitionData[model].right;
+#ifdef __MIC_NATIVE
+	    umpLeft  = tr->partitionData[model].mic_umpLeft;
+	    umpRight = tr->partitionData[model].mic_umpRight;
+#endif
+	    globalScaler = tr->partitionData[model].globalScaler;
+#endif
+
+	    /* this conditional statement is exactly identical to what we do in evaluateIterative */
+	    if(tr->td[0].executeModel[model] && width > 0)
+	      {
+		double
+		  kernelStart = startKernelTimer();
+
+		newviewEntry(tr, tInfo, model, offset, width, left, right, umpLeft, umpRight, globalScaler);
+
+		stopKernelTimer(KERNEL_NEWVIEW, tr->partitionData[model].dataType, tInfo->tipCase, kernelStart);
+	      }
 	} // for model
-    }  // omp parallel block
+    }
   }  // for traversal
+
+  if(tr->td[0].count > startIndex)
+    traceEnd(TRACE_NEWVIEW, traceStart, (size_t)(tr->td[0].count - startIndex));
+}
+
+
+/* now this is the function that just iterates over the length of the traversal descriptor and 
+   just computes the conditional likelihhod arrays in the order given by the descriptor.
+   So in a sense, this function has no clue that there is any tree-like structure 
+   in the traversal descriptor, it just operates on an array of structs of given length */ 
+
+void newviewIterative (tree *tr, int startIndex)
+{
+  /* one parallel region for the entire traversal */
+#ifdef _USE_OMP
+#pragma omp parallel
+#endif
+  newviewTraversal(tr, startIndex);
 }
 
 
@@ -1827,6 +2143,8 @@ void newviewGeneric (tree *tr, nodeptr p, boolean masked)
 
   tr->td[0].count = 0;
 
+  startClvTraversal(p, (nodeptr)NULL);
+
   /* compute the traversal descriptor */
   computeTraversalInfo(p, &(tr->td[0].ti[0]), &(tr->td[0].count), tr->mxtips, tr->numBranches, TRUE);
 
@@ -1869,8 +2187,13 @@ void newviewGeneric (tree *tr, nodeptr p, boolean masked)
     {
       /* store execute mask in traversal descriptor */
 
+      double 
+	t = gettime(); 
+
       storeExecuteMaskInTraversalDescriptor(tr);           
       newviewIterative(tr, 0);
+
+      tr->kernelTime += gettime() - t; 
     }
 
   /* clean up */
@@ -1894,8 +2217,8 @@ void newviewGeneric (tree *tr, nodeptr p, boolean masked)
 static void newviewGTRGAMMA_GAPPED_SAVE(int tipCase,
 					double *x1_start, double *x2_start, double *x3_start,
 					double *EV, double *tipVector,
-					unsigned char *tipX1, unsigned char *tipX2,
-					const size_t n, double *left, double *right, int *wgt, int *scalerIncrement, 
+					int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+					const size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling, 
 					unsigned int *x1_gap, unsigned int *x2_gap, unsigned int *x3_gap, 
 					double *x1_gapColumn, double *x2_gapColumn, double *x3_gapColumn)
 {
@@ -2252,7 +2575,10 @@ static void newviewGTRGAMMA_GAPPED_SAVE(int tipCase,
 	       {	       
 		 if(scaleGap)
 		   {		    
-		       addScale += wgt[i];		     
+		       if(useFastScaling)
+			 addScale += wgt[i];
+		       else
+			 ex3[i] += 1;
 		   }
 	       }
 	     else
@@ -2390,7 +2716,10 @@ static void newviewGTRGAMMA_GAPPED_SAVE(int tipCase,
 		     _mm_store_pd(&x3[14], _mm_mul_pd(values[7], sv));	     
 		     
 		     
-		     addScale += wgt[i];
+		     if(useFastScaling)
+		       addScale += wgt[i];
+		     else
+		       ex3[i] += 1;
 		    
 		   }
 		 else
@@ -2580,7 +2909,10 @@ static void newviewGTRGAMMA_GAPPED_SAVE(int tipCase,
 	   {	     
 	     if(scaleGap)
 	       {		 
-		 addScale += wgt[i];		 	       
+		 if(useFastScaling)
+		   addScale += wgt[i];
+		 else
+		   ex3[i] += 1;
 	       }
 	   }
 	 else
@@ -2757,7 +3089,10 @@ static void newviewGTRGAMMA_GAPPED_SAVE(int tipCase,
 		 _mm_store_pd(&x3[14], _mm_mul_pd(values[7], sv));	     
 		 
 		 
-		 addScale += wgt[i];
+		 if(useFastScaling)
+		   addScale += wgt[i];
+		 else
+		   ex3[i] += 1;
 		
 	       }
 	     else
@@ -2791,8 +3126,8 @@ static void newviewGTRGAMMA_GAPPED_SAVE(int tipCase,
 static void newviewGTRGAMMA(int tipCase,
 			    double *x1_start, double *x2_start, double *x3_start,
 			    double *EV, double *tipVector,
-			    unsigned char *tipX1, unsigned char *tipX2,
-			    const size_t n, double *left, double *right, int *wgt, int *scalerIncrement
+			    int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+			    const size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling
 			    )
 {
   size_t
@@ -3092,7 +3427,10 @@ static void newviewGTRGAMMA(int tipCase,
 		 _mm_store_pd(&x3[14], _mm_mul_pd(values[7], sv));	     
 		 
 		 
-		 addScale += wgt[i];
+		 if(useFastScaling)
+		   addScale += wgt[i];
+		 else
+		   ex3[i] += 1;
 		 
 	       }
 	     else
@@ -3272,7 +3610,10 @@ static void newviewGTRGAMMA(int tipCase,
 	     _mm_store_pd(&x3[14], _mm_mul_pd(values[7], sv));	     
 	     
 	    
-	     addScale += wgt[i];
+	     if(useFastScaling)
+	       addScale += wgt[i];
+	     else
+	       ex3[i] += 1;
 	    
 	   }
 	 else
@@ -3299,8 +3640,8 @@ static void newviewGTRGAMMA(int tipCase,
 }
 static void newviewGTRCAT( int tipCase,  double *EV,  int *cptr,
 			   double *x1_start, double *x2_start,  double *x3_start, double *tipVector,
-			   unsigned char *tipX1, unsigned char *tipX2,
-			   size_t n,  double *left, double *right, int *wgt, int *scalerIncrement)
+			   int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+			   size_t n,  double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling)
 {
   double
     *le,
@@ -3570,7 +3911,10 @@ static void newviewGTRCAT( int tipCase,  double *EV,  int *cptr,
 	      _mm_store_pd(&x3[2], _mm_mul_pd(EV_t_l2_k0, sc));	      	      
 	      
 	      
-	      addScale += wgt[i];	  
+	      if(useFastScaling)
+		addScale += wgt[i];
+	      else
+		ex3[i] += 1;
 	    }	
 	  else
 	    {
@@ -3708,7 +4052,10 @@ static void newviewGTRCAT( int tipCase,  double *EV,  int *cptr,
 	      _mm_store_pd(&x3[2], _mm_mul_pd(EV_t_l2_k0, sc));	      	      
 	      
 	      
-	      addScale += wgt[i];	  
+	      if(useFastScaling)
+		addScale += wgt[i];
+	      else
+		ex3[i] += 1;
 	    }	
 	  else
 	    {
@@ -3730,8 +4077,8 @@ static void newviewGTRCAT( int tipCase,  double *EV,  int *cptr,
 
 static void newviewGTRCAT_SAVE( int tipCase,  double *EV,  int *cptr,
 				double *x1_start, double *x2_start,  double *x3_start, double *tipVector,
-				unsigned char *tipX1, unsigned char *tipX2,
-				size_t n,  double *left, double *right, int *wgt, int *scalerIncrement,
+				int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+				size_t n,  double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling,
 				unsigned int *x1_gap, unsigned int *x2_gap, unsigned int *x3_gap,
 				double *x1_gapColumn, double *x2_gapColumn, double *x3_gapColumn, const int maxCats)
 {
@@ -4039,7 +4386,12 @@ static void newviewGTRCAT_SAVE( int tipCase,  double *EV,  int *cptr,
 	  if(isGap(x3_gap, i))
 	    {
 	      if(scaleGap)		   		    
-		addScale += wgt[i];
+		{
+		  if(useFastScaling)
+		    addScale += wgt[i];
+		  else
+		    ex3[i] += 1;
+		}
 	    }
 	  else
 	    {	      
@@ -4180,7 +4532,10 @@ static void newviewGTRCAT_SAVE( int tipCase,  double *EV,  int *cptr,
 		  _mm_store_pd(&x3[0], _mm_mul_pd(EV_t_l0_k0, sc));
 		  _mm_store_pd(&x3[2], _mm_mul_pd(EV_t_l2_k0, sc));	      	      
 		  		  
-		  addScale += wgt[i];	  
+		  if(useFastScaling)
+		    addScale += wgt[i];
+		  else
+		    ex3[i] += 1;
 		}	
 	      else
 		{
@@ -4199,7 +4554,12 @@ static void newviewGTRCAT_SAVE( int tipCase,  double *EV,  int *cptr,
 	  if(isGap(x3_gap, i))
 	    {
 	      if(scaleGap)		   		    
-		addScale += wgt[i];
+		{
+		  if(useFastScaling)
+		    addScale += wgt[i];
+		  else
+		    ex3[i] += 1;
+		}
 	    }
 	  else
 	    {	     
@@ -4345,7 +4705,10 @@ static void newviewGTRCAT_SAVE( int tipCase,  double *EV,  int *cptr,
 		  _mm_store_pd(&x3[0], _mm_mul_pd(EV_t_l0_k0, sc));
 		  _mm_store_pd(&x3[2], _mm_mul_pd(EV_t_l2_k0, sc));	      	      
 		  	      
-		  addScale += wgt[i];	  
+		  if(useFastScaling)
+		    addScale += wgt[i];
+		  else
+		    ex3[i] += 1;
 		}	
 	      else
 		{
@@ -4367,8 +4730,8 @@ static void newviewGTRCAT_SAVE( int tipCase,  double *EV,  int *cptr,
 
 static void newviewGTRGAMMAPROT_GAPPED_SAVE(int tipCase,
 					    double *x1, double *x2, double *x3, double *extEV, double *tipVector,
-					    unsigned char *tipX1, unsigned char *tipX2,
-					    size_t n, double *left, double *right, int *wgt, int *scalerIncrement, 
+					    int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+					    size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling, 
 					    unsigned int *x1_gap, unsigned int *x2_gap, unsigned int *x3_gap,  
 					    double *x1_gapColumn, double *x2_gapColumn, double *x3_gapColumn
 					    )
@@ -4603,7 +4966,10 @@ static void newviewGTRGAMMAPROT_GAPPED_SAVE(int tipCase,
 	       {	       
 		 if(gapScaling)
 		   {		     
-		     addScale += wgt[i];		     
+		     if(useFastScaling)
+		       addScale += wgt[i];
+		     else
+		       ex3[i] += 1;
 		   }
 	       }
 	     else
@@ -4691,7 +5057,10 @@ static void newviewGTRGAMMAPROT_GAPPED_SAVE(int tipCase,
 			 _mm_store_pd(&v[l], _mm_mul_pd(ex3v,twoto));	
 		       }		   		  
 		     		    
-		     addScale += wgt[i];		      
+		     if(useFastScaling)
+		       addScale += wgt[i];
+		     else
+		       ex3[i] += 1;
 		   }
 		 
 		 x3_ptr += 80;
@@ -4788,7 +5157,10 @@ static void newviewGTRGAMMAPROT_GAPPED_SAVE(int tipCase,
 	   {	     
 	     if(gapScaling)
 	       {		
-		 addScale += wgt[i];			       
+		 if(useFastScaling)
+		   addScale += wgt[i];
+		 else
+		   ex3[i] += 1;
 	       }
 	   }
 	 else
@@ -4887,7 +5259,10 @@ static void newviewGTRGAMMAPROT_GAPPED_SAVE(int tipCase,
 		     _mm_store_pd(&v[l], _mm_mul_pd(ex3v,twoto));	
 		   }		   		  
 		 		
-		 addScale += wgt[i];		 	  
+		 if(useFastScaling)
+		   addScale += wgt[i];
+		 else
+		   ex3[i] += 1;
 	       }
 	     x3_ptr += 80;
 	   }
@@ -4906,8 +5281,8 @@ static void newviewGTRGAMMAPROT_GAPPED_SAVE(int tipCase,
 
 static void newviewGTRGAMMAPROT(int tipCase,
 				double *x1, double *x2, double *x3, double *extEV, double *tipVector,
-				unsigned char *tipX1, unsigned char *tipX2,
-				size_t n, double *left, double *right, int *wgt, int *scalerIncrement)
+				int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+				size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling)
 {
   double  *uX1, *uX2, *v;
   double x1px2;
@@ -5096,7 +5471,10 @@ static void newviewGTRGAMMAPROT(int tipCase,
 
 
 	
-		addScale += wgt[i];
+		if(useFastScaling)
+		  addScale += wgt[i];
+		else
+		  ex3[i] += 1;
 		       
 	      }
 	  }
@@ -5189,7 +5567,10 @@ static void newviewGTRGAMMAPROT(int tipCase,
 
 
 	    
-	     addScale += wgt[i];
+	     if(useFastScaling)
+	       addScale += wgt[i];
+	     else
+	       ex3[i] += 1;
 	      
 	   }
        }
@@ -5208,8 +5589,8 @@ static void newviewGTRGAMMAPROT(int tipCase,
 static void newviewGTRCATPROT(int tipCase, double *extEV,
 			      int *cptr,
 			      double *x1, double *x2, double *x3, double *tipVector,
-			      unsigned char *tipX1, unsigned char *tipX2,
-			      size_t n, double *left, double *right, int *wgt, int *scalerIncrement )
+			      int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+			      size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling )
 {
   double
     *le, *ri, *v, *vl, *vr;
@@ -5338,7 +5719,10 @@ static void newviewGTRCATPROT(int tipCase, double *extEV,
 		    _mm_store_pd(&v[l], _mm_mul_pd(ex3v,twoto));		    
 		  }
 	
-		addScale += wgt[i];	  
+		if(useFastScaling)
+		  addScale += wgt[i];
+		else
+		  ex3[i] += 1;
 	      }
 	  }
       }
@@ -5417,7 +5801,10 @@ static void newviewGTRCATPROT(int tipCase, double *extEV,
 
 
 	       
-	       addScale += wgt[i];	   
+	       if(useFastScaling)
+		 addScale += wgt[i];
+	       else
+		 ex3[i] += 1;
 	     }
 	}
       break;
@@ -5433,8 +5820,8 @@ static void newviewGTRCATPROT(int tipCase, double *extEV,
 static void newviewGTRCATPROT_SAVE(int tipCase, double *extEV,
 				   int *cptr,
 				   double *x1, double *x2, double *x3, double *tipVector,
-				   unsigned char *tipX1, unsigned char *tipX2,
-				   size_t n, double *left, double *right, int *wgt, int *scalerIncrement,
+				   int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+				   size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling,
 				   unsigned int *x1_gap, unsigned int *x2_gap, unsigned int *x3_gap,
 				   double *x1_gapColumn, double *x2_gapColumn, double *x3_gapColumn, const int maxCats)
 {
@@ -5593,7 +5980,12 @@ static void newviewGTRCATPROT_SAVE(int tipCase, double *extEV,
 	    if(isGap(x3_gap, i))
 	      {
 		if(scaleGap)		   		    
-		  addScale += wgt[i];
+		  {
+		    if(useFastScaling)
+		      addScale += wgt[i];
+		    else
+		      ex3[i] += 1;
+		  }
 	      }
 	    else
 	      {	 
@@ -5674,7 +6066,10 @@ static void newviewGTRCATPROT_SAVE(int tipCase, double *extEV,
 			_mm_store_pd(&v[l], _mm_mul_pd(ex3v,twoto));		    
 		      }
 		    
-		    addScale += wgt[i];	  
+		    if(useFastScaling)
+		      addScale += wgt[i];
+		    else
+		      ex3[i] += 1;
 		  }
 		x3_ptr += 20;
 	      }
@@ -5687,7 +6082,12 @@ static void newviewGTRCATPROT_SAVE(int tipCase, double *extEV,
 	  if(isGap(x3_gap, i))
 	    {
 	      if(scaleGap)		   		    
-		addScale += wgt[i];
+		{
+		  if(useFastScaling)
+		    addScale += wgt[i];
+		  else
+		    ex3[i] += 1;
+		}
 	    }
 	  else
 	    {	  	     
@@ -5773,7 +6173,10 @@ static void newviewGTRCATPROT_SAVE(int tipCase, double *extEV,
 		      _mm_store_pd(&v[l], _mm_mul_pd(ex3v,twoto));	
 		    }		   		  
 		  
-		  addScale += wgt[i];	   
+		  if(useFastScaling)
+		    addScale += wgt[i];
+		  else
+		    ex3[i] += 1;
 		}
 	      x3_ptr += 20;
 	    }
@@ -6540,33 +6943,272 @@ static void newviewGTRGAMMA_BINARY(int tipCase,
 /**** CLV computation at inner node of the tree *********************/
 
 
-static void newviewGTRGAMMA_NSTATES(int tipCase,
-				    double *x1, double *x2, double *x3, double *extEV, double *tipVector,
-				    unsigned char *tipX1, unsigned char *tipX2,
-				    size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const size_t numberOfAllCharacters, const size_t numberOfStates, 
-				    const size_t gammaRates)
+/* the computations of a single site x3 (gammaRates * numberOfStates entries) of newviewGTRGAMMA_NSTATES() */
+
+/* both children are tips given by their tip vector index, uX1 and uX2 are the precomputed products of the
+   tip vectors with the P matrices */
+
+static inline void tipTipSiteNSTATES(double *uX1, double *uX2, double *x3, double *extEV, const size_t numberOfStates, const size_t gammaRates)
 {
-  double  
-    *uX1, 
-    *uX2, 
-    *v, 
+  double
+    *v,
+    x1px2;
+
+  size_t
+    j,
+    k,
+    l;
+
+  const size_t
+    loopLength = numberOfStates - (numberOfStates % VECTOR_WIDTH);
+
+  for(j = 0; j < gammaRates; j++)
+    {
+      v = &x3[j * numberOfStates];
+
+      VECTOR_REGISTER zero =  VECTOR_SET_ZERO();
+
+      for(k = 0; k < loopLength; k += VECTOR_WIDTH)
+	VECTOR_STORE(&v[k], zero);
+
+      for(;k < numberOfStates; k++)
+	v[k] = 0.0;
+
+      for(k = 0; k < numberOfStates; k++)
+	{
+	  double
+	    *eev = &extEV[k * numberOfStates];
+
+	  x1px2 = uX1[j * numberOfStates + k] * uX2[j * numberOfStates + k];
+
+	  VECTOR_REGISTER
+	    x1px2v = VECTOR_SET_ONE(x1px2);
+
+	  for(l = 0; l < loopLength; l += VECTOR_WIDTH)
+	    {
+	      VECTOR_REGISTER vv = VECTOR_LOAD(&v[l]);
+	      VECTOR_REGISTER ee = VECTOR_LOAD(&eev[l]);
+
+	      vv = VECTOR_ADD(vv, VECTOR_MUL(x1px2v,ee));
+
+	      VECTOR_STORE(&v[l], vv);
+	    }
+
+	  for(;l < numberOfStates; l++)
+	    v[l] += x1px2 * eev[l];
+	}
+    }
+}
+
+/* the left child is a tip given by its tip vector index (uX1 as above), the right one an inner node,
+   returns TRUE if the site was scaled */
+
+static inline boolean tipInnerSiteNSTATES(double *uX1, double *x2, double *x3, double *extEV, double *right,
+				   const size_t numberOfStates, const size_t gammaRates)
+{
+  double
+    *v,
     x1px2,
-    *vl, 
+    ump_x2[numberOfStates];
+
+  size_t
+    j,
+    k,
+    l;
+
+  const size_t
+    loopLength = numberOfStates - (numberOfStates % VECTOR_WIDTH),
+    statesSquare = numberOfStates * numberOfStates,
+    stride = numberOfStates * gammaRates;
+
+  for(k = 0; k < gammaRates; k++)
+    {
+      v = &(x2[k * numberOfStates]);
+
+      for(l = 0; l < numberOfStates; l++)
+	{
+	  double *r =  &right[k * statesSquare + l * numberOfStates];
+	  VECTOR_REGISTER ump_x2v = VECTOR_SET_ZERO();
+
+	  for(j = 0; j < loopLength; j+= VECTOR_WIDTH)
+	    {
+	      VECTOR_REGISTER vv = VECTOR_LOAD(&v[j]);
+	      VECTOR_REGISTER rr = VECTOR_LOAD(&r[j]);
+	      ump_x2v = VECTOR_ADD(ump_x2v, VECTOR_MUL(vv, rr));
+	    }
+
+	  ump_x2[l] = haddScalar(ump_x2v);
+
+	  for(;j < numberOfStates; j++)
+	    ump_x2[l] += v[j] * r[j];
+	}
+
+      v = &(x3[numberOfStates * k]);
+
+      VECTOR_REGISTER zero =  VECTOR_SET_ZERO();
+
+      for(l = 0; l < loopLength; l += VECTOR_WIDTH)
+	VECTOR_STORE(&v[l], zero);
+
+      for(;l < numberOfStates; l++)
+	v[l] = 0.0;
+
+      for(l = 0; l < numberOfStates; l++)
+	{
+	  double *eev = &extEV[l * numberOfStates];
+	  x1px2 = uX1[k * numberOfStates + l]  * ump_x2[l];
+	  VECTOR_REGISTER x1px2v = VECTOR_SET_ONE(x1px2);
+
+	  for(j = 0; j < loopLength; j += VECTOR_WIDTH)
+	    {
+	      VECTOR_REGISTER vv = VECTOR_LOAD(&v[j]);
+	      VECTOR_REGISTER ee = VECTOR_LOAD(&eev[j]);
+
+	      vv = VECTOR_ADD(vv, VECTOR_MUL(x1px2v,ee));
+
+	      VECTOR_STORE(&v[j], vv);
+	    }
+
+	  for(;j < numberOfStates; j++)
+	    v[j] += x1px2 * eev[j];
+	}
+    }
+
+  return scaleEntry(stride, 0, x3, loopLength * gammaRates);
+}
+
+/* both children are given by likelihood vectors: inner vectors (x1Rate = numberOfStates) or the
+   tip vectors of POMO that are the same for all rates (x1Rate = 0), returns TRUE if the site was scaled */
+
+static inline boolean innerInnerSiteNSTATES(double *x1, const size_t x1Rate, double *x2, const size_t x2Rate, double *x3,
+				     double *extEV, double *left, double *right, const size_t numberOfStates, const size_t gammaRates)
+{
+  double
+    *v,
+    *vl,
     *vr;
-  
+
   size_t
-    i, 
-    j, 
-    l, 
+    j,
+    l,
+    k;
+
+  const size_t
+    loopLength = numberOfStates - (numberOfStates % VECTOR_WIDTH),
+    statesSquare = numberOfStates * numberOfStates,
+    stride = numberOfStates * gammaRates;
+
+  for(k = 0; k < gammaRates; k++)
+    {
+      vl = &(x1[x1Rate * k]);
+      vr = &(x2[x2Rate * k]);
+      v =  &(x3[numberOfStates * k]);
+
+      VECTOR_REGISTER zero =  VECTOR_SET_ZERO();
+
+      for(l = 0; l < loopLength; l += VECTOR_WIDTH)
+	VECTOR_STORE(&v[l], zero);
+
+      for(;l < numberOfStates; l++)
+	v[l] = 0.0;
+
+      for(l = 0; l < numberOfStates; l++)
+	{
+	  VECTOR_REGISTER al = VECTOR_SET_ZERO();
+	  VECTOR_REGISTER ar = VECTOR_SET_ZERO();
+
+	  double *ll   = &left[k * statesSquare + l * numberOfStates];
+	  double *rr   = &right[k * statesSquare + l * numberOfStates];
+	  double *EVEV = &extEV[numberOfStates * l];
+
+	  double
+	    sal = 0.0,
+	    sar = 0.0;
+
+	  for(j = 0; j < loopLength; j += VECTOR_WIDTH)
+	    {
+	      VECTOR_REGISTER lv  = VECTOR_LOAD(&ll[j]);
+	      VECTOR_REGISTER rv  = VECTOR_LOAD(&rr[j]);
+	      VECTOR_REGISTER vll = VECTOR_LOAD(&vl[j]);
+	      VECTOR_REGISTER vrr = VECTOR_LOAD(&vr[j]);
+
+	      al = VECTOR_ADD(al, VECTOR_MUL(vll, lv));
+	      ar = VECTOR_ADD(ar, VECTOR_MUL(vrr, rv));
+	    }
+
+	  //Hadd with broadcast!
+
+	  al = haddBroadCast(al);
+	  ar = haddBroadCast(ar);
+
+	  if(j < numberOfStates)
+	    {
+	      for(;j < numberOfStates; j++)
+		{
+		  sal += (ll[j] * vl[j]);
+		  sar += (rr[j] * vr[j]);
+		}
+
+	      al = VECTOR_ADD(al, VECTOR_SET_ONE(sal));
+	      ar = VECTOR_ADD(ar, VECTOR_SET_ONE(sar));
+	    }
+
+	  al = VECTOR_MUL(al, ar);
+
+	  for(j = 0; j < loopLength; j += VECTOR_WIDTH)
+	    {
+	      VECTOR_REGISTER vv  = VECTOR_LOAD(&v[j]);
+	      VECTOR_REGISTER EVV = VECTOR_LOAD(&EVEV[j]);
+
+	      vv = VECTOR_ADD(vv, VECTOR_MUL(al, EVV));
+
+	      VECTOR_STORE(&v[j], vv);
+	    }
+
+	  if(j < numberOfStates)
+	    {
+	      VECTOR_STORE_LEFT(&sal, al);
+	      for(;j < numberOfStates; j++)
+		v[j] += (sal * EVEV[j]);
+	    }
+	}
+    }
+
+  return scaleEntry(stride, 0, x3, loopLength * gammaRates);
+}
+
+/* With the memory saving option (x3_gap != NULL) the inner vectors only store the sites that are not
+   entirely undetermined below the node, the gap column holds the vector of the remaining ones, as in
+   newviewGTRGAMMA_GAPPED_SAVE(). The tips are stored for all sites. For tip vector indices the
+   undetermined character is the last one (numberOfAllCharacters - 1) */
+
+static void newviewGTRGAMMA_NSTATES(int tipCase,
+				    double *x1, double *x2, double *x3, double *extEV, double *tipVector,
+				    int *ex3, unsigned char *tipX1, unsigned char *tipX2,
+				    size_t n, double *left, double *right, int *wgt, int *scalerIncrement, const boolean useFastScaling, const size_t numberOfAllCharacters, const size_t numberOfStates,
+				    const size_t gammaRates,
+				    unsigned int *x1_gap, unsigned int *x2_gap, unsigned int *x3_gap,
+				    double *x1_gapColumn, double *x2_gapColumn, double *x3_gapColumn)
+{
+  double
+    *v,
+    *vl,
+    *vr,
+    *x1_ptr = x1,
+    *x2_ptr = x2,
+    *x3_ptr = x3;
+
+  size_t
+    i,
+    l,
     k;
 
   int
-    addScale = 0;
+    addScale = 0,
+    scaleGap = 0;
 
-  const size_t   
+  const size_t
     loopLength = numberOfStates - (numberOfStates % VECTOR_WIDTH), //or 18 for testing!
-    scalingLoopLength = loopLength * gammaRates,
-    statesSquare = numberOfStates * numberOfStates,
     stride = numberOfStates * gammaRates,
     umpLength = numberOfAllCharacters * numberOfStates * gammaRates;
 
@@ -6574,95 +7216,60 @@ static void newviewGTRGAMMA_NSTATES(int tipCase,
     {
     case TIP_TIP:
       {
-	double 
-	  umpX1[umpLength], 
-	  umpX2[umpLength];     
-
-	//printf("TT\n");
+	double
+	  umpX1[umpLength],
+	  umpX2[umpLength];
 
 	for(i = 0; i < numberOfAllCharacters; i++)
 	  {
-	    v = &(tipVector[numberOfStates * i]);	    
+	    v = &(tipVector[numberOfStates * i]);
 
 	    for(k = 0; k < stride; k++)
 	      {
 		double *ll =  &left[k * numberOfStates];
 		double *rr =  &right[k * numberOfStates];
-		
+
 		VECTOR_REGISTER umpX1v = VECTOR_SET_ZERO();
-		VECTOR_REGISTER umpX2v = VECTOR_SET_ZERO();	       			
+		VECTOR_REGISTER umpX2v = VECTOR_SET_ZERO();
 
 		for(l = 0; l < loopLength; l += VECTOR_WIDTH)
-		  {		   		    
+		  {
 		    VECTOR_REGISTER vv = VECTOR_LOAD(&v[l]);
-		    		   
+
 		    umpX1v = VECTOR_ADD(umpX1v, VECTOR_MUL(vv, VECTOR_LOAD(&ll[l])));
-		    umpX2v = VECTOR_ADD(umpX2v, VECTOR_MUL(vv, VECTOR_LOAD(&rr[l])));					
-		  }							
-		
+		    umpX2v = VECTOR_ADD(umpX2v, VECTOR_MUL(vv, VECTOR_LOAD(&rr[l])));
+		  }
+
 		umpX1[stride * i + k] = haddScalar(umpX1v);
 		umpX2[stride * i + k] = haddScalar(umpX2v);
-	
+
 		for(;l < numberOfStates; l++)
 		  {
-		    umpX1[stride * i + k] += v[l] * ll[l]; 
+		    umpX1[stride * i + k] += v[l] * ll[l];
 		    umpX2[stride * i + k] += v[l] * rr[l];
 		  }
-		
+
 	      }
-	  }       
+	  }
+
+	if(x3_gap)
+	  tipTipSiteNSTATES(&umpX1[stride * (numberOfAllCharacters - 1)], &umpX2[stride * (numberOfAllCharacters - 1)], x3_gapColumn,
+			    extEV, numberOfStates, gammaRates);
 
 	for(i = 0; i < n; i++)
 	  {
-	    uX1 = &umpX1[stride * tipX1[i]];
-	    uX2 = &umpX2[stride * tipX2[i]];
-
-	    for(j = 0; j < gammaRates; j++)
+	    if(!x3_gap || noGap(x3_gap, i))
 	      {
-		v = &x3[i * stride + j * numberOfStates];
-
-		VECTOR_REGISTER zero =  VECTOR_SET_ZERO();
-	       
-		for(k = 0; k < loopLength; k += VECTOR_WIDTH)		  		    	      
-		  VECTOR_STORE(&v[k], zero);
-	       
-		for(;k < numberOfStates; k++)
-		  v[k] = 0.0;
-	       
-		for(k = 0; k < numberOfStates; k++)
-		  { 
-		    double 
-		      *eev = &extEV[k * numberOfStates];
-		    
-		    x1px2 = uX1[j * numberOfStates + k] * uX2[j * numberOfStates + k];
-		    
-		    VECTOR_REGISTER 
-		      x1px2v = VECTOR_SET_ONE(x1px2);
-
-		    for(l = 0; l < loopLength; l += VECTOR_WIDTH)
-		      {
-		      	VECTOR_REGISTER vv = VECTOR_LOAD(&v[l]);
-			VECTOR_REGISTER ee = VECTOR_LOAD(&eev[l]);
-
-			vv = VECTOR_ADD(vv, VECTOR_MUL(x1px2v,ee));
-			
-			VECTOR_STORE(&v[l], vv);
-		      }
-
-		    for(;l < numberOfStates; l++)
-		      v[l] += x1px2 * eev[l];
-		  }
-	      }	   
+		tipTipSiteNSTATES(&umpX1[stride * tipX1[i]], &umpX2[stride * tipX2[i]], x3_ptr, extEV, numberOfStates, gammaRates);
+		x3_ptr += stride;
+	      }
 	  }
       }
       break;
     case TIP_INNER:
       {
-	double 
-	  umpX1[umpLength], 
-	  ump_x2[numberOfStates];
-
-	//printf("TI\n");
+	double
+	  umpX1[umpLength];
 
 	for(i = 0; i < numberOfAllCharacters; i++)
 	  {
@@ -6671,361 +7278,133 @@ static void newviewGTRGAMMA_NSTATES(int tipCase,
 	    for(k = 0; k < stride; k++)
 	      {
 		double *ll =  &left[k * numberOfStates];
-				
+
 		VECTOR_REGISTER umpX1v = VECTOR_SET_ZERO();
-		
+
 		for(l = 0; l < loopLength; l += VECTOR_WIDTH)
 		  {
 		    VECTOR_REGISTER vv = VECTOR_LOAD(&v[l]);
-		    umpX1v = VECTOR_ADD(umpX1v, VECTOR_MUL(vv, VECTOR_LOAD(&ll[l])));		    					
-		  }					
+		    umpX1v = VECTOR_ADD(umpX1v, VECTOR_MUL(vv, VECTOR_LOAD(&ll[l])));
+		  }
 
 		umpX1[stride * i + k] = haddScalar(umpX1v);
-		
-		for(;l < numberOfStates; l++)		  
-		  umpX1[stride * i + k] += v[l] * ll[l]; 	       
+
+		for(;l < numberOfStates; l++)
+		  umpX1[stride * i + k] += v[l] * ll[l];
 	      }
 	  }
 
+	if(x3_gap)
+	  scaleGap = tipInnerSiteNSTATES(&umpX1[stride * (numberOfAllCharacters - 1)], x2_gapColumn, x3_gapColumn, extEV, right,
+					 numberOfStates, gammaRates);
+
 	for (i = 0; i < n; i++)
 	  {
-	    uX1 = &umpX1[stride * tipX1[i]];
-
-	    for(k = 0; k < gammaRates; k++)
+	    if(x3_gap && isGap(x3_gap, i))
 	      {
-		v = &(x2[stride * i + k * numberOfStates]);
-	       
-		for(l = 0; l < numberOfStates; l++)
-		  {		   
-		    double *r =  &right[k * statesSquare + l * numberOfStates];
-		    VECTOR_REGISTER ump_x2v = VECTOR_SET_ZERO();	    
-		    
-		    for(j = 0; j < loopLength; j+= VECTOR_WIDTH)
-		      {
-			VECTOR_REGISTER vv = VECTOR_LOAD(&v[j]);
-			VECTOR_REGISTER rr = VECTOR_LOAD(&r[j]);
-			ump_x2v = VECTOR_ADD(ump_x2v, VECTOR_MUL(vv, rr));
-		      }
-		     
-		    ump_x2[l] = haddScalar(ump_x2v);
-
-		    for(;j < numberOfStates; j++)
-		      ump_x2[l] += v[j] * r[j];
+		if(scaleGap)
+		  {
+		    if(useFastScaling)
+		      addScale += wgt[i];
+		    else
+		      ex3[i] += 1;
+		  }
+	      }
+	    else
+	      {
+		if(x2_gap && isGap(x2_gap, i))
+		  vr = x2_gapColumn;
+		else
+		  {
+		    vr = x2_ptr;
+		    x2_ptr += stride;
 		  }
 
-		v = &(x3[stride * i + numberOfStates * k]);
-
-		VECTOR_REGISTER zero =  VECTOR_SET_ZERO();
-		
-		for(l = 0; l < loopLength; l += VECTOR_WIDTH)		  		    
-		  VECTOR_STORE(&v[l], zero);
-
-		for(;l < numberOfStates; l++)
-		  v[l] = 0.0;
-		  
-		for(l = 0; l < numberOfStates; l++)
+		if(tipInnerSiteNSTATES(&umpX1[stride * tipX1[i]], vr, x3_ptr, extEV, right, numberOfStates, gammaRates))
 		  {
-		    double *eev = &extEV[l * numberOfStates];
-		    x1px2 = uX1[k * numberOfStates + l]  * ump_x2[l];
-		    VECTOR_REGISTER x1px2v = VECTOR_SET_ONE(x1px2);
-		  
-		    for(j = 0; j < loopLength; j += VECTOR_WIDTH)
-		      {
-			VECTOR_REGISTER vv = VECTOR_LOAD(&v[j]);
-			VECTOR_REGISTER ee = VECTOR_LOAD(&eev[j]);
-			
-			vv = VECTOR_ADD(vv, VECTOR_MUL(x1px2v,ee));
-			
-			VECTOR_STORE(&v[j], vv);
-		      }		     		    
+		    if(useFastScaling)
+		      addScale += wgt[i];
+		    else
+		      ex3[i] += 1;
+		  }
 
-		    for(;j < numberOfStates; j++)
-		      v[j] += x1px2 * eev[j];
-		  }			
+		x3_ptr += stride;
 	      }
-	   	   
-	    if(scaleEntry(stride, i, x3, scalingLoopLength))
-	      addScale += wgt[i];		       	      	
 	  }
       }
       break;
-    case INNER_INNER:      	      
-      for (i = 0; i < n; i++)
-       {
-	 for(k = 0; k < gammaRates; k++)
-	   {
-	     vl = &(x1[stride * i + numberOfStates * k]);
-	     vr = &(x2[stride * i + numberOfStates * k]);
-	     v =  &(x3[stride * i + numberOfStates * k]);
-
-	     VECTOR_REGISTER zero =  VECTOR_SET_ZERO();
-	     
-	     for(l = 0; l < loopLength; l += VECTOR_WIDTH)		  		    
-	       VECTOR_STORE(&v[l], zero);
-
-	     for(;l < numberOfStates; l++)
-	       v[l] = 0.0;
-
-	     for(l = 0; l < numberOfStates; l++)
-	       {		 		 
-		 VECTOR_REGISTER al = VECTOR_SET_ZERO();
-		 VECTOR_REGISTER ar = VECTOR_SET_ZERO();		  
-		 
-		 double *ll   = &left[k * statesSquare + l * numberOfStates];
-		 double *rr   = &right[k * statesSquare + l * numberOfStates];
-		 double *EVEV = &extEV[numberOfStates * l];
-		 
-		 double 
-		   sal = 0.0,
-		   sar = 0.0;
-		 
-		 for(j = 0; j < loopLength; j += VECTOR_WIDTH)
-		   {
-		     VECTOR_REGISTER lv  = VECTOR_LOAD(&ll[j]);
-		     VECTOR_REGISTER rv  = VECTOR_LOAD(&rr[j]);
-		     VECTOR_REGISTER vll = VECTOR_LOAD(&vl[j]);
-		     VECTOR_REGISTER vrr = VECTOR_LOAD(&vr[j]);
-		     
-		     al = VECTOR_ADD(al, VECTOR_MUL(vll, lv));
-		     ar = VECTOR_ADD(ar, VECTOR_MUL(vrr, rv));
-		   }  		 
-		       
-		 //Hadd with broadcast!
-
-		 //al = _mm_hadd_pd(al, al);
-		 //ar = _mm_hadd_pd(ar, ar);
-
-		 al = haddBroadCast(al);
-		 ar = haddBroadCast(ar);
-		 
-		 
-		 if(j < numberOfStates)
-		   {
-		     for(;j < numberOfStates; j++)
-		       {
-			 sal += (ll[j] * vl[j]);
-			 sar += (rr[j] * vr[j]);
-		       }
-		     
-		     al = VECTOR_ADD(al, VECTOR_SET_ONE(sal));
-		     ar = VECTOR_ADD(ar, VECTOR_SET_ONE(sar));
-		   }
-		 
-		 al = VECTOR_MUL(al, ar);
-		 
-		 for(j = 0; j < loopLength; j += VECTOR_WIDTH)
-		   {
-		     VECTOR_REGISTER vv  = VECTOR_LOAD(&v[j]);
-		     VECTOR_REGISTER EVV = VECTOR_LOAD(&EVEV[j]);
-		     
-		     vv = VECTOR_ADD(vv, VECTOR_MUL(al, EVV));
-		     
-		     VECTOR_STORE(&v[j], vv);
-		   }	
-		 
-		 if(j < numberOfStates)
-		   {		       
-		     VECTOR_STORE_LEFT(&sal, al);
-		     for(;j < numberOfStates; j++)
-		       v[j] += (sal * EVEV[j]);
-		   }		   
-	       }
-		 
-	   }	   
-
-	 if(scaleEntry(stride, i, x3, scalingLoopLength))	   	    
-	   addScale += wgt[i];		  
-       }
-      break;
+    case INNER_INNER:
     case TIP_TIP_CLV:
-
-      //printf("TTC\n");      
-
-      for (i = 0; i < n; i++)
-	{
-	  for(k = 0; k < gammaRates; k++)
-	    {
-	      vl = &(x1[numberOfStates * i]);
-	      vr = &(x2[numberOfStates * i]);
-	      v =  &(x3[stride * i + numberOfStates * k]);
-	      
-	      VECTOR_REGISTER zero =  VECTOR_SET_ZERO();
-	      
-	      for(l = 0; l < loopLength; l += VECTOR_WIDTH)		  		    
-		VECTOR_STORE(&v[l], zero);
-	      
-	      for(;l < numberOfStates; l++)
-		v[l] = 0.0;
-	      
-	      for(l = 0; l < numberOfStates; l++)
-		{		 		 
-		  VECTOR_REGISTER al = VECTOR_SET_ZERO();
-		  VECTOR_REGISTER ar = VECTOR_SET_ZERO();		  
-		  
-		  double *ll   = &left[k * statesSquare + l * numberOfStates];
-		  double *rr   = &right[k * statesSquare + l * numberOfStates];
-		  double *EVEV = &extEV[numberOfStates * l];
-		  
-		  double 
-		    sal = 0.0,
-		    sar = 0.0;
-		  
-		  for(j = 0; j < loopLength; j += VECTOR_WIDTH)
-		    {
-		      VECTOR_REGISTER lv  = VECTOR_LOAD(&ll[j]);
-		      VECTOR_REGISTER rv  = VECTOR_LOAD(&rr[j]);
-		      VECTOR_REGISTER vll = VECTOR_LOAD(&vl[j]);
-		      VECTOR_REGISTER vrr = VECTOR_LOAD(&vr[j]);
-		      
-		      al = VECTOR_ADD(al, VECTOR_MUL(vll, lv));
-		      ar = VECTOR_ADD(ar, VECTOR_MUL(vrr, rv));		     
-		    }  		 
-		  
-		  //Hadd with broadcast!
-		  
-		  //al = _mm_hadd_pd(al, al);
-		  //ar = _mm_hadd_pd(ar, ar);
-		  
-		  al = haddBroadCast(al);
-		  ar = haddBroadCast(ar);
-		  
-		  
-		  if(j < numberOfStates)
-		    {
-		      for(;j < numberOfStates; j++)
-			{
-			  sal += (ll[j] * vl[j]);
-			  sar += (rr[j] * vr[j]);
-			}
-		      
-		      al = VECTOR_ADD(al, VECTOR_SET_ONE(sal));
-		      ar = VECTOR_ADD(ar, VECTOR_SET_ONE(sar));
-		    }
-		  
-		  al = VECTOR_MUL(al, ar);
-		  
-		  for(j = 0; j < loopLength; j += VECTOR_WIDTH)
-		    {
-		      VECTOR_REGISTER vv  = VECTOR_LOAD(&v[j]);
-		      VECTOR_REGISTER EVV = VECTOR_LOAD(&EVEV[j]);
-		      
-		      vv = VECTOR_ADD(vv, VECTOR_MUL(al, EVV));
-		      
-		      VECTOR_STORE(&v[j], vv);
-		    }	
-		  
-		  if(j < numberOfStates)
-		    {		       
-		      VECTOR_STORE_LEFT(&sal, al);
-		      for(;j < numberOfStates; j++)
-			v[j] += (sal * EVEV[j]);
-		    }		   
-		}
-	    }	  	  
-	  
-	  //mth todo need scaling here?
-	  if(scaleEntry(stride, i, x3, scalingLoopLength))
-	    addScale += wgt[i];		  	  
-	}         
-
-       
-  
-      break;
     case TIP_INNER_CLV:
-      
-      //printf("TIC\n");
-      
-      for (i = 0; i < n; i++)
-	{
-	  for(k = 0; k < gammaRates; k++)
-	    {
-	      vl = &(x1[numberOfStates * i]);
-	      vr = &(x2[stride * i + numberOfStates * k]);
-	      v =  &(x3[stride * i + numberOfStates * k]);
+      {
+	/* the tip vectors of POMO are the same for all rates */
 
-	     VECTOR_REGISTER zero =  VECTOR_SET_ZERO();
-	     
-	     for(l = 0; l < loopLength; l += VECTOR_WIDTH)		  		    
-	       VECTOR_STORE(&v[l], zero);
+	const size_t
+	  x1Rate = (tipCase == INNER_INNER) ? numberOfStates : 0,
+	  x2Rate = (tipCase == TIP_TIP_CLV) ? 0 : numberOfStates;
 
-	     for(;l < numberOfStates; l++)
-	       v[l] = 0.0;
+	if(x3_gap)
+	  scaleGap = innerInnerSiteNSTATES(x1_gapColumn, x1Rate, x2_gapColumn, x2Rate, x3_gapColumn, extEV, left, right,
+					   numberOfStates, gammaRates);
 
-	     for(l = 0; l < numberOfStates; l++)
-	       {		 		 
-		 VECTOR_REGISTER al = VECTOR_SET_ZERO();
-		 VECTOR_REGISTER ar = VECTOR_SET_ZERO();		  
-		 
-		 double *ll   = &left[k * statesSquare + l * numberOfStates];
-		 double *rr   = &right[k * statesSquare + l * numberOfStates];
-		 double *EVEV = &extEV[numberOfStates * l];
-		 
-		 double 
-		   sal = 0.0,
-		   sar = 0.0;
-		 
-		 for(j = 0; j < loopLength; j += VECTOR_WIDTH)
-		   {
-		     VECTOR_REGISTER lv  = VECTOR_LOAD(&ll[j]);
-		     VECTOR_REGISTER rv  = VECTOR_LOAD(&rr[j]);
-		     VECTOR_REGISTER vll = VECTOR_LOAD(&vl[j]);
-		     VECTOR_REGISTER vrr = VECTOR_LOAD(&vr[j]);
-		     
-		     al = VECTOR_ADD(al, VECTOR_MUL(vll, lv));
-		     ar = VECTOR_ADD(ar, VECTOR_MUL(vrr, rv));
-		   }  		 
-		       
-		 //Hadd with broadcast!
+	for (i = 0; i < n; i++)
+	  {
+	    if(x3_gap && isGap(x3_gap, i))
+	      {
+		if(scaleGap)
+		  {
+		    if(useFastScaling)
+		      addScale += wgt[i];
+		    else
+		      ex3[i] += 1;
+		  }
+	      }
+	    else
+	      {
+		if(x1Rate == 0)
+		  vl = &(x1[numberOfStates * i]);
+		else
+		  {
+		    if(x1_gap && isGap(x1_gap, i))
+		      vl = x1_gapColumn;
+		    else
+		      {
+			vl = x1_ptr;
+			x1_ptr += stride;
+		      }
+		  }
 
-		 //al = _mm_hadd_pd(al, al);
-		 //ar = _mm_hadd_pd(ar, ar);
+		if(x2Rate == 0)
+		  vr = &(x2[numberOfStates * i]);
+		else
+		  {
+		    if(x2_gap && isGap(x2_gap, i))
+		      vr = x2_gapColumn;
+		    else
+		      {
+			vr = x2_ptr;
+			x2_ptr += stride;
+		      }
+		  }
 
-		 al = haddBroadCast(al);
-		 ar = haddBroadCast(ar);
-		 		 
-		 if(j < numberOfStates)
-		   {
-		     for(;j < numberOfStates; j++)
-		       {
-			 sal += (ll[j] * vl[j]);
-			 sar += (rr[j] * vr[j]);
-		       }
-		     
-		     al = VECTOR_ADD(al, VECTOR_SET_ONE(sal));
-		     ar = VECTOR_ADD(ar, VECTOR_SET_ONE(sar));
-		   }
-		 
-		 al = VECTOR_MUL(al, ar);
-		 
-		 for(j = 0; j < loopLength; j += VECTOR_WIDTH)
-		   {
-		     VECTOR_REGISTER vv  = VECTOR_LOAD(&v[j]);
-		     VECTOR_REGISTER EVV = VECTOR_LOAD(&EVEV[j]);
-		     
-		     vv = VECTOR_ADD(vv, VECTOR_MUL(al, EVV));
-		     
-		     VECTOR_STORE(&v[j], vv);
-		   }	
-		 
-		 if(j < numberOfStates)
-		   {		       
-		     VECTOR_STORE_LEFT(&sal, al);
-		     for(;j < numberOfStates; j++)
-		       v[j] += (sal * EVEV[j]);
-		   }		   
-	       }
-		 
-	    }	   
+		if(innerInnerSiteNSTATES(vl, x1Rate, vr, x2Rate, x3_ptr, extEV, left, right, numberOfStates, gammaRates))
+		  {
+		    if(useFastScaling)
+		      addScale += wgt[i];
+		    else
+		      ex3[i] += 1;
+		  }
 
-	  if(scaleEntry(stride, i, x3, scalingLoopLength))
-	    addScale += wgt[i];	
-	}
+		x3_ptr += stride;
+	      }
+	  }
+      }
       break;
     default:
       assert(0);
     }
 
-  
+
   *scalerIncrement = addScale;
 }
 
@@ -64,6 +64,7 @@ extern checkPointState ckp;
 
 extern int processes;
 extern int processID;
+extern MPI_Comm comm;
 
 static void optParamGeneric(tree *tr, double modelEpsilon, linkageList *ll, int numberOfModels, int rateNumber, double lim_inf, double lim_sup, int whichParameterType);
 
@@ -2170,8 +2171,8 @@ static void getWeightsAndWeightedRates(const tree * const tr, int **weightPerPar
 	}
     }
   
-  MPI_Allreduce(MPI_IN_PLACE, weightPerPart, tr->NumberOfModels, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
-  MPI_Allreduce(MPI_IN_PLACE, weightedRates, tr->NumberOfModels, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD); 
+  MPI_Allreduce(MPI_IN_PLACE, weightPerPart, tr->NumberOfModels, MPI_INT, MPI_SUM, comm);
+  MPI_Allreduce(MPI_IN_PLACE, weightedRates, tr->NumberOfModels, MPI_DOUBLE, MPI_SUM, comm); 
 
   for( i = 0; i < tr->NumberOfModels; ++i)
     {
@@ -2461,14 +2462,14 @@ static void scatterProcessedRates(tree *tr, int *rateCategory)
       for(i = 0; i < tr->NumberOfModels; ++i)
 	numCatPerPart[i] = tr->partitionData[i].numberOfCategories; 
     }
-  MPI_Bcast(numCatPerPart, tr->NumberOfModels,  MPI_INT, 0,MPI_COMM_WORLD); 
+  MPI_Bcast(numCatPerPart, tr->NumberOfModels,  MPI_INT, 0,comm); 
   for(i = 0; i < tr->NumberOfModels; ++i)
     tr->partitionData[i].numberOfCategories = numCatPerPart[i]; 
   free(numCatPerPart); 
     
   /* for simplicity, broad cast all peSiteRates */
   for(i = 0; i < tr->NumberOfModels; ++i)
-    MPI_Bcast(tr->partitionData[i].perSiteRates, tr->maxCategories, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(tr->partitionData[i].perSiteRates, tr->maxCategories, MPI_DOUBLE, 0, comm);
 
 
   /* prepare for scattering */
@@ -3159,18 +3160,27 @@ static void checkTolerance(double l1, double l2)
     }
 }
 
+/* 
+   duration of the last iteration of modOpt(), with a time limit (--time-limit) the search 
+   stops the model optimization when the next iteration would not finish in time 
+*/
+static double 
+  modOptIterationTime = 0.0;
+
 //#define _DEBUG_MOD_OPT
 
 void modOpt(tree *tr, double likelihoodEpsilon, analdef *adef, int treeIteration)
 { 
   int 
     i, 
+    modOptIterations = 0,
     catOpt = 0,
     *unlinked = (int *)malloc(sizeof(int) * (size_t)tr->NumberOfModels);  
 
   double 
     inputLikelihood,
     currentLikelihood,
+    iterationStart,
     modelEpsilon = 0.0001;
   
   linkageList 
@@ -3235,6 +3245,14 @@ void modOpt(tree *tr, double likelihoodEpsilon, analdef *adef, int treeIteration
 
   do
     {    
+      if(adef->mode == BIG_RAPID_MODE && tr->timeLimit > 0.0 && timeLimitReached(tr, modOptIterationTime))
+	{
+	  printBothOpen("\nTime limit: stopping the model optimization after %d iterations\n", modOptIterations);
+	  break;
+	}
+
+      iterationStart = gettime();
+
       if(adef->mode == TREE_EVALUATION)
 	{
 	  ckp.state = MOD_OPT;
@@ -3252,7 +3270,9 @@ void modOpt(tree *tr, double likelihoodEpsilon, analdef *adef, int treeIteration
       printf("start: %f\n", currentLikelihood);
 #endif
       
+      startPhaseTimer(TIMER_MODOPT_RATES);
       optRatesGeneric(tr, modelEpsilon, rateList);
+      stopPhaseTimer(TIMER_MODOPT_RATES);
                         
       evaluateGeneric(tr, tr->start, TRUE);    
 
@@ -3262,7 +3282,9 @@ void modOpt(tree *tr, double likelihoodEpsilon, analdef *adef, int treeIteration
 
       autoProtein(tr);
 
-      treeEvaluate(tr, 0.0625);    
+      startPhaseTimer(TIMER_MODOPT_BRANCHES);
+      treeEvaluate(tr, 0.0625);
+      stopPhaseTimer(TIMER_MODOPT_BRANCHES);
       
 #ifdef _DEBUG_MOD_OPT
       evaluateGeneric(tr, tr->start, TRUE); 
@@ -3271,18 +3293,24 @@ void modOpt(tree *tr, double likelihoodEpsilon, analdef *adef, int treeIteration
 
       evaluateGeneric(tr, tr->start, TRUE);
       
+      startPhaseTimer(TIMER_MODOPT_FREQS);
       optBaseFreqs(tr, modelEpsilon, freqList);
+      stopPhaseTimer(TIMER_MODOPT_FREQS);
       
       evaluateGeneric(tr, tr->start, TRUE);
       
+      startPhaseTimer(TIMER_MODOPT_BRANCHES);
       treeEvaluate(tr, 0.0625);
+      stopPhaseTimer(TIMER_MODOPT_BRANCHES);
 
 #ifdef _DEBUG_MOD_OPT
       evaluateGeneric(tr, tr->start, TRUE); 
       printf("after optBaseFreqs 1 %f\n", tr->likelihood);
 #endif 
 
+      startPhaseTimer(TIMER_MODOPT_PHI);
       optPomoPhiGeneric(tr, modelEpsilon, phiList);
+      stopPhaseTimer(TIMER_MODOPT_PHI);
 
       evaluateGeneric(tr, tr->start, TRUE);
 
@@ -3291,14 +3319,18 @@ void modOpt(tree *tr, double likelihoodEpsilon, analdef *adef, int treeIteration
       switch(tr->rateHetModel)
 	{
 	case GAMMA:      	  	  
+	  startPhaseTimer(TIMER_MODOPT_ALPHAS);
 	  optAlphasGeneric(tr, modelEpsilon, alphaList); 
+	  stopPhaseTimer(TIMER_MODOPT_ALPHAS);
 	  
 	  evaluateGeneric(tr, tr->start, TRUE); 
 	 	 
 #ifdef _DEBUG_MOD_OPT	 
 	  printf("after alphas %f\n", tr->likelihood);
 #endif	  
-	  treeEvaluate(tr, 0.1);	  	 
+	  startPhaseTimer(TIMER_MODOPT_BRANCHES);
+	  treeEvaluate(tr, 0.1);
+	  stopPhaseTimer(TIMER_MODOPT_BRANCHES);
 
 #ifdef _DEBUG_MOD_OPT
 	  evaluateGeneric(tr, tr->start, TRUE); 
@@ -3310,7 +3342,9 @@ void modOpt(tree *tr, double likelihoodEpsilon, analdef *adef, int treeIteration
 	  if(catOpt < 3)
 	    {	      	     	     	     
 	      evaluateGeneric(tr, tr->start, TRUE);
-	      optimizeRateCategories(tr, tr->categories);	      	     	      	      	     
+	      startPhaseTimer(TIMER_MODOPT_CATS);
+	      optimizeRateCategories(tr, tr->categories);
+	      stopPhaseTimer(TIMER_MODOPT_CATS);	      	     	      	      	     
 
 #ifdef _DEBUG_MOD_OPT
 	      evaluateGeneric(tr, tr->start, TRUE); 
@@ -3336,6 +3370,9 @@ void modOpt(tree *tr, double likelihoodEpsilon, analdef *adef, int treeIteration
       */
       
       printAAmatrix(tr, fabs(currentLikelihood - tr->likelihood));            
+
+      modOptIterationTime = gettime() - iterationStart;
+      modOptIterations++;
     }
   while(fabs(currentLikelihood - tr->likelihood) > likelihoodEpsilon);  
   
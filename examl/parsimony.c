@@ -0,0 +1,547 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <mpi.h>
+
+#ifdef __SIM_SSE3
+#include <emmintrin.h>
+#endif
+
+#include "axml.h"
+
+
+extern int processID;
+extern MPI_Comm comm;
+extern const unsigned int mask32[32];
+
+
+/*
+   Bit-parallel Fitch parsimony over the sites assigned to this process,
+   used to pre-screen the SPR insertion positions of the fast (lazy) SPR phase.
+
+   For every partition and node we store one bit-plane per state, bit i of word w
+   of plane k is set if state k is in the Fitch set of site w * PCF + i.
+   The vectors at inner nodes are oriented by the xPars flags analogously to the
+   x flags of the likelihood vectors. Tip vectors are computed once from the tip
+   data, for POMO a state is in the set of a tip if it has a non-zero tip likelihood
+   (i.e., if it is compatible with the observed allele counts), for 64-state data
+   the tip holds the state itself or the undetermined character.
+*/
+
+/* the length of a bit-plane is padded to this many words, such that the SSE code needs no remainder loop */
+#ifdef __SIM_SSE3
+#define PARSIMONY_PADDING 4
+#else
+#define PARSIMONY_PADDING 1
+#endif
+
+/* scratch vectors for the vectors oriented towards the insertion branches, one per recursion level */
+static parsimonyNumber
+  **upVectors = (parsimonyNumber **)NULL;
+
+static int
+  upVectorsLength = 0;
+
+/* offsets of the partitions within a scratch vector and its total length */
+static size_t
+  *parsimonyOffset = (size_t *)NULL,
+  parsimonyTotalLength = 0;
+
+/* insertion positions of the current pruned subtree and their parsimony costs */
+static nodeptr
+  *candidateNode = (nodeptr *)NULL;
+
+static unsigned int
+  *candidateCost = (unsigned int *)NULL,
+  *candidateBuffer = (unsigned int *)NULL;
+
+static int
+  candidateCount = 0,
+  candidateCapacity = 0;
+
+/* statistics */
+static double
+  candidatesTotal = 0.0,
+  candidatesSelected = 0.0;
+
+
+static parsimonyNumber *getParsimonyVector(tree *tr, int model, int number)
+{
+  pInfo
+    *p = &(tr->partitionData[model]);
+
+  return &(p->parsVect[(size_t)number * (size_t)p->states * p->parsimonyLength]);
+}
+
+static void initializeTipParsimony(tree *tr, int model)
+{
+  pInfo
+    *p = &(tr->partitionData[model]);
+
+  size_t
+    states = (size_t)p->states,
+    length = p->parsimonyLength,
+    width = p->width,
+    i,
+    k;
+
+  int
+    j,
+    undetermined = getUndetermined(p->dataType);
+
+  const unsigned int
+    *bitVector = getBitVector(p->dataType);
+
+  for(j = 1; j <= tr->mxtips; j++)
+    {
+      parsimonyNumber
+	*v = getParsimonyVector(tr, model, j);
+
+      for(i = 0; i < width; i++)
+	{
+	  for(k = 0; k < states; k++)
+	    {
+	      boolean
+		isSet;
+
+	      if(isPomo(p->dataType))
+		isSet = (p->xTipCLV[j][i * states + k] > 0.0) ? TRUE : FALSE;
+	      else
+		{
+		  /* there is no bit vector for 64-state data, the tips store the state or the undetermined character */
+		  if(bitVector)
+		    isSet = (bitVector[p->yVector[j][i]] & mask32[k]) ? TRUE : FALSE;
+		  else
+		    isSet = ((size_t)p->yVector[j][i] == k || p->yVector[j][i] == undetermined) ? TRUE : FALSE;
+		}
+
+	      if(isSet)
+		v[k * length + i / PCF] |= mask32[i % PCF];
+	    }
+	}
+
+      /* the padding sites are undetermined, such that they never require a step */
+
+      for(i = width; i < length * PCF; i++)
+	for(k = 0; k < states; k++)
+	  v[k * length + i / PCF] |= mask32[i % PCF];
+    }
+}
+
+/* Fitch operation: dst = left & right for sites where the intersection is not empty, else left | right */
+
+static void fitch(parsimonyNumber *left, parsimonyNumber *right, parsimonyNumber *dst, size_t states, size_t length)
+{
+  size_t
+    i,
+    k;
+
+#ifdef __SIM_SSE3
+  for(i = 0; i < length; i += 4)
+    {
+      __m128i
+	any = _mm_setzero_si128();
+
+      for(k = 0; k < states; k++)
+	{
+	  __m128i
+	    t = _mm_and_si128(_mm_load_si128((__m128i *)&left[k * length + i]), _mm_load_si128((__m128i *)&right[k * length + i]));
+
+	  _mm_store_si128((__m128i *)&dst[k * length + i], t);
+	  any = _mm_or_si128(any, t);
+	}
+
+      for(k = 0; k < states; k++)
+	{
+	  __m128i
+	    u = _mm_or_si128(_mm_load_si128((__m128i *)&left[k * length + i]), _mm_load_si128((__m128i *)&right[k * length + i]));
+
+	  _mm_store_si128((__m128i *)&dst[k * length + i], _mm_or_si128(_mm_load_si128((__m128i *)&dst[k * length + i]), _mm_andnot_si128(any, u)));
+	}
+    }
+#else
+  for(i = 0; i < length; i++)
+    {
+      parsimonyNumber
+	any = 0;
+
+      for(k = 0; k < states; k++)
+	{
+	  dst[k * length + i] = left[k * length + i] & right[k * length + i];
+	  any |= dst[k * length + i];
+	}
+
+      for(k = 0; k < states; k++)
+	dst[k * length + i] |= ~any & (left[k * length + i] | right[k * length + i]);
+    }
+#endif
+}
+
+/* weighted number of sites that require an additional step, when subtree s is inserted into the branch between a and b.
+   The steps are weighted by the pattern weights, such that a bootstrap replicate (-b) is only ranked on the patterns 
+   it contains. The padding sites never require a step */
+
+static unsigned int insertionCost(parsimonyNumber *a, parsimonyNumber *b, parsimonyNumber *s, const int *wgt, size_t states, size_t length)
+{
+  size_t
+    i,
+    k;
+
+  unsigned int
+    cost = 0;
+
+  for(i = 0; i < length; i++)
+    {
+      parsimonyNumber
+	anyAB = 0,
+	anyS = 0;
+
+      for(k = 0; k < states; k++)
+	anyAB |= a[k * length + i] & b[k * length + i];
+
+      for(k = 0; k < states; k++)
+	{
+	  parsimonyNumber
+	    t = (a[k * length + i] & b[k * length + i]) | (~anyAB & (a[k * length + i] | b[k * length + i]));
+
+	  anyS |= t & s[k * length + i];
+	}
+
+      anyS = ~anyS;
+
+      while(anyS)
+	{
+	  cost += (unsigned int)wgt[i * PCF + (size_t)__builtin_ctz(anyS)];
+	  anyS &= anyS - 1;
+	}
+    }
+
+  return cost;
+}
+
+static void getxPars(nodeptr p)
+{
+  p->xPars = 1;
+  p->next->xPars = 0;
+  p->next->next->xPars = 0;
+}
+
+/* makes sure that the vector at p is oriented towards p->back */
+
+static void newviewParsimony(tree *tr, nodeptr p)
+{
+  if(isTip(p->number, tr->mxtips) || p->xPars)
+    return;
+
+  {
+    nodeptr
+      q = p->next->back,
+      r = p->next->next->back;
+
+    int
+      model;
+
+    newviewParsimony(tr, q);
+    newviewParsimony(tr, r);
+
+    for(model = 0; model < tr->NumberOfModels; model++)
+      fitch(getParsimonyVector(tr, model, q->number), getParsimonyVector(tr, model, r->number), getParsimonyVector(tr, model, p->number),
+	    (size_t)tr->partitionData[model].states, tr->partitionData[model].parsimonyLength);
+
+    getxPars(p);
+  }
+}
+
+static parsimonyNumber *getUpVector(int depth)
+{
+  if(depth >= upVectorsLength)
+    {
+      int
+	i,
+	newLength = 2 * depth + 2;
+
+      upVectors = (parsimonyNumber **)realloc(upVectors, (size_t)newLength * sizeof(parsimonyNumber *));
+
+      for(i = upVectorsLength; i < newLength; i++)
+	upVectors[i] = (parsimonyNumber *)malloc_aligned(parsimonyTotalLength * sizeof(parsimonyNumber));
+
+      upVectorsLength = newLength;
+    }
+
+  return upVectors[depth];
+}
+
+/* up = Fitch(vector of the side towards the pruning point, vector of the sibling) */
+
+static void combineUp(tree *tr, parsimonyNumber *upParent, boolean parentIsScratch, int parentNumber, nodeptr sibling, parsimonyNumber *up)
+{
+  int
+    model;
+
+  newviewParsimony(tr, sibling);
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      parsimonyNumber
+	*parent = parentIsScratch ? &upParent[parsimonyOffset[model]] : getParsimonyVector(tr, model, parentNumber);
+
+      fitch(parent, getParsimonyVector(tr, model, sibling->number), &up[parsimonyOffset[model]],
+	    (size_t)tr->partitionData[model].states, tr->partitionData[model].parsimonyLength);
+    }
+}
+
+static void enumerateInsertions(tree *tr, nodeptr s, nodeptr q, parsimonyNumber *up, int depth, int mintrav, int maxtrav);
+
+/* visits the two branches below node element e (e->back leads to the pruning point),
+   up is the vector of the side of e->back oriented towards e, or NULL if that is a
+   vector stored at node e->back */
+
+static void descendInsertions(tree *tr, nodeptr s, nodeptr e, parsimonyNumber *up, int depth, int mintrav, int maxtrav)
+{
+  nodeptr
+    a = e->next->back,
+    b = e->next->next->back;
+
+  parsimonyNumber
+    *buffer = getUpVector(depth);
+
+  combineUp(tr, up, (up != (parsimonyNumber *)NULL), e->back->number, b, buffer);
+  enumerateInsertions(tr, s, a, buffer, depth + 1, mintrav, maxtrav);
+
+  combineUp(tr, up, (up != (parsimonyNumber *)NULL), e->back->number, a, buffer);
+  enumerateInsertions(tr, s, b, buffer, depth + 1, mintrav, maxtrav);
+}
+
+/* same recursion as addTraverseBIG(): scores the insertion of s into the branch (q, q->back) */
+
+static void enumerateInsertions(tree *tr, nodeptr s, nodeptr q, parsimonyNumber *up, int depth, int mintrav, int maxtrav)
+{
+  if(--mintrav <= 0)
+    {
+      int
+	model;
+
+      unsigned int
+	cost = 0;
+
+      newviewParsimony(tr, q);
+
+      for(model = 0; model < tr->NumberOfModels; model++)
+	cost += insertionCost(getParsimonyVector(tr, model, q->number), &up[parsimonyOffset[model]], getParsimonyVector(tr, model, s->number),
+			      tr->partitionData[model].wgt, (size_t)tr->partitionData[model].states, tr->partitionData[model].parsimonyLength);
+
+      if(candidateCount == candidateCapacity)
+	{
+	  candidateCapacity = 2 * candidateCapacity + 64;
+	  candidateNode   = (nodeptr *)realloc(candidateNode, (size_t)candidateCapacity * sizeof(nodeptr));
+	  candidateCost   = (unsigned int *)realloc(candidateCost, (size_t)candidateCapacity * sizeof(unsigned int));
+	  candidateBuffer = (unsigned int *)realloc(candidateBuffer, (size_t)candidateCapacity * sizeof(unsigned int));
+	}
+
+      candidateNode[candidateCount] = q;
+      candidateCost[candidateCount] = cost;
+      candidateCount++;
+    }
+
+  if((!isTip(q->number, tr->mxtips)) && (--maxtrav > 0))
+    {
+      /* the up vector of q is the scratch vector of our caller */
+      descendInsertions(tr, s, q, up, depth, mintrav, maxtrav);
+    }
+}
+
+static int costCompare(const void *a, const void *b)
+{
+  unsigned int
+    x = *((const unsigned int *)a),
+    y = *((const unsigned int *)b);
+
+  return (x > y) - (x < y);
+}
+
+
+/**
+    Computes the parsimony cost of all insertion positions that
+    addTraverseBIG() will visit for the subtree p->back, which has
+    been pruned from the branch p1 -- p2, and marks the best
+    tr->prescreenFraction of them in tr->insertionSelected. Only the
+    marked positions are subsequently scored by ML. The weighted costs
+    are summed over all processes.
+ */
+void prescreenInsertions(tree *tr, nodeptr p, nodeptr p1, nodeptr p2, int mintrav, int maxtrav)
+{
+  nodeptr
+    s = p->back;
+
+  int
+    i,
+    keep;
+
+  unsigned int
+    threshold;
+
+  candidateCount = 0;
+
+  newviewParsimony(tr, s);
+
+  /* p1 and p2 are directly connected now, their vectors towards each other
+     do not contain the pruned subtree */
+
+  if(!isTip(p1->number, tr->mxtips))
+    {
+      newviewParsimony(tr, p1->back);
+      descendInsertions(tr, s, p1, (parsimonyNumber *)NULL, 0, mintrav, maxtrav);
+    }
+
+  if(!isTip(p2->number, tr->mxtips))
+    {
+      newviewParsimony(tr, p2->back);
+      descendInsertions(tr, s, p2, (parsimonyNumber *)NULL, 0, mintrav, maxtrav);
+    }
+
+  if(candidateCount == 0)
+    return;
+
+  MPI_Allreduce(candidateCost, candidateBuffer, candidateCount, MPI_UNSIGNED, MPI_SUM, comm);
+  memcpy(candidateCost, candidateBuffer, (size_t)candidateCount * sizeof(unsigned int));
+
+  qsort(candidateBuffer, (size_t)candidateCount, sizeof(unsigned int), costCompare);
+
+  keep = (int)ceil(tr->prescreenFraction * (double)candidateCount);
+  if(keep < 1)
+    keep = 1;
+  if(keep > candidateCount)
+    keep = candidateCount;
+
+  /* ties are kept as well */
+  threshold = candidateBuffer[keep - 1];
+
+  for(i = 0; i < candidateCount; i++)
+    {
+      tr->insertionSelected[candidateNode[i]->number] = (candidateCost[i] <= threshold) ? 1 : 0;
+
+      if(candidateCost[i] <= threshold)
+	candidatesSelected += 1.0;
+    }
+
+  candidatesTotal += (double)candidateCount;
+}
+
+/* all inner vectors need to be re-computed, e.g., after a different tree has been restored */
+
+void resetParsimonyOrientation(tree *tr)
+{
+  int
+    i;
+
+  for(i = tr->mxtips + 1; i < 2 * tr->mxtips; i++)
+    {
+      nodeptr
+	p = tr->nodep[i];
+
+      p->xPars = 0;
+      p->next->xPars = 0;
+      p->next->next->xPars = 0;
+    }
+}
+
+static void invalidateParsimonySubtree(tree *tr, nodeptr e)
+{
+  if(isTip(e->number, tr->mxtips))
+    return;
+
+  /* unless the vector is oriented towards the modified branch, it contains it */
+
+  if(!e->xPars)
+    {
+      e->next->xPars = 0;
+      e->next->next->xPars = 0;
+    }
+
+  invalidateParsimonySubtree(tr, e->next->back);
+  invalidateParsimonySubtree(tr, e->next->next->back);
+}
+
+/**
+    the subtrees at the branch (p, p->back) have been modified, hence
+    we need to invalidate the vectors of all nodes whose subtree
+    contains this branch
+ */
+void invalidateParsimonyBranch(tree *tr, nodeptr p)
+{
+  invalidateParsimonySubtree(tr, p);
+  invalidateParsimonySubtree(tr, p->back);
+}
+
+void allocateParsimonyDataStructures(tree *tr)
+{
+  int
+    model;
+
+  parsimonyOffset = (size_t *)malloc((size_t)tr->NumberOfModels * sizeof(size_t));
+  parsimonyTotalLength = 0;
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      pInfo
+	*p = &(tr->partitionData[model]);
+
+      p->parsimonyLength = (p->width + PCF - 1) / PCF;
+      p->parsimonyLength = ((p->parsimonyLength + PARSIMONY_PADDING - 1) / PARSIMONY_PADDING) * PARSIMONY_PADDING;
+      if(p->parsimonyLength == 0)
+	p->parsimonyLength = PARSIMONY_PADDING;
+
+      p->parsVect = (parsimonyNumber *)malloc_aligned(2 * (size_t)tr->mxtips * (size_t)p->states * p->parsimonyLength * sizeof(parsimonyNumber));
+      memset(p->parsVect, 0, 2 * (size_t)tr->mxtips * (size_t)p->states * p->parsimonyLength * sizeof(parsimonyNumber));
+
+      parsimonyOffset[model] = parsimonyTotalLength;
+      parsimonyTotalLength += (size_t)p->states * p->parsimonyLength;
+
+      initializeTipParsimony(tr, model);
+    }
+
+  tr->insertionSelected = (unsigned char *)calloc(2 * (size_t)tr->mxtips, sizeof(unsigned char));
+
+  resetParsimonyOrientation(tr);
+}
+
+void freeParsimonyDataStructures(tree *tr)
+{
+  int
+    i,
+    model;
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      free(tr->partitionData[model].parsVect);
+      tr->partitionData[model].parsVect = (parsimonyNumber *)NULL;
+    }
+
+  for(i = 0; i < upVectorsLength; i++)
+    free(upVectors[i]);
+  free(upVectors);
+  upVectors = (parsimonyNumber **)NULL;
+  upVectorsLength = 0;
+
+  free(parsimonyOffset);
+  parsimonyOffset = (size_t *)NULL;
+
+  free(candidateNode);
+  free(candidateCost);
+  free(candidateBuffer);
+  candidateNode = (nodeptr *)NULL;
+  candidateCost = candidateBuffer = (unsigned int *)NULL;
+  candidateCount = candidateCapacity = 0;
+
+  free(tr->insertionSelected);
+  tr->insertionSelected = (unsigned char *)NULL;
+}
+
+void printParsimonyPrescreenStatistics(void)
+{
+  if(candidatesTotal > 0.0)
+    printBothOpen("\nParsimony pre-screening: %.0f of %.0f insertion positions (%f%%) scored by ML\n",
+		  candidatesSelected, candidatesTotal, 100.0 * candidatesSelected / candidatesTotal);
+}
@@ -7,7 +7,78 @@
 extern int processID; 
 
 
-void initializePartitionAssignment( PartitionAssignment **pAssPtr, pInfo **partitions, int numPart, int numProc)
+/* 
+   Simple cost model for the likelihood kernels. 
+
+   For an inner-inner node the work per site and rate category is
+   dominated by the two matrix-vector products with the P matrices,
+   i.e., it grows with states^2. Nodes with a tip child are cheaper for
+   all data types that look up precomputed tip vectors (we assume
+   roughly half of the traversal entries involve a tip). POMO tips are
+   stored as CLVs, hence tip entries cost as much as inner ones. 
+
+   The per-type factors were derived from the newview kernels of
+   "examl-AVX-bench -m GAMMA -s 5000" (see kernelBench.c): the
+   efficiency is the INNER_INNER time per site divided by states^2 and
+   normalized to DNA, the tip cost is the TIP_INNER time per site
+   divided by the INNER_INNER one. The secondary structure and 64-state
+   generic types can not be benchmarked and use the factors of the
+   32-state generic kernel. Please re-measure them if the kernels
+   change substantially.
+*/ 
+
+#define TIP_ENTRY_SHARE 0.5
+
+static double kernelEfficiency(int dataType)
+{
+  switch(dataType)
+    {
+    case BINARY_DATA: 
+      return 1.40;		/* binary kernels waste most of the vector width */
+    case DNA_DATA: 
+      return 1.00; 
+    case AA_DATA: 
+      return 0.46; 
+    case POMO_16:
+      return 0.67;
+    case POMO_64: 
+      return 0.60;
+    default:
+      return 0.66;		/* generic N-state kernels */
+    }
+}
+
+static double tipEntryCost(int dataType)
+{
+  switch(dataType)
+    {
+    case BINARY_DATA: 
+      return 1.00;
+    case DNA_DATA: 
+      return 0.52; 
+    case AA_DATA: 
+      return 0.80; 
+    default:
+      return 0.68;
+    }
+}
+
+double estimateSiteCost(int dataType, int states, int rateHetModel)
+{
+  double 
+    rates = (double)discreteRateCategories(rateHetModel),
+    inner = (double)states * (double)states * rates,
+    tipFactor = 1.0; 
+
+  /* POMO tips are full conditional likelihood vectors */
+  if(!isPomo(dataType))
+    tipFactor = (1.0 - TIP_ENTRY_SHARE) + TIP_ENTRY_SHARE * tipEntryCost(dataType); 
+
+  return inner * tipFactor * kernelEfficiency(dataType); 
+}
+
+
+void initializePartitionAssignment( PartitionAssignment **pAssPtr, pInfo **partitions, int numPart, int numProc, int rateHetModel)
 {
   int 
     i; 
@@ -21,6 +92,7 @@ void initializePartitionAssignment( PartitionAssignment **pAssPtr, pInfo **parti
 
   pAss->numProc = numProc; 
   pAss->numPartitions = numPart; 
+  pAss->rateHetModel = rateHetModel; 
 
   pAss->partitions = (Partition *)calloc((size_t)pAss->numPartitions, sizeof(Partition)); 
   
@@ -31,10 +103,13 @@ void initializePartitionAssignment( PartitionAssignment **pAssPtr, pInfo **parti
       p->id = i; 
       p->width = partitions[i]->upper - partitions[i]->lower;
       p->type = partitions[i]->states;
+      p->dataType = partitions[i]->dataType;
+      p->cost = estimateSiteCost(p->dataType, p->type, rateHetModel); 
     }
   
   pAss->assignPerProc = (Assignment **)calloc((size_t)pAss->numProc , sizeof(Assignment*)); 
   pAss->numAssignPerProc = (int *)calloc((size_t)pAss->numProc, sizeof(int)); 
+  pAss->workPerProc = (double *)calloc((size_t)pAss->numProc, sizeof(double)); 
 }
 
 
@@ -47,6 +122,8 @@ void deletePartitionAssignment(PartitionAssignment *pAss)
   for(i = 0; i < pAss->numProc; ++i)
     free(pAss->assignPerProc[i]);
   free(pAss->assignPerProc); 
+  free(pAss->numAssignPerProc); 
+  free(pAss->workPerProc); 
   free(pAss);
 }
 
@@ -93,6 +170,7 @@ static void assignPartitionPartial(PartitionAssignment *pa, Partition* p, int pr
   a->partId = p->id; 
   a->width = numElem; 
   sizeAssigned[procId] += numElem; 
+  pa->workPerProc[procId] += (double)numElem * p->cost; 
 }
 
 
@@ -165,10 +243,35 @@ static int popAndYield(int **procsHighIter, int *procsHighStart, int **procsLowI
 
 
 
+ /** 
+    The processes that are visited first in assignThesePartitions
+    receive the larger share (cap instead of cap - 1) and fill
+    up first. We thus visit processes in order of increasing work that
+    has already been assigned to them for other data types.
+ */ 
+static double *workForSort = (double *)NULL; 
+
+static int procSort(const void *a, const void *b)
+{
+  int 
+    pa = *((const int*)a),
+    pb = *((const int*)b);
+
+  if(workForSort[pa] < workForSort[pb])
+    return -1; 
+  if(workForSort[pa] > workForSort[pb])
+    return 1; 
+  
+  return pa - pb; 
+}
+
+
 static void assignThesePartitions(PartitionAssignment* pa, Partition *partitions, int numCur)
 {
   int
+    k,
     proc, 
+    *procOrder = (int *)NULL,	/* processes sorted by the work they already got */
     remainder,			/* number of processes that receive 1 character less than other s */
     i,
     numFull = 0,		/* number of processes that cannot take any more   */
@@ -220,6 +323,13 @@ static void assignThesePartitions(PartitionAssignment* pa, Partition *partitions
   numAssigned = (int *)calloc((size_t)pa->numProc, sizeof(int));
   
   sizeAssigned = (size_t *)calloc((size_t)pa->numProc, sizeof(size_t)); 
+
+  procOrder = (int *)calloc((size_t)pa->numProc, sizeof(int)); 
+  for(proc = 0; proc < pa->numProc; ++proc)
+    procOrder[proc] = proc; 
+  workForSort = pa->workPerProc; 
+  qsort(procOrder, (size_t)pa->numProc, sizeof(int), procSort);
+  workForSort = (double *)NULL; 
   
   /* phase 2: initial distribution of full partitions to procesess. We
      distribute full partitions until for the first time, we cannot
@@ -227,8 +337,10 @@ static void assignThesePartitions(PartitionAssignment* pa, Partition *partitions
      the number of characters we want to assign to this process */
   while(iterate)
     {           
-      for(proc = 0; proc < pa->numProc;++proc)
+      for(k = 0; k < pa->numProc; ++k)
 	{
+	  proc = procOrder[k]; 
+
 	  if(partIter < partEnd && sizeAssigned[proc] + partIter->width <= cap)
 	    {
 	      assignPartitionFull(pa, partIter, proc, numAssigned, sizeAssigned); 
@@ -272,8 +384,11 @@ static void assignThesePartitions(PartitionAssignment* pa, Partition *partitions
 
   numFull = 0; 
   
-  for(proc = 0; proc < pa->numProc; ++proc)
+  /* insert in reverse order, such that the least loaded processes are on top of the stacks */
+  for(k = pa->numProc - 1; k >= 0; --k)
     {
+      proc = procOrder[k]; 
+
       if(sizeAssigned[proc] < cap)
  	{
  	  if(numAssigned[proc] == numLow)
@@ -399,13 +514,56 @@ static void assignThesePartitions(PartitionAssignment* pa, Partition *partitions
   
   free(numAssigned); 
   free(sizeAssigned); 
+  free(procOrder); 
+  free(procsLowStart); 
+  free(procsHighStart); 
 }
 
+/* 
+   sorts the types (numbers of states) by decreasing per-site cost, a
+   type costs as much as its most expensive partition
+*/ 
+static void sortTypes(PartitionAssignment *pa, int *types, int numTypes)
+{
+  int 
+    i,
+    j; 
+
+  double
+    *typeCost = (double *)calloc((size_t)numTypes, sizeof(double)); 
+
+  for(j = 0; j < numTypes; ++j)
+    for(i = 0; i < pa->numPartitions; ++i)
+      if(pa->partitions[i].type == types[j] && pa->partitions[i].cost > typeCost[j])
+	typeCost[j] = pa->partitions[i].cost; 
+
+  for(j = 1; j < numTypes; ++j)
+    for(i = j; i > 0 && typeCost[i - 1] < typeCost[i]; --i)
+      {
+	int 
+	  t = types[i]; 
+
+	double 
+	  c = typeCost[i]; 
+
+	types[i] = types[i - 1]; 
+	types[i - 1] = t; 
+	typeCost[i] = typeCost[i - 1]; 
+	typeCost[i - 1] = c; 
+      }
+
+  free(typeCost); 
+}
+
+
 /** 
-    Assigns all partitions. Notice that for each data type (currently
-    only AA and DNA), we execute the algorithm separately. Thus, in
-    the worst case imbalances for AA and DNA could hit the same
-    processes (but this is probably not worth bothering). 
+    Assigns all partitions. Notice that for each data type, we execute
+    the algorithm separately, since this balances the number of sites,
+    and hence the work, within a type. The types are handled in order of
+    decreasing per-site cost and for each type the processes that have
+    received the least estimated work so far are served first. Thus,
+    the rounding imbalances of the individual types do not accumulate
+    on the same processes.
  */ 
 void assign(PartitionAssignment *pa)
 {
@@ -424,6 +582,8 @@ void assign(PartitionAssignment *pa)
   int
     types[NUMBER_OF_TYPES] = { 2, 4, 16, 20, 64};
 
+  sortTypes(pa, types, NUMBER_OF_TYPES); 
+
   for(j = 0; j < NUMBER_OF_TYPES; ++j)
     {
       size_t 
@@ -466,6 +626,107 @@ void assign(PartitionAssignment *pa)
 
 
 
+/** 
+    Assigns all partitions such that each process obtains a fraction
+    of the sites of each data type that is proportional to its
+    share. The sites of a type are cut into consecutive chunks in order
+    of partition ids, hence a process obtains at most one contiguous
+    slice per partition (as required by readMyData()). This is used for
+    re-balancing, when the per-process speed has been measured and is
+    not uniform.
+ */ 
+void assignProportional(PartitionAssignment *pa, double *share)
+{
+  int 
+    partitionsHandled = 0,
+    curType,
+    i, 
+    j,
+    k,
+    *numAssigned = (int *)calloc((size_t)pa->numProc, sizeof(int)); 
+
+  int
+    types[NUMBER_OF_TYPES] = { 2, 4, 16, 20, 64};
+
+  double 
+    shareSum = 0.0; 
+
+  size_t
+    *bounds = (size_t *)calloc((size_t)pa->numProc + 1, sizeof(size_t)),
+    *sizeAssigned = (size_t *)calloc((size_t)pa->numProc, sizeof(size_t)); 
+
+  for(k = 0; k < pa->numProc; ++k)
+    {
+      assert(share[k] > 0.0); 
+      shareSum += share[k]; 
+    }
+
+  for(j = 0; j < NUMBER_OF_TYPES; ++j)
+    {
+      size_t 
+	pos = 0,
+	total = 0; 
+
+      double 
+	acc = 0.0; 
+
+      curType = types[j]; 
+
+      for(i = 0; i < pa->numPartitions; ++i)
+	if(pa->partitions[i].type == curType)
+	  total += pa->partitions[i].width; 
+
+      if(total == 0)
+	continue; 
+
+      /* bounds[k] is the first site of this type assigned to process k */
+      bounds[0] = 0; 
+      for(k = 1; k < pa->numProc; ++k)
+	{
+	  acc += share[k - 1]; 
+	  bounds[k] = (size_t)floor((double)total * acc / shareSum + 0.5); 
+	  if(bounds[k] > total)
+	    bounds[k] = total; 
+	}
+      bounds[pa->numProc] = total; 
+
+      for(i = 0; i < pa->numPartitions; ++i)
+	{
+	  Partition 
+	    *p = pa->partitions + i; 
+
+	  size_t 
+	    start = pos,
+	    end = pos + p->width; 
+
+	  if(p->type != curType)
+	    continue; 
+
+	  for(k = 0; k < pa->numProc; ++k)
+	    {
+	      size_t 
+		lo = (bounds[k] > start) ? bounds[k] : start,
+		hi = (bounds[k + 1] < end) ? bounds[k + 1] : end; 
+
+	      if(lo < hi)
+		assignPartitionPartial(pa, p, k, numAssigned, sizeAssigned, lo - start, hi - lo); 
+	    }
+
+	  pos = end; 
+	  ++partitionsHandled; 
+	}
+
+      assert(pos == total); 
+    }
+
+  assert(partitionsHandled == pa->numPartitions); 
+
+  free(numAssigned); 
+  free(sizeAssigned); 
+  free(bounds); 
+}
+
+
 void printAssignment(Assignment a, int procid)
 {
   printf("p: %d\t(%lu,%lu) -> proc %d\n", a.partId, a.offset, a.width , procid); 
@@ -507,9 +768,40 @@ void printLoad(PartitionAssignment *pa)
 	}
     }
 
-  printf("#proc\t#part\t#sites\n"); 
-  for( i = 0; i < pa->numProc ; ++i)
-    printf("%d\t%d\t%lu\n", i, numsPerProc[i], sitesPerProc[i]); 
+  printf("cost model (estimated work per site):\n"); 
+  for(i = 0; i < pa->numPartitions; ++i)
+    {
+      boolean 
+	seen = FALSE; 
+      
+      for(j = 0; j < i; ++j)
+	if(pa->partitions[j].dataType == pa->partitions[i].dataType)
+	  seen = TRUE; 
+
+      if(!seen)
+	printf("\t%d states%s:\t%.1f\n", pa->partitions[i].type, isPomo(pa->partitions[i].dataType) ? " (POMO)" : "", pa->partitions[i].cost); 
+    }
+  printf("\n"); 
+
+  {
+    double 
+      maxWork = 0.0, 
+      avgWork = 0.0; 
+
+    printf("#proc\t#part\t#sites\t#work\n"); 
+    for( i = 0; i < pa->numProc ; ++i)
+      {
+	printf("%d\t%d\t%lu\t%.0f\n", i, numsPerProc[i], sitesPerProc[i], pa->workPerProc[i]); 
+	avgWork += pa->workPerProc[i]; 
+	if(pa->workPerProc[i] > maxWork)
+	  maxWork = pa->workPerProc[i]; 
+      }
+    
+    avgWork /= (double)pa->numProc; 
+
+    if(avgWork > 0.0)
+      printf("estimated load imbalance (max/avg work): %f\n", maxWork / avgWork); 
+  }
 
   free(numsPerProc);
   free(sitesPerProc);
@@ -19,6 +19,8 @@ typedef struct
   int id; 
   size_t width; 
   int type;
+  int dataType;
+  double cost;			/* estimated kernel cost of a single site */
 }  Partition; 
 
 
@@ -29,12 +31,19 @@ typedef struct
   Partition *partitions;
   Assignment **assignPerProc;  	/* procid -> array of assignments  */
   int *numAssignPerProc; 	/* procid -> size of above array */
+  double *workPerProc;		/* procid -> estimated work assigned so far */
+  int rateHetModel; 
 } PartitionAssignment; 
 
 /*
   constructor
 */ 
-void initializePartitionAssignment( PartitionAssignment **pAssPtr, pInfo **partitions, int numPart, int numProc);
+void initializePartitionAssignment( PartitionAssignment **pAssPtr, pInfo **partitions, int numPart, int numProc, int rateHetModel);
+/* 
+   estimated cost of computing a single site of a partition with
+   the given data type and number of states
+ */ 
+double estimateSiteCost(int dataType, int states, int rateHetModel); 
 /* 
    deletor 
  */ 
@@ -43,13 +52,18 @@ void deletePartitionAssignment(PartitionAssignment *pAss);
   assign partitions to all proceses  
  */ 
 void assign(PartitionAssignment *pa); 
+/*
+  assign partitions such that process i obtains a fraction of each
+  data type that is proportional to share[i]
+ */ 
+void assignProportional(PartitionAssignment *pa, double *share); 
 /* 
    prints a single assignment 
  */ 
 void printAssignment(Assignment a, int procid); 
 /* 
-   calculates and prints the load (number of partitions and number of
-   sites) for each process
+   calculates and prints the load (number of partitions, number of
+   sites and estimated work) for each process as well as the cost model 
  */ 
 void printLoad(PartitionAssignment *pa); 
 
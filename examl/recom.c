@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include <mpi.h>
+
+#include "axml.h"
+
+extern int processID;
+
+
+/*
+   Recomputation-based memory saving for very large trees.
+
+   Normally every inner node has its own conditional likelihood vector (CLV). With
+   --clv-budget only a fixed number of vectors (slots) is allocated, and the inner nodes
+   share them: tr->clvSlot[number] gives the slot that currently holds the vector of an
+   inner node, or -1 if the vector has been evicted. The slots are the first entries of
+   the xVector and xSpaceVector arrays of every partition, so the kernels still allocate and
+   address the vectors as before, only via the slot instead of the node number.
+
+   The slots are assigned while computeTraversalInfo() builds the traversal descriptor,
+   which is executed later on. Hence every entry stores the slots of p, q, and r at the
+   time it has been created (pSlot, qSlot, rSlot) and a slot is only re-assigned to
+   another node once no later entry of the same descriptor reads it:
+
+   - vectors that are still needed are pinned: the roots of the descriptor (startClvTraversal()),
+     the valid children of a node while its other subtree is computed, and every node that
+     has been added to the descriptor until its parent has been added,
+   - the unpinned slot that has been used least recently is evicted. Evicting a vector clears
+     the orientation flags (x) of its node, such that the next traversal that needs it
+     descends into its subtree and recomputes it, along with any evicted vectors in there.
+
+   The number of vectors that are pinned at the same time depends on the order in which
+   the two subtrees of a node are computed. As for register allocation (Sethi-Ullman), we
+   first compute the subtree that requires more vectors, such that a traversal needs at most
+   about log2(number of taxa) + 2 slots.
+
+   All processes take the same decisions since they work on the same tree.
+*/
+
+static tree
+  *recomTree = (tree *)NULL;
+
+static int
+  numberOfSlots = 0,
+  generation = 0;
+
+static lruList
+  slotOrder;
+
+static nodeptr
+  *slotNode = (nodeptr *)NULL;	/* inner node held by a slot, NULL if free */
+
+static int
+  *slotPin = (int *)NULL,	/* slot is pinned if equal to generation */
+  *plannedVectors = (int *)NULL,	/* vectors required for computing the subtree of a node, see vectorsRequired() */
+  *plannedGeneration = (int *)NULL;
+
+/* statistics */
+static double
+  computedVectors = 0.0,
+  evictedVectors = 0.0;
+
+
+static void pinVector(int number)
+{
+  int
+    s = recomTree->clvSlot[number];
+
+  assert(s >= 0 && slotNode[s]->number == number);
+
+  slotPin[s] = generation;
+  touchLruEntry(&slotOrder, s);
+}
+
+static void unpinVector(int number)
+{
+  slotPin[recomTree->clvSlot[number]] = 0;
+}
+
+/* the vector of an inner node is gone, its subtree must be traversed again to recompute it */
+static void evictVector(int s)
+{
+  nodeptr
+    p = slotNode[s];
+
+  if(p)
+    {
+      p->x = 0;
+      p->next->x = 0;
+      p->next->next->x = 0;
+
+      recomTree->clvSlot[p->number] = -1;
+      evictedVectors += 1.0;
+    }
+
+  slotNode[s] = (nodeptr)NULL;
+}
+
+/* returns the least recently used slot that is not pinned */
+static int unpinnedSlot(void)
+{
+  int
+    s;
+
+  for(s = slotOrder.oldest; s >= 0; s = slotOrder.newer[s])
+    if(slotPin[s] != generation)
+      return s;
+
+  if(processID == 0)
+    printf("\nError, all %d vectors of the CLV budget are needed at the same time, please increase \"--clv-budget\"\n", numberOfSlots);
+  errorExit(-1);
+
+  return -1;
+}
+
+static boolean recomputeChild(nodeptr c, boolean partialTraversal)
+{
+  return (!c->x || !partialTraversal);
+}
+
+static int vectorsRequired(nodeptr p, boolean partialTraversal);
+
+/* vectors pinned while and after computing the subtree at c (cost) and after it (held) */
+static int childVectors(nodeptr c, boolean partialTraversal, int *held)
+{
+  if(isTip(c->number, recomTree->mxtips))
+    {
+      *held = 0;
+      return 0;
+    }
+
+  *held = 1;
+
+  if(!recomputeChild(c, partialTraversal))
+    {
+      /* this vector will be used again soon, make it the last one to be evicted */
+      touchLruEntry(&slotOrder, recomTree->clvSlot[c->number]);
+      return 1;
+    }
+
+  return vectorsRequired(c, partialTraversal);
+}
+
+/* maximum number of vectors that are pinned at the same time for computing the vector at the inner node p */
+static int vectorsRequired(nodeptr p, boolean partialTraversal)
+{
+  nodeptr
+    q = p->next->back,
+    r = p->next->next->back;
+
+  int
+    heldQ,
+    heldR,
+    costQ,
+    costR,
+    cost;
+
+  if(plannedGeneration[p->number] == generation)
+    return plannedVectors[p->number];
+
+  costQ = childVectors(q, partialTraversal, &heldQ);
+  costR = childVectors(r, partialTraversal, &heldR);
+
+  /* tips and valid vectors are available from the start, hence "computed" first */
+
+  if(heldQ == 0 || !recomputeChild(q, partialTraversal))
+    cost = MAX(costQ, heldQ + costR);
+  else
+    {
+      if(heldR == 0 || !recomputeChild(r, partialTraversal))
+	cost = MAX(costR, heldR + costQ);
+      else
+	cost = MIN(MAX(costQ, heldQ + costR), MAX(costR, heldR + costQ));
+    }
+
+  cost = MAX(cost, heldQ + heldR + 1);
+
+  plannedVectors[p->number] = cost;
+  plannedGeneration[p->number] = generation;
+
+  return cost;
+}
+
+/**
+   sets up the slots for tr->clvBudget vectors, all inner vectors are invalid afterwards.
+   Also called again after the sites have been re-distributed.
+ */
+void initRecomputation(tree *tr)
+{
+  int
+    s,
+    i,
+    innerNodes = tr->mxtips - 2;
+
+  assert(tr->clvBudget > 0 && !tr->saveMemory && tr->numBranches == 1);
+
+  freeRecomputation(tr);
+
+  recomTree = tr;
+
+  numberOfSlots = MIN(tr->clvBudget, innerNodes);
+
+  tr->clvSlot = (int *)malloc(sizeof(int) * 2 * (size_t)tr->mxtips);
+  plannedVectors = (int *)calloc(2 * (size_t)tr->mxtips, sizeof(int));
+  plannedGeneration = (int *)calloc(2 * (size_t)tr->mxtips, sizeof(int));
+
+  slotNode = (nodeptr *)calloc((size_t)numberOfSlots, sizeof(nodeptr));
+  slotPin = (int *)calloc((size_t)numberOfSlots, sizeof(int));
+  initLruList(&slotOrder, numberOfSlots);
+
+  for(i = 0; i < 2 * tr->mxtips; i++)
+    tr->clvSlot[i] = -1;
+
+  /* no inner node has a vector yet. Note that tr->nodep[i] is not necessarily node i
+     after nodeRectifier(), but it still covers all inner nodes */
+
+  for(i = tr->mxtips + 1; i < 2 * tr->mxtips; i++)
+    {
+      nodeptr
+	p = tr->nodep[i];
+
+      p->x = 0;
+      p->next->x = 0;
+      p->next->next->x = 0;
+    }
+
+  generation = 1;
+
+  for(s = 0; s < numberOfSlots; s++)
+    linkLruEntryAsNewest(&slotOrder, s);
+}
+
+void freeRecomputation(tree *tr)
+{
+  if(!recomTree)
+    return;
+
+  assert(recomTree == tr);
+
+  free(tr->clvSlot);
+  free(plannedVectors);
+  free(plannedGeneration);
+  free(slotNode);
+  free(slotPin);
+  freeLruList(&slotOrder);
+
+  tr->clvSlot = (int *)NULL;
+  plannedVectors = (int *)NULL;
+  plannedGeneration = (int *)NULL;
+  slotNode = (nodeptr *)NULL;
+  slotPin = (int *)NULL;
+  numberOfSlots = 0;
+  recomTree = (tree *)NULL;
+}
+
+/**
+   must be called before computing a new traversal descriptor for the branch p, q (q may be NULL).
+   Releases all vectors pinned by the previous descriptor and pins the valid vectors at p and q,
+   which are read by evaluate or makenewz after the traversal.
+ */
+void startClvTraversal(nodeptr p, nodeptr q)
+{
+  if(!recomTree)
+    return;
+
+  generation++;
+
+  if(!isTip(p->number, recomTree->mxtips) && p->x)
+    pinVector(p->number);
+
+  if(q && !isTip(q->number, recomTree->mxtips) && q->x)
+    pinVector(q->number);
+}
+
+/**
+   called by computeTraversalInfo() for an inner node with two inner children q and r
+   before descending into them: pins the children that are valid and swaps q and r if the subtree
+   at r requires more vectors, such that it is computed first.
+ */
+void orderClvChildren(nodeptr *q, nodeptr *r, boolean partialTraversal)
+{
+  boolean
+    recomputeQ,
+    recomputeR;
+
+  if(!recomTree)
+    return;
+
+  recomputeQ = recomputeChild(*q, partialTraversal);
+  recomputeR = recomputeChild(*r, partialTraversal);
+
+  if(!recomputeQ)
+    pinVector((*q)->number);
+
+  if(!recomputeR)
+    pinVector((*r)->number);
+
+  if(recomputeQ && recomputeR && vectorsRequired(*r, partialTraversal) > vectorsRequired(*q, partialTraversal))
+    {
+      nodeptr
+	tmp = *q;
+
+      *q = *r;
+      *r = tmp;
+    }
+}
+
+/**
+   called by computeTraversalInfo() once the entry ti for an inner node has been filled in,
+   stores the slots of the vectors it reads and writes.
+ */
+void assignClvSlots(traversalInfo *ti, nodeptr p, int maxTips)
+{
+  int
+    s;
+
+  if(!recomTree)
+    {
+      ti->pSlot = ti->pNumber - maxTips - 1;
+      ti->qSlot = isTip(ti->qNumber, maxTips) ? -1 : ti->qNumber - maxTips - 1;
+      ti->rSlot = isTip(ti->rNumber, maxTips) ? -1 : ti->rNumber - maxTips - 1;
+      return;
+    }
+
+  ti->qSlot = -1;
+  ti->rSlot = -1;
+
+  /* the children must stay in place until the slot of p has been chosen */
+
+  if(!isTip(ti->qNumber, maxTips))
+    {
+      pinVector(ti->qNumber);
+      ti->qSlot = recomTree->clvSlot[ti->qNumber];
+    }
+
+  if(!isTip(ti->rNumber, maxTips))
+    {
+      pinVector(ti->rNumber);
+      ti->rSlot = recomTree->clvSlot[ti->rNumber];
+    }
+
+  s = recomTree->clvSlot[ti->pNumber];
+
+  if(s < 0)
+    {
+      s = unpinnedSlot();
+
+      evictVector(s);
+
+      slotNode[s] = p;
+      recomTree->clvSlot[ti->pNumber] = s;
+    }
+
+  ti->pSlot = s;
+
+  computedVectors += 1.0;
+
+  /* the children have been consumed, p is needed by its parent or by the final evaluation */
+
+  if(ti->qSlot >= 0)
+    unpinVector(ti->qNumber);
+
+  if(ti->rSlot >= 0)
+    unpinVector(ti->rNumber);
+
+  pinVector(ti->pNumber);
+}
+
+/* smallest budget that can be handled for a tree with the given number of taxa, small trees need all their inner vectors */
+int minimumClvBudget(int numberOfTaxa)
+{
+  return MIN((int)ceil(log((double)numberOfTaxa) / log(2.0)) + 4, numberOfTaxa - 2);
+}
+
+void printRecomputationStatistics(tree *tr)
+{
+  if(recomTree)
+    printBothOpen("\nCLV budget: %d of %d inner vectors resident, %.0f vectors computed, %.0f evicted\n",
+		  numberOfSlots, tr->mxtips - 2, computedVectors, evictedVectors);
+}
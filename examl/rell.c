@@ -0,0 +1,542 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include <mpi.h>
+
+#include "axml.h"
+
+
+extern int processID;
+extern MPI_Comm comm;
+extern char workdir[1024];
+extern char run_id[128];
+extern const unsigned int mask32[32];
+
+
+/*
+   RELL (resampling of estimated log likelihoods) bootstrap supports.
+
+   For the best tree and the best other trees encountered during the
+   search we compute the per-pattern log likelihoods of the sites
+   assigned to this process. A RELL replicate then re-samples the
+   pattern weights (see bootstrap.c) and picks the tree with the best
+   re-weighted likelihood without any optimization. The support of a
+   branch of the best tree is the percentage of replicates in which the
+   winning tree contains the corresponding bipartition.
+
+   The per-pattern log likelihoods are computed by the kernels: while
+   the partitions point to the buffers below, the newview() functions
+   count the scaling multiplications of every site (ex3) and the evaluate
+   functions return the log likelihood of every site. The other trees
+   store their per-pattern log likelihoods when they enter the list of
+   the best trees during the search (storeSiteLikelihoods()), such that
+   we need not optimize them once more at the end.
+*/
+
+#define RELL_REPLICATES 1000
+#define RELL_SEED 12345
+
+
+static size_t localPatterns(tree *tr)
+{
+  int
+    model;
+
+  size_t
+    patterns = 0;
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    patterns += tr->partitionData[model].width;
+
+  return patterns;
+}
+
+/* weighted sum of the per-pattern log likelihoods of all processes */
+static double sumSiteLikelihoods(tree *tr, double *siteLH)
+{
+  int
+    model;
+
+  double
+    sum = 0.0;
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      pInfo
+	*pr = &(tr->partitionData[model]);
+
+      size_t
+	i;
+
+      for(i = 0; i < pr->width; i++)
+	sum += (double)pr->wgt[i] * siteLH[i];
+
+      siteLH += pr->width;
+    }
+
+  MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_DOUBLE, MPI_SUM, comm);
+
+  return sum;
+}
+
+/* the per-pattern log likelihoods must sum up to the likelihood of the tree computed by the kernels */
+static boolean consistentSiteLikelihoods(double sum, double likelihood)
+{
+  return (ABS(sum - likelihood) < 0.1 + 1.0e-6 * ABS(likelihood));
+}
+
+/**
+   computes the log likelihoods of the local patterns of all partitions
+   for the current tree, siteLH is indexed by the pattern numbers of
+   this process (i.e., the partitions are concatenated). This requires
+   a full traversal, the likelihood of the tree remains unchanged.
+ */
+static void computeSiteLikelihoods(tree *tr, double *siteLH)
+{
+  int
+    model;
+
+  double
+    likelihood = tr->likelihood,
+    *perPartitionLH = (double *)malloc(sizeof(double) * (size_t)tr->NumberOfModels),
+    *out = siteLH;
+
+#ifdef __MIC_NATIVE
+  assert(0 && "Per-site log likelihoods are not implemented on Intel MIC");
+#endif
+
+  memcpy(perPartitionLH, tr->perPartitionLH, sizeof(double) * (size_t)tr->NumberOfModels);
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      pInfo
+	*pr = &(tr->partitionData[model]);
+
+      assert(tr->executeModel[model]);
+
+      pr->siteLikelihoods = out;
+      pr->siteScaler = (int *)calloc(pr->width + 1, sizeof(int));
+      pr->siteScalerIncrement = (int *)malloc(sizeof(int) * (pr->width + 1));
+
+      out += pr->width;
+    }
+
+  evaluateGeneric(tr, tr->start, TRUE);
+
+  for(model = 0; model < tr->NumberOfModels; model++)
+    {
+      pInfo
+	*pr = &(tr->partitionData[model]);
+
+      free(pr->siteScaler);
+      free(pr->siteScalerIncrement);
+
+      pr->siteLikelihoods = (double *)NULL;
+      pr->siteScaler = (int *)NULL;
+      pr->siteScalerIncrement = (int *)NULL;
+    }
+
+  tr->likelihood = likelihood;
+  memcpy(tr->perPartitionLH, perPartitionLH, sizeof(double) * (size_t)tr->NumberOfModels);
+  free(perPartitionLH);
+}
+
+/**
+   stores the per-pattern log likelihoods of the current tree in tpl,
+   called for the trees that enter the list of RELL candidates during
+   the search. Must be called by all processes.
+ */
+void storeSiteLikelihoods(tree *tr, topol *tpl)
+{
+  size_t
+    patterns = localPatterns(tr);
+
+  if(!tpl->siteLikelihoods)
+    tpl->siteLikelihoods = (double *)malloc(sizeof(double) * (patterns > 0 ? patterns : 1));
+
+  computeSiteLikelihoods(tr, tpl->siteLikelihoods);
+}
+
+
+/* bipartitions, i.e., the tips below the inner nodes in the orientation towards tr->start */
+
+typedef struct
+{
+  unsigned int
+    **bitVectors,
+    vectorLength,
+    treeVectorLength;
+
+  hashNumberType
+    *hashes;
+
+  hashtable
+    *h;
+} splitSet;
+
+/* bipartitions that contain tip 1 are stored as their complement */
+static void normalizeSplit(tree *tr, splitSet *s, unsigned int *toInsert, unsigned int *buffer, hashNumberType *hash)
+{
+  unsigned int
+    i;
+
+  if(toInsert[0] & 1)
+    {
+      for(i = 0; i < s->vectorLength; i++)
+	buffer[i] = ~toInsert[i];
+
+      if(tr->mxtips % MASK_LENGTH)
+	buffer[s->vectorLength - 1] &= (mask32[tr->mxtips % MASK_LENGTH] - 1);
+
+      *hash = *hash ^ s->hashes[0];
+    }
+  else
+    memcpy(buffer, toInsert, sizeof(unsigned int) * s->vectorLength);
+}
+
+static entry *findSplit(splitSet *s, unsigned int *bitVector, hashNumberType hash)
+{
+  entry
+    *e = s->h->table[hash % s->h->tableSize];
+
+  for(; e != (entry *)NULL; e = e->next)
+    if(memcmp(e->bitVector, bitVector, sizeof(unsigned int) * s->vectorLength) == 0)
+      return e;
+
+  return (entry *)NULL;
+}
+
+/*
+   computes the bipartitions of the subtree at p, inserts them into the
+   hash table (insert == TRUE) and marks the entries as present in tree
+   treeNumber (unless treeNumber < 0), returns the number of
+   bipartitions found in the table
+*/
+static int traverseSplits(tree *tr, splitSet *s, nodeptr p, int treeNumber, boolean insert, unsigned int *buffer)
+{
+  int
+    found = 0;
+
+  if(isTip(p->number, tr->mxtips))
+    return 0;
+  else
+    {
+      nodeptr
+	q = p->next->back,
+	r = p->next->next->back;
+
+      unsigned int
+	i,
+	*vector = s->bitVectors[p->number];
+
+      hashNumberType
+	hash;
+
+      found += traverseSplits(tr, s, q, treeNumber, insert, buffer);
+      found += traverseSplits(tr, s, r, treeNumber, insert, buffer);
+
+      for(i = 0; i < s->vectorLength; i++)
+	vector[i] = s->bitVectors[q->number][i] | s->bitVectors[r->number][i];
+
+      s->hashes[p->number] = s->hashes[q->number] ^ s->hashes[r->number];
+
+      if(!isTip(p->back->number, tr->mxtips))
+	{
+	  entry
+	    *e;
+
+	  hash = s->hashes[p->number];
+	  normalizeSplit(tr, s, vector, buffer, &hash);
+
+	  e = findSplit(s, buffer, hash);
+
+	  if(!e && insert)
+	    {
+	      e = initEntry();
+	      e->bitVector = (unsigned int *)malloc(sizeof(unsigned int) * s->vectorLength);
+	      e->treeVector = (unsigned int *)calloc((size_t)s->treeVectorLength, sizeof(unsigned int));
+	      memcpy(e->bitVector, buffer, sizeof(unsigned int) * s->vectorLength);
+
+	      e->next = s->h->table[hash % s->h->tableSize];
+	      s->h->table[hash % s->h->tableSize] = e;
+	      s->h->entryCount = s->h->entryCount + 1;
+	    }
+
+	  if(e)
+	    {
+	      if(treeNumber >= 0)
+		e->treeVector[treeNumber / MASK_LENGTH] |= mask32[treeNumber % MASK_LENGTH];
+
+	      /* the support of the branch p <-> p->back of the best tree */
+	      if(insert)
+		e->bipNumber = (unsigned int)p->number;
+
+	      found++;
+	    }
+	}
+
+      return found;
+    }
+}
+
+static void initSplitSet(tree *tr, splitSet *s, int numberOfTrees)
+{
+  int
+    i;
+
+  s->bitVectors = initBitVector(tr->mxtips, &(s->vectorLength));
+  s->treeVectorLength = (unsigned int)(numberOfTrees + MASK_LENGTH - 1) / MASK_LENGTH;
+  s->h = initHashTable((unsigned int)tr->mxtips * 4);
+  s->hashes = (hashNumberType *)malloc(sizeof(hashNumberType) * 2 * (size_t)tr->mxtips);
+
+  /* tip 1 is not contained in any normalized bipartition, we use its hash for complementing */
+  for(i = 1; i <= tr->mxtips; i++)
+    s->hashes[i] = tr->nodep[i]->hash;
+
+  s->hashes[0] = 0;
+  for(i = 1; i <= tr->mxtips; i++)
+    s->hashes[0] ^= s->hashes[i];
+}
+
+static void freeSplitSet(splitSet *s, int mxtips)
+{
+  freeBitVectors(s->bitVectors, 2 * mxtips);
+  free(s->bitVectors);
+  freeHashTable(s->h);
+  free(s->h);
+  free(s->hashes);
+}
+
+
+/**
+   collects the best tree (number 0, its bipartitions are inserted into
+   the table) and the candidates with consistent per-pattern log
+   likelihoods, and counts how often each of them wins a RELL
+   replicate. Returns the number of trees.
+ */
+static int countRELLWins(tree *tr, bestlist *candidates, splitSet *splits, double *bestSiteLH, int *wins)
+{
+  int
+    i,
+    t,
+    model,
+    numberOfTrees = 0,
+    maxTrees = 1 + ((candidates != (bestlist *)NULL) ? candidates->nvalid : 0);
+
+  double
+    **siteLH = (double **)malloc(sizeof(double *) * (size_t)maxTrees),
+    *treeLH = (double *)malloc(sizeof(double) * (size_t)maxTrees);
+
+  long
+    seed = RELL_SEED;
+
+  unsigned int
+    *buffer = (unsigned int *)malloc(sizeof(unsigned int) * splits->vectorLength);
+
+  traverseSplits(tr, splits, tr->start->back, numberOfTrees, TRUE, buffer);
+  siteLH[numberOfTrees] = bestSiteLH;
+  printBothOpen("RELL tree %d likelihood %f\n", numberOfTrees, tr->likelihood);
+  numberOfTrees++;
+
+  for(i = 1; i < maxTrees; i++)
+    {
+      topol
+	*tpl = candidates->byScore[i];
+
+      double
+	sum;
+
+      if(!tpl->siteLikelihoods)
+	continue;
+
+      recallBestTree(candidates, i, tr);
+
+      /* candidates with the topology of the best tree are skipped */
+      if(traverseSplits(tr, splits, tr->start->back, -1, FALSE, buffer) == tr->mxtips - 3)
+	continue;
+
+      sum = sumSiteLikelihoods(tr, tpl->siteLikelihoods);
+
+      if(!consistentSiteLikelihoods(sum, tpl->likelihood))
+	{
+	  printBothOpen("WARNING: the per-site log likelihoods of RELL candidate %d sum up to %f instead of %f, the tree is not used\n",
+			i, sum, tpl->likelihood);
+	  continue;
+	}
+
+      traverseSplits(tr, splits, tr->start->back, numberOfTrees, FALSE, buffer);
+      siteLH[numberOfTrees] = tpl->siteLikelihoods;
+      printBothOpen("RELL tree %d likelihood %f\n", numberOfTrees, tpl->likelihood);
+      numberOfTrees++;
+    }
+
+  /* replicates */
+
+  initializeBootstrap(tr);
+
+  for(i = 0; i < RELL_REPLICATES; i++)
+    {
+      int
+	bestTree = 0;
+
+      resampleWeights(tr, 1 + (long)(randum(&seed) * 2147483646.0));
+
+      for(t = 0; t < numberOfTrees; t++)
+	{
+	  double
+	    *lh = siteLH[t];
+
+	  size_t
+	    k;
+
+	  treeLH[t] = 0.0;
+
+	  for(model = 0; model < tr->NumberOfModels; model++)
+	    {
+	      pInfo
+		*pr = &(tr->partitionData[model]);
+
+	      for(k = 0; k < pr->width; k++)
+		treeLH[t] += (double)pr->wgt[k] * lh[k];
+
+	      lh += pr->width;
+	    }
+	}
+
+      MPI_Allreduce(MPI_IN_PLACE, treeLH, numberOfTrees, MPI_DOUBLE, MPI_SUM, comm);
+
+      for(t = 1; t < numberOfTrees; t++)
+	if(treeLH[t] > treeLH[bestTree])
+	  bestTree = t;
+
+      wins[bestTree]++;
+    }
+
+  restoreWeights(tr);
+
+  free(siteLH);
+  free(treeLH);
+  free(buffer);
+
+  return numberOfTrees;
+}
+
+/* supports of the bipartitions of the best tree, writes the tree with the supports to ExaML_RELL.runID */
+static void writeRELLSupports(tree *tr, splitSet *splits, int *wins, int numberOfTrees, double t0)
+{
+  hashNumberType
+    k;
+
+  if(!tr->bInf)
+    tr->bInf = (branchInfo *)calloc((size_t)(tr->mxtips - 2), sizeof(branchInfo));
+
+  for(k = 0; k < splits->h->tableSize; k++)
+    {
+      entry
+	*e;
+
+      for(e = splits->h->table[k]; e != (entry *)NULL; e = e->next)
+	{
+	  int
+	    t,
+	    support = 0;
+
+	  for(t = 0; t < numberOfTrees; t++)
+	    if(e->treeVector[t / MASK_LENGTH] & mask32[t % MASK_LENGTH])
+	      support += wins[t];
+
+	  tr->bInf[e->bipNumber - (unsigned int)tr->mxtips - 1].support = (int)(0.5 + 100.0 * (double)support / (double)RELL_REPLICATES);
+	}
+    }
+
+  if(processID == 0)
+    {
+      char
+	fileName[1024];
+
+      FILE
+	*f;
+
+      strcpy(fileName, workdir);
+      strcat(fileName, "ExaML_RELL.");
+      strcat(fileName, run_id);
+
+      f = myfopen(fileName, "wb");
+      Tree2String(tr->tree_string, tr, tr->start->back, TRUE, TRUE, FALSE, TRUE, TRUE, SUMMARIZE_LH, FALSE, FALSE);
+      fprintf(f, "%s", tr->tree_string);
+      fclose(f);
+
+      printBothOpen("Best tree won %d of %d RELL replicates against %d other trees, time %f\n", wins[0], RELL_REPLICATES, numberOfTrees - 1, gettime() - t0);
+      printBothOpen("Best tree with RELL supports written to file %s\n", fileName);
+    }
+}
+
+/**
+   computes RELL bootstrap supports for the branches of the current
+   (best) tree using the trees stored in candidates as alternatives and
+   writes the tree with the supports to ExaML_RELL.runID. Must be
+   called by all processes, the current tree is restored at the end.
+   Inconsistent per-pattern log likelihoods only lead to a warning:
+   such candidates are left out, and no supports are computed if the
+   best tree is affected, such that the ML result is written as usual.
+ */
+void computeRELLSupports(tree *tr, bestlist *candidates)
+{
+  int
+    numberOfTrees,
+    maxTrees = 1 + ((candidates != (bestlist *)NULL) ? candidates->nvalid : 0),
+    *wins = (int *)calloc((size_t)maxTrees, sizeof(int));
+
+  size_t
+    patterns = localPatterns(tr);
+
+  double
+    t0 = gettime(),
+    bestLikelihood = tr->likelihood,
+    sum,
+    *bestSiteLH = (double *)malloc(sizeof(double) * (patterns > 0 ? patterns : 1));
+
+  splitSet
+    splits;
+
+  printBothOpen("\nComputing RELL supports from %d replicates\n", RELL_REPLICATES);
+
+  computeSiteLikelihoods(tr, bestSiteLH);
+  sum = sumSiteLikelihoods(tr, bestSiteLH);
+
+  if(!consistentSiteLikelihoods(sum, bestLikelihood))
+    printBothOpen("WARNING: the per-site log likelihoods of the best tree sum up to %f instead of %f, RELL supports are not computed\n",
+		  sum, bestLikelihood);
+  else
+    {
+      /* remember the best tree, we will overwrite it with the candidates */
+      bestlist
+	*best = (bestlist *)malloc(sizeof(bestlist));
+
+      best->ninit = 0;
+      initBestTree(best, 1, tr->mxtips);
+      saveBestTree(best, tr, TRUE);
+
+      initSplitSet(tr, &splits, maxTrees);
+
+      numberOfTrees = countRELLWins(tr, candidates, &splits, bestSiteLH, wins);
+
+      recallBestTree(best, 1, tr);
+
+      if(!consistentSiteLikelihoods(tr->likelihood, bestLikelihood))
+	printBothOpen("WARNING: the best tree has likelihood %f instead of %f after the RELL replicates, RELL supports are not written\n",
+		      tr->likelihood, bestLikelihood);
+      else
+	writeRELLSupports(tr, &splits, wins, numberOfTrees, t0);
+
+      freeBestTree(best);
+      free(best);
+      freeSplitSet(&splits, tr->mxtips);
+    }
+
+  free(bestSiteLH);
+  free(wins);
+}
@@ -41,6 +41,7 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <string.h>
+#include <pthread.h>
 
 #include "axml.h"
 
@@ -63,6 +64,7 @@ extern char binaryCheckpointName[1024];
 extern char binaryCheckpointInputName[1024];
 
 extern int processID;
+extern MPI_Comm comm;
 
 
 
@@ -481,6 +483,33 @@ nodeptr  removeNodeRestoreBIG (tree *tr, nodeptr p)
 }
 
 
+/* inserts p between q and q->back without optimizing the branch lengths (lazy SPR) */
+
+static void hookupLazyBIG(tree *tr, nodeptr p, nodeptr q)
+{
+  nodeptr  
+    r = q->back;
+
+  double  
+    z[NUM_BRANCHES]; 
+
+  int 
+    i;
+      
+  for(i = 0; i < tr->numBranches; i++)
+    {
+      z[i] = sqrt(q->z[i]);      
+      
+      if(z[i] < zmin) 
+	z[i] = zmin;
+      if(z[i] > zmax)
+	z[i] = zmax;
+    }
+      
+  hookup(p->next,       q, z, tr->numBranches);
+  hookup(p->next->next, r, z, tr->numBranches);	                         
+}
+
 boolean insertBIG (tree *tr, nodeptr p, nodeptr q, int numBranches)
 {
   nodeptr  r, s;
@@ -534,22 +563,7 @@ boolean insertBIG (tree *tr, nodeptr p, nodeptr q, int numBranches)
       hookup(p,             s, e3, numBranches);      		  
     }
   else
-    {       
-      double  z[NUM_BRANCHES]; 
-      
-      for(i = 0; i < numBranches; i++)
-	{
-	  z[i] = sqrt(q->z[i]);      
-	  
-	  if(z[i] < zmin) 
-	    z[i] = zmin;
-	  if(z[i] > zmax)
-	    z[i] = zmax;
-	}
-      
-      hookup(p->next,       q, z, tr->numBranches);
-      hookup(p->next->next, r, z, tr->numBranches);	                         
-    }
+    hookupLazyBIG(tr, p, q);
   
   newviewGeneric(tr, p, FALSE);
   
@@ -607,6 +621,24 @@ boolean insertRestoreBIG (tree *tr, nodeptr p, nodeptr q)
 }
 
 
+/* saves the current tree in the list of the best ML trees, for the RELL supports we also store 
+   the per-site log likelihoods of the trees that enter the list. Returns TRUE in this case, since 
+   this requires a full traversal. */
+
+static boolean saveBestML(tree *tr, bestlist *bestML)
+{
+  int
+    scrNum = saveBestTree(bestML, tr, FALSE);
+
+  if(scrNum > 0 && tr->rellTrees > 0)
+    {
+      storeSiteLikelihoods(tr, bestML->byScore[scrNum]);
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
 static void restoreTopologyOnly(tree *tr, bestlist *bt, bestlist *bestML)
 { 
   nodeptr p = tr->removeNode;
@@ -615,6 +647,7 @@ static void restoreTopologyOnly(tree *tr, bestlist *bt, bestlist *bestML)
   nodeptr p1, p2, r, s;
   double currentLH = tr->likelihood;
   int i;
+  boolean fullTraversal = FALSE;
       
   p1 = p->next->back;
   p2 = p->next->next->back;
@@ -661,8 +694,8 @@ static void restoreTopologyOnly(tree *tr, bestlist *bt, bestlist *bestML)
   tr->likelihood = tr->bestOfNode;
     
   saveBestTree(bt, tr, TRUE);
-  if(tr->saveBestTrees)
-    saveBestTree(bestML, tr, FALSE);
+  if(bestML)
+    fullTraversal = saveBestML(tr, bestML);
   
   tr->likelihood = currentLH;
   
@@ -675,6 +708,14 @@ static void restoreTopologyOnly(tree *tr, bestlist *bt, bestlist *bestML)
       
   hookup(p->next,       p1, p1z, tr->numBranches); 
   hookup(p->next->next, p2, p2z, tr->numBranches);      
+
+  /* the per-site log likelihoods have been computed for the tree with the inserted subtree, 
+     hence the vectors must be re-computed for the restored tree */
+  if(fullTraversal)
+    {
+      evaluateGeneric(tr, tr->start, TRUE);
+      tr->likelihood = currentLH;
+    }
 }
 
 
@@ -723,9 +764,24 @@ boolean testInsertBIG (tree *tr, nodeptr p, nodeptr q)
   
   if(doIt)
     {     
-      if (! insertBIG(tr, p, q, tr->numBranches))       return FALSE;         
+      if(Thorough)
+	{
+	  if (! insertBIG(tr, p, q, tr->numBranches))       return FALSE;         
       
-      evaluateGeneric(tr, p->next->next, FALSE);   
+	  evaluateGeneric(tr, p->next->next, FALSE);   
+	}
+      else
+	{
+	  /* lazy insertion: no need to compute the vector at p before scoring, 
+	     see evaluateInsertion() */
+
+	  for(i = 0; i < tr->numBranches; i++)
+	    tr->lzi[i] = q->z[i];
+
+	  hookupLazyBIG(tr, p, q);
+
+	  evaluateInsertion(tr, p);
+	}
        
       if(tr->likelihood > tr->bestOfNode)
 	{
@@ -786,8 +842,11 @@ void addTraverseBIG(tree *tr, nodeptr p, nodeptr q, int mintrav, int maxtrav)
 {  
   if (--mintrav <= 0) 
     {              
-      if (! testInsertBIG(tr, p, q))  return;
-
+      /* in the fast phase only the insertion positions selected by the parsimony pre-screening are scored */
+      if(Thorough || !tr->parsimonyPrescreen || tr->insertionSelected[q->number])
+	{
+	  if (! testInsertBIG(tr, p, q))  return;
+	}
     }
   
   if ((!isTip(q->number, tr->mxtips)) && (--maxtrav > 0)) 
@@ -827,8 +886,13 @@ int rearrangeBIG(tree *tr, nodeptr p, int mintrav, int maxtrav)
 	      p2z[i] = p2->z[i];	   	   
 	    }
 	  
+	  startClvCacheWindow();
+
 	  if (! removeNodeBIG(tr, p,  tr->numBranches)) return badRear;
 	  
+	  if(!Thorough && tr->parsimonyPrescreen)
+	    prescreenInsertions(tr, p, p1, p2, mintrav, maxtrav);
+
 	  if (!isTip(p1->number, tr->mxtips)) 
 	    {
 	      addTraverseBIG(tr, p, p1->next->back,
@@ -848,6 +912,8 @@ int rearrangeBIG(tree *tr, nodeptr p, int mintrav, int maxtrav)
 	  hookup(p->next,       p1, p1z, tr->numBranches); 
 	  hookup(p->next->next, p2, p2z, tr->numBranches);	   	    	    
 	  newviewGeneric(tr, p, FALSE);	   	    
+
+	  stopClvCacheWindow();
 	}
     }  
   
@@ -877,9 +943,14 @@ int rearrangeBIG(tree *tr, nodeptr p, int mintrav, int maxtrav)
 	      q2z[i] = q2->z[i];
 	    }
 	  
+	  startClvCacheWindow();
+
 	  if (! removeNodeBIG(tr, q, tr->numBranches)) return badRear;
 	  
 	  mintrav2 = mintrav > 2 ? mintrav : 2;
+
+	  if(!Thorough && tr->parsimonyPrescreen)
+	    prescreenInsertions(tr, q, q1, q2, mintrav2, maxtrav);
 	  
 	  if (/*! q1->tip*/ !isTip(q1->number, tr->mxtips)) 
 	    {
@@ -901,6 +972,8 @@ int rearrangeBIG(tree *tr, nodeptr p, int mintrav, int maxtrav)
 	  hookup(q->next->next, q2, q2z, tr->numBranches);
 	  
 	  newviewGeneric(tr, q, FALSE); 	   
+
+	  stopClvCacheWindow();
 	}
     } 
   
@@ -911,6 +984,30 @@ int rearrangeBIG(tree *tr, nodeptr p, int mintrav, int maxtrav)
 
 
 
+/* 
+   time limit (--time-limit) bookkeeping of the SPR cycles, see computeBIGRAPID(): 
+   the time that must be left for the rest of the cycle when treeOptimizeRapid() stops early,
+   whether the last cycle was stopped early, and the time per node and radius of the thorough 
+   rearrangements at the end of the last fast cycle
+*/
+static double 
+  sprReserve = 0.0,
+  thoroughRadiusTime = 0.0;
+
+static boolean 
+  sprCycleStopped = FALSE;
+
+static boolean sprTimeLimitReached(tree *tr)
+{
+  if(tr->timeLimit > 0.0 && timeLimitReached(tr, sprReserve))
+    {
+      sprCycleStopped = TRUE;
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
 double treeOptimizeRapid(tree *tr, int mintrav, int maxtrav, analdef *adef, bestlist *bt, bestlist *bestML)
 {
   int 
@@ -918,8 +1015,14 @@ double treeOptimizeRapid(tree *tr, int mintrav, int maxtrav, analdef *adef, best
     index,
     *perm = (int*)NULL;   
 
+  double
+    thoroughStart;
+
   nodeRectifier(tr);
 
+  if(tr->parsimonyPrescreen)
+    resetParsimonyOrientation(tr);
+
   if (maxtrav > tr->mxtips - 3)  
     maxtrav = tr->mxtips - 3;  
     
@@ -960,6 +1063,9 @@ double treeOptimizeRapid(tree *tr, int mintrav, int maxtrav, analdef *adef, best
 
   for(i = 1; i <= tr->mxtips + tr->mxtips - 2; i++)
     {           
+      if(sprTimeLimitReached(tr))
+	break;
+
       tr->bestOfNode = unlikely;          
 
       if(adef->permuteTreeoptimize)
@@ -976,8 +1082,8 @@ double treeOptimizeRapid(tree *tr, int mintrav, int maxtrav, analdef *adef, best
 		  restoreTreeFast(tr);	 	 
 		  tr->startLH = tr->endLH = tr->likelihood;	 
 		  saveBestTree(bt, tr, TRUE); 
-		  if(tr->saveBestTrees)
-		    saveBestTree(bestML, tr, FALSE);
+		  if(bestML)
+		    saveBestML(tr, bestML);
 		}
 	      else
 		{ 		  
@@ -1000,9 +1106,14 @@ double treeOptimizeRapid(tree *tr, int mintrav, int maxtrav, analdef *adef, best
   if(!Thorough)
     {           
       Thorough = 1;  
+
+      thoroughStart = gettime();
       
       for(i = 0; i < iList.valid; i++)
 	{ 	  
+	  if(sprTimeLimitReached(tr))
+	    break;
+
 	  tr->bestOfNode = unlikely;
 	  
 	  if(rearrangeBIG(tr, iList.list[i].node, mintrav, maxtrav))
@@ -1012,8 +1123,8 @@ double treeOptimizeRapid(tree *tr, int mintrav, int maxtrav, analdef *adef, best
 		  restoreTreeFast(tr);	 	 
 		  tr->startLH = tr->endLH = tr->likelihood;	 
 		  saveBestTree(bt, tr, TRUE);
-		  if(tr->saveBestTrees)
-		    saveBestTree(bestML, tr, FALSE);
+		  if(bestML)
+		    saveBestML(tr, bestML);
 		}
 	      else
 		{ 
@@ -1025,6 +1136,9 @@ double treeOptimizeRapid(tree *tr, int mintrav, int maxtrav, analdef *adef, best
 		}      
 	    }
 	}       
+
+      if(i > 0)
+	thoroughRadiusTime = (gettime() - thoroughStart) / ((double)i * (double)(maxtrav - mintrav + 1));
           
       Thorough = 0;
     }
@@ -1094,8 +1208,24 @@ boolean testInsertRestoreBIG (tree *tr, nodeptr p, nodeptr q)
 
 void restoreTreeFast(tree *tr)
 {
+  nodeptr
+    q = tr->removeNode->next->back;
+
   removeNodeRestoreBIG(tr, tr->removeNode);    
   testInsertRestoreBIG(tr, tr->removeNode, tr->insertNode);
+
+  /* the subtree has been moved from the branch now connecting q and q->back to its new position */
+
+  if(tr->parsimonyPrescreen)
+    {
+      nodeptr
+	p = tr->removeNode;
+
+      p->xPars = p->next->xPars = p->next->next->xPars = 0;
+
+      invalidateParsimonyBranch(tr, q);
+      invalidateParsimonyBranch(tr, p->next);
+    }
 }
 
 
@@ -1148,6 +1278,102 @@ static void gatherDistributedCatInfos(tree *tr, int **rateCategory_result, doubl
 }
 
 
+/* 
+   checkpoints are serialized into a memory buffer by the master and
+   then written to disk by a background thread, such that the search
+   does not have to wait for the file system. There is at most one
+   write in flight, the next checkpoint waits for the previous one.
+*/
+
+typedef struct
+{
+  char 
+    *buffer,
+    fileName[2048],
+    obsoleteFileName[2048];	/* checkpoint to delete after the write, empty if none */
+
+  size_t 
+    length;
+} checkpointWrite;
+
+static pthread_t 
+  checkpointThread;
+
+static boolean 
+  checkpointThreadActive = FALSE;
+
+static checkpointWrite 
+  pendingCheckpoint;
+
+static void *checkpointWriter(void *arg)
+{
+  checkpointWrite
+    *w = (checkpointWrite *)arg;
+
+  char 
+    tmpName[2048 + 8];
+
+  FILE 
+    *f;
+
+  /* write to a temporary file first, so a checkpoint file is never incomplete */
+
+  sprintf(tmpName, "%s.tmp", w->fileName);
+
+  f = myfopen(tmpName, "w");
+  
+  myBinFwrite(w->buffer, sizeof(char), w->length, f);
+
+  fclose(f);
+
+  if(rename(tmpName, w->fileName) != 0)
+    printf("\nWarning: could not rename checkpoint file %s to %s\n", tmpName, w->fileName);
+
+  if(w->obsoleteFileName[0] != '\0')
+    remove(w->obsoleteFileName);
+
+  free(w->buffer);
+  w->buffer = (char *)NULL;
+
+  return NULL;
+}
+
+/**
+   waits until the last checkpoint has been written to disk, must be
+   called before the program terminates
+ */
+void finishCheckpointWriting(void)
+{
+  if(checkpointThreadActive)
+    {
+      pthread_join(checkpointThread, NULL);
+      checkpointThreadActive = FALSE;
+    }
+}
+
+static void startCheckpointWriting(tree *tr, char *buffer, size_t length)
+{
+  finishCheckpointWriting();
+
+  pendingCheckpoint.buffer = buffer;
+  pendingCheckpoint.length = length;
+
+  sprintf(pendingCheckpoint.fileName, "%s_%d", binaryCheckpointName, ckpCount);
+
+  if(tr->keepCheckpoints > 0 && ckpCount >= tr->keepCheckpoints)
+    sprintf(pendingCheckpoint.obsoleteFileName, "%s_%d", binaryCheckpointName, ckpCount - tr->keepCheckpoints);
+  else
+    pendingCheckpoint.obsoleteFileName[0] = '\0';
+
+  ckpCount++;
+
+  if(pthread_create(&checkpointThread, (pthread_attr_t *)NULL, checkpointWriter, &pendingCheckpoint) == 0)
+    checkpointThreadActive = TRUE;
+  else
+    checkpointWriter(&pendingCheckpoint);
+}
+
+
 /** 
     added parameters patrat and rateCategory. The checkpoint writer
     has to gather this distributed information first. 
@@ -1158,8 +1384,10 @@ static void writeCheckpointInner(tree *tr, int *rateCategory, double *patrat, an
     model; 
   
   char 
-    extendedName[2048],
-    buf[64];
+    *buffer = (char *)NULL;
+
+  size_t
+    length = 0;
 
   FILE 
     *f;
@@ -1167,14 +1395,13 @@ static void writeCheckpointInner(tree *tr, int *rateCategory, double *patrat, an
   /* only master should write the checkpoint */
   assert(processID == 0); 
 
-  strcpy(extendedName,  binaryCheckpointName);
-  strcat(extendedName, "_");
-  sprintf(buf, "%d", ckpCount);
-  strcat(extendedName, buf);  
-
-  ckpCount++;
+  f = open_memstream(&buffer, &length);
 
-  f = myfopen(extendedName, "w"); 
+  if(!f)
+    {
+      printf("\nError, could not allocate the checkpoint buffer\n");
+      errorExit(-1);
+    }
   
 
   ckp.cmd.useMedian = tr->useMedian;
@@ -1284,6 +1511,8 @@ static void writeCheckpointInner(tree *tr, int *rateCategory, double *patrat, an
 
   fclose(f); 
 
+  startCheckpointWriting(tr, buffer, length);
+
   /* printBothOpen("\nCheckpoint written to: %s likelihood: %f\n", extendedName, tr->likelihood); */
 }
 
@@ -1294,7 +1523,17 @@ void writeCheckpoint(tree *tr, analdef *adef)
     *rateCategory = (int *)NULL; 
   
   double 
-    *patrat = (double *)NULL; 
+    *patrat = (double *)NULL,
+    traceStart; 
+
+  /* a restart can not resume the bootstrap replicates, hence there is nothing to checkpoint */
+
+  if(adef->boot)
+    return;
+
+  traceStart = traceBegin(); 
+
+  startPhaseTimer(TIMER_WRITE_CHECKPOINT);
 
   if(tr->rateHetModel == CAT)
     gatherDistributedCatInfos(tr, &rateCategory, &patrat); 
@@ -1309,6 +1548,9 @@ void writeCheckpoint(tree *tr, analdef *adef)
 	  free(patrat); 
 	}
     }
+
+  stopPhaseTimer(TIMER_WRITE_CHECKPOINT);
+  traceEnd(TRACE_CHECKPOINT, traceStart, 0);
 }
 
 
@@ -1383,6 +1625,11 @@ static void readTree(tree *tr, FILE *f)
 	updateTipXVectors(tr, (size_t)model);
   }
 
+  /* the vector orientations stored in the nodes refer to the vectors of the run that wrote the checkpoint */
+
+  if(tr->clvBudget > 0)
+    initRecomputation(tr);
+
   evaluateGeneric(tr, tr->start, TRUE);  
 
   printBothOpen("ExaML Restart with likelihood: %1.50f\n", tr->likelihood);  
@@ -1726,7 +1973,9 @@ static void readCheckpoint(tree *tr, analdef *adef)
 
 void restart(tree *tr, analdef *adef)
 {  
+  startPhaseTimer(TIMER_READ_CHECKPOINT);
   readCheckpoint(tr, adef);
+  stopPhaseTimer(TIMER_READ_CHECKPOINT);
 
   switch(ckp.state)
     {
@@ -1758,7 +2007,8 @@ int determineRearrangementSetting(tree *tr,  analdef *adef, bestlist *bestT, bes
     bestTrav = 5;
 
   double 
-    startLH = tr->likelihood; 
+    startLH = tr->likelihood,
+    radiusTime = 0.0; 
   
   boolean 
     impr   = TRUE,
@@ -1790,8 +2040,20 @@ int determineRearrangementSetting(tree *tr,  analdef *adef, bestlist *bestT, bes
 
   while(impr && maxtrav < MaxFast)
     {	
+      /* with a time limit, only try the next (larger) radius if the last one would still fit into the remaining time */
+      if(tr->timeLimit > 0.0 && radiusTime > 0.0 && timeLimitReached(tr, radiusTime))
+	{
+	  printBothOpen("Time limit: rearrangement radius determination stopped after radius %d\n", maxtrav - 5);
+	  break;
+	}
+
+      radiusTime = gettime();
+
       recallBestTree(bestT, 1, tr);     
       nodeRectifier(tr);            
+
+      if(tr->parsimonyPrescreen)
+	resetParsimonyOrientation(tr);
       
       /* Andre I believe that the code below, except for
 	 writeCheckpoint cann still only be executed by process 0 =>
@@ -1835,6 +2097,9 @@ int determineRearrangementSetting(tree *tr,  analdef *adef, bestlist *bestT, bes
 	
 	for(i = 1; i <= tr->mxtips + tr->mxtips - 2; i++)
 	  {                	         
+	    if(sprTimeLimitReached(tr))
+	      break;
+
 	    tr->bestOfNode = unlikely;
 	    
 	    if(rearrangeBIG(tr, tr->nodep[i], 1, maxtrav))
@@ -1855,14 +2120,22 @@ int determineRearrangementSetting(tree *tr,  analdef *adef, bestlist *bestT, bes
 	  printBothOpen("Changes: %d TRAV: %d lh %f MNZC %d\n", changes, maxtrav, tr->likelihood, mnzc);
 	*/      
       }
+
+      /* out of time in the middle of the SPR moves: keep the tree as it is, the search will not start any SPR cycle */
+      if(sprCycleStopped)
+	{
+	  printBothOpen("Time limit: rearrangement radius determination stopped during radius %d\n", maxtrav);
+	  saveBestTree(bt, tr, TRUE);
+	  break;
+	}
       
       treeEvaluate(tr, 0.25);
 
       /* printBothOpen("TRAV: %d lh %f MNZC %d\n", maxtrav, tr->likelihood, mnzc); */
 
       saveBestTree(bt, tr, TRUE); 
-      if(tr->saveBestTrees)
-	saveBestTree(bestML, tr, FALSE);           
+      if(bestML)
+	saveBestML(tr, bestML);
                                          
 #ifdef _DEBUG_CHECKPOINTING
       printBothOpen("TRAV: %d lh %f MNZC %d\n", maxtrav, tr->likelihood, mnzc);
@@ -1890,7 +2163,8 @@ int determineRearrangementSetting(tree *tr,  analdef *adef, bestlist *bestT, bes
 	}
       
       maxtrav += 5;
-      
+
+      radiusTime = gettime() - radiusTime;
              
     }
 
@@ -1909,11 +2183,295 @@ int determineRearrangementSetting(tree *tr,  analdef *adef, bestlist *bestT, bes
 
 
 
+/* NNI moves for the fast topology search mode (--nni) */
+
+/* Newton-Raphson iterations for optimizing the central branch of an NNI alternative */
+#define NNI_NEWTON_ITERATIONS 3
+
+/* maximum number of NNI sweeps over all inner branches between two SPR cycles */
+#define NNI_MAX_SWEEPS 10
+
+/* minimum log likelihood improvement for accepting an NNI move */
+#define NNI_EPSILON 0.01
+
+/* 
+   exchanges the subtree p->next->back with the subtree q->next->back (swap == 1) or 
+   q->next->next->back (swap == 2) where q = p->back, the subtrees keep their branch lengths. 
+   Applying the same swap twice restores the original topology 
+*/
+static void nniSwap(tree *tr, nodeptr p, int swap)
+{
+  nodeptr
+    q = p->back,
+    s1 = p->next,
+    s2 = (swap == 1) ? q->next : q->next->next,
+    t1 = s1->back,
+    t2 = s2->back;
+
+  double
+    z1[NUM_BRANCHES],
+    z2[NUM_BRANCHES];
+
+  int
+    i;
+
+  for(i = 0; i < tr->numBranches; i++)
+    {
+      z1[i] = s1->z[i];
+      z2[i] = s2->z[i];
+    }
+
+  hookup(s1, t2, z2, tr->numBranches);
+  hookup(s2, t1, z1, tr->numBranches);
+}
+
+/* 
+   scores the current topology around the branch (p, q = p->back) after an NNI swap: 
+   the vectors at the four subtrees around the branch are still valid, hence only p and q 
+   need to be re-computed. The central branch is optimized with a few Newton-Raphson 
+   iterations starting from z0, the optimized branch length is returned in z 
+*/
+static double nniScore(tree *tr, nodeptr p, double *z0, double *z)
+{
+  nodeptr
+    q = p->back;
+
+  newviewGeneric(tr, p, FALSE);
+  newviewGeneric(tr, q, FALSE);
+
+  makenewzGeneric(tr, p, q, z0, NNI_NEWTON_ITERATIONS, z, FALSE);
+
+  hookup(p, q, z, tr->numBranches);
+
+  evaluateGeneric(tr, p, FALSE);
+
+  return tr->likelihood;
+}
+
+/* 
+   evaluates the two alternative topologies around the inner branch (p, p->back) 
+   and applies the best one if it improves the likelihood of the current tree, 
+   which is expected to be stored in tr->likelihood. Returns TRUE if the topology has changed 
+*/
+static boolean nniBranch(tree *tr, nodeptr p)
+{
+  nodeptr
+    q = p->back;
+
+  double
+    startLH = tr->likelihood,
+    bestLH = startLH,
+    z0[NUM_BRANCHES],
+    z[NUM_BRANCHES],
+    bestZ[NUM_BRANCHES];
+
+  int
+    i,
+    swap,
+    bestSwap = 0;
+
+  for(i = 0; i < tr->numBranches; i++)
+    z0[i] = p->z[i];
+
+  for(swap = 1; swap <= 2; swap++)
+    {
+      double
+	lh;
+
+      nniSwap(tr, p, swap);
+
+      lh = nniScore(tr, p, z0, z);
+
+      if(lh > bestLH + NNI_EPSILON)
+	{
+	  bestLH = lh;
+	  bestSwap = swap;
+	  for(i = 0; i < tr->numBranches; i++)
+	    bestZ[i] = z[i];
+	}
+
+      nniSwap(tr, p, swap);
+    }
+
+  if(bestSwap)
+    {
+      /* apply the best alternative again and re-compute the vectors at p and q */
+
+      nniSwap(tr, p, bestSwap);
+      hookup(p, q, bestZ, tr->numBranches);
+
+      newviewGeneric(tr, p, FALSE);
+      newviewGeneric(tr, q, FALSE);
+
+      tr->likelihood = bestLH;
+
+      return TRUE;
+    }
+  else
+    {
+      /* restore the original branch and the vectors at p and q */
+
+      hookup(p, q, z0, tr->numBranches);
+
+      newviewGeneric(tr, p, FALSE);
+      newviewGeneric(tr, q, FALSE);
+
+      tr->likelihood = startLH;
+
+      return FALSE;
+    }
+}
+
+/* collects one end of every branch that connects two inner nodes */
+static void nniCollectBranches(tree *tr, nodeptr p, nodeptr *branches, int *count)
+{
+  if(!isTip(p->number, tr->mxtips))
+    {
+      if(!isTip(p->back->number, tr->mxtips))
+	{
+	  branches[*count] = p;
+	  *count = *count + 1;
+	}
+
+      nniCollectBranches(tr, p->next->back, branches, count);
+      nniCollectBranches(tr, p->next->next->back, branches, count);
+    }
+}
+
+/* 
+   fast NNI-based hill climbing: sweeps over all inner branches of the tree, for each branch 
+   the two alternative topologies are scored using the vectors of the four adjacent subtrees 
+   and a few Newton-Raphson iterations on the central branch. Improving moves are applied 
+   immediately. Sweeps are repeated until no further improvement is found, then all 
+   branch lengths are optimized once. This converges to a good region of tree space 
+   at a fraction of the cost of an SPR cycle. 
+*/
+static void nniSearch(tree *tr)
+{
+  nodeptr
+    *branches = (nodeptr *)malloc(sizeof(nodeptr) * (size_t)tr->mxtips);
+
+  double
+    startLH,
+    t = gettime();
+
+  int
+    i,
+    sweeps = 0,
+    moves = 0,
+    improved;
+
+  /* NNI moves could violate the constraint */
+  if(tr->constraintTree)
+    {
+      free(branches);
+      return;
+    }
+
+  evaluateGeneric(tr, tr->start, TRUE);
+
+  startLH = tr->likelihood;
+
+  do
+    {
+      int
+	count = 0;
+
+      improved = 0;
+
+      nniCollectBranches(tr, tr->start->back, branches, &count);
+
+      assert(count == tr->mxtips - 3);
+
+      for(i = 0; i < count; i++)
+	if(!isTip(branches[i]->back->number, tr->mxtips) && nniBranch(tr, branches[i]))
+	  improved++;
+
+      moves += improved;
+      sweeps++;
+    }
+  while(improved && sweeps < NNI_MAX_SWEEPS);
+
+  if(moves > 0)
+    treeEvaluate(tr, 1.0);
+
+  printBothOpen("NNI search: %d moves in %d sweeps, likelihood %f -> %f, time %f\n", moves, sweeps, startLH, tr->likelihood, gettime() - t);
+
+  free(branches);
+}
+
+
+
+/* time-limited search (--time-limit) */
+
+/* fraction of the time limit that is kept in reserve for the final evaluation and output */
+#define TIME_LIMIT_RESERVE 0.05
+
+static double remainingTime(tree *tr)
+{
+  return (1.0 - TIME_LIMIT_RESERVE) * tr->timeLimit - (gettime() - masterTime);
+}
+
+/* 
+   returns TRUE if a step of the given expected duration can not be completed within the time limit.
+   The decision of process 0 is used by all processes, since their clocks differ slightly 
+*/
+boolean timeLimitReached(tree *tr, double expectedDuration)
+{
+  int 
+    reached = (remainingTime(tr) < expectedDuration) ? 1 : 0;
+
+  MPI_Bcast(&reached, 1, MPI_INT, 0, comm);
+
+  return (reached ? TRUE : FALSE);
+}
+
+/* 
+   returns the largest number of rearrangement radii (at most maxRadii) for the next SPR cycle, such that 
+   its predicted duration fits into the remaining time, or 0 if not even a single radius fits.
+   The duration of the last cycle that used lastRadii radii is split into the time for the SPR moves, 
+   which we assume to be proportional to the number of radii, and the time for the rest of the cycle 
+   (mainly the branch length optimization of the best trees). If the last cycle had to be stopped 
+   early, no further cycle fits 
+*/
+static int timeLimitedRadii(tree *tr, double sprTime, double otherTime, int lastRadii, int maxRadii)
+{
+  double
+    remaining = remainingTime(tr);
+
+  int 
+    radii = maxRadii;
+
+  if(sprCycleStopped)
+    radii = 0;
+  else if(lastRadii == 0)
+    {
+      /* nothing measured yet (after a restart), treeOptimizeRapid() stops the cycle if it runs out of time */
+      if(remaining <= 0.0)
+	radii = 0;
+    }
+  else
+    {
+      double 
+	perRadius = sprTime / (double)lastRadii;
+      
+      while(radii > 0 && otherTime + perRadius * (double)radii > remaining)
+	radii--;
+    }
+
+  MPI_Bcast(&radii, 1, MPI_INT, 0, comm);
+
+  return radii;
+}
+
+
 void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel) 
 {   
   int
     i,
     impr, 
+    radii,
+    cycleRadii = 0,
     bestTrav = 0,
     treeVectorLength = 0,
     rearrangementsMax = 0, 
@@ -1925,7 +2483,12 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
     lh = unlikely, 
     previousLh = unlikely, 
     difference, 
-    epsilon;              
+    epsilon,
+    cycleStart,
+    sprTime = 0.0,
+    otherTime = 0.0,
+    settingTime = 0.0,
+    initialTime = 0.0;              
   
   bestlist 
     *bestML,
@@ -1937,6 +2500,9 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
   tr->lhAVG = 0.0;
   tr->lhDEC = 0.0;
 
+  sprCycleStopped = FALSE;
+  thoroughRadiusTime = 0.0;
+
   /* initialization for the hash table to compute RF distances */
 
   if(tr->searchConvergenceCriterion && processID == 0)   
@@ -1955,11 +2521,13 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
 
 
 
-  if(tr->saveBestTrees > 0)
+  /* the good trees are also the alternative trees for the RELL supports */
+
+  if(tr->saveBestTrees > 0 || tr->rellTrees > 0)
     { 
       bestML = (bestlist *) malloc(sizeof(bestlist));      
       bestML->ninit = 0;
-      initBestTree(bestML, tr->saveBestTrees, tr->mxtips);  
+      initBestTree(bestML, MAX(tr->saveBestTrees, tr->rellTrees), tr->mxtips);  
     }
   else
     bestML = (bestlist *)NULL;
@@ -1969,6 +2537,12 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
      RAxML-specific and should probably not be in the library */
 
   initInfoList(50);
+
+  if(tr->parsimonyPrescreen)
+    allocateParsimonyDataStructures(tr);
+
+  if(tr->clvCacheEntries > 0)
+    initClvCache(tr);
  
   /* some pretty atbitrary thresholds */
 
@@ -2016,7 +2590,9 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
     {
       if((!adef->useCheckpoint) || (adef->useCheckpoint && ckp.state == REARR_SETTING))
 	{
+	  settingTime = gettime();
 	  bestTrav = adef->bestTrav = determineRearrangementSetting(tr, adef, bestT, bt, bestML);     	  
+	  settingTime = gettime() - settingTime;
 	  printBothOpen("\nBest rearrangement radius: %d\n", bestTrav);
 	}
     }
@@ -2032,10 +2608,14 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
     {      
 
       /* optimize model params more thoroughly or just optimize branch lengths */
+      initialTime = gettime();
+
       if(estimateModel)
 	modOpt(tr, 5.0, adef, 0);
       else
 	treeEvaluate(tr, 1);   
+
+      initialTime = gettime() - initialTime;
     }
   
   /* save the current tree again, while the topology has not changed, the branch lengths have changed in the meantime, hence
@@ -2107,6 +2687,9 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
 	/* otherwise, restore the currently best tree */
 	recallBestTree(bestT, 1, tr); 
 
+      /* safe point: no vectors need to be preserved, re-distribute sites if processes are imbalanced */
+      rebalanceSiteAssignment(tr);
+
       /* save states of algorithmic/heuristic variables for printing the next checkpoint */
 
       /* 
@@ -2152,6 +2735,55 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
 	writeCheckpoint(tr, adef); 
       }	
 
+      /* with a time limit we stop the search here if the next SPR cycle can not be completed in time 
+	 (the search can be continued from the checkpoint above), or reduce its rearrangement radius such that it can */
+
+      radii = bestTrav;
+
+      if(tr->timeLimit > 0.0)
+	{
+	  /* the initial model optimization and the radius determination are only checked coarsely, hence they may 
+	     have used up the whole time limit already */
+
+	  if(fastIterations == 0 && gettime() - masterTime > tr->timeLimit)
+	    printBothOpen("\nWARNING: the time limit of %f seconds was exceeded before the first fast SPR cycle, after %f seconds\n"
+			  "WARNING: the initial model optimization and the determination of the rearrangement radius took too long,\n"
+			  "WARNING: consider a larger time limit or setting the rearrangement radius via -i\n\n", 
+			  tr->timeLimit, gettime() - masterTime);
+
+	  /* 
+	     before the first cycle, determineRearrangementSetting() has done the SPR moves of at least 
+	     one fast cycle with bestTrav radii (and of the smaller radii before it), hence its duration 
+	     bounds the SPR moves of the first cycle from above. The model or branch length optimization 
+	     that followed it stands in for the rest of the cycle 
+	  */
+
+	  if(cycleRadii == 0 && settingTime > 0.0)
+	    {
+	      sprTime = settingTime;
+	      otherTime = initialTime;
+	      cycleRadii = bestTrav;
+	    }
+
+	  radii = timeLimitedRadii(tr, sprTime, otherTime, cycleRadii, bestTrav);
+
+	  if(radii == 0)
+	    {
+	      printBothOpen("\nTime limit: stopping the search after %d fast SPR cycles\n", fastIterations);
+
+	      if(tr->searchConvergenceCriterion && processID == 0)
+		{
+		  cleanupHashTable(tr->h, 0);
+		  cleanupHashTable(tr->h, 1);
+		}
+
+	      goto cleanup;
+	    }
+
+	  if(radii < bestTrav)
+	    printBothOpen("Time limit: rearrangement radius of the next fast SPR cycle reduced to %d\n", radii);
+	}
+
       /* this is the aforementioned convergence criterion that requires computing the RF,
 	 let's not worry about this right now */
 
@@ -2191,7 +2823,7 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
 	      double 
 		rrf = convergenceCriterion(tr->h, tr->mxtips);
 	      
-	      MPI_Bcast(&rrf, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	      MPI_Bcast(&rrf, 1, MPI_DOUBLE, 0, comm);
 	      
 	      if(rrf <= 0.01) /* 1% cutoff */
 		{
@@ -2211,7 +2843,7 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
 	  double 
 	    rrf;
 	  
-	  MPI_Bcast(&rrf, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	  MPI_Bcast(&rrf, 1, MPI_DOUBLE, 0, comm);
 	 
 	  if(rrf <= 0.01) /* 1% cutoff */		   
 	    goto cleanup_fast;	      
@@ -2222,10 +2854,22 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
 
       fastIterations++;	
 
+      cycleStart = gettime();
+
       /* optimize branch lengths */
      
-     
+      startPhaseTimer(TIMER_SPR_BRANCHES);
       treeEvaluate(tr, 1.0);    
+      stopPhaseTimer(TIMER_SPR_BRANCHES);
+
+      /* quickly sweep over the tree with NNI moves before the next SPR cycle */
+
+      if(tr->nniSearch)
+	{
+	  startPhaseTimer(TIMER_SPR_NNI);
+	  nniSearch(tr);
+	  stopPhaseTimer(TIMER_SPR_NNI);
+	}
      
       /* save the tree with those branch lengths again */
       
@@ -2245,7 +2889,14 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
             
       /* in here we actually do a cycle of SPR moves */
 
-      treeOptimizeRapid(tr, 1, bestTrav, adef, bt, bestML);   
+      sprTime = gettime();
+      sprReserve = otherTime;
+      startPhaseTimer(TIMER_SPR_REARRANGE);
+
+      treeOptimizeRapid(tr, 1, radii, adef, bt, bestML);   
+
+      stopPhaseTimer(TIMER_SPR_REARRANGE);
+      sprTime = gettime() - sprTime;
           
       /* set impr to 0 since in the immediately following for loop we check if the SPR moves above have generated 
 	 a better tree */
@@ -2255,6 +2906,8 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
       /* loop over the 20 best trees generated by the fast SPR moves, and check if they improve the likelihood after all of their branch lengths
 	 have been optimized */
 
+      startPhaseTimer(TIMER_SPR_CANDIDATES);
+
       for(i = 1; i <= bt->nvalid; i++)
 	{	    	
 	  /* restore tree i from list generated by treeOptimizeRapid */
@@ -2282,6 +2935,11 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
 	      
 	    }	   	   
 	}
+
+      stopPhaseTimer(TIMER_SPR_CANDIDATES);
+
+      otherTime = gettime() - cycleStart - sprTime;
+      cycleRadii = radii;
 #ifdef _DEBUG_CHECKPOINTING
       printBothOpen("FAST LH: %f\n", lh);
 #endif
@@ -2330,11 +2988,21 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
      optimize branch lengths and leave the other model parameters (GTR rates, alhpa) 
      alone */
 
+  /* with a time limit, modOpt() stops iterating once the next iteration does not fit anymore */
+
   if(estimateModel)
     modOpt(tr, 1.0, adef, 0);
   else
     treeEvaluate(tr, 1.0);
 
+  /* 
+     for the time limit, the first thorough SPR cycle is predicted from the thorough rearrangements 
+     of the best subtrees at the end of the last fast cycle, which are applied to every subtree now 
+  */
+
+  if(thoroughRadiusTime > 0.0 && cycleRadii > 0)
+    sprTime = thoroughRadiusTime * (double)(tr->mxtips + tr->mxtips - 2) * (double)cycleRadii;
+
   /* start loop that executes thorough SPR cycles */
 
   while(1)
@@ -2379,6 +3047,8 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
 	   structuire tr */
 	recallBestTree(bestT, 1, tr);
 
+      rebalanceSiteAssignment(tr);
+
       /* now, we write a checkpoint */
       /* Andre I believe that the code below, except for
 	 writeCheckpoint cann still only be executed by process 0
@@ -2468,7 +3138,7 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
 		  double 
 		    rrf = convergenceCriterion(tr->h, tr->mxtips);
 		  
-		  MPI_Bcast(&rrf, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+		  MPI_Bcast(&rrf, 1, MPI_DOUBLE, 0, comm);
 		  
 		  if(rrf <= 0.01) /* 1% cutoff */
 		    {
@@ -2486,7 +3156,7 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
 	      double 
 		rrf;
 	      
-	      MPI_Bcast(&rrf, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	      MPI_Bcast(&rrf, 1, MPI_DOUBLE, 0, comm);
 	      
 	      if(rrf <= 0.01) /* 1% cutoff */		   
 		goto cleanup;	      
@@ -2507,10 +3177,35 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
 	  if(rearrangementsMax > adef->max_rearrange)	     	     	 
 	    goto cleanup; 	   
 	}
+
+      /* as for the fast SPR cycles, stop or only try the smaller radii of the window if time runs out */
+
+      radii = rearrangementsMax - rearrangementsMin + 1;
+
+      if(tr->timeLimit > 0.0)
+	{
+	  int 
+	    maxRadii = radii;
+
+	  radii = timeLimitedRadii(tr, sprTime, otherTime, cycleRadii, maxRadii);
+
+	  if(radii == 0)
+	    {
+	      printBothOpen("\nTime limit: stopping the search in the thorough SPR phase\n");
+	      goto cleanup;
+	    }
+
+	  if(radii < maxRadii)
+	    printBothOpen("Time limit: rearrangement radii of the next thorough SPR cycle reduced to %d-%d\n", rearrangementsMin, rearrangementsMin + radii - 1);
+	}
+
+      cycleStart = gettime();
       
       /* optimize branch lengths of best tree */
 
+      startPhaseTimer(TIMER_SPR_BRANCHES);
       treeEvaluate(tr, 1.0);
+      stopPhaseTimer(TIMER_SPR_BRANCHES);
      
       /* do some bokkeeping and printouts again */
       previousLh = lh = tr->likelihood;	      
@@ -2519,13 +3214,22 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
 
       /* do a cycle of thorough SPR moves with the minimum and maximum rearrangement radii */
 
-      treeOptimizeRapid(tr, rearrangementsMin, rearrangementsMax, adef, bt, bestML);
+      sprTime = gettime();
+      sprReserve = otherTime;
+      startPhaseTimer(TIMER_SPR_REARRANGE);
+
+      treeOptimizeRapid(tr, rearrangementsMin, rearrangementsMin + radii - 1, adef, bt, bestML);
+
+      stopPhaseTimer(TIMER_SPR_REARRANGE);
+      sprTime = gettime() - sprTime;
 	
       impr = 0;			      		            
 
       /* once again get the best 20 trees produced by the SPR cycle, load them from the bt tree list into tr
 	 optimize their branch lengths and figure out if the LnL of the tree has improved */
 
+      startPhaseTimer(TIMER_SPR_CANDIDATES);
+
       for(i = 1; i <= bt->nvalid; i++)
 	{		 
 	  recallBestTree(bt, i, tr);	 	    	    	
@@ -2543,6 +3247,11 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
 	    }	   	   
 	}  
 
+      stopPhaseTimer(TIMER_SPR_CANDIDATES);
+
+      otherTime = gettime() - cycleStart - sprTime;
+      cycleRadii = radii;
+
 #ifdef _DEBUG_CHECKPOINTING
       printBothOpen("SLOW LH: %f\n", lh);              
 #endif
@@ -2558,12 +3267,28 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
   printBothOpen("After SLOW SPRs Final %f\n", tr->likelihood);   
 #endif
    
-  printBothOpen("\nLikelihood of best tree: %f\n", tr->likelihood);
+  /* the likelihood of a bootstrap replicate is reported by computeBootstraps() */
+  if(!adef->boot)
+    printBothOpen("\nLikelihood of best tree: %f\n", tr->likelihood);
   /* print the absolut best tree */
 
   printLog(tr);
   printResult(tr, adef, TRUE);
 
+  /* the search is over, the RELL supports below are computed from full traversals anyway */
+
+  if(tr->clvCacheEntries > 0)
+    {
+      printClvCacheStatistics();
+      freeClvCache(tr);
+    }
+
+  if(tr->clvBudget > 0)
+    printRecomputationStatistics(tr);
+
+  if(tr->rellTrees > 0)
+    computeRELLSupports(tr, bestML);
+
   /* print other good trees encountered during the search */
 
   if(tr->saveBestTrees > 0)
@@ -2571,10 +3296,13 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
       char 
 	fileName[2048] = "",
 	buf[64] = "";
+
+      int
+	goodTrees = MIN(bestML->nvalid, tr->saveBestTrees);
      
-      printBothOpen("\n\nEvaluating %d other good ML trees\n\n", bestML->nvalid);
+      printBothOpen("\n\nEvaluating %d other good ML trees\n\n", goodTrees);
       
-      for(i = 1; i <= bestML->nvalid; i++)
+      for(i = 1; i <= goodTrees; i++)
 	{		 
 	  recallBestTree(bestML, i, tr);	 	    	    		  
 	  /*treeEvaluate(tr, 0.25);*/
@@ -2587,7 +3315,7 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
 
 	      strcpy(fileName,       workdir);
 	      strcat(fileName, "RAxML_");
-	      sprintf(buf, "%d", bestML->nvalid);
+	      sprintf(buf, "%d", goodTrees);
 	      strcat(fileName, buf);
 	      strcat(fileName, "_goodTrees.");
 	      strcat(fileName, run_id);
@@ -2621,7 +3349,18 @@ void computeBIGRAPID (tree *tr, analdef *adef, boolean estimateModel)
   free(bestT);
   freeBestTree(bt);
   free(bt);
+  if(bestML)
+    {
+      freeBestTree(bestML);
+      free(bestML);
+    }
   freeInfoList();  
+
+  if(tr->parsimonyPrescreen)
+    {
+      printParsimonyPrescreenStatistics();
+      freeParsimonyDataStructures(tr);
+    }
   
 
   /* and we are done, return to main() in axml.c  */
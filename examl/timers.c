@@ -0,0 +1,628 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include <mpi.h>
+
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+#include "axml.h"
+
+extern int processID;
+extern int processes;
+extern MPI_Comm comm;
+
+
+/*
+   Phase and kernel timers (--timers).
+
+   The timers are always compiled in, but they only read the clock once they have been
+   enabled, otherwise every start and stop is a function call that returns immediately.
+   We use clock_gettime(CLOCK_MONOTONIC), which is served from user space (vDSO) on Linux
+   and costs a few tens of nanoseconds, unlike RDTSC it does not depend on the clock
+   frequency and needs no calibration.
+
+   - kernel timers accumulate the time of the likelihood kernels (newview, evaluate,
+     the sumtable of makenewz, and execCore) per data type and tip case, that is, around a
+     single call for one partition and one traversal descriptor entry. Under OpenMP only
+     the master thread records them.
+   - phase timers accumulate the time of the stages of the model optimization (modOpt()),
+     of the SPR cycles in computeBIGRAPID(), of the I/O, and of the checkpoints. The phases
+     include the kernel times spent in them and a phase may be nested in another one (e.g.,
+     the model optimization in the search), but not in itself.
+
+   printTimerReport() collects the timers of all processes and writes the min/avg/max over
+   the processes and a per-process summary to the info file.
+
+   With --perf-counters, the kernel timers additionally read a group of hardware counters
+   (perf_event_open(), user space only) at the start and the end of every kernel call: cycles,
+   instructions, last level cache misses, and optionally raw floating point events with the number
+   of floating point operations per event, e.g., for Intel CPUs since Skylake
+
+     --perf-counters=r01c7:1,r04c7:2,r10c7:4
+
+   (FP_ARITH_INST_RETIRED.SCALAR_DOUBLE, 128B_PACKED_DOUBLE, and 256B_PACKED_DOUBLE). The report gives
+   the IPC, the memory bandwidth estimated from the cache misses (64 bytes each), and the FLOP rate
+   per kernel and data type. Reading the group costs a system call per kernel call, hence the
+   counters should be used for tuning runs. Processes on which the counters can not be opened (e.g.,
+   perf_event_paranoid > 2 or in a virtual machine without a PMU) only report the timers.
+*/
+
+#define TIP_CASES       4	/* TIP_TIP, TIP_INNER, INNER_INNER, and kernels without tip case */
+#define KERNEL_TIMERS   (NUM_KERNELS * MAX_MODEL * TIP_CASES)
+#define TIMER_SLOTS     (NUM_PHASE_TIMERS + KERNEL_TIMERS)
+#define RANK_COLUMNS    5
+
+#define MAX_COUNTERS    8
+#define COUNTER_CYCLES        0
+#define COUNTER_INSTRUCTIONS  1
+#define COUNTER_CACHE_MISSES  2
+#define FIRST_FLOP_COUNTER    3
+#define CACHE_LINE_BYTES      64.0
+
+/* per process: seconds and calls of all timers, counters of the kernel timers, number of open counters */
+#define RECORD_LENGTH   (2 * TIMER_SLOTS + KERNEL_TIMERS * MAX_COUNTERS + 1)
+
+static boolean
+  timersEnabled = FALSE;
+
+static double
+  phaseStart[NUM_PHASE_TIMERS],
+  timerSeconds[TIMER_SLOTS],
+  timerCalls[TIMER_SLOTS];
+
+static boolean
+  countersRequested = FALSE;
+
+static int
+  numberOfCounters = 0,
+  counterFd[MAX_COUNTERS];
+
+static double
+  flopsPerEvent[MAX_COUNTERS],
+  counterStart[MAX_COUNTERS],
+  counterValues[KERNEL_TIMERS][MAX_COUNTERS];
+
+static const char
+  *phaseNames[NUM_PHASE_TIMERS] =
+  {
+    "input: binary alignment",
+    "input: checkpoint",
+    "output: checkpoints",
+    "output: trees and log",
+    "likelihood reductions",
+    "modOpt: substitution rates",
+    "modOpt: base frequencies",
+    "modOpt: POMO phi",
+    "modOpt: alpha",
+    "modOpt: rate categories",
+    "modOpt: branch lengths",
+    "SPR: branch lengths",
+    "SPR: NNI moves",
+    "SPR: rearrangements",
+    "SPR: best trees"
+  },
+  *kernelNames[NUM_KERNELS] = {"newview", "evaluate", "makenewz", "execCore"},
+  *dataTypeNames[MAX_MODEL] = {"BINARY", "DNA", "AA", "SECONDARY", "SECONDARY_6", "SECONDARY_7",
+			       "GENERIC_32", "GENERIC_64", "POMO_16", "POMO_64"},
+  *tipCaseNames[TIP_CASES] = {"TIP_TIP", "TIP_INNER", "INNER_INNER", ""},
+  *rankColumnNames[RANK_COLUMNS] = {"kernels", "reductions", "modOpt", "SPR", "I/O"};
+
+
+static double now(void)
+{
+  struct timespec
+    t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+
+  return (double)t.tv_sec + (double)t.tv_nsec * 1.0e-9;
+}
+
+static int openCounter(uint32_t type, uint64_t config, int groupFd)
+{
+  struct perf_event_attr
+    attr;
+
+  memset(&attr, 0, sizeof(attr));
+
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = (groupFd == -1) ? 1 : 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  return (int)syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+static void closeCounters(void)
+{
+  int
+    i;
+
+  for(i = 0; i < numberOfCounters; i++)
+    close(counterFd[i]);
+
+  numberOfCounters = 0;
+}
+
+/* parses the raw events "rHEX:flops,rHEX:flops,..." of --perf-counters and opens the counter group */
+static void initCounters(const char *events)
+{
+  uint64_t
+    rawEvents[MAX_COUNTERS];
+
+  int
+    i,
+    numberOfRawEvents = 0;
+
+  while(events && *events)
+    {
+      unsigned long long
+	code;
+
+      double
+	flops;
+
+      int
+	length;
+
+      if(numberOfRawEvents == MAX_COUNTERS - FIRST_FLOP_COUNTER ||
+	 sscanf(events, "r%llx:%lf%n", &code, &flops, &length) != 2 || flops <= 0.0)
+	{
+	  if(processID == 0)
+	    printf("\nError, \"--perf-counters\" expects up to %d raw events with their floating point operations, e.g., r01c7:1,r10c7:4\n\n",
+		   MAX_COUNTERS - FIRST_FLOP_COUNTER);
+	  errorExit(-1);
+	}
+
+      rawEvents[numberOfRawEvents] = (uint64_t)code;
+      flopsPerEvent[FIRST_FLOP_COUNTER + numberOfRawEvents] = flops;
+      numberOfRawEvents++;
+
+      events += length;
+
+      if(*events == ',')
+	events++;
+    }
+
+  counterFd[COUNTER_CYCLES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+
+  if(counterFd[COUNTER_CYCLES] < 0)
+    {
+      if(processID == 0)
+	printf("\nWarning, hardware counters are not available (%s), \"--perf-counters\" only reports the timers\n\n", strerror(errno));
+      return;
+    }
+
+  numberOfCounters = 1;
+
+  counterFd[COUNTER_INSTRUCTIONS] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, counterFd[COUNTER_CYCLES]);
+  counterFd[COUNTER_CACHE_MISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, counterFd[COUNTER_CYCLES]);
+
+  for(i = 0; i < numberOfRawEvents; i++)
+    counterFd[FIRST_FLOP_COUNTER + i] = openCounter(PERF_TYPE_RAW, rawEvents[i], counterFd[COUNTER_CYCLES]);
+
+  for(i = 1; i < FIRST_FLOP_COUNTER + numberOfRawEvents; i++)
+    {
+      if(counterFd[i] < 0)
+	{
+	  if(processID == 0)
+	    printf("\nWarning, hardware counter %d of \"--perf-counters\" can not be opened (%s), only reporting the timers\n\n", i, strerror(errno));
+	  closeCounters();
+	  return;
+	}
+
+      numberOfCounters++;
+    }
+
+  ioctl(counterFd[COUNTER_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+/* reads the counter group, the values are scaled up if the kernel had to multiplex the counters */
+static void readCounters(double *values)
+{
+  uint64_t
+    buffer[3 + MAX_COUNTERS];
+
+  double
+    scale = 0.0;
+
+  int
+    i;
+
+  if(read(counterFd[COUNTER_CYCLES], buffer, sizeof(buffer)) < (ssize_t)(sizeof(uint64_t) * (size_t)(3 + numberOfCounters)))
+    {
+      memset(values, 0, sizeof(double) * MAX_COUNTERS);
+      return;
+    }
+
+  /* buffer[0] is the number of counters, followed by the time enabled and running */
+
+  if(buffer[2] > 0)
+    scale = (double)buffer[1] / (double)buffer[2];
+
+  for(i = 0; i < numberOfCounters; i++)
+    values[i] = (double)buffer[3 + i] * scale;
+}
+
+void initTimers(tree *tr)
+{
+  timersEnabled = tr->timers;
+  countersRequested = tr->perfCounters;
+
+  memset(phaseStart, 0, sizeof(phaseStart));
+  memset(timerSeconds, 0, sizeof(timerSeconds));
+  memset(timerCalls, 0, sizeof(timerCalls));
+  memset(counterValues, 0, sizeof(counterValues));
+
+  if(countersRequested)
+    initCounters(tr->perfCounterEvents);
+}
+
+/* returns the start time for stopKernelTimer(), 0.0 if the timers are disabled */
+double startKernelTimer(void)
+{
+  if(!timersEnabled)
+    return 0.0;
+
+#ifdef _USE_OMP
+  if(omp_get_thread_num() != 0)
+    return 0.0;
+#endif
+
+  if(numberOfCounters > 0)
+    readCounters(counterStart);
+
+  return now();
+}
+
+/* tipCase is TIP_TIP, TIP_INNER, INNER_INNER, or -1 for kernels that do not distinguish them */
+void stopKernelTimer(int kernel, int dataType, int tipCase, double start)
+{
+  int
+    slot;
+
+  if(!timersEnabled)
+    return;
+
+#ifdef _USE_OMP
+  if(omp_get_thread_num() != 0)
+    return;
+#endif
+
+  assert(kernel >= 0 && kernel < NUM_KERNELS && dataType >= 0 && dataType < MAX_MODEL && tipCase <= INNER_INNER);
+
+  slot = NUM_PHASE_TIMERS + (kernel * MAX_MODEL + dataType) * TIP_CASES + ((tipCase < 0) ? TIP_CASES - 1 : tipCase);
+
+  timerSeconds[slot] += now() - start;
+  timerCalls[slot] += 1.0;
+
+  if(numberOfCounters > 0)
+    {
+      double
+	values[MAX_COUNTERS];
+
+      int
+	i;
+
+      readCounters(values);
+
+      for(i = 0; i < numberOfCounters; i++)
+	counterValues[slot - NUM_PHASE_TIMERS][i] += values[i] - counterStart[i];
+    }
+}
+
+void startPhaseTimer(int phase)
+{
+  if(timersEnabled)
+    phaseStart[phase] = now();
+}
+
+void stopPhaseTimer(int phase)
+{
+  if(timersEnabled)
+    {
+      timerSeconds[phase] += now() - phaseStart[phase];
+      timerCalls[phase] += 1.0;
+    }
+}
+
+static void timerName(int slot, char *name)
+{
+  if(slot < NUM_PHASE_TIMERS)
+    strcpy(name, phaseNames[slot]);
+  else
+    {
+      int
+	k = slot - NUM_PHASE_TIMERS,
+	tipCase = k % TIP_CASES,
+	dataType = (k / TIP_CASES) % MAX_MODEL,
+	kernel = k / (TIP_CASES * MAX_MODEL);
+
+      sprintf(name, "kernel: %s %s %s", kernelNames[kernel], dataTypeNames[dataType], tipCaseNames[tipCase]);
+    }
+}
+
+/* column of the per-process summary a timer is added to */
+static int rankColumn(int slot)
+{
+  if(slot >= NUM_PHASE_TIMERS)
+    return 0;
+
+  switch(slot)
+    {
+    case TIMER_REDUCTION:
+      return 1;
+    case TIMER_MODOPT_RATES:
+    case TIMER_MODOPT_FREQS:
+    case TIMER_MODOPT_PHI:
+    case TIMER_MODOPT_ALPHAS:
+    case TIMER_MODOPT_CATS:
+    case TIMER_MODOPT_BRANCHES:
+      return 2;
+    case TIMER_SPR_BRANCHES:
+    case TIMER_SPR_NNI:
+    case TIMER_SPR_REARRANGE:
+    case TIMER_SPR_CANDIDATES:
+      return 3;
+    case TIMER_READ_ALIGNMENT:
+    case TIMER_READ_CHECKPOINT:
+    case TIMER_WRITE_CHECKPOINT:
+    case TIMER_OUTPUT:
+      return 4;
+    default:
+      assert(0);
+    }
+
+  return -1;
+}
+
+/* adds the time and the counters of kernel timer k of all processes that have opened the counters */
+static void addCounters(double *all, int k, double *seconds, double *counters, int *numberOfEvents)
+{
+  int
+    rank,
+    i;
+
+  for(rank = 0; rank < processes; rank++)
+    {
+      double
+	*record = &all[rank * RECORD_LENGTH];
+
+      if(record[RECORD_LENGTH - 1] == 0.0)
+	continue;
+
+      *seconds += record[NUM_PHASE_TIMERS + k];
+
+      for(i = 0; i < MAX_COUNTERS; i++)
+	counters[i] += record[2 * TIMER_SLOTS + k * MAX_COUNTERS + i];
+
+      *numberOfEvents = MAX(*numberOfEvents, (int)record[RECORD_LENGTH - 1]);
+    }
+}
+
+static void printCounterLine(const char *name, double seconds, double *counters, int numberOfEvents, int processesWithCounters)
+{
+  char
+    flopRate[32] = "-";
+
+  int
+    i;
+
+  double
+    flops = 0.0;
+
+  if(seconds <= 0.0 || counters[COUNTER_CYCLES] <= 0.0)
+    return;
+
+  if(numberOfEvents > FIRST_FLOP_COUNTER)
+    {
+      for(i = FIRST_FLOP_COUNTER; i < numberOfEvents; i++)
+	flops += counters[i] * flopsPerEvent[i];
+
+      sprintf(flopRate, "%.3f", flops / seconds * 1.0e-9);
+    }
+
+  /* the seconds and counts are summed up over the processes, hence the rates are per process */
+
+  printBothOpen("%-45s %10.3f %8.2f %8.3f %12.3e %10.3f %10s\n", name, seconds / (double)processesWithCounters,
+		counters[COUNTER_INSTRUCTIONS] / counters[COUNTER_CYCLES], counters[COUNTER_CYCLES] / seconds * 1.0e-9,
+		counters[COUNTER_CACHE_MISSES], counters[COUNTER_CACHE_MISSES] * CACHE_LINE_BYTES / seconds * 1.0e-9, flopRate);
+}
+
+static void printCounterReport(double *all)
+{
+  int
+    rank,
+    k,
+    dataType,
+    numberOfEvents = 0,
+    processesWithCounters = 0;
+
+  for(rank = 0; rank < processes; rank++)
+    if(all[rank * RECORD_LENGTH + RECORD_LENGTH - 1] > 0.0)
+      processesWithCounters++;
+
+  if(processesWithCounters == 0)
+    {
+      printBothOpen("Hardware counters (--perf-counters): not available on any process\n\n");
+      return;
+    }
+
+  printBothOpen("Hardware counters of the kernels (--perf-counters) on %d of %d processes, rates per process,\n", processesWithCounters, processes);
+  printBothOpen("bandwidth estimated from the last level cache misses:\n\n");
+  printBothOpen("%-45s %10s %8s %8s %12s %10s %10s\n", "timer", "seconds", "IPC", "GHz", "LLC misses", "GB/s", "GFLOP/s");
+
+  for(k = 0; k < KERNEL_TIMERS; k++)
+    {
+      char
+	name[128];
+
+      double
+	seconds = 0.0,
+	counters[MAX_COUNTERS];
+
+      memset(counters, 0, sizeof(counters));
+
+      addCounters(all, k, &seconds, counters, &numberOfEvents);
+
+      timerName(NUM_PHASE_TIMERS + k, name);
+
+      printCounterLine(name, seconds, counters, numberOfEvents, processesWithCounters);
+    }
+
+  printBothOpen("\n");
+
+  /* all kernels of a data type */
+
+  for(dataType = 0; dataType < MAX_MODEL; dataType++)
+    {
+      char
+	name[128];
+
+      double
+	seconds = 0.0,
+	counters[MAX_COUNTERS];
+
+      int
+	kernel,
+	tipCase;
+
+      memset(counters, 0, sizeof(counters));
+
+      for(kernel = 0; kernel < NUM_KERNELS; kernel++)
+	for(tipCase = 0; tipCase < TIP_CASES; tipCase++)
+	  addCounters(all, (kernel * MAX_MODEL + dataType) * TIP_CASES + tipCase, &seconds, counters, &numberOfEvents);
+
+      sprintf(name, "all kernels %s", dataTypeNames[dataType]);
+
+      printCounterLine(name, seconds, counters, numberOfEvents, processesWithCounters);
+    }
+
+  printBothOpen("\n");
+}
+
+/**
+   collects the timers of all processes and prints the summary to the info file,
+   must be called by all processes.
+ */
+void printTimerReport(void)
+{
+  double
+    local[RECORD_LENGTH],
+    *all = (double *)NULL;
+
+  if(!timersEnabled)
+    return;
+
+  memcpy(local, timerSeconds, sizeof(timerSeconds));
+  memcpy(local + TIMER_SLOTS, timerCalls, sizeof(timerCalls));
+  memcpy(local + 2 * TIMER_SLOTS, counterValues, sizeof(counterValues));
+  local[RECORD_LENGTH - 1] = (double)numberOfCounters;
+
+  if(processID == 0)
+    all = (double *)malloc(sizeof(double) * RECORD_LENGTH * (size_t)processes);
+
+  MPI_Gather(local, RECORD_LENGTH, MPI_DOUBLE, all, RECORD_LENGTH, MPI_DOUBLE, 0, comm);
+
+  if(processID == 0)
+    {
+      int
+	slot,
+	rank,
+	column;
+
+      printBothOpen("\nTime per process in seconds (--timers), the phases include the kernel time spent in them:\n\n");
+      printBothOpen("%-45s %12s %10s %10s %10s %8s\n", "timer", "calls (avg)", "min", "avg", "max", "max rank");
+
+      for(slot = 0; slot < TIMER_SLOTS; slot++)
+	{
+	  char
+	    name[128];
+
+	  double
+	    minimum = all[slot],
+	    maximum = all[slot],
+	    sum = 0.0,
+	    calls = 0.0;
+
+	  int
+	    maxRank = 0;
+
+	  for(rank = 0; rank < processes; rank++)
+	    {
+	      double
+		t = all[rank * RECORD_LENGTH + slot];
+
+	      sum += t;
+	      calls += all[rank * RECORD_LENGTH + TIMER_SLOTS + slot];
+
+	      minimum = MIN(minimum, t);
+
+	      if(t > maximum)
+		{
+		  maximum = t;
+		  maxRank = rank;
+		}
+	    }
+
+	  if(calls == 0.0)
+	    continue;
+
+	  timerName(slot, name);
+
+	  printBothOpen("%-45s %12.0f %10.3f %10.3f %10.3f %8d\n", name, calls / (double)processes,
+			minimum, sum / (double)processes, maximum, maxRank);
+	}
+
+      {
+	char
+	  line[16 * (RANK_COLUMNS + 1)] = "";
+
+	sprintf(line, "%8s", "rank");
+
+	for(column = 0; column < RANK_COLUMNS; column++)
+	  sprintf(line + strlen(line), " %10s", rankColumnNames[column]);
+
+	printBothOpen("\nTime per process in seconds, by group of timers:\n\n%s\n", line);
+
+	for(rank = 0; rank < processes; rank++)
+	  {
+	    double
+	      columns[RANK_COLUMNS];
+
+	    memset(columns, 0, sizeof(columns));
+
+	    for(slot = 0; slot < TIMER_SLOTS; slot++)
+	      columns[rankColumn(slot)] += all[rank * RECORD_LENGTH + slot];
+
+	    sprintf(line, "%8d", rank);
+
+	    for(column = 0; column < RANK_COLUMNS; column++)
+	      sprintf(line + strlen(line), " %10.3f", columns[column]);
+
+	    printBothOpen("%s\n", line);
+	  }
+      }
+
+      printBothOpen("\n");
+
+      if(countersRequested)
+	printCounterReport(all);
+
+      free(all);
+    }
+}
@@ -221,6 +221,7 @@ static topol  *setupTopol (int maxtips)
       tpl->nextnode    = 0;    
       tpl->scrNum      = 0;     /* position in sorted list of scores */
       tpl->tplNum      = 0;     /* position in sorted list of trees */	      
+      tpl->siteLikelihoods = (double *) NULL;
     }
   
   return  tpl;
@@ -230,6 +231,7 @@ static topol  *setupTopol (int maxtips)
 static void  freeTopol (topol *tpl)
 {
   free(tpl->links);
+  free(tpl->siteLikelihoods);
   free(tpl);
 } 
 
@@ -0,0 +1,380 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <assert.h>
+
+#include <mpi.h>
+
+#ifdef _USE_OMP
+#include <omp.h>
+#endif
+
+#include "axml.h"
+
+extern int processID;
+extern int processes;
+extern MPI_Comm comm;
+extern char workdir[1024];
+extern char run_id[128];
+
+
+/*
+   Event tracer (--trace=numberOfEvents).
+
+   Every process records the begin and duration of the traversal batches (one call of
+   newviewTraversal(), i.e., all entries of a traversal descriptor), of evaluateIterative(),
+   makenewzIterative(), execCore(), the checkpoint writes, and of all MPI collectives
+   into a ring buffer of numberOfEvents entries (24 bytes each). Once the buffer is full,
+   the oldest events are overwritten.
+
+   The MPI collectives are recorded by wrappers that call the PMPI profiling interface,
+   such that no call site needs to be changed. The wrappers only cover the collectives
+   that ExaML uses.
+
+   At the end of the run writeTrace() writes the events of all processes to a single file
+   ExaML_trace.runID in the Chrome trace event format (JSON), which can be opened in
+   chrome://tracing or ui.perfetto.dev. Every process is shown as a separate row (pid = rank),
+   such that waiting times in the collectives become visible as long MPI events on the processes
+   that arrive early. The processes append their events in turn, passing a token from rank to rank.
+
+   The time stamps are taken with clock_gettime(CLOCK_MONOTONIC) relative to the end of a
+   barrier in initTrace(), hence the clocks of the processes agree up to the time it takes to
+   leave the barrier (usually a few microseconds). Under OpenMP only the master thread records events.
+*/
+
+#if MPI_VERSION >= 3
+#define MPI_CONST const
+#else
+#define MPI_CONST
+#endif
+
+/* the MPI collectives follow the events of axml.h */
+
+#define TRACE_MPI_ALLREDUCE   (TRACE_CHECKPOINT + 1)
+#define TRACE_MPI_REDUCE      (TRACE_CHECKPOINT + 2)
+#define TRACE_MPI_BCAST       (TRACE_CHECKPOINT + 3)
+#define TRACE_MPI_BARRIER     (TRACE_CHECKPOINT + 4)
+#define TRACE_MPI_GATHER      (TRACE_CHECKPOINT + 5)
+#define TRACE_MPI_GATHERV     (TRACE_CHECKPOINT + 6)
+#define TRACE_MPI_ALLGATHER   (TRACE_CHECKPOINT + 7)
+#define TRACE_MPI_SCATTERV    (TRACE_CHECKPOINT + 8)
+#define NUM_TRACE_EVENTS      (TRACE_CHECKPOINT + 9)
+
+#define TRACE_TOKEN_TAG       4711
+
+typedef struct
+{
+  uint64_t
+    start,		/* nanoseconds since the origin */
+    duration;		/* nanoseconds */
+
+  uint32_t
+    type,
+    argument;
+} traceEvent;
+
+static traceEvent
+  *ring = (traceEvent *)NULL;
+
+static size_t
+  ringSize = 0,
+  recorded = 0;		/* all events so far, the ring holds the last ringSize ones */
+
+static double
+  origin = 0.0;
+
+static const char
+  *eventNames[NUM_TRACE_EVENTS] = {"newview", "evaluate", "makenewz", "execCore", "checkpoint",
+				   "MPI_Allreduce", "MPI_Reduce", "MPI_Bcast", "MPI_Barrier", "MPI_Gather",
+				   "MPI_Gatherv", "MPI_Allgather", "MPI_Scatterv"},
+  *argumentNames[NUM_TRACE_EVENTS] = {"entries", "", "", "", "",
+				      "bytes", "bytes", "bytes", "", "bytes",
+				      "bytes", "bytes", "bytes"};
+
+
+static double now(void)
+{
+  struct timespec
+    t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+
+  return (double)t.tv_sec + (double)t.tv_nsec * 1.0e-9;
+}
+
+static boolean isRecording(void)
+{
+  if(!ring)
+    return FALSE;
+
+#ifdef _USE_OMP
+  if(omp_get_thread_num() != 0)
+    return FALSE;
+#endif
+
+  return TRUE;
+}
+
+/* allocates the ring buffer for tr->traceEvents events, must be called by all processes */
+void initTrace(tree *tr)
+{
+  if(tr->traceEvents == 0)
+    return;
+
+  ring = (traceEvent *)malloc(sizeof(traceEvent) * tr->traceEvents);
+
+  if(!ring)
+    {
+      printf("\nError, process %d could not allocate the trace buffer for %lu events\n\n", processID, (unsigned long)tr->traceEvents);
+      errorExit(-1);
+    }
+
+  ringSize = tr->traceEvents;
+  recorded = 0;
+
+  PMPI_Barrier(comm);
+
+  origin = now();
+}
+
+/* returns the start time for traceEnd(), 0.0 if the tracer is disabled */
+double traceBegin(void)
+{
+  if(!isRecording())
+    return 0.0;
+
+  return now();
+}
+
+void traceEnd(int type, double start, size_t argument)
+{
+  traceEvent
+    *e;
+
+  double
+    end;
+
+  if(!isRecording())
+    return;
+
+  end = now();
+
+  assert(type >= 0 && type < NUM_TRACE_EVENTS);
+
+  e = &ring[recorded % ringSize];
+
+  e->start = (uint64_t)((start - origin) * 1.0e9);
+  e->duration = (uint64_t)((end - start) * 1.0e9);
+  e->type = (uint32_t)type;
+  e->argument = (uint32_t)MIN(argument, (size_t)UINT32_MAX);
+
+  recorded++;
+}
+
+static size_t typeBytes(MPI_Datatype type, int count)
+{
+  int
+    size;
+
+  PMPI_Type_size(type, &size);
+
+  return (size_t)size * (size_t)count;
+}
+
+/**
+   writes the events of all processes to ExaML_trace.runID and releases the buffer,
+   must be called by all processes.
+ */
+void writeTrace(void)
+{
+  char
+    fileName[1024];
+
+  FILE
+    *f;
+
+  size_t
+    i,
+    first = (recorded > ringSize) ? recorded - ringSize : 0;
+
+  int
+    token = 0,
+    overwritten = (recorded > ringSize) ? 1 : 0,
+    processesOverwritten = 0;
+
+  if(!ring)
+    return;
+
+  strcpy(fileName, workdir);
+  strcat(fileName, "ExaML_trace.");
+  strcat(fileName, run_id);
+
+  /* the processes append their events in turn */
+
+  if(processID > 0)
+    PMPI_Recv(&token, 1, MPI_INT, processID - 1, TRACE_TOKEN_TAG, comm, MPI_STATUS_IGNORE);
+
+  f = myfopen(fileName, (processID == 0) ? "wb" : "ab");
+
+  if(processID == 0)
+    fprintf(f, "{\"traceEvents\":[\n");
+
+  fprintf(f, "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"rank %d\"}}",
+	  (processID == 0) ? "" : ",\n", processID, processID);
+
+  for(i = first; i < recorded; i++)
+    {
+      traceEvent
+	*e = &ring[i % ringSize];
+
+      fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f",
+	      eventNames[e->type], (e->type > TRACE_CHECKPOINT) ? "mpi" : "examl", processID,
+	      (double)e->start * 1.0e-3, (double)e->duration * 1.0e-3);
+
+      if(argumentNames[e->type][0] != '\0')
+	fprintf(f, ",\"args\":{\"%s\":%u}", argumentNames[e->type], (unsigned int)e->argument);
+
+      fprintf(f, "}");
+    }
+
+  if(processID == processes - 1)
+    fprintf(f, "\n]}\n");
+
+  fclose(f);
+
+  if(processID < processes - 1)
+    PMPI_Send(&token, 1, MPI_INT, processID + 1, TRACE_TOKEN_TAG, comm);
+
+  PMPI_Reduce(&overwritten, &processesOverwritten, 1, MPI_INT, MPI_SUM, 0, comm);
+
+  printBothOpen("\nEvent trace written to file %s", fileName);
+
+  if(processesOverwritten > 0)
+    printBothOpen(", %d processes recorded more than %lu events and only kept the most recent ones", processesOverwritten, (unsigned long)ringSize);
+
+  printBothOpen("\n");
+
+  free(ring);
+  ring = (traceEvent *)NULL;
+}
+
+
+/* wrappers of the MPI collectives used by ExaML, see the profiling interface of the MPI standard */
+
+int MPI_Allreduce(MPI_CONST void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm communicator)
+{
+  double
+    start = traceBegin();
+
+  int
+    result = PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, communicator);
+
+  if(ring)
+    traceEnd(TRACE_MPI_ALLREDUCE, start, typeBytes(datatype, count));
+
+  return result;
+}
+
+int MPI_Reduce(MPI_CONST void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm communicator)
+{
+  double
+    start = traceBegin();
+
+  int
+    result = PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, communicator);
+
+  if(ring)
+    traceEnd(TRACE_MPI_REDUCE, start, typeBytes(datatype, count));
+
+  return result;
+}
+
+int MPI_Bcast(void *buffer, int count, MPI_Datatype datatype, int root, MPI_Comm communicator)
+{
+  double
+    start = traceBegin();
+
+  int
+    result = PMPI_Bcast(buffer, count, datatype, root, communicator);
+
+  if(ring)
+    traceEnd(TRACE_MPI_BCAST, start, typeBytes(datatype, count));
+
+  return result;
+}
+
+int MPI_Barrier(MPI_Comm communicator)
+{
+  double
+    start = traceBegin();
+
+  int
+    result = PMPI_Barrier(communicator);
+
+  if(ring)
+    traceEnd(TRACE_MPI_BARRIER, start, 0);
+
+  return result;
+}
+
+int MPI_Gather(MPI_CONST void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf, int recvcount, MPI_Datatype recvtype,
+	       int root, MPI_Comm communicator)
+{
+  double
+    start = traceBegin();
+
+  int
+    result = PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, communicator);
+
+  if(ring)
+    traceEnd(TRACE_MPI_GATHER, start, typeBytes(sendtype, sendcount));
+
+  return result;
+}
+
+int MPI_Gatherv(MPI_CONST void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf, MPI_CONST int *recvcounts,
+		MPI_CONST int *displs, MPI_Datatype recvtype, int root, MPI_Comm communicator)
+{
+  double
+    start = traceBegin();
+
+  int
+    result = PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, communicator);
+
+  if(ring)
+    traceEnd(TRACE_MPI_GATHERV, start, typeBytes(sendtype, sendcount));
+
+  return result;
+}
+
+int MPI_Allgather(MPI_CONST void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf, int recvcount, MPI_Datatype recvtype,
+		  MPI_Comm communicator)
+{
+  double
+    start = traceBegin();
+
+  int
+    result = PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, communicator);
+
+  if(ring)
+    traceEnd(TRACE_MPI_ALLGATHER, start, typeBytes(sendtype, sendcount));
+
+  return result;
+}
+
+int MPI_Scatterv(MPI_CONST void *sendbuf, MPI_CONST int *sendcounts, MPI_CONST int *displs, MPI_Datatype sendtype, void *recvbuf,
+		 int recvcount, MPI_Datatype recvtype, int root, MPI_Comm communicator)
+{
+  double
+    start = traceBegin();
+
+  int
+    result = PMPI_Scatterv(sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root, communicator);
+
+  if(ring)
+    traceEnd(TRACE_MPI_SCATTERV, start, typeBytes(recvtype, recvcount));
+
+  return result;
+}
@@ -281,7 +281,14 @@ static char *Tree2StringREC(char *treestr, tree *tr, nodeptr p, boolean printBra
 	  if(( !isTip(p->number, tr->mxtips)) && 
 	     ( !isTip(p->back->number, tr->mxtips)))
 	    {	
-	      assert(0);
+	      if(rellTree)
+		{
+		  /* the supports are stored at the lower (inner) node of the branch */
+		  assert(tr->bInf != (branchInfo *)NULL);
+		  sprintf(treestr, "%d:%8.20f", tr->bInf[p->number - tr->mxtips - 1].support, getBranchLength(tr, perGene, p));
+		}
+	      else
+		assert(0);
 		      
 	      /*assert(p->bInf != (branchInfo *)NULL);*/
 	      
@@ -296,7 +303,9 @@ static char *Tree2StringREC(char *treestr, tree *tr, nodeptr p, boolean printBra
 	    }
 	  else		
 	    {
-	      if(rellTree || branchLabelSupport)
+	      if(rellTree)
+		sprintf(treestr, ":%8.20f", getBranchLength(tr, perGene, p));
+	      if(branchLabelSupport)
 		sprintf(treestr, ":%8.20f", p->z[0]);	
 	      if(printSHSupport)
 		sprintf(treestr, ":%8.20f", getBranchLength(tr, perGene, p));
@@ -1161,11 +1170,52 @@ boolean treeReadLenMULT (FILE *fp, tree *tr, int *partCount)
 }
 
 
+/* counts the trees in a file by their terminating semicolons and rewinds the file */
+static int countTrees(FILE *f)
+{
+  int 
+    ch,
+    count = 0;
+
+  while((ch = fgetc(f)) != EOF)
+    if(ch == ';')
+      count++;
+
+  rewind(f);
+
+  return count;
+}
+
+/* positions the file after the n-th tree */
+static void skipTrees(FILE *f, int n)
+{
+  int 
+    ch;
+
+  while(n > 0 && (ch = fgetc(f)) != EOF)
+    if(ch == ';')
+      n--;
+}
+
 void getStartingTree(tree *tr)
 {
   FILE *treeFile = myfopen(tree_file, "rb");
 
   tr->likelihood = unlikely;
+
+  /* independent search groups start from different trees if the file contains more than one */
+
+  if(tr->numberOfGroups > 1)
+    {
+      int 
+	numberOfTrees = countTrees(treeFile);
+
+      if(numberOfTrees > 0)
+	{
+	  skipTrees(treeFile, tr->groupID % numberOfTrees);
+	  printBothOpen("\nSearch group %d starts from tree %d of %d in file %s\n", tr->groupID, tr->groupID % numberOfTrees + 1, numberOfTrees, tree_file);
+	}
+    }
    
   if(tr->constraintTree)
     {
@@ -1182,5 +1232,105 @@ void getStartingTree(tree *tr)
   tr->start = tr->nodep[1];
 }
 
+/* appends the branches of the subtree p, without the branch (p, p->back) */
+static void collectBranches(tree *tr, nodeptr p, nodeptr *branches, int *count)
+{
+  if(!isTip(p->number, tr->mxtips))
+    {
+      nodeptr 
+	q;
+
+      for(q = p->next; q != p; q = q->next)
+	{
+	  branches[(*count)++] = q;
+	  collectBranches(tr, q->back, branches, count);
+	}
+    }
+}
+
+/* prunes a random subtree and re-inserts it into a random other branch, the modified branches get the default length */
+static void randomSPR(tree *tr, long *seed, nodeptr *branches)
+{
+  nodeptr
+    p = tr->nodep[tr->mxtips + 1 + (int)(randum(seed) * (double)(tr->mxtips - 2))],
+    p1,
+    p2,
+    q,
+    r;
+
+  int
+    count = 0,
+    i;
+
+  for(i = (int)(randum(seed) * 3.0); i > 0; i--)
+    p = p->next;
+
+  /* the subtree p->back is pruned */
+
+  p1 = p->next->back;
+  p2 = p->next->next->back;
+  hookupDefault(p1, p2, tr->numBranches);
+
+  collectBranches(tr, p1, branches, &count);
+  collectBranches(tr, p2, branches, &count);
+
+  if(count == 0)
+    {
+      hookupDefault(p->next, p1, tr->numBranches);
+      hookupDefault(p->next->next, p2, tr->numBranches);
+      return;
+    }
+
+  q = branches[MIN((int)(randum(seed) * (double)count), count - 1)];
+  r = q->back;
+
+  hookupDefault(p->next, q, tr->numBranches);
+  hookupDefault(p->next->next, r, tr->numBranches);
+}
+
+/**
+   With independent search groups (--groups), the groups that start from the same tree as a
+   group before them, because the starting tree file holds fewer trees than there are groups, 
+   apply random SPR moves to their starting tree, using the random number seed of the group.
+   Otherwise these groups would repeat the same deterministic search.
+ */
+void perturbStartingTree(tree *tr)
+{
+  FILE 
+    *treeFile;
+
+  int 
+    numberOfTrees,
+    moves = (tr->mxtips + 9) / 10,
+    i;
+
+  long
+    seed = (long)tr->randomSeed;
+
+  nodeptr
+    *branches;
+
+  if(tr->numberOfGroups < 2 || tr->constraintTree || tr->mxtips < 5)
+    return;
+
+  treeFile = myfopen(tree_file, "rb");
+  numberOfTrees = countTrees(treeFile);
+  fclose(treeFile);
+
+  if(tr->groupID < numberOfTrees)
+    return;
+
+  branches = (nodeptr *)malloc(sizeof(nodeptr) * 2 * (size_t)tr->mxtips);
+
+  for(i = 0; i < moves; i++)
+    randomSPR(tr, &seed, branches);
+
+  free(branches);
+
+  tr->start = tr->nodep[1];
+
+  printBothOpen("Search group %d applies %d random SPR moves to its starting tree (random number seed %u)\n", tr->groupID, moves, tr->randomSeed);
+}
+
 
 